@@ -37,10 +37,13 @@
 struct DatabaseJob {
     enum Type {
         PutThumbnail,
-        GetThumbnail
+        GetThumbnail,
+        PutValue,
+        GetValue
     } type;
 
     QImage image;
+    QByteArray value;
     QString hash;
     bool result;
     bool completed;
@@ -82,6 +85,20 @@ bool Database::upgradeVersion1()
     return success;
 }
 
+bool Database::upgradeVersion2()
+{
+    bool success = false;
+    QSqlQuery query;
+    if (query.exec("CREATE TABLE cache (key TEXT PRIMARY KEY NOT NULL, accessed DATETIME NOT NULL, value BLOB);")) {
+        success = query.exec("UPDATE version SET version = 2;");
+        if (!success)
+            LOG_ERROR() << query.lastError();
+    } else {
+        LOG_ERROR() << "Failed to create cache table.";
+    }
+    return success;
+}
+
 void Database::doJob(DatabaseJob * job)
 {
     Q_ASSERT(job);
@@ -120,8 +137,31 @@ void Database::doJob(DatabaseJob * job)
                 LOG_ERROR() << update.lastError();
         }
         job->image = result;
+    } else if (job->type == DatabaseJob::PutValue) {
+        QSqlQuery query;
+        query.prepare("INSERT OR REPLACE INTO cache VALUES (:key, datetime('now'), :value);");
+        query.bindValue(":key", job->hash);
+        query.bindValue(":value", job->value);
+        job->result = query.exec();
+        if (!job->result)
+            LOG_ERROR() << query.lastError();
+    } else if (job->type == DatabaseJob::GetValue) {
+        QSqlQuery query;
+        query.prepare("SELECT value FROM cache WHERE key = :key;");
+        query.bindValue(":key", job->hash);
+        if (query.exec() && query.first()) {
+            job->value = query.value(0).toByteArray();
+            QSqlQuery update;
+            update.prepare("UPDATE cache SET accessed = datetime('now') WHERE key = :key ;");
+            update.bindValue(":key", job->hash);
+            if (!update.exec())
+                LOG_ERROR() << update.lastError();
+        }
     }
-    deleteOldThumbnails();
+    if (job->type == DatabaseJob::PutValue)
+        deleteOldValues();
+    else if (job->type == DatabaseJob::PutThumbnail || job->type == DatabaseJob::GetThumbnail)
+        deleteOldThumbnails();
     job->completed = true;
 }
 
@@ -165,6 +205,25 @@ QImage Database::getThumbnail(const QString &hash)
     return job.image;
 }
 
+bool Database::putValue(const QString& key, const QByteArray& value)
+{
+    DatabaseJob job;
+    job.type = DatabaseJob::PutValue;
+    job.hash = key;
+    job.value = value;
+    submitAndWaitForJob(&job);
+    return job.result;
+}
+
+QByteArray Database::getValue(const QString& key)
+{
+    DatabaseJob job;
+    job.type = DatabaseJob::GetValue;
+    job.hash = key;
+    submitAndWaitForJob(&job);
+    return job.value;
+}
+
 void Database::shutdown()
 {
     requestInterruption();
@@ -183,6 +242,13 @@ void Database::deleteOldThumbnails()
         LOG_ERROR() << query.lastError();
 }
 
+void Database::deleteOldValues()
+{
+    QSqlQuery query;
+    if (!query.exec("DELETE FROM cache WHERE key IN (SELECT key FROM cache ORDER BY accessed DESC LIMIT -1 OFFSET 10000);"))
+        LOG_ERROR() << query.lastError();
+}
+
 void Database::run()
 {
 //    connect(&MAIN, SIGNAL(aboutToShutDown()),
@@ -217,6 +283,8 @@ void Database::run()
     }
     if (version < 1 && upgradeVersion1())
         version = 1;
+    if (version < 2 && upgradeVersion2())
+        version = 2;
     LOG_DEBUG() << "Database version is" << version;
 
     while (true) {
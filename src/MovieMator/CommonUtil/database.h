@@ -40,8 +40,12 @@ public:
     static Database& singleton(QWidget* parent = nullptr);
 
     bool upgradeVersion1();
+    bool upgradeVersion2();
     bool putThumbnail(const QString& hash, const QImage& image);
     QImage getThumbnail(const QString& hash);
+    //缓存分析结果等小块数据，和缩略图一样按最近访问时间淘汰
+    bool putValue(const QString& key, const QByteArray& value);
+    QByteArray getValue(const QString& key);
     void shutdown();
 
 private slots:
@@ -54,6 +58,7 @@ private:
     void doJob(DatabaseJob * job);
     void submitAndWaitForJob(DatabaseJob * job);
     void deleteOldThumbnails();
+    void deleteOldValues();
     void run();
 
     QList<DatabaseJob*> m_jobs;
@@ -172,6 +172,28 @@ void ShotcutSettings::setEncodePath(const QString& s)
     settings.setValue("encode/path", s);
 }
 
+// 0 means derive the limit from the core count and each task's thread usage.
+int ShotcutSettings::encodeConcurrentTasks() const
+{
+    return settings.value("encode/concurrentTasks", 0).toInt();
+}
+
+void ShotcutSettings::setEncodeConcurrentTasks(int n)
+{
+    settings.setValue("encode/concurrentTasks", n);
+}
+
+// 0 means derive the limit from the core count and each job's thread usage.
+int ShotcutSettings::jobsConcurrentJobs() const
+{
+    return settings.value("jobs/concurrentJobs", 0).toInt();
+}
+
+void ShotcutSettings::setJobsConcurrentJobs(int n)
+{
+    settings.setValue("jobs/concurrentJobs", n);
+}
+
 bool ShotcutSettings::meltedEnabled() const
 {
     return settings.value("melted/enabled", false).toBool();
@@ -304,6 +326,58 @@ void ShotcutSettings::setPlayerRealtime(bool b)
     settings.setValue("player/realtime", b);
 }
 
+bool ShotcutSettings::playerPreviewStats() const
+{
+    return settings.value("player/previewStats", false).toBool();
+}
+
+void ShotcutSettings::setPlayerPreviewStats(bool b)
+{
+    settings.setValue("player/previewStats", b);
+}
+
+bool ShotcutSettings::playerFrameCache() const
+{
+    return settings.value("player/frameCache", true).toBool();
+}
+
+void ShotcutSettings::setPlayerFrameCache(bool b)
+{
+    settings.setValue("player/frameCache", b);
+}
+
+// 预览帧缓存上限，单位 MB
+int ShotcutSettings::playerFrameCacheSize() const
+{
+    return settings.value("player/frameCacheSize", 256).toInt();
+}
+
+void ShotcutSettings::setPlayerFrameCacheSize(int megabytes)
+{
+    settings.setValue("player/frameCacheSize", megabytes);
+}
+
+// 预渲染文件目录的大小上限，单位 MB
+int ShotcutSettings::previewRenderCacheSize() const
+{
+    return settings.value("player/previewRenderCacheSize", 4096).toInt();
+}
+
+void ShotcutSettings::setPreviewRenderCacheSize(int megabytes)
+{
+    settings.setValue("player/previewRenderCacheSize", megabytes);
+}
+
+bool ShotcutSettings::proxyEnabled() const
+{
+    return settings.value("proxy/enabled", true).toBool();
+}
+
+void ShotcutSettings::setProxyEnabled(bool b)
+{
+    settings.setValue("proxy/enabled", b);
+}
+
 bool ShotcutSettings::playerScrubAudio() const
 {
     return settings.value("player/scrubAudio", true).toBool();
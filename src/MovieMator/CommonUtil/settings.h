@@ -77,6 +77,10 @@ public:
 
     QString encodePath() const;
     void setEncodePath(const QString&);
+    int encodeConcurrentTasks() const;
+    void setEncodeConcurrentTasks(int);
+    int jobsConcurrentJobs() const;
+    void setJobsConcurrentJobs(int);
 
     bool meltedEnabled() const;
     void setMeltedEnabled(bool);
@@ -105,6 +109,16 @@ public:
     void setPlayerProgressive(bool);
     bool playerRealtime() const;
     void setPlayerRealtime(bool);
+    bool playerPreviewStats() const;
+    void setPlayerPreviewStats(bool);
+    bool playerFrameCache() const;
+    void setPlayerFrameCache(bool);
+    int playerFrameCacheSize() const;
+    void setPlayerFrameCacheSize(int);
+    int previewRenderCacheSize() const;
+    void setPreviewRenderCacheSize(int);
+    bool proxyEnabled() const;
+    void setProxyEnabled(bool);
     bool playerScrubAudio() const;
     void setPlayerScrubAudio(bool);
     int playerVolume() const;
@@ -48,8 +48,15 @@
 #define kShotcutDetailProperty "moviemator:detail"
 #define kShotcutHashProperty "moviemator:hash"
 #define kFilterTrackProperty "moviemator:filterTrack"
+/* 预览使用代理文件；使用中时原始文件和流序号保存在下面几项 */
+#define kProxyProperty "moviemator:proxy"
+#define kOriginalResourceProperty "moviemator:originalResource"
+#define kOriginalVideoIndexProperty "moviemator:originalVideoIndex"
+#define kOriginalAudioIndexProperty "moviemator:originalAudioIndex"
 
 #define kProducerTypeProperty "moviemator:producer_type"
+/* 响度标准化添加的音量滤镜，值为标准化的目标响度（LUFS） */
+#define kLoudnessTargetProperty "moviemator:loudnessTarget"
 
 /* Ideally all shotcut properties should begin with "shotcut:", but these
  * do not and kept for legacy reasons? */
@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += widgets qml quick opengl quickwidgets
+QT       += widgets qml quick opengl quickwidgets xml
 
 TARGET = MltController
 TEMPLATE = lib
@@ -26,6 +26,10 @@ SOURCES += \
         mltcontroller.cpp \
     glwidget.cpp \
     sharedframe.cpp \
+    previewstats.cpp \
+    framecache.cpp \
+    rangesubstitution.cpp \
+    servicesnapshot.cpp \
     qmltypes/qmlprofile.cpp
 
 HEADERS += \
@@ -33,6 +37,10 @@ HEADERS += \
         mltcontroller_global.h \ 
     glwidget.h \
     sharedframe.h \
+    previewstats.h \
+    framecache.h \
+    rangesubstitution.h \
+    servicesnapshot.h \
     transportcontrol.h \
     qmltypes/qmlprofile.h
 
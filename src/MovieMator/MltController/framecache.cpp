@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "framecache.h"
+#include "mltcontroller.h"
+#include <QScopedPointer>
+#include <Mlt.h>
+#include <Logger.h>
+
+FrameCache::FrameCache(QObject* parent)
+    : QThread(parent)
+    , m_frames(256 * 1024)
+    , m_revision(0)
+    , m_producer(nullptr)
+    , m_clone(nullptr)
+    , m_cloneRevision(-1)
+    , m_hits(0)
+    , m_misses(0)
+    , m_stopped(false)
+{
+    m_request.pending = false;
+    m_request.revision = -1;
+}
+
+FrameCache::~FrameCache()
+{
+    stop();
+    delete m_clone;
+    delete m_producer;
+}
+
+void FrameCache::stop()
+{
+    m_mutex.lock();
+    m_stopped = true;
+    m_condition.wakeAll();
+    m_mutex.unlock();
+    wait();
+}
+
+void FrameCache::setCapacity(int megabytes)
+{
+    QMutexLocker locker(&m_mutex);
+    // 缩小容量时 QCache会按最久没用到的顺序淘汰
+    m_frames.setMaxCost(qMax(megabytes, 0) * 1024);
+}
+
+void FrameCache::invalidate(int in, int out)
+{
+    QMutexLocker locker(&m_mutex);
+    m_revision++;
+    m_request.pending = false;
+    if (in <= 0 && out < 0) {
+        m_frames.clear();
+        return;
+    }
+    foreach (int position, m_frames.keys()) {
+        if (position >= in && (out < 0 || position <= out))
+            m_frames.remove(position);
+    }
+}
+
+int FrameCache::revision() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_revision;
+}
+
+bool FrameCache::lookup(int position, SharedFrame& frame)
+{
+    QMutexLocker locker(&m_mutex);
+    // object()同时把这一帧移到最近使用
+    Entry* entry = m_frames.object(position);
+    if (!entry) {
+        m_misses++;
+        return false;
+    }
+    frame = entry->frame;
+    m_hits++;
+    return true;
+}
+
+void FrameCache::lookAhead(Mlt::Producer& producer, int position, int direction, int count, int length,
+                           const RenderSettings& settings)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_frames.maxCost() || !producer.is_valid())
+        return;
+    if (!m_producer || m_producer->get_producer() != producer.get_producer()) {
+        delete m_producer;
+        m_producer = new Mlt::Producer(producer);
+    }
+    // 新的请求直接替换还没开始的请求
+    m_request.pending = true;
+    m_request.revision = m_revision;
+    m_request.position = position;
+    m_request.direction = (direction < 0)? -1 : 1;
+    m_request.count = count;
+    m_request.length = length;
+    m_request.settings = settings;
+    if (!isRunning())
+        start(QThread::LowPriority);
+    m_condition.wakeAll();
+}
+
+int FrameCache::hits() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_hits;
+}
+
+int FrameCache::misses() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_misses;
+}
+
+QString FrameCache::statsText() const
+{
+    QMutexLocker locker(&m_mutex);
+    int total = m_hits + m_misses;
+    return QString("cache %1 frames %2 MB  hits %3/%4 (%5%)")
+            .arg(m_frames.size())
+            .arg(m_frames.totalCost() / 1024)
+            .arg(m_hits).arg(total)
+            .arg(total? 100.0 * m_hits / total : 0.0, 0, 'f', 0);
+}
+
+void FrameCache::clearStats()
+{
+    QMutexLocker locker(&m_mutex);
+    m_hits = 0;
+    m_misses = 0;
+}
+
+void FrameCache::insert(int revision, int position, const SharedFrame& frame, int bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    if (revision != m_revision)
+        return;
+    Entry* entry = new Entry;
+    entry->frame = frame;
+    // 超过容量的帧 QCache直接丢弃
+    m_frames.insert(position, entry, qMax(bytes / 1024, 1));
+}
+
+bool FrameCache::contains(int revision, int position) const
+{
+    QMutexLocker locker(&m_mutex);
+    return revision == m_revision && m_frames.contains(position);
+}
+
+bool FrameCache::isCancelled(int revision) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stopped || m_request.pending || revision != m_revision;
+}
+
+// 内容变化后在本线程里重新生成克隆；预览 producer只被读取，不会被 seek
+bool FrameCache::updateClone(int revision)
+{
+    if (m_clone && m_cloneRevision == revision)
+        return true;
+    delete m_clone;
+    m_clone = nullptr;
+    m_cloneRevision = -1;
+
+    m_mutex.lock();
+    QScopedPointer<Mlt::Producer> source(m_producer? new Mlt::Producer(*m_producer) : nullptr);
+    m_mutex.unlock();
+    if (!source || !source->is_valid())
+        return false;
+
+    // 和 Controller::XML()相同的设置；素材保存为 avformat-novalidate，克隆只在取帧时才打开文件
+    Mlt::Consumer consumer(MLT.profile(), "xml", "string");
+    consumer.set("no_meta", 1);
+    consumer.set("store", "moviemator");
+    consumer.set("time_format", "clock");
+    consumer.set("root", "MovieMator");
+    consumer.connect(*source);
+    consumer.start();
+    QByteArray xml(consumer.get("string"));
+    if (xml.isEmpty() || isCancelled(revision))
+        return false;
+
+    m_clone = new Mlt::Producer(MLT.profile(), "xml-string", xml.constData());
+    if (!m_clone->is_valid()) {
+        LOG_WARNING() << "failed to create look-ahead producer";
+        delete m_clone;
+        m_clone = nullptr;
+        return false;
+    }
+    m_cloneRevision = revision;
+    return true;
+}
+
+void FrameCache::run()
+{
+    forever {
+        m_mutex.lock();
+        while (!m_stopped && !m_request.pending)
+            m_condition.wait(&m_mutex);
+        if (m_stopped) {
+            m_mutex.unlock();
+            break;
+        }
+        Request request = m_request;
+        m_request.pending = false;
+        bool playing = m_producer && !qFuzzyIsNull(m_producer->get_speed());
+        m_mutex.unlock();
+
+        // 播放时不预渲染，不和 consumer抢 CPU
+        if (playing || !updateClone(request.revision))
+            continue;
+
+        for (int i = 0; i < request.count; ++i) {
+            int position = request.position + i * request.direction;
+            if (position < 0 || position >= request.length)
+                break;
+            if (contains(request.revision, position))
+                continue;
+            if (isCancelled(request.revision))
+                break;
+
+            m_clone->seek(position);
+            QScopedPointer<Mlt::Frame> frame(m_clone->get_frame());
+            if (!frame || !frame->is_valid())
+                break;
+            // 与预览 consumer设置到帧上的参数保持一致
+            frame->set("consumer_deinterlace", request.settings.progressive);
+            frame->set("deinterlace_method", request.settings.deinterlaceMethod.toLatin1().constData());
+            frame->set("rescale.interp", request.settings.rescale.toLatin1().constData());
+            frame->set("consumer_color_trc", request.settings.colorTrc.toLatin1().constData());
+            mlt_image_format format = mlt_image_yuv420p;
+            int width = request.settings.width;
+            int height = request.settings.height;
+            if (!frame->get_image(format, width, height))
+                break;
+            SharedFrame shared(*frame);
+            insert(request.revision, position, shared, width * height * 3 / 2);
+        }
+    }
+    delete m_clone;
+    m_clone = nullptr;
+    m_cloneRevision = -1;
+}
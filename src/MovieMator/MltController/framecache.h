@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include "mltcontroller_global.h"
+#include "sharedframe.h"
+
+#include <QCache>
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+
+namespace Mlt {
+class Producer;
+}
+
+/*!
+  \class FrameCache
+  \brief Bounded RAM cache of rendered preview frames with a look-ahead thread.
+
+  \threadsafe
+
+  Frames are keyed by position. invalidate() drops the frames of the changed
+  range (or all of them) and bumps the revision, which stops the look-ahead
+  from storing frames it rendered from the old content.
+
+  The look-ahead never touches the preview producer's play head. When the
+  revision changes it serializes the preview producer on its own thread and
+  loads the XML into a private clone, then seeks and renders only that clone,
+  so it never runs get_frame concurrently with the consumer on the same
+  services. Frames are evicted in least-recently-used order by QCache, with
+  the image size in kilobytes as the cost.
+*/
+
+class MLTCONTROLLERSHARED_EXPORT FrameCache : public QThread
+{
+    Q_OBJECT
+public:
+    // 预渲染时需要和预览 consumer一致的参数
+    struct RenderSettings {
+        int width;
+        int height;
+        bool progressive;
+        QString deinterlaceMethod;
+        QString rescale;
+        QString colorTrc;
+    };
+
+    explicit FrameCache(QObject* parent = nullptr);
+    ~FrameCache();
+
+    void setCapacity(int megabytes);
+    //丢弃 [in, out]之间的帧，out为 -1表示到结尾
+    void invalidate(int in = 0, int out = -1);
+    int revision() const;
+
+    bool lookup(int position, SharedFrame& frame);
+    //从 position开始沿 direction（1或 -1）方向预渲染 count帧
+    void lookAhead(Mlt::Producer& producer, int position, int direction, int count, int length,
+                   const RenderSettings& settings);
+
+    int hits() const;
+    int misses() const;
+    QString statsText() const;
+    void clearStats();
+    void stop();
+
+protected:
+    void run();
+
+private:
+    struct Entry {
+        SharedFrame frame;
+    };
+
+    struct Request {
+        bool pending;
+        int revision;
+        int position;
+        int direction;
+        int count;
+        int length;
+        RenderSettings settings;
+    };
+
+    void insert(int revision, int position, const SharedFrame& frame, int bytes);
+    bool contains(int revision, int position) const;
+    bool isCancelled(int revision) const;
+    bool updateClone(int revision);
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_condition;
+    QCache<int, Entry> m_frames;    // 只保存当前版本的帧，cost为 KB
+    Request m_request;
+    int m_revision;
+    Mlt::Producer* m_producer;      // 预览 consumer正在用的 producer，只用来生成克隆
+    Mlt::Producer* m_clone;         // 预渲染线程自己的 producer，只在预渲染线程里使用
+    int m_cloneRevision;
+    int m_hits;
+    int m_misses;
+    bool m_stopped;
+};
+
+#endif // FRAMECACHE_H
@@ -24,6 +24,8 @@
 
 #include <QtWidgets>
 #include <QOpenGLFunctions_3_2_Core>
+#include <QOpenGLExtraFunctions>
+#include <QElapsedTimer>
 #include <QUrl>
 #include <QOffscreenSurface>
 #include <QtQml>
@@ -77,6 +79,9 @@ GLWidget::GLWidget(QObject *parent)
     , m_zoom(0.0f)
     , m_offset(QPoint(0, 0))
     , m_shareContext(nullptr)
+    , m_textureFence(nullptr)
+    , m_lastSeekPosition(-1)
+    , m_cachedPosition(-1)
 {
     LOG_DEBUG() << "begin";
     m_texture[0] = m_texture[1] = m_texture[2] = 0;
@@ -115,6 +120,7 @@ GLWidget::~GLWidget()
 {
     LOG_DEBUG() << "begin";
     stop();
+    m_frameCache.stop();
     delete m_glslManager;
     delete m_threadStartEvent;
     delete m_threadStopEvent;
@@ -182,7 +188,7 @@ void GLWidget::initializeGL()
         m_shareContext->setShareContext(quickWindow()->openglContext());
         m_shareContext->create();
     }
-    m_frameRenderer = new FrameRenderer(quickWindow()->openglContext(), &m_offscreenSurface);
+    m_frameRenderer = new FrameRenderer(quickWindow()->openglContext(), &m_offscreenSurface, &m_previewStats);
     Q_ASSERT(m_frameRenderer);
     Q_ASSERT(quickWindow()->openglContext());
     quickWindow()->openglContext()->makeCurrent(quickWindow());
@@ -385,10 +391,27 @@ void GLWidget::paintGL()
             m_mutex.unlock();
             return;
         }
+        QElapsedTimer timer;
+        timer.start();
         uploadTextures(quickWindow()->openglContext(), m_sharedFrame, m_texture);
+        if (m_frameRenderer)
+            m_frameRenderer->setUploadTime(int(timer.nsecsElapsed() / 1000));
+        m_previewStats.frameUploaded(m_sharedFrame.get_position());
         m_mutex.unlock();
     }
 
+    // 等待渲染线程的纹理上传完成，GPU端等待，不阻塞本线程
+    m_mutex.lock();
+    GLsync fence = m_textureFence;
+    m_textureFence = nullptr;
+    m_mutex.unlock();
+    if (fence) {
+        QOpenGLExtraFunctions* ef = quickWindow()->openglContext()->extraFunctions();
+        ef->glWaitSync(fence, 0, GL_TIMEOUT_IGNORED);
+        ef->glDeleteSync(fence);
+        check_error(f);
+    }
+
     if (!m_texture[0]) return;
 
     // Bind textures.
@@ -457,6 +480,7 @@ void GLWidget::paintGL()
     // Render
     glDrawArrays(GL_TRIANGLE_STRIP, 0, vertices.size());
     check_error(f);
+    m_previewStats.framePainted();
 
     // Cleanup
     m_shader->disableAttributeArray(m_vertexLocation);
@@ -620,6 +644,15 @@ int GLWidget::setProducer(Mlt::Producer* producer, bool isMulti)
 int GLWidget::reconfigure(bool isMulti)
 {
     int error = 0;
+    // 预览设置变化后重新统计，便于对比
+    m_previewStats.reset();
+    // 缓存的帧是按旧的 producer和预览设置渲染的
+    m_frameCache.invalidate();
+    m_frameCache.clearStats();
+    m_frameCache.setCapacity(Settings.playerFrameCache()? Settings.playerFrameCacheSize() : 0);
+    m_cachedPosition = -1;
+    m_lastSeekPosition = -1;
+    m_rangeSubstitution.setActiveProducer(m_producer? m_producer->get_producer() : nullptr);
 
     // use SDL for audio, OpenGL for video
     QString serviceName = property("mlt_service").toString();
@@ -648,6 +681,9 @@ int GLWidget::reconfigure(bool isMulti)
         m_threadCreateEvent = m_consumer->listen("consumer-thread-create", this, reinterpret_cast<mlt_listener>(onThreadCreate));
         delete m_threadJoinEvent;
         m_threadJoinEvent = m_consumer->listen("consumer-thread-join", this, reinterpret_cast<mlt_listener>(onThreadJoin));
+        // 预渲染区间的替换只用于 CPU预览
+        if (!m_glslManager && m_rangeSubstitution.filter())
+            m_consumer->attach(*m_rangeSubstitution.filter());
     }
     if (m_consumer->is_valid()) {
         // Connect the producer to the consumer - tell it to "run" later
@@ -757,8 +793,105 @@ void GLWidget::setOffsetY(int y)
 //    }
 //}
 
+int GLWidget::uploadTime() const
+{
+    return m_frameRenderer ? m_frameRenderer->uploadTime() : -1;
+}
+
+QString GLWidget::previewStatsText() const
+{
+    QString text = m_previewStats.summaryText();
+    if (Settings.playerFrameCache() && !Settings.playerGPU())
+        text += "\n" + m_frameCache.statsText();
+    return text;
+}
+
+void GLWidget::setFrameCacheEnabled(bool enabled)
+{
+    m_frameCache.invalidate();
+    m_frameCache.clearStats();
+    m_frameCache.setCapacity(enabled? Settings.playerFrameCacheSize() : 0);
+    m_cachedPosition = -1;
+    m_lastSeekPosition = -1;
+}
+
+void GLWidget::seek(int position)
+{
+    if (!seekCached(position))
+        Controller::seek(position);
+    emit paused();
+}
+
+void GLWidget::contentChanged(int in, int out)
+{
+    m_frameCache.invalidate(in, out);
+    m_cachedPosition = -1;
+    m_rangeSubstitution.invalidate();
+    emit contentInvalidated();
+}
+
+// 暂停时拖动播放头，缓存中有这一帧就直接显示，不经过 consumer重新渲染
+bool GLWidget::seekCached(int position)
+{
+    if (!Settings.playerFrameCache() || Settings.playerGPU() || m_glslManager)
+        return false;
+    if (!m_producer || !m_consumer || !m_frameRenderer || m_consumer->is_stopped())
+        return false;
+    if (!qFuzzyIsNull(m_producer->get_speed()))
+        return false;
+
+    int direction = (m_lastSeekPosition >= 0 && position < m_lastSeekPosition)? -1 : 1;
+    m_lastSeekPosition = position;
+
+    bool hit = false;
+    SharedFrame cached;
+    if (m_frameCache.lookup(position, cached) && m_frameRenderer->semaphore()->tryAcquire()) {
+        m_producer->seek(position);
+        m_cachedPosition = position;
+        QMetaObject::invokeMethod(m_frameRenderer, "showFrame", Qt::QueuedConnection,
+                                  Q_ARG(Mlt::Frame, cached.clone(false, true)));
+        hit = true;
+    } else {
+        m_cachedPosition = -1;
+    }
+    lookAhead(position + direction, direction);
+    return hit;
+}
+
+void GLWidget::lookAhead(int position, int direction)
+{
+    FrameCache::RenderSettings settings;
+    settings.width = profile().width();
+    settings.height = profile().height();
+    settings.progressive = profile().progressive() || property("progressive").toBool();
+    settings.deinterlaceMethod = property("deinterlace_method").toString();
+    settings.rescale = property("rescale").toString();
+    settings.colorTrc = Settings.playerGamma();
+    m_frameCache.lookAhead(*m_producer, position, direction, 25, m_producer->get_length(), settings);
+}
+
+bool GLWidget::writePreviewTrace(const QString& path) const
+{
+    QStringList comments;
+    comments << QString("profile=%1x%2 %3fps").arg(MLT.profile().width()).arg(MLT.profile().height()).arg(MLT.profile().fps());
+    comments << QString("realtime=%1").arg(MLT.realTime());
+    comments << QString("gpu=%1").arg(Settings.playerGPU());
+    comments << QString("deinterlace_method=%1").arg(property("deinterlace_method").toString());
+    comments << QString("rescale=%1").arg(property("rescale").toString());
+    return m_previewStats.writeCsv(path, comments);
+}
+
 void GLWidget::updateTexture(GLuint yName, GLuint uName, GLuint vName)
 {
+    // 直接连接，运行在 FrameRenderer线程，其 context为当前 context
+    GLsync fence = m_frameRenderer->takeDisplayFence();
+    m_mutex.lock();
+    GLsync previous = m_textureFence;
+    m_textureFence = fence;
+    m_mutex.unlock();
+    if (previous)
+        m_frameRenderer->context()->extraFunctions()->glDeleteSync(previous);
+
     m_texture[0] = yName;
     m_texture[1] = uName;
     m_texture[2] = vName;
@@ -778,8 +911,15 @@ void GLWidget::on_frame_show(mlt_consumer, void* self, mlt_frame frame_ptr)
     if (frame.get_int("rendered")) {
         GLWidget* widget = static_cast<GLWidget*>(self);
         int timeout = (widget->consumer()->get_int("real_time") > 0)? 0: 1000;
+        widget->m_previewStats.frameDelivered(frame.get_position(), frame.get_double("_speed"), widget->profile().fps());
+        // 正在显示缓存中的帧，暂停状态下 consumer渲染的帧已经过时
+        if (widget->m_cachedPosition >= 0 && qFuzzyIsNull(frame.get_double("_speed")))
+            return;
         if (widget->m_frameRenderer && widget->m_frameRenderer->semaphore()->tryAcquire(1, timeout)) {
             QMetaObject::invokeMethod(widget->m_frameRenderer, "showFrame", Qt::QueuedConnection, Q_ARG(Mlt::Frame, frame));
+        } else {
+            // FrameRenderer还在处理前面的帧
+            widget->m_previewStats.frameDropped(frame.get_position());
         }
     }
 //#if MOVIEMATOR_FREE
@@ -833,17 +973,27 @@ void RenderThread::run()
     }
 }
 
-FrameRenderer::FrameRenderer(QOpenGLContext* shareContext, QSurface* surface)
+FrameRenderer::FrameRenderer(QOpenGLContext* shareContext, QSurface* surface, PreviewStats* stats)
      : QThread(nullptr)
      , m_semaphore(3)
      , m_context(nullptr)
      , m_surface(surface)
      , m_previousMSecs(QDateTime::currentMSecsSinceEpoch())
+     , m_uploadTime(-1)
+     , m_stats(stats)
+     , m_pboSupported(-1)
+     , m_pboIndex(0)
+     , m_pboSize(0)
+     , m_displayFence(nullptr)
      , m_gl32(nullptr)
 {
     Q_ASSERT(shareContext);
     m_renderTexture[0] = m_renderTexture[1] = m_renderTexture[2] = 0;
     m_displayTexture[0] = m_displayTexture[1] = m_displayTexture[2] = 0;
+    for (int i = 0; i < PboCount; ++i) {
+        m_pbo[i] = 0;
+        m_pboFence[i] = nullptr;
+    }
     if (Settings.playerGPU() || shareContext->supportsThreadedOpenGL()) {
         m_context = new QOpenGLContext;
         Q_ASSERT(m_context);
@@ -877,6 +1027,8 @@ void FrameRenderer::showFrame(Mlt::Frame frame)
         int height = 0;
         frame.get_image(format, width, height);
         m_displayFrame = SharedFrame(frame);
+        if (m_stats)
+            m_stats->frameConverted(frame.get_position());
     }
 
     Q_ASSERT(m_surface->surfaceHandle());
@@ -885,6 +1037,8 @@ void FrameRenderer::showFrame(Mlt::Frame frame)
             frame.set("movit.convert.use_texture", 1);
             mlt_image_format format = mlt_image_glsl_texture;
             const GLuint* textureId = reinterpret_cast<const GLuint*>(frame.get_image(format, width, height));
+            if (m_stats)
+                m_stats->frameConverted(frame.get_position());
 
             m_context->makeCurrent(m_surface);
 #ifdef USE_GL_SYNC
@@ -911,6 +1065,8 @@ void FrameRenderer::showFrame(Mlt::Frame frame)
 #else
             m_context->functions()->glFinish();
 #endif // USE_GL_FENCE
+            if (m_stats)
+                m_stats->frameUploaded(frame.get_position());
             emit textureReady(*textureId);
             m_context->doneCurrent();
 
@@ -922,14 +1078,23 @@ void FrameRenderer::showFrame(Mlt::Frame frame)
             // Using a threaded OpenGL to upload textures.
             m_context->makeCurrent(m_surface);
             QOpenGLFunctions* f = m_context->functions();
-
-            uploadTextures(m_context, m_displayFrame, m_renderTexture);
-            f->glBindTexture(GL_TEXTURE_2D, 0);
-            check_error(f);
-            f->glFinish();
+            QElapsedTimer timer;
+            timer.start();
+
+            if (!uploadWithPbo()) {
+                uploadTextures(m_context, m_displayFrame, m_renderTexture);
+                m_renderTextureSize = QSize();
+                f->glBindTexture(GL_TEXTURE_2D, 0);
+                check_error(f);
+                f->glFinish();
+            }
+            m_uploadTime.storeRelease(int(timer.nsecsElapsed() / 1000));
+            if (m_stats)
+                m_stats->frameUploaded(m_displayFrame.get_position());
 
             for (int i = 0; i < 3; ++i)
                 qSwap(m_renderTexture[i], m_displayTexture[i]);
+            qSwap(m_renderTextureSize, m_displayTextureSize);
             emit textureReady(m_displayTexture[0], m_displayTexture[1], m_displayTexture[2]);
             m_context->doneCurrent();
         }
@@ -957,9 +1122,147 @@ SharedFrame FrameRenderer::getDisplayFrame()
     return m_displayFrame;
 }
 
+GLsync FrameRenderer::takeDisplayFence()
+{
+    GLsync fence = m_displayFence;
+    m_displayFence = nullptr;
+    return fence;
+}
+
+static void allocateTexture(QOpenGLFunctions* f, GLuint texture, int width, int height)
+{
+    f->glBindTexture  (GL_TEXTURE_2D, texture);
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    f->glTexImage2D   (GL_TEXTURE_2D, 0, GL_LUMINANCE, width, height, 0,
+                    GL_LUMINANCE, GL_UNSIGNED_BYTE, nullptr);
+    check_error(f);
+}
+
+// 把 m_displayFrame上传到 m_renderTexture。不支持 PBO或映射失败时返回 false，
+// 由调用者走 uploadTextures。需要 m_context为当前 context。
+bool FrameRenderer::uploadWithPbo()
+{
+    if (m_pboSupported < 0) {
+        // 持久映射(GL 4.4)在 macOS上没有，这里用 GL 3.0的 map_buffer_range加 fence实现同样的流水
+        QPair<int, int> version = m_context->format().version();
+        if (m_context->isOpenGLES())
+            m_pboSupported = version.first >= 3;
+        else
+            m_pboSupported = version >= qMakePair(3, 2)
+                    || (m_context->hasExtension("GL_ARB_pixel_buffer_object")
+                        && m_context->hasExtension("GL_ARB_map_buffer_range")
+                        && m_context->hasExtension("GL_ARB_sync"));
+        LOG_INFO() << "PBO texture upload" << (m_pboSupported ? "enabled" : "not supported");
+    }
+    if (!m_pboSupported || !m_displayFrame.is_valid())
+        return false;
+
+    QOpenGLExtraFunctions* f = m_context->extraFunctions();
+    int width = m_displayFrame.get_image_width();
+    int height = m_displayFrame.get_image_height();
+    const uint8_t* image = m_displayFrame.get_image();
+    const int planeWidth[3] = {width, width / 2, width / 2};
+    const int planeHeight[3] = {height, height / 2, height / 2};
+    const int planeOffset[3] = {0, width * height, width * height + width / 2 * height / 2};
+    const int size = width * height + 2 * (width / 2 * height / 2);
+
+    // 纹理只在尺寸变化时重新分配，之后只用 glTexSubImage2D更新内容
+    if (m_renderTextureSize != QSize(width, height)) {
+        if (m_renderTexture[0])
+            f->glDeleteTextures(3, m_renderTexture);
+        f->glGenTextures(3, m_renderTexture);
+        for (int i = 0; i < 3; ++i)
+            allocateTexture(f, m_renderTexture[i], planeWidth[i], planeHeight[i]);
+        m_renderTextureSize = QSize(width, height);
+    }
+    if (!m_pbo[0])
+        f->glGenBuffers(PboCount, m_pbo);
+    if (m_pboSize != size) {
+        for (int i = 0; i < PboCount; ++i) {
+            f->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo[i]);
+            f->glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        }
+        m_pboSize = size;
+        check_error(f);
+    }
+
+    // 环中这块 PBO上一次的传输还没完成时才需要等待
+    int index = m_pboIndex;
+    m_pboIndex = (m_pboIndex + 1) % PboCount;
+    if (m_pboFence[index]) {
+        f->glClientWaitSync(m_pboFence[index], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        f->glDeleteSync(m_pboFence[index]);
+        m_pboFence[index] = nullptr;
+    }
+
+    f->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo[index]);
+    void* buffer = f->glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!buffer) {
+        LOG_WARNING() << "glMapBufferRange failed, falling back to direct texture upload";
+        f->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        releasePbo();
+        m_pboSupported = 0;
+        return false;
+    }
+    memcpy(buffer, image, size_t(size));
+    f->glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    // 半宽的色度平面每行不一定是 4字节对齐
+    f->glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int i = 0; i < 3; ++i) {
+        f->glBindTexture(GL_TEXTURE_2D, m_renderTexture[i]);
+        f->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, planeWidth[i], planeHeight[i],
+                GL_LUMINANCE, GL_UNSIGNED_BYTE, reinterpret_cast<const GLvoid*>(quintptr(planeOffset[i])));
+    }
+    f->glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    f->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    f->glBindTexture(GL_TEXTURE_2D, 0);
+    check_error(f);
+
+    // 用 fence代替 glFinish：一个给下次复用这块 PBO时等待，一个交给 paintGL
+    m_pboFence[index] = f->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    if (m_displayFence)
+        f->glDeleteSync(m_displayFence);
+    m_displayFence = f->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    f->glFlush();
+    return true;
+}
+
+void FrameRenderer::releasePbo()
+{
+    QOpenGLExtraFunctions* f = m_context->extraFunctions();
+    for (int i = 0; i < PboCount; ++i) {
+        if (m_pboFence[i]) {
+            f->glDeleteSync(m_pboFence[i]);
+            m_pboFence[i] = nullptr;
+        }
+    }
+    if (m_displayFence) {
+        f->glDeleteSync(m_displayFence);
+        m_displayFence = nullptr;
+    }
+    if (m_pbo[0]) {
+        f->glDeleteBuffers(PboCount, m_pbo);
+        for (int i = 0; i < PboCount; ++i)
+            m_pbo[i] = 0;
+    }
+    m_pboSize = 0;
+    m_pboIndex = 0;
+}
+
 void FrameRenderer::cleanup()
 {
     LOG_DEBUG() << "begin";
+    if (m_pbo[0]) {
+        Q_ASSERT(m_context);
+        m_context->makeCurrent(m_surface);
+        releasePbo();
+        m_context->doneCurrent();
+    }
     if (m_renderTexture[0] && m_renderTexture[1] && m_renderTexture[2]) {
         Q_ASSERT(m_context);
         m_context->makeCurrent(m_surface);
@@ -970,5 +1273,6 @@ void FrameRenderer::cleanup()
         m_renderTexture[0] = m_renderTexture[1] = m_renderTexture[2] = 0;
         m_displayTexture[0] = m_displayTexture[1] = m_displayTexture[2] = 0;
     }
+    m_renderTextureSize = m_displayTextureSize = QSize();
     LOG_DEBUG() << "end";
 }
@@ -34,8 +34,13 @@
 #include <QMutex>
 #include <QThread>
 #include <QRect>
+#include <QSize>
+#include <QAtomicInt>
 #include "mltcontroller.h"
 #include "sharedframe.h"
+#include "previewstats.h"
+#include "framecache.h"
+#include "rangesubstitution.h"
 
 class QOpenGLFunctions_3_2_Core;
 class QOpenGLTexture;
@@ -56,6 +61,8 @@ class MLTCONTROLLERSHARED_EXPORT GLWidget : public QQuickWidget, public Controll
     Q_PROPERTY(QRect rect READ rect NOTIFY rectChanged)
     Q_PROPERTY(float zoom READ zoom NOTIFY zoomChanged)
     Q_PROPERTY(QPoint offset READ offset NOTIFY offsetChanged)
+    Q_PROPERTY(int uploadTime READ uploadTime)
+    Q_PROPERTY(QString previewStats READ previewStatsText)
 
 public:
     GLWidget(QObject *parent = nullptr);
@@ -68,14 +75,12 @@ public:
     int reconfigure(bool isMulti);
 
     void play(double speed = 1.0) {
+        m_cachedPosition = -1;
         Controller::play(speed);
         if (qFuzzyIsNull(speed)) emit paused();
         else emit playing();
     }
-    void seek(int position) {
-        Controller::seek(position);
-        emit paused();
-    }
+    void seek(int position);
     void pause() {
         Controller::pause();
         emit paused();
@@ -88,6 +93,15 @@ public:
     QRect rect() const { return m_rect; }
     float zoom() const { return m_zoom * MLT.profile().width() / m_rect.width(); }
     QPoint offset() const;
+    //最近一帧纹理上传耗时（微秒），-1表示还没有上传过
+    int uploadTime() const;
+    PreviewStats* previewStats() { return &m_previewStats; }
+    QString previewStatsText() const;
+    FrameCache* frameCache() { return &m_frameCache; }
+    void setFrameCacheEnabled(bool enabled);
+    RangeSubstitution* rangeSubstitution() { return &m_rangeSubstitution; }
+    //把预览各阶段的时间戳写成 CSV，文件头记录当前的预览设置
+    Q_INVOKABLE bool writePreviewTrace(const QString& path) const;
 
     void setCommonProperties(QQmlContext* context);
 
@@ -110,6 +124,8 @@ signals:
     void rectChanged();
     void zoomChanged();
     void offsetChanged();
+    //producer的内容被修改，预渲染的区间需要重新检查
+    void contentInvalidated();
 
 private:
     QRect m_rect;
@@ -136,8 +152,16 @@ private:
     QOpenGLContext* m_shareContext;
     SharedFrame m_sharedFrame;
     QMutex m_mutex;
+    GLsync m_textureFence;  //渲染线程上传纹理后插入的 fence，paintGL中等待
+    PreviewStats m_previewStats;
+    FrameCache m_frameCache;
+    int m_lastSeekPosition;
+    QAtomicInt m_cachedPosition;    //当前显示的是缓存中的这一帧，-1表示显示的是 consumer渲染的帧
+    RangeSubstitution m_rangeSubstitution;
 
     static void on_frame_show(mlt_consumer, void* self, mlt_frame frame);
+    bool seekCached(int position);
+    void lookAhead(int position, int direction);
 
 private slots:
     void initializeGL();
@@ -151,6 +175,7 @@ protected:
     void mouseMoveEvent(QMouseEvent *);
     void keyPressEvent(QKeyEvent* event);
     void createShader();
+    void contentChanged(int in, int out);
 };
 
 class RenderThread : public QThread
@@ -173,12 +198,16 @@ class FrameRenderer : public QThread
 {
     Q_OBJECT
 public:
-    FrameRenderer(QOpenGLContext* shareContext, QSurface* surface);
+    FrameRenderer(QOpenGLContext* shareContext, QSurface* surface, PreviewStats* stats = nullptr);
     ~FrameRenderer();
     QSemaphore* semaphore() { return &m_semaphore; }
     QOpenGLContext* context() const { return m_context; }
     SharedFrame getDisplayFrame();
     Q_INVOKABLE void showFrame(Mlt::Frame frame);
+    int uploadTime() const { return m_uploadTime.loadAcquire(); }
+    void setUploadTime(int usecs) { m_uploadTime.storeRelease(usecs); }
+    //取走 textureReady对应的 fence，只能在 textureReady的直接连接槽中调用
+    GLsync takeDisplayFence();
 
 public slots:
     void cleanup();
@@ -194,6 +223,21 @@ private:
     QOpenGLContext* m_context;
     QSurface* m_surface;
     qint64 m_previousMSecs;
+    QAtomicInt m_uploadTime;
+    PreviewStats* m_stats;
+
+    //CPU预览时通过 PBO环形缓冲上传纹理，纹理只在尺寸变化时重新分配
+    enum { PboCount = 3 };
+    bool uploadWithPbo();
+    void releasePbo();
+    int m_pboSupported;         //-1未检测，0不支持，1支持
+    GLuint m_pbo[PboCount];
+    GLsync m_pboFence[PboCount];
+    int m_pboIndex;
+    int m_pboSize;
+    GLsync m_displayFence;
+    QSize m_renderTextureSize;
+    QSize m_displayTextureSize;
 public:
     GLuint m_renderTexture[3];
     GLuint m_displayTexture[3];
@@ -24,6 +24,7 @@
 #include <QPalette>
 #include <QMetaType>
 #include <QFileInfo>
+#include <QDomDocument>
 #include <QUuid>
 #include <Logger.h>
 #include <Mlt.h>
@@ -59,6 +60,44 @@ Controller::Controller()
     LOG_DEBUG() << "end";
 }
 
+//无界面模式的 controller：没有视频窗口、QML和 OpenGL，也不创建 consumer，
+//只提供 profile、producer和 XML等功能
+class HeadlessController : public Controller
+{
+public:
+    QObject* videoWidget() { return nullptr; }
+    int displayWidth() const { return profile().width(); }
+    int displayHeight() const { return profile().height(); }
+    void setCommonProperties(QQmlContext*) {}
+    void play(double speed)
+    {
+        if (m_producer)
+            m_producer->set_speed(speed);
+    }
+    void pause()
+    {
+        if (m_producer)
+            m_producer->set_speed(0);
+    }
+    void seek(int position)
+    {
+        if (m_producer)
+            m_producer->seek(position);
+    }
+
+protected:
+    int reconfigure(bool) { return 0; }
+};
+
+void Controller::createHeadless()
+{
+    if (!instance) {
+        qRegisterMetaType<Mlt::Frame>("Mlt::Frame");
+        qRegisterMetaType<SharedFrame>("SharedFrame");
+        instance = new HeadlessController;
+    }
+}
+
 Controller& Controller::singleton(QObject *parent)
 {
     if (!instance) {
@@ -254,7 +293,7 @@ void Controller::play(double speed)
                 m_consumer->stop();
         }
         m_consumer->start();
-        refreshConsumer(Settings.playerScrubAudio());
+        refreshPosition(Settings.playerScrubAudio());
     }
     if (m_jackFilter)
         m_jackFilter->fire_event("jack-start");
@@ -310,7 +349,7 @@ void Controller::onJackStarted(int position)
     if (m_producer) {
         m_producer->set_speed(1);
         m_producer->seek(position);
-        refreshConsumer();
+        refreshPosition();
     }
 }
 
@@ -335,7 +374,7 @@ void Controller::onJackStopped(int position)
     }
     if (m_consumer && m_consumer->get_int("real_time") >= -1)
         m_consumer->purge();
-    refreshConsumer();
+    refreshPosition();
 }
 
 bool Controller::enableJack(bool enable)
@@ -397,7 +436,7 @@ double Controller::volume() const
 
 void Controller::onWindowResize()
 {
-    refreshConsumer();
+    refreshPosition();
 }
 
 void Controller::seek(int position)
@@ -420,7 +459,7 @@ void Controller::seek(int position)
                 m_consumer->start();
             } else {
                 m_consumer->purge();
-                refreshConsumer(Settings.playerScrubAudio());
+                refreshPosition(Settings.playerScrubAudio());
             }
         }
     }
@@ -430,6 +469,19 @@ void Controller::seek(int position)
 }
 
 void Controller::refreshConsumer(bool scrubAudio)
+{
+    // 外部调用刷新都是因为内容被修改了，不知道范围时按全部处理
+    contentChanged(0, -1);
+    refreshPosition(scrubAudio);
+}
+
+void Controller::refreshRange(int in, int out, bool scrubAudio)
+{
+    contentChanged(in, out);
+    refreshPosition(scrubAudio);
+}
+
+void Controller::refreshPosition(bool scrubAudio)
 {
     LOG_DEBUG() << "begin";
     if (m_consumer) {
@@ -479,10 +531,66 @@ void Controller::saveXML(const QString& filename, Service* service, bool withRel
         c.start();
         if (ignore)
             s.set("ignore_points", ignore);
+        restoreOriginalResources(filename, withRelativePaths? QFileInfo(filename).absolutePath() : QString());
     }
     LOG_DEBUG() << "end";
 }
 
+static void setPropertyText(QDomElement& property, const QString& text)
+{
+    while (property.hasChildNodes())
+        property.removeChild(property.firstChild());
+    property.appendChild(property.ownerDocument().createTextNode(text));
+}
+
+// 代理文件只用于预览，保存的工程和导出用的 XML都换回原始文件，只保留 kProxyProperty标记
+void Controller::restoreOriginalResources(const QString& filename, const QString& root)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+    QByteArray xml = file.readAll();
+    file.close();
+    if (!xml.contains(kOriginalResourceProperty))
+        return;
+    QDomDocument dom;
+    if (!dom.setContent(xml))
+        return;
+
+    QList<QDomElement> services;
+    QDomNodeList properties = dom.elementsByTagName("property");
+    for (int i = 0; i < properties.size(); ++i) {
+        QDomElement property = properties.at(i).toElement();
+        if (property.attribute("name") == kOriginalResourceProperty)
+            services << property.parentNode().toElement();
+    }
+    foreach (QDomElement service, services) {
+        QHash<QString, QDomElement> byName;
+        for (QDomElement p = service.firstChildElement("property"); !p.isNull(); p = p.nextSiblingElement("property"))
+            byName.insert(p.attribute("name"), p);
+
+        QString resource = byName.value(kOriginalResourceProperty).text();
+        if (!root.isEmpty() && resource.startsWith(root + '/'))
+            resource = resource.mid(root.size() + 1);
+        if (byName.contains("resource"))
+            setPropertyText(byName["resource"], resource);
+        if (byName.contains(kOriginalVideoIndexProperty) && byName.contains("video_index"))
+            setPropertyText(byName["video_index"], byName.value(kOriginalVideoIndexProperty).text());
+        if (byName.contains(kOriginalAudioIndexProperty) && byName.contains("audio_index"))
+            setPropertyText(byName["audio_index"], byName.value(kOriginalAudioIndexProperty).text());
+        service.removeChild(byName.value(kOriginalResourceProperty));
+        if (byName.contains(kOriginalVideoIndexProperty))
+            service.removeChild(byName.value(kOriginalVideoIndexProperty));
+        if (byName.contains(kOriginalAudioIndexProperty))
+            service.removeChild(byName.value(kOriginalAudioIndexProperty));
+    }
+
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        file.write(dom.toByteArray(2));
+        file.close();
+    }
+}
+
 QString Controller::XML(Service* service)
 {
     Q_ASSERT(m_producer);
@@ -960,7 +1068,7 @@ QString Controller::getHash(Mlt::Properties& properties) const
             resource = QString::fromUtf8(properties.get("warp_resource"));
         else if (service == "vidstab")
             resource = QString::fromUtf8(properties.get("filename"));
-        QString hash = Util::getFileHash(resource);
+        hash = Util::getFileHash(resource);
         if (!hash.isEmpty())
             properties.set(kShotcutHashProperty, hash.toLatin1().constData());
     }
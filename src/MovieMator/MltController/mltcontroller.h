@@ -60,9 +60,15 @@ class MLTCONTROLLERSHARED_EXPORT Controller
 protected:
     Controller();
     virtual int reconfigure(bool isMulti) = 0;
+    // producer在 [in, out]之间的内容（时间线、滤镜）发生变化，out为 -1表示到结尾
+    virtual void contentChanged(int /*in*/, int /*out*/) {}
+    // 只重新渲染当前位置，内容没有变化
+    void refreshPosition(bool scrubAudio = false);
 
 public:
     static Controller& singleton(QObject *parent = nullptr);
+    // 无界面模式（如 moviemator-benchmark）：创建不带视频窗口和 consumer的 controller，要在第一次调用 singleton()之前调用
+    static void createHeadless();
     virtual ~Controller();
     static void destroy();
 
@@ -84,6 +90,8 @@ public:
     void onWindowResize();
     virtual void seek(int position);
     void refreshConsumer(bool scrubAudio = false);
+    // 只有 [in, out]之间的内容被修改时用它代替 refreshConsumer()，out为 -1表示到结尾
+    void refreshRange(int in, int out, bool scrubAudio = false);
     void saveXML(const QString& filename, Service* service = nullptr, bool withRelativePaths = true);
     QString XML(Service* service = nullptr);
 
@@ -151,6 +159,8 @@ public:
 private:
     // 去除 xml内容里的 profile等信息
     QString getXMLWithoutProfile(QString &strXml);
+    // 把使用代理文件的素材换回原始文件
+    void restoreOriginalResources(const QString& filename, const QString& root);
 
 protected:
     Mlt::Repository* m_repo;
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "previewstats.h"
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+#include <Logger.h>
+
+// 保存的历史帧数（用于 CSV），约 30fps下 100秒
+static const int kHistorySize = 3000;
+// 计算百分位和帧率的滑动窗口
+static const int kWindowSize = 300;
+// 正常速度播放时位置跳跃超过该值视为 seek，不计入丢帧
+static const int kMaxGap = 30;
+// 在最近几条记录中查找同一位置的帧
+static const int kSearchDepth = 8;
+
+static double toMs(qint64 nsecs)
+{
+    return nsecs / 1000000.0;
+}
+
+static PreviewStats::Percentiles percentiles(QVector<qint64>& values)
+{
+    PreviewStats::Percentiles result = {0.0, 0.0, 0.0};
+    if (values.isEmpty())
+        return result;
+    std::sort(values.begin(), values.end());
+    int last = values.size() - 1;
+    result.p50 = toMs(values.at(last * 50 / 100));
+    result.p95 = toMs(values.at(last * 95 / 100));
+    result.p99 = toMs(values.at(last * 99 / 100));
+    return result;
+}
+
+PreviewStats::PreviewStats()
+    : m_records(kHistorySize)
+{
+    m_clock.start();
+    reset();
+}
+
+void PreviewStats::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    m_next = 0;
+    m_count = 0;
+    m_lastPosition = -1;
+    m_uploadedIndex = -1;
+    m_frameDuration = 40000000;
+    m_dropped = 0;
+    m_late = 0;
+}
+
+PreviewStats::Record* PreviewStats::find(int position)
+{
+    for (int i = 1; i <= qMin(m_count, kSearchDepth); i++) {
+        Record& record = m_records[(m_next - i + kHistorySize) % kHistorySize];
+        if (record.position == position && !record.dropped)
+            return &record;
+    }
+    return nullptr;
+}
+
+void PreviewStats::frameDelivered(int position, double speed, double fps)
+{
+    QMutexLocker locker(&m_mutex);
+    if (fps > 0.0)
+        m_frameDuration = qint64(1000000000.0 / fps);
+    //正常速度播放时位置不连续说明 consumer丢了帧
+    if (qFuzzyCompare(speed, 1.0) && m_lastPosition >= 0) {
+        int gap = position - m_lastPosition - 1;
+        if (gap > 0 && gap <= kMaxGap)
+            m_dropped += gap;
+    }
+    m_lastPosition = position;
+
+    if (m_uploadedIndex == m_next)
+        m_uploadedIndex = -1;
+    Record& record = m_records[m_next];
+    record.position = position;
+    record.delivered = m_clock.nsecsElapsed();
+    record.converted = 0;
+    record.uploaded = 0;
+    record.painted = 0;
+    record.dropped = false;
+    m_next = (m_next + 1) % kHistorySize;
+    m_count = qMin(m_count + 1, kHistorySize);
+}
+
+void PreviewStats::frameDropped(int position)
+{
+    QMutexLocker locker(&m_mutex);
+    Record* record = find(position);
+    if (record)
+        record->dropped = true;
+    m_dropped++;
+}
+
+void PreviewStats::frameConverted(int position)
+{
+    QMutexLocker locker(&m_mutex);
+    Record* record = find(position);
+    if (record)
+        record->converted = m_clock.nsecsElapsed();
+}
+
+void PreviewStats::frameUploaded(int position)
+{
+    QMutexLocker locker(&m_mutex);
+    Record* record = find(position);
+    //非线程模式下每次重绘都会重新上传同一帧
+    if (!record || record->painted)
+        return;
+    //上一帧还没画出来就被新的纹理覆盖
+    if (m_uploadedIndex >= 0) {
+        m_records[m_uploadedIndex].dropped = true;
+        m_dropped++;
+    }
+    record->uploaded = m_clock.nsecsElapsed();
+    m_uploadedIndex = int(record - m_records.data());
+}
+
+void PreviewStats::framePainted()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_uploadedIndex < 0)
+        return;
+    Record& record = m_records[m_uploadedIndex];
+    record.painted = m_clock.nsecsElapsed();
+    if (record.painted - record.delivered > m_frameDuration)
+        m_late++;
+    m_uploadedIndex = -1;
+}
+
+PreviewStats::Summary PreviewStats::summary() const
+{
+    QMutexLocker locker(&m_mutex);
+    Summary result;
+    QVector<qint64> latency, convert, upload;
+    qint64 first = 0, last = 0;
+
+    for (int i = 1; i <= qMin(m_count, kWindowSize); i++) {
+        const Record& record = m_records.at((m_next - i + kHistorySize) % kHistorySize);
+        if (record.dropped || !record.painted)
+            continue;
+        latency.append(record.painted - record.delivered);
+        if (record.converted) {
+            convert.append(record.converted - record.delivered);
+            if (record.uploaded)
+                upload.append(record.uploaded - record.converted);
+        }
+        if (!last)
+            last = record.painted;
+        first = record.painted;
+    }
+
+    result.frames = latency.size();
+    result.dropped = m_dropped;
+    result.late = m_late;
+    result.fps = (result.frames > 1 && last > first)? (result.frames - 1) * 1000000000.0 / (last - first) : 0.0;
+    result.latency = percentiles(latency);
+    result.convert = percentiles(convert);
+    result.upload = percentiles(upload);
+    return result;
+}
+
+QString PreviewStats::summaryText() const
+{
+    Summary s = summary();
+    QString text;
+    text += QString("fps %1  dropped %2  late %3\n").arg(s.fps, 0, 'f', 1).arg(s.dropped).arg(s.late);
+    text += QString("latency p50/p95/p99 %1/%2/%3 ms\n")
+            .arg(s.latency.p50, 0, 'f', 1).arg(s.latency.p95, 0, 'f', 1).arg(s.latency.p99, 0, 'f', 1);
+    text += QString("convert p50/p95/p99 %1/%2/%3 ms\n")
+            .arg(s.convert.p50, 0, 'f', 1).arg(s.convert.p95, 0, 'f', 1).arg(s.convert.p99, 0, 'f', 1);
+    text += QString("upload p50/p95/p99 %1/%2/%3 ms")
+            .arg(s.upload.p50, 0, 'f', 1).arg(s.upload.p95, 0, 'f', 1).arg(s.upload.p99, 0, 'f', 1);
+    return text;
+}
+
+bool PreviewStats::writeCsv(const QString& path, const QStringList& comments) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
+        LOG_WARNING() << "failed to write preview trace" << path;
+        return false;
+    }
+    QTextStream stream(&file);
+    foreach (const QString& comment, comments)
+        stream << "# " << comment << "\n";
+    stream << "position,delivered_ms,converted_ms,uploaded_ms,painted_ms,latency_ms,dropped\n";
+
+    QMutexLocker locker(&m_mutex);
+    for (int i = m_count; i >= 1; i--) {
+        const Record& record = m_records.at((m_next - i + kHistorySize) % kHistorySize);
+        stream << record.position << ","
+               << toMs(record.delivered) << ","
+               << (record.converted ? QString::number(toMs(record.converted)) : QString()) << ","
+               << (record.uploaded ? QString::number(toMs(record.uploaded)) : QString()) << ","
+               << (record.painted ? QString::number(toMs(record.painted)) : QString()) << ","
+               << (record.painted ? QString::number(toMs(record.painted - record.delivered)) : QString()) << ","
+               << (record.dropped ? 1 : 0) << "\n";
+    }
+    LOG_INFO() << "wrote" << m_count << "frames of preview trace to" << path;
+    return true;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PREVIEWSTATS_H
+#define PREVIEWSTATS_H
+
+#include "mltcontroller_global.h"
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/*!
+  \class PreviewStats
+  \brief Records per-frame timestamps of the preview pipeline.
+
+  \threadsafe
+
+  Each frame is stamped when the consumer delivers it (GLWidget::on_frame_show),
+  when its image has been converted (FrameRenderer::showFrame), when its
+  textures have been uploaded and when it is painted (GLWidget::paintGL).
+  Dropped and late frames are counted and rolling percentiles are computed over
+  the most recent frames. The full history can be written to a CSV trace.
+*/
+
+class MLTCONTROLLERSHARED_EXPORT PreviewStats
+{
+public:
+    struct Percentiles {
+        double p50;
+        double p95;
+        double p99;
+    };
+
+    struct Summary {
+        int frames;         // 窗口内完整显示的帧数
+        int dropped;
+        int late;
+        double fps;         // 窗口内实际显示帧率
+        Percentiles latency;    // 送达到显示
+        Percentiles convert;    // 送达到格式转换完成
+        Percentiles upload;     // 转换完成到纹理上传完成
+    };
+
+    PreviewStats();
+
+    void reset();
+    void frameDelivered(int position, double speed, double fps);
+    void frameDropped(int position);
+    void frameConverted(int position);
+    void frameUploaded(int position);
+    void framePainted();
+
+    Summary summary() const;
+    QString summaryText() const;
+    bool writeCsv(const QString& path, const QStringList& comments = QStringList()) const;
+
+private:
+    struct Record {
+        int position;
+        qint64 delivered;   // 纳秒，相对 m_clock
+        qint64 converted;
+        qint64 uploaded;
+        qint64 painted;
+        bool dropped;
+    };
+
+    Record* find(int position);
+
+    mutable QMutex m_mutex;
+    QElapsedTimer m_clock;
+    QVector<Record> m_records;  // 环形缓冲
+    int m_next;
+    int m_count;
+    int m_lastPosition;
+    int m_uploadedIndex;        // 最近上传、还未显示的帧，-1表示没有
+    qint64 m_frameDuration;     // 纳秒
+    int m_dropped;
+    int m_late;
+};
+
+#endif // PREVIEWSTATS_H
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rangesubstitution.h"
+#include "mltcontroller.h"
+#include <Mlt.h>
+#include <Logger.h>
+#include <string.h>
+
+static const char* kSourceFrameProperty = "_moviemator.preview_frame";
+static const char* kSourceProducerProperty = "_moviemator.preview_producer";
+
+RangeSubstitution::RangeSubstitution()
+    : m_filter(nullptr)
+    , m_owner(nullptr)
+    , m_active(nullptr)
+{
+    mlt_filter filter = mlt_filter_new();
+    if (filter) {
+        filter->child = this;
+        filter->process = process;
+        m_filter = new Mlt::Filter(filter);
+        mlt_filter_close(filter);
+    }
+}
+
+RangeSubstitution::~RangeSubstitution()
+{
+    clearSources();
+    if (m_filter)
+        m_filter->get_filter()->child = nullptr;
+    delete m_filter;
+}
+
+void RangeSubstitution::setActiveProducer(mlt_producer producer)
+{
+    QMutexLocker locker(&m_mutex);
+    m_active = producer;
+}
+
+void RangeSubstitution::setRanges(mlt_producer owner, const QList<Range>& ranges)
+{
+    QList<Source> sources;
+    foreach (const Range& range, ranges) {
+        Source source;
+        source.in = range.in;
+        source.out = range.out;
+        source.producer = new Mlt::Producer(MLT.profile(), range.path.toUtf8().constData());
+        if (!source.producer->is_valid()) {
+            LOG_WARNING() << "failed to open preview render" << range.path;
+            delete source.producer;
+            continue;
+        }
+        sources << source;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    clearSources();
+    m_owner = owner;
+    m_sources = sources;
+}
+
+void RangeSubstitution::invalidate()
+{
+    QMutexLocker locker(&m_mutex);
+    clearSources();
+}
+
+int RangeSubstitution::rangeCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_sources.size();
+}
+
+void RangeSubstitution::clearSources()
+{
+    // 正在使用中的帧各自持有 producer的引用
+    foreach (const Source& source, m_sources)
+        delete source.producer;
+    m_sources.clear();
+}
+
+// 在 consumer线程中调用，返回的 producer已增加引用
+mlt_producer RangeSubstitution::sourceAt(int position, int* offset)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_owner || m_owner != m_active)
+        return nullptr;
+    foreach (const Source& source, m_sources) {
+        if (position >= source.in && position <= source.out) {
+            *offset = position - source.in;
+            mlt_producer producer = source.producer->get_producer();
+            mlt_properties_inc_ref(MLT_PRODUCER_PROPERTIES(producer));
+            return producer;
+        }
+    }
+    return nullptr;
+}
+
+static int get_image(mlt_frame frame, uint8_t** image, mlt_image_format* format, int* width, int* height, int writable)
+{
+    mlt_frame source = static_cast<mlt_frame>(mlt_frame_pop_service(frame));
+    int error = mlt_frame_get_image(source, image, format, width, height, writable);
+    if (!error && *image) {
+        int size = mlt_image_format_size(*format, *width, *height, nullptr);
+        uint8_t* copy = static_cast<uint8_t*>(mlt_pool_alloc(size));
+        memcpy(copy, *image, size_t(size));
+        mlt_frame_set_image(frame, copy, size, mlt_pool_release);
+        *image = copy;
+        mlt_properties properties = MLT_FRAME_PROPERTIES(frame);
+        mlt_properties_set_double(properties, "aspect_ratio",
+                                  mlt_properties_get_double(MLT_FRAME_PROPERTIES(source), "aspect_ratio"));
+        mlt_properties_set_int(properties, "progressive", 1);
+    }
+    return error;
+}
+
+static int get_audio(mlt_frame frame, void** buffer, mlt_audio_format* format, int* frequency, int* channels, int* samples)
+{
+    mlt_frame source = static_cast<mlt_frame>(mlt_frame_pop_audio(frame));
+    int error = mlt_frame_get_audio(source, buffer, format, frequency, channels, samples);
+    if (!error && *buffer) {
+        int size = mlt_audio_format_size(*format, *samples, *channels);
+        void* copy = mlt_pool_alloc(size);
+        memcpy(copy, *buffer, size_t(size));
+        mlt_frame_set_audio(frame, copy, *format, size, mlt_pool_release);
+        *buffer = copy;
+    }
+    return error;
+}
+
+mlt_frame RangeSubstitution::process(mlt_filter filter, mlt_frame frame)
+{
+    RangeSubstitution* self = static_cast<RangeSubstitution*>(filter->child);
+    if (!self)
+        return frame;
+    int offset = 0;
+    mlt_producer producer = self->sourceAt(int(mlt_frame_get_position(frame)), &offset);
+    if (!producer)
+        return frame;
+
+    mlt_frame source = nullptr;
+    mlt_producer_seek(producer, offset);
+    if (mlt_service_get_frame(MLT_PRODUCER_SERVICE(producer), &source, 0) || !source) {
+        mlt_producer_close(producer);
+        return frame;
+    }
+    // 帧释放时才释放预渲染的帧和 producer，帧要先于 producer释放
+    mlt_properties properties = MLT_FRAME_PROPERTIES(frame);
+    mlt_properties_set_data(properties, kSourceFrameProperty, source, 0,
+                            reinterpret_cast<mlt_destructor>(mlt_frame_close), nullptr);
+    mlt_properties_set_data(properties, kSourceProducerProperty, producer, 0,
+                            reinterpret_cast<mlt_destructor>(mlt_producer_close), nullptr);
+
+    // 压在原来的 get_image/get_audio之上，原来的不会再被调用
+    mlt_frame_push_service(frame, source);
+    mlt_frame_push_get_image(frame, get_image);
+    mlt_frame_push_audio(frame, source);
+    mlt_frame_push_audio(frame, reinterpret_cast<void*>(get_audio));
+    return frame;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RANGESUBSTITUTION_H
+#define RANGESUBSTITUTION_H
+
+#include "mltcontroller_global.h"
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <framework/mlt.h>
+
+namespace Mlt {
+class Filter;
+class Producer;
+}
+
+/*!
+  \class RangeSubstitution
+  \brief Consumer filter that replaces frames of pre-rendered ranges.
+
+  \threadsafe
+
+  The filter is attached to the preview consumer. For a frame whose position
+  falls inside a published range it takes image and audio from the
+  pre-rendered file instead of the producer's own get_image/get_audio, which
+  are then never called, so the effects of that range are not computed.
+
+  Ranges belong to one producer (the timeline tractor) and only apply while
+  that producer is the one connected to the consumer. invalidate() drops all
+  ranges at once; the owner publishes them again once it has checked that
+  their content is unchanged.
+*/
+
+class MLTCONTROLLERSHARED_EXPORT RangeSubstitution
+{
+public:
+    struct Range {
+        int in;
+        int out;
+        QString path;   // 预渲染的文件，第0帧对应时间线上的 in
+    };
+
+    RangeSubstitution();
+    ~RangeSubstitution();
+
+    Mlt::Filter* filter() const { return m_filter; }
+
+    //当前连接到 consumer的 producer
+    void setActiveProducer(mlt_producer producer);
+    void setRanges(mlt_producer owner, const QList<Range>& ranges);
+    void invalidate();
+    int rangeCount() const;
+
+private:
+    struct Source {
+        int in;
+        int out;
+        Mlt::Producer* producer;
+    };
+
+    static mlt_frame process(mlt_filter filter, mlt_frame frame);
+    mlt_producer sourceAt(int position, int* offset);
+    void clearSources();
+
+    mutable QMutex m_mutex;
+    Mlt::Filter* m_filter;
+    mlt_producer m_owner;
+    mlt_producer m_active;
+    QList<Source> m_sources;
+};
+
+#endif // RANGESUBSTITUTION_H
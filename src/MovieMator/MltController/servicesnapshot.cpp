@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "servicesnapshot.h"
+#include <QList>
+#include <Mlt.h>
+
+ServiceSnapshot::ServiceSnapshot(mlt_profile profile)
+    : m_profile(profile)
+{
+}
+
+ServiceSnapshot::~ServiceSnapshot()
+{
+    foreach (mlt_producer producer, m_parents)
+        mlt_producer_close(producer);
+}
+
+Mlt::Producer* ServiceSnapshot::take(Mlt::Producer& producer)
+{
+    if (!producer.is_valid())
+        return nullptr;
+    ServiceSnapshot snapshot(mlt_service_profile(producer.get_service()));
+    mlt_producer copy = snapshot.cloneProducer(producer.get_producer());
+    if (!copy)
+        return nullptr;
+    Mlt::Producer* result = new Mlt::Producer(copy);
+    mlt_producer_close(copy);
+    return result;
+}
+
+// 隐藏属性（以 _开头）保存的是运行时数据，xml consumer也不写
+void ServiceSnapshot::copyProperties(mlt_properties from, mlt_properties to)
+{
+    int count = mlt_properties_count(from);
+    for (int i = 0; i < count; ++i) {
+        const char* name = mlt_properties_get_name(from, i);
+        if (!name || name[0] == '_')
+            continue;
+        // 按名字取值，动画属性会转成字符串
+        const char* value = mlt_properties_get(from, name);
+        if (value)
+            mlt_properties_set(to, name, value);
+    }
+}
+
+// 返回的 producer已增加引用
+mlt_producer ServiceSnapshot::cloneProducer(mlt_producer producer)
+{
+    if (!mlt_producer_is_cut(producer))
+        return cloneParent(producer);
+
+    mlt_producer parent = cloneParent(mlt_producer_cut_parent(producer));
+    if (!parent)
+        return nullptr;
+    mlt_producer cut = mlt_producer_cut(parent, mlt_producer_get_in(producer), mlt_producer_get_out(producer));
+    mlt_producer_close(parent);
+    if (cut) {
+        copyProperties(MLT_PRODUCER_PROPERTIES(producer), MLT_PRODUCER_PROPERTIES(cut));
+        cloneFilters(MLT_PRODUCER_SERVICE(producer), MLT_PRODUCER_SERVICE(cut));
+    }
+    return cut;
+}
+
+mlt_producer ServiceSnapshot::cloneParent(mlt_producer producer)
+{
+    mlt_producer copy = m_parents.value(producer);
+    if (!copy) {
+        switch (mlt_service_identify(MLT_PRODUCER_SERVICE(producer))) {
+        case playlist_type:
+            copy = clonePlaylist(MLT_PLAYLIST(producer));
+            break;
+        case tractor_type:
+            copy = cloneTractor(MLT_TRACTOR(producer));
+            break;
+        default:
+            copy = mlt_producer_new(m_profile);
+            if (copy) {
+                copyProperties(MLT_PRODUCER_PROPERTIES(producer), MLT_PRODUCER_PROPERTIES(copy));
+                cloneFilters(MLT_PRODUCER_SERVICE(producer), MLT_PRODUCER_SERVICE(copy));
+            }
+            break;
+        }
+        if (!copy)
+            return nullptr;
+        m_parents.insert(producer, copy);
+    }
+    mlt_properties_inc_ref(MLT_PRODUCER_PROPERTIES(copy));
+    return copy;
+}
+
+mlt_producer ServiceSnapshot::clonePlaylist(mlt_playlist playlist)
+{
+    mlt_playlist copy = mlt_playlist_new(m_profile);
+    if (!copy)
+        return nullptr;
+    int count = mlt_playlist_count(playlist);
+    for (int i = 0; i < count; ++i) {
+        mlt_playlist_clip_info info;
+        if (mlt_playlist_get_clip_info(playlist, &info, i))
+            continue;
+        if (mlt_playlist_is_blank(playlist, i)) {
+            mlt_playlist_blank(copy, info.frame_count - 1);
+            continue;
+        }
+        mlt_producer clip = cloneProducer(info.cut);
+        if (clip) {
+            mlt_playlist_append_io(copy, clip, info.frame_in, info.frame_out);
+            mlt_producer_close(clip);
+        }
+    }
+    // 长度由片段决定，属性在片段之后复制
+    copyProperties(MLT_PLAYLIST_PROPERTIES(playlist), MLT_PLAYLIST_PROPERTIES(copy));
+    cloneFilters(MLT_PLAYLIST_SERVICE(playlist), MLT_PLAYLIST_SERVICE(copy));
+    return MLT_PLAYLIST_PRODUCER(copy);
+}
+
+mlt_producer ServiceSnapshot::cloneTractor(mlt_tractor tractor)
+{
+    mlt_tractor copy = mlt_tractor_new();
+    if (!copy)
+        return nullptr;
+    mlt_properties_set_data(MLT_TRACTOR_PROPERTIES(copy), "_profile", m_profile, 0, nullptr, nullptr);
+
+    mlt_multitrack multitrack = mlt_tractor_multitrack(tractor);
+    int count = mlt_multitrack_count(multitrack);
+    for (int i = 0; i < count; ++i) {
+        mlt_producer track = cloneProducer(mlt_multitrack_track(multitrack, i));
+        if (track) {
+            mlt_tractor_set_track(copy, track, i);
+            mlt_producer_close(track);
+        }
+    }
+
+    // 从 tractor往下依次是最后种到 field上的服务，倒序后按原来的顺序种回去
+    QList<mlt_service> planted;
+    mlt_service service = mlt_service_producer(MLT_TRACTOR_SERVICE(tractor));
+    while (service && mlt_service_identify(service) != multitrack_type) {
+        mlt_service_type type = mlt_service_identify(service);
+        if (type == transition_type || type == filter_type)
+            planted.prepend(service);
+        service = mlt_service_producer(service);
+    }
+    mlt_field field = mlt_tractor_field(copy);
+    foreach (mlt_service original, planted) {
+        mlt_properties properties = MLT_SERVICE_PROPERTIES(original);
+        if (mlt_service_identify(original) == transition_type) {
+            mlt_transition transition = mlt_transition_new();
+            copyProperties(properties, MLT_TRANSITION_PROPERTIES(transition));
+            mlt_field_plant_transition(field, transition,
+                                       mlt_properties_get_int(properties, "a_track"),
+                                       mlt_properties_get_int(properties, "b_track"));
+            mlt_transition_close(transition);
+        } else {
+            mlt_filter filter = mlt_filter_new();
+            copyProperties(properties, MLT_FILTER_PROPERTIES(filter));
+            mlt_field_plant_filter(field, filter, mlt_properties_get_int(properties, "track"));
+            mlt_filter_close(filter);
+        }
+    }
+
+    copyProperties(MLT_TRACTOR_PROPERTIES(tractor), MLT_TRACTOR_PROPERTIES(copy));
+    cloneFilters(MLT_TRACTOR_SERVICE(tractor), MLT_TRACTOR_SERVICE(copy));
+    return MLT_TRACTOR_PRODUCER(copy);
+}
+
+void ServiceSnapshot::cloneFilters(mlt_service from, mlt_service to)
+{
+    mlt_filter filter = nullptr;
+    for (int i = 0; (filter = mlt_service_filter(from, i)); ++i) {
+        // 自动加上的 loader滤镜 xml consumer不保存，副本里也不需要
+        if (mlt_properties_get_int(MLT_FILTER_PROPERTIES(filter), "_loader"))
+            continue;
+        mlt_filter copy = mlt_filter_new();
+        if (!copy)
+            continue;
+        copyProperties(MLT_FILTER_PROPERTIES(filter), MLT_FILTER_PROPERTIES(copy));
+        mlt_service_attach(to, copy);
+        mlt_filter_close(copy);
+    }
+}
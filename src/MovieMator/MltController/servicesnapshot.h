@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SERVICESNAPSHOT_H
+#define SERVICESNAPSHOT_H
+
+#include "mltcontroller_global.h"
+
+#include <QHash>
+#include <framework/mlt.h>
+
+namespace Mlt {
+class Producer;
+}
+
+/*!
+  \class ServiceSnapshot
+  \brief Detached copy of a producer graph for serialization.
+
+  take() copies the structure of a producer — playlists, tractors,
+  transitions, attached filters and cuts — together with the public
+  properties of every service. Leaf producers, filters and transitions are
+  generic MLT services that only hold the copied properties; no media is
+  opened and no plugin is loaded, so taking a snapshot is cheap enough for
+  the GUI thread. The copy shares nothing with the original and can be
+  written by the xml consumer on another thread while editing goes on.
+
+  Producers used by several cuts stay shared in the copy, so the xml
+  consumer writes them once just like for the original.
+*/
+
+class MLTCONTROLLERSHARED_EXPORT ServiceSnapshot
+{
+public:
+    // 返回的副本只能用来保存 XML，不能播放
+    static Mlt::Producer* take(Mlt::Producer& producer);
+
+private:
+    explicit ServiceSnapshot(mlt_profile profile);
+    ~ServiceSnapshot();
+
+    mlt_producer cloneProducer(mlt_producer producer);
+    mlt_producer cloneParent(mlt_producer producer);
+    mlt_producer clonePlaylist(mlt_playlist playlist);
+    mlt_producer cloneTractor(mlt_tractor tractor);
+    void cloneFilters(mlt_service from, mlt_service to);
+    static void copyProperties(mlt_properties from, mlt_properties to);
+
+    mlt_profile m_profile;
+    QHash<mlt_producer, mlt_producer> m_parents;
+};
+
+#endif // SERVICESNAPSHOT_H
@@ -7,13 +7,20 @@ SUBDIRS = CuteLogger \
     src \
     Breakpad \
     CrashReporter \
-    ResourceDockGenerator
+    ResourceDockGenerator \
+    PlaylistDock \
+    mvcp \
+    benchmark \
+    tests
 cache()
 CommonUtil.depends = CuteLogger
 QmlUtilities.depends = CommonUtil
 MltController.depends = QmlUtilities
 ResourceDockGenerator.depends = CommonUtil
+PlaylistDock.depends = CuteLogger CommonUtil MltController
 src.depends = CuteLogger CommonUtil QmlUtilities MltController Breakpad ResourceDockGenerator
+benchmark.depends = $$src.depends
+tests.depends = CuteLogger CommonUtil QmlUtilities MltController Breakpad ResourceDockGenerator PlaylistDock mvcp
 
 
 TRANSLATIONS += \
@@ -39,11 +39,55 @@
 #include <Mlt.h>
 #include <mltcontroller.h>
 
+// 同时运行的缩略图任务数和排队上限
+static const int kMaxThumbnailTasks = 2;
+static const int kMaxQueuedThumbnails = 64;
+
 static void deleteQImage(QImage* image)
 {
     delete image;
 }
 
+// 与 Controller::getHash() 使用相同的资源字段
+static QString hashResource(Mlt::Properties& properties)
+{
+    QString service = properties.get("mlt_service");
+    if (service == "timewarp")
+        return QString::fromUtf8(properties.get("warp_resource"));
+    else if (service == "vidstab")
+        return QString::fromUtf8(properties.get("filename"));
+    return QString::fromUtf8(properties.get("resource"));
+}
+
+static bool needsThumbnail(Mlt::Producer& parent, const QString& setting)
+{
+    if (setting == "hidden" || !parent.is_valid())
+        return false;
+    if (!parent.get_data(kThumbnailInProperty))
+        return true;
+    return (setting == "tall" || setting == "wide") && !parent.get_data(kThumbnailOutProperty);
+}
+
+class UpdateHashTask : public QRunnable
+{
+    QObject* m_model;
+    QString m_resource;
+
+public:
+    UpdateHashTask(QObject* model, const QString& resource)
+        : QRunnable()
+        , m_model(model)
+        , m_resource(resource)
+    {}
+
+    void run()
+    {
+        QString hash = Util::getFileHash(m_resource);
+        QMetaObject::invokeMethod(m_model, "onHashReady", Qt::QueuedConnection,
+                                  Q_ARG(QString, m_resource), Q_ARG(QString, hash));
+    }
+};
+
 class UpdateThumbnailTask : public QRunnable
 {
     PlaylistModel* m_model;
@@ -117,8 +161,15 @@ public:
     void run()
     {
         QString setting = Settings.playlistThumbnails();
-        if (setting == "hidden")
-            return;
+        if (setting != "hidden")
+            updateThumbnails(setting);
+        // 回到 GUI 线程刷新该行并调度下一个任务
+        QMetaObject::invokeMethod(m_model, "onThumbnailReady", Qt::QueuedConnection,
+                                  Q_ARG(void*, m_producer.get_producer()), Q_ARG(int, m_row));
+    }
+
+    void updateThumbnails(const QString& setting)
+    {
 
         // Scale the in and out point frame numbers to this member profile's fps.
         int inPoint = qRound(m_in / MLT.profile().fps() * m_profile.fps());
@@ -133,7 +184,6 @@ public:
         } else {
             m_producer.set(kThumbnailInProperty, new QImage(image), 0, (mlt_destructor) deleteQImage, NULL);
         }
-        m_model->showThumbnail(m_row);
 
         if (setting == "tall" || setting == "wide") {
             image = DB.getThumbnail(cacheKey(outPoint));
@@ -144,7 +194,6 @@ public:
             } else {
                 m_producer.set(kThumbnailOutProperty, new QImage(image), 0, (mlt_destructor) deleteQImage, NULL);
             }
-            m_model->showThumbnail(m_row);
         }
     }
 
@@ -154,22 +203,26 @@ public:
         int width = PlaylistModel::THUMBNAIL_WIDTH * 2;
         return MLT.image(*tempProducer(), frameNumber, width, height);
     }
-
-signals:
-    void thumbnailUpdated(int row);
 };
 
 PlaylistModel::PlaylistModel(QObject *parent)
     : QAbstractTableModel(parent)
     , m_playlist(0)
     , m_dropRow(-1)
+    , m_scheduleQueued(false)
+    , m_firstVisibleRow(-1)
+    , m_lastVisibleRow(-1)
 {
     qRegisterMetaType<QVector<int> >("QVector<int>");
     m_unbookmarkedFilesModel.setColumnCount(ColumnCount);
+    // 额外的一个线程留给文件哈希
+    m_threadPool.setMaxThreadCount(kMaxThumbnailTasks + 1);
 }
 
 PlaylistModel::~PlaylistModel()
 {
+    m_thumbnailQueue.clear();
+    m_threadPool.waitForDone();
     delete m_playlist;
     m_playlist = 0;
 }
@@ -187,7 +240,6 @@ int PlaylistModel::columnCount(const QModelIndex& /*parent*/) const
 QVariant PlaylistModel::data(const QModelIndex &index, int role) const
 {
     Q_ASSERT(index.row() < m_playlist->count());
-    Q_ASSERT(m_playlist->clip_info(index.row()));
 
     if (!m_playlist) return QVariant();
     switch (role) {
@@ -218,8 +270,8 @@ QVariant PlaylistModel::data(const QModelIndex &index, int role) const
                 if (result.isNull() && info->producer && info->producer->is_valid())
                     result = QString::fromUtf8(info->producer->get("mlt_service"));
             }
-            if (!info->producer->get(kShotcutHashProperty))
-                MLT.getHash(*info->producer);
+            if (info->producer && info->producer->is_valid() && !info->producer->get(kShotcutHashProperty))
+                requestHash(*info->producer);
             return result;
         }
         case COLUMN_IN:
@@ -247,51 +299,10 @@ QVariant PlaylistModel::data(const QModelIndex &index, int role) const
         if (index.column() == COLUMN_THUMBNAIL) {
             QScopedPointer<Mlt::Producer> producer(m_playlist->get_clip(index.row()));
             Mlt::Producer parent(producer->get_parent());
-            int width = THUMBNAIL_WIDTH;
             QString setting = Settings.playlistThumbnails();
-            QImage image;
-
-            if (setting == "wide")
-                image = QImage(width * 2, THUMBNAIL_HEIGHT, QImage::Format_ARGB32);
-            else if (setting == "tall")
-                image = QImage(width, THUMBNAIL_HEIGHT * 2, QImage::Format_ARGB32);
-            else if (setting == "large")
-                image = QImage(width * 2, THUMBNAIL_HEIGHT * 2, QImage::Format_ARGB32);
-            else
-                image = QImage(width, THUMBNAIL_HEIGHT, QImage::Format_ARGB32);
-
-            if (parent.is_valid() && parent.get_data(kThumbnailInProperty)) {
-                QPainter painter(&image);
-                image.fill(QApplication::palette().base().color().rgb());
-
-                // draw the in thumbnail
-                QImage* thumb = (QImage*) parent.get_data(kThumbnailInProperty);
-                QRect rect = thumb->rect();
-                if (setting != "large") {
-                    rect.setWidth(width);
-                    rect.setHeight(THUMBNAIL_HEIGHT);
-                }
-                painter.drawImage(rect, *thumb);
-
-                if ((setting == "wide" || setting == "tall") && parent.get_data(kThumbnailOutProperty)) {
-                    // draw the out thumbnail
-                    thumb = (QImage*) parent.get_data(kThumbnailOutProperty);
-                    if (setting == "wide") {
-                        rect.setWidth(width * 2);
-                        rect.setLeft(width);
-                    }
-                    else if (setting == "tall") {
-                        rect.setHeight(THUMBNAIL_HEIGHT * 2);
-                        rect.setTop(THUMBNAIL_HEIGHT);
-                    }
-                    painter.drawImage(rect, *thumb);
-                }
-                painter.end();
-            }
-            else {
-                image.fill(QApplication::palette().base().color().rgb());
-            }
-            return image;
+            if (needsThumbnail(parent, setting) && !m_thumbnailRunning.contains(parent.get_producer()))
+                requestThumbnail(index.row());
+            return decoration(parent, setting);
         }
         break;
     default:
@@ -450,6 +461,7 @@ QModelIndex PlaylistModel::createIndex(int row, int column) const
 void PlaylistModel::clear()
 {
     if (!m_playlist) return;
+    invalidateThumbnails();
     if (rowCount()) {
         beginRemoveRows(QModelIndex(), 0, rowCount() - 1);
         m_playlist->clear();
@@ -460,6 +472,7 @@ void PlaylistModel::clear()
 
 void PlaylistModel::load()
 {
+    invalidateThumbnails();
     if (m_playlist) {
         if (rowCount()) {
             beginRemoveRows(QModelIndex(), 0, rowCount() - 1);
@@ -500,8 +513,6 @@ void PlaylistModel::append(Mlt::Producer& producer)
     int in = producer.get_in();
     int out = producer.get_out();
     producer.set_in_and_out(0, producer.get_length() - 1);
-    QThreadPool::globalInstance()->start(
-        new UpdateThumbnailTask(this, producer, in, out, count));
     beginInsertRows(QModelIndex(), count, count);
     m_playlist->append(producer, in, out);
     endInsertRows();
@@ -514,8 +525,8 @@ void PlaylistModel::insert(Mlt::Producer& producer, int row)
     int in = producer.get_in();
     int out = producer.get_out();
     producer.set_in_and_out(0, producer.get_length() - 1);
-    QThreadPool::globalInstance()->start(
-        new UpdateThumbnailTask(this, producer, in, out, row));
+    // 排队中的行号在插入后失效，可见行重绘时会重新请求
+    m_thumbnailQueue.clear();
     beginInsertRows(QModelIndex(), row, row);
     m_playlist->insert(producer, row, in, out);
     endInsertRows();
@@ -525,6 +536,10 @@ void PlaylistModel::insert(Mlt::Producer& producer, int row)
 void PlaylistModel::remove(int row)
 {
     if (!m_playlist) return;
+    QScopedPointer<Mlt::ClipInfo> info(m_playlist->clip_info(row));
+    if (info && info->producer)
+        m_decorations.remove(info->producer->get_producer());
+    m_thumbnailQueue.clear();
     beginRemoveRows(QModelIndex(), row, row);
     m_playlist->remove(row);
     endRemoveRows();
@@ -540,8 +555,10 @@ void PlaylistModel::update(int row, Mlt::Producer& producer)
     int in = producer.get_in();
     int out = producer.get_out();
     producer.set_in_and_out(0, producer.get_length() - 1);
-    QThreadPool::globalInstance()->start(
-        new UpdateThumbnailTask(this, producer, in, out, row));
+    QScopedPointer<Mlt::ClipInfo> info(m_playlist->clip_info(row));
+    if (info && info->producer)
+        m_decorations.remove(info->producer->get_producer());
+    m_thumbnailQueue.removeAll(row);
     m_playlist->remove(row);
     m_playlist->insert(producer, row, in, out);
     emit dataChanged(createIndex(row, 0), createIndex(row, COLUMN_COUNT - 1));
@@ -562,6 +579,7 @@ void PlaylistModel::insertBlank(int frames, int row)
 {
     createIfNeeded();
     beginInsertRows(QModelIndex(), row, row);
+    m_thumbnailQueue.clear();
     m_playlist->insert_blank(row, frames - 1);
     endInsertRows();
     emit modified();
@@ -579,6 +597,7 @@ void PlaylistModel::close()
 void PlaylistModel::move(int from, int to)
 {
     if (!m_playlist) return;
+    m_thumbnailQueue.clear();
     m_playlist->move(from, to);
     emit dataChanged(createIndex(from, 0), createIndex(from, COLUMN_COUNT - 1));
     emit dataChanged(createIndex(to, 0), createIndex(to, COLUMN_COUNT - 1));
@@ -597,21 +616,20 @@ void PlaylistModel::createIfNeeded()
 
 void PlaylistModel::showThumbnail(int row)
 {
+    if (!m_playlist || row < 0 || row >= m_playlist->count()) return;
+    QScopedPointer<Mlt::ClipInfo> info(m_playlist->clip_info(row));
+    if (info && info->producer)
+        m_decorations.remove(info->producer->get_producer());
     emit dataChanged(createIndex(row, COLUMN_THUMBNAIL), createIndex(row, COLUMN_THUMBNAIL));
 }
 
 void PlaylistModel::refreshThumbnails()
 {
-    if (m_playlist && m_playlist->is_valid()) {
-        for (int i = 0; i < m_playlist->count(); i++) {
-            Mlt::ClipInfo* info = m_playlist->clip_info(i);
-            if (info && info->producer && info->producer->is_valid()) {
-                QThreadPool::globalInstance()->start(
-                    new UpdateThumbnailTask(this, *info->producer, info->frame_in, info->frame_out, i));
-            }
-            delete info;
-        }
-    }
+    // 缩略图按需生成：丢弃缓存后重绘可见行即可触发请求
+    m_decorations.clear();
+    m_placeholder = QImage();
+    if (m_playlist && m_playlist->is_valid() && m_playlist->count() > 0)
+        emit dataChanged(createIndex(0, COLUMN_THUMBNAIL), createIndex(m_playlist->count() - 1, COLUMN_THUMBNAIL));
 }
 
 void PlaylistModel::setPlaylist(Mlt::Playlist& playlist)
@@ -619,6 +637,7 @@ void PlaylistModel::setPlaylist(Mlt::Playlist& playlist)
     int index = 0;
 
     if (playlist.is_valid()) {
+        invalidateThumbnails();
         if (m_playlist) {
             if (rowCount()) {
                 beginRemoveRows(QModelIndex(), 0, rowCount() - 1);
@@ -653,3 +672,172 @@ QImage PlaylistModel::thumbnail(int row)
     return ret.value<QImage>();
 }
 
+void PlaylistModel::setVisibleRows(int first, int last)
+{
+    m_firstVisibleRow = first;
+    m_lastVisibleRow = last;
+    // 取消已滚出视野、还未开始的请求
+    QList<int>::iterator it = m_thumbnailQueue.begin();
+    while (it != m_thumbnailQueue.end()) {
+        if (isRowVisible(*it))
+            ++it;
+        else
+            it = m_thumbnailQueue.erase(it);
+    }
+}
+
+void PlaylistModel::scheduleThumbnails()
+{
+    m_scheduleQueued = false;
+    QString setting = Settings.playlistThumbnails();
+    while (m_playlist && m_thumbnailRunning.size() < kMaxThumbnailTasks && !m_thumbnailQueue.isEmpty()) {
+        // 可见行优先，其余按请求顺序
+        int i = 0;
+        while (i < m_thumbnailQueue.size() && !isRowVisible(m_thumbnailQueue.at(i)))
+            ++i;
+        int row = m_thumbnailQueue.takeAt(i < m_thumbnailQueue.size()? i : 0);
+        if (row < 0 || row >= m_playlist->count())
+            continue;
+        QScopedPointer<Mlt::ClipInfo> info(m_playlist->clip_info(row));
+        if (!info || !info->producer || !info->producer->is_valid())
+            continue;
+        if (m_thumbnailRunning.contains(info->producer->get_producer()) || !needsThumbnail(*info->producer, setting))
+            continue;
+        m_thumbnailRunning.insert(info->producer->get_producer());
+        m_threadPool.start(new UpdateThumbnailTask(this, *info->producer, info->frame_in, info->frame_out, row));
+    }
+}
+
+void PlaylistModel::onThumbnailReady(void* parent, int row)
+{
+    mlt_producer producer = static_cast<mlt_producer>(parent);
+    m_thumbnailRunning.remove(producer);
+    m_decorations.remove(producer);
+    if (m_playlist) {
+        QScopedPointer<Mlt::ClipInfo> info(m_playlist->clip_info(row));
+        if (info && info->producer && info->producer->get_producer() == producer) {
+            showThumbnail(row);
+        } else {
+            // 任务运行期间行号发生了变化
+            for (int i = 0; i < m_playlist->count(); i++) {
+                QScopedPointer<Mlt::ClipInfo> other(m_playlist->clip_info(i));
+                if (other && other->producer && other->producer->get_producer() == producer)
+                    showThumbnail(i);
+            }
+        }
+    }
+    scheduleThumbnails();
+}
+
+void PlaylistModel::onHashReady(const QString& resource, const QString& hash)
+{
+    m_hashPending.remove(resource);
+    if (!m_playlist || hash.isEmpty()) return;
+    for (int i = 0; i < m_playlist->count(); i++) {
+        QScopedPointer<Mlt::ClipInfo> info(m_playlist->clip_info(i));
+        if (info && info->producer && info->producer->is_valid()
+                && !info->producer->get(kShotcutHashProperty)
+                && hashResource(*info->producer) == resource)
+            info->producer->set(kShotcutHashProperty, hash.toLatin1().constData());
+    }
+}
+
+void PlaylistModel::requestThumbnail(int row) const
+{
+    if (!m_thumbnailQueue.contains(row)) {
+        m_thumbnailQueue.append(row);
+        // 超出上限时丢弃最早的请求，最近的请求更可能在视野内
+        while (m_thumbnailQueue.size() > kMaxQueuedThumbnails)
+            m_thumbnailQueue.removeFirst();
+    }
+    if (!m_scheduleQueued) {
+        m_scheduleQueued = true;
+        QMetaObject::invokeMethod(const_cast<PlaylistModel*>(this), "scheduleThumbnails", Qt::QueuedConnection);
+    }
+}
+
+void PlaylistModel::requestHash(Mlt::Producer& producer) const
+{
+    QString resource = hashResource(producer);
+    if (resource.isEmpty() || m_hashPending.contains(resource))
+        return;
+    m_hashPending.insert(resource);
+    m_threadPool.start(new UpdateHashTask(const_cast<PlaylistModel*>(this), resource));
+}
+
+bool PlaylistModel::isRowVisible(int row) const
+{
+    if (m_firstVisibleRow < 0 || m_lastVisibleRow < 0)
+        return true;
+    return row >= m_firstVisibleRow && row <= m_lastVisibleRow;
+}
+
+void PlaylistModel::invalidateThumbnails()
+{
+    m_thumbnailQueue.clear();
+    m_decorations.clear();
+    m_placeholder = QImage();
+}
+
+QImage PlaylistModel::decoration(Mlt::Producer& parent, const QString& setting) const
+{
+    if (setting != m_decorationSetting) {
+        m_decorations.clear();
+        m_placeholder = QImage();
+        m_decorationSetting = setting;
+    }
+    bool hasThumbnail = parent.is_valid() && parent.get_data(kThumbnailInProperty);
+    if (hasThumbnail) {
+        QHash<mlt_producer, QImage>::const_iterator it = m_decorations.constFind(parent.get_producer());
+        if (it != m_decorations.constEnd())
+            return it.value();
+    } else if (!m_placeholder.isNull()) {
+        return m_placeholder;
+    }
+
+    int width = THUMBNAIL_WIDTH;
+    QImage image;
+
+    if (setting == "wide")
+        image = QImage(width * 2, THUMBNAIL_HEIGHT, QImage::Format_ARGB32);
+    else if (setting == "tall")
+        image = QImage(width, THUMBNAIL_HEIGHT * 2, QImage::Format_ARGB32);
+    else if (setting == "large")
+        image = QImage(width * 2, THUMBNAIL_HEIGHT * 2, QImage::Format_ARGB32);
+    else
+        image = QImage(width, THUMBNAIL_HEIGHT, QImage::Format_ARGB32);
+    image.fill(QApplication::palette().base().color().rgb());
+
+    if (!hasThumbnail) {
+        m_placeholder = image;
+        return image;
+    }
+
+    QPainter painter(&image);
+
+    // draw the in thumbnail
+    QImage* thumb = (QImage*) parent.get_data(kThumbnailInProperty);
+    QRect rect = thumb->rect();
+    if (setting != "large") {
+        rect.setWidth(width);
+        rect.setHeight(THUMBNAIL_HEIGHT);
+    }
+    painter.drawImage(rect, *thumb);
+
+    if ((setting == "wide" || setting == "tall") && parent.get_data(kThumbnailOutProperty)) {
+        // draw the out thumbnail
+        thumb = (QImage*) parent.get_data(kThumbnailOutProperty);
+        if (setting == "wide") {
+            rect.setWidth(width * 2);
+            rect.setLeft(width);
+        }
+        else if (setting == "tall") {
+            rect.setHeight(THUMBNAIL_HEIGHT * 2);
+            rect.setTop(THUMBNAIL_HEIGHT);
+        }
+        painter.drawImage(rect, *thumb);
+    }
+    painter.end();
+    m_decorations.insert(parent.get_producer(), image);
+    return image;
+}
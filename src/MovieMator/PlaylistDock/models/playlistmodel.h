@@ -29,6 +29,10 @@
 #include <QStringList>
 #include "MltPlaylist.h"
 #include <QStandardItemModel>
+#include <QThreadPool>
+#include <QHash>
+#include <QSet>
+#include <QImage>
 
 class PLAYLISTDOCKSHARED_EXPORT PlaylistModel : public QAbstractTableModel
 {
@@ -76,6 +80,8 @@ public:
     Mlt::Playlist* playlist() { return m_playlist; }
     void setPlaylist(Mlt::Playlist& playlist);
     QImage thumbnail(int row);
+    // 视图滚动时告知当前可见行，缩略图优先生成可见行，滚出视野的排队请求会被取消
+    void setVisibleRows(int first, int last);
 
 signals:
     void created();
@@ -100,9 +106,32 @@ public slots:
     void close();
     void move(int from, int to);
 
+private slots:
+    void scheduleThumbnails();
+    void onThumbnailReady(void* parent, int row);
+    void onHashReady(const QString& resource, const QString& hash);
+
 private:
+    void requestThumbnail(int row) const;
+    void requestHash(Mlt::Producer& producer) const;
+    bool isRowVisible(int row) const;
+    void invalidateThumbnails();
+    QImage decoration(Mlt::Producer& parent, const QString& setting) const;
+
     Mlt::Playlist* m_playlist;
     int m_dropRow;
+    mutable QThreadPool m_threadPool;
+    // 等待生成缩略图的行，数量有上限
+    mutable QList<int> m_thumbnailQueue;
+    mutable bool m_scheduleQueued;
+    QSet<mlt_producer> m_thumbnailRunning;
+    mutable QSet<QString> m_hashPending;
+    // 按 parent producer 缓存合成好的缩略图，避免每次绘制都重新合成
+    mutable QHash<mlt_producer, QImage> m_decorations;
+    mutable QImage m_placeholder;
+    mutable QString m_decorationSetting;
+    int m_firstVisibleRow;
+    int m_lastVisibleRow;
 };
 
 #endif // PLAYLISTMODEL_H
@@ -102,6 +102,9 @@ PlaylistDock::PlaylistDock(QWidget *parent) :
     ui->tableView->setColumnHidden(PlaylistModel::COLUMN_IN, true);
     ui->tableView->setColumnHidden(PlaylistModel::COLUMN_START, true);
     connect(ui->tableView->selectionModel(), SIGNAL(currentRowChanged(QModelIndex,QModelIndex)), this, SLOT(on_tableView_selectionChanged(QModelIndex,QModelIndex)));
+
+    // 滚动时更新可见行，缩略图优先生成可见行
+    connect(ui->tableView->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(onTableViewScrolled()));
 }
 
 PlaylistDock::~PlaylistDock()
@@ -609,3 +612,12 @@ void PlaylistDock::on_actionProperty_triggered()
         emit propertiesDockTriggered();
     }
 }
+
+void PlaylistDock::onTableViewScrolled()
+{
+    int first = ui->tableView->rowAt(0);
+    int last = ui->tableView->rowAt(ui->tableView->viewport()->height() - 1);
+    if (last < 0)
+        last = m_model.rowCount() - 1;
+    m_model.setVisibleRows(first, last);
+}
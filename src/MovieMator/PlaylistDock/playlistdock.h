@@ -115,6 +115,8 @@ private slots:
 
     void on_actionProperty_triggered();
 
+    void onTableViewScrolled();
+
 private:
     Ui::PlaylistDock *ui;
     PlaylistModel m_model;
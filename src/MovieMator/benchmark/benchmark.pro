@@ -0,0 +1,25 @@
+# 无界面的性能基准程序：moviemator-benchmark script.json [-o report.json]
+# 与编辑器共用 src.pri里的源文件，不链接进发布的 MovieMator
+include(../src/src.pri)
+
+TARGET = moviemator-benchmark
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+win32:CONFIG -= windows
+
+SOURCES += main.cpp \
+    benchmarkrunner.cpp \
+    timelinebenchmark.cpp \
+    scopefanoutbenchmark.cpp \
+    probebenchmark.cpp \
+    encodequeuebenchmark.cpp \
+    filtersresetbenchmark.cpp
+
+HEADERS += benchmarkrunner.h \
+    benchmarksuite.h \
+    timelinebenchmark.h \
+    scopefanoutbenchmark.h \
+    probebenchmark.h \
+    encodequeuebenchmark.h \
+    filtersresetbenchmark.h
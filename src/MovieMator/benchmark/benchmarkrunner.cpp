@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "benchmarkrunner.h"
+#include "benchmarksuite.h"
+#include <Logger.h>
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QTimer>
+#include <QTextStream>
+#include <algorithm>
+
+static double percentile(QVector<double> samples, double p)
+{
+    if (samples.isEmpty())
+        return 0.0;
+    std::sort(samples.begin(), samples.end());
+    int i = qBound(0, int(p * (samples.size() - 1) + 0.5), samples.size() - 1);
+    return samples.at(i);
+}
+
+BenchmarkRunner::BenchmarkRunner(const QString& scriptFile, const QString& outputFile, QObject *parent)
+    : QObject(parent)
+    , m_scriptFile(scriptFile)
+    , m_outputFile(outputFile)
+{
+}
+
+void BenchmarkRunner::addSuite(BenchmarkSuite* suite)
+{
+    Q_ASSERT(suite);
+    suite->setParent(this);
+    m_suites << suite;
+}
+
+QDir BenchmarkRunner::scriptDir() const
+{
+    return QFileInfo(m_scriptFile).absoluteDir();
+}
+
+void BenchmarkRunner::start()
+{
+    QFile file(m_scriptFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fail(QString("cannot read script %1").arg(m_scriptFile));
+        finish(1);
+        return;
+    }
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+    if (error.error != QJsonParseError::NoError || !doc.isObject()) {
+        fail(QString("invalid script %1: %2").arg(m_scriptFile).arg(error.errorString()));
+        finish(1);
+        return;
+    }
+    m_script = doc.object();
+
+    //只准备脚本用到的 suite，未知的操作在开始回放之前就报错
+    QList<BenchmarkSuite*> used;
+    foreach (QJsonValue value, m_script.value("operations").toArray()) {
+        QString name = value.toObject().value("op").toString();
+        BenchmarkSuite* suite = suiteFor(name);
+        if (!suite) {
+            fail(QString("unknown operation %1").arg(name));
+            finish(1);
+            return;
+        }
+        if (!used.contains(suite))
+            used << suite;
+    }
+    foreach (BenchmarkSuite* suite, used) {
+        if (!suite->prepare()) {
+            finish(1);
+            return;
+        }
+    }
+    //工程加载的后续步骤在事件循环里完成，下一轮再开始回放
+    QTimer::singleShot(0, this, SLOT(runScript()));
+}
+
+void BenchmarkRunner::runScript()
+{
+    foreach (QJsonValue value, m_script.value("operations").toArray()) {
+        QJsonObject op = value.toObject();
+        QString name = op.value("op").toString();
+        BenchmarkSuite* suite = suiteFor(name);
+        int repeat = qMax(1, op.value("repeat").toInt(1));
+        for (int i = 0; i < repeat; ++i) {
+            if (!suite->run(name, op, i))
+                break;
+        }
+    }
+    finish(m_errors.isEmpty() ? 0 : 2);
+}
+
+BenchmarkSuite* BenchmarkRunner::suiteFor(const QString& name) const
+{
+    foreach (BenchmarkSuite* suite, m_suites) {
+        if (suite->operations().contains(name))
+            return suite;
+    }
+    return nullptr;
+}
+
+void BenchmarkRunner::record(const QString& name, double ms)
+{
+    m_stats[name].samples.append(ms);
+}
+
+void BenchmarkRunner::recordError(const QString& name)
+{
+    m_stats[name].errors++;
+}
+
+void BenchmarkRunner::fail(const QString& message)
+{
+    LOG_WARNING() << message;
+    m_errors << message;
+}
+
+void BenchmarkRunner::addResult(const QString& section, const QJsonObject& result)
+{
+    m_results[section].append(result);
+}
+
+void BenchmarkRunner::setValue(const QString& key, const QJsonValue& value)
+{
+    m_values[key] = value;
+}
+
+QJsonObject BenchmarkRunner::report() const
+{
+    QJsonObject operations;
+    QMapIterator<QString, Stats> it(m_stats);
+    while (it.hasNext()) {
+        it.next();
+        const QVector<double>& samples = it.value().samples;
+        double total = 0.0;
+        foreach (double ms, samples)
+            total += ms;
+        QJsonObject stats;
+        stats["count"] = samples.size();
+        stats["errors"] = it.value().errors;
+        stats["totalMs"] = total;
+        stats["meanMs"] = samples.isEmpty() ? 0.0 : total / samples.size();
+        stats["minMs"] = samples.isEmpty() ? 0.0 : *std::min_element(samples.begin(), samples.end());
+        stats["maxMs"] = samples.isEmpty() ? 0.0 : *std::max_element(samples.begin(), samples.end());
+        stats["p50Ms"] = percentile(samples, 0.5);
+        stats["p95Ms"] = percentile(samples, 0.95);
+        operations[it.key()] = stats;
+    }
+
+    QJsonObject result = m_values;
+    result["script"] = m_scriptFile;
+    result["operations"] = operations;
+    QMapIterator<QString, QJsonArray> section(m_results);
+    while (section.hasNext()) {
+        section.next();
+        result[section.key()] = section.value();
+    }
+    result["errors"] = QJsonArray::fromStringList(m_errors);
+    return result;
+}
+
+void BenchmarkRunner::finish(int exitCode)
+{
+    QByteArray json = QJsonDocument(report()).toJson();
+    if (m_outputFile.isEmpty()) {
+        QTextStream(stdout) << json;
+    } else {
+        QFile file(m_outputFile);
+        if (file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            file.write(json);
+        else
+            LOG_WARNING() << "cannot write benchmark report" << m_outputFile;
+    }
+    QCoreApplication::exit(exitCode);
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BENCHMARKRUNNER_H
+#define BENCHMARKRUNNER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonValue>
+#include <QMap>
+#include <QVector>
+#include <QList>
+#include <QDir>
+
+class BenchmarkSuite;
+
+//性能基准的脚本执行器：读取 JSON脚本，按顺序把每个操作交给声明了该操作的 BenchmarkSuite，
+//汇总每种操作的耗时分布和各 suite的结果，以 JSON输出，方便在任何机器上比较热路径的回归。
+//脚本格式：
+//{
+//  "project": "project.mmp",                                   //相对于脚本所在目录
+//  "generate": {"kind": "short-clips", "count": 500},          //没有 project时生成合成工程
+//  "operations": [
+//    {"op": "insert", "track": 0, "position": 0, "frames": 25, "repeat": 20},
+//    {"op": "render", "in": 0, "out": 499, "target": ""},
+//    ...
+//  ]
+//}
+//每个 op支持 repeat（重复次数），其余参数见各 suite的说明。
+class BenchmarkRunner : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BenchmarkRunner(const QString& scriptFile, const QString& outputFile, QObject *parent = nullptr);
+
+    //suite的父对象是 runner，由 runner负责释放
+    void addSuite(BenchmarkSuite* suite);
+
+    const QJsonObject& script() const { return m_script; }
+    QDir scriptDir() const;
+
+    void record(const QString& name, double ms);
+    void recordError(const QString& name);
+    void fail(const QString& message);
+    //把一条结果追加到报告的 section数组里
+    void addResult(const QString& section, const QJsonObject& result);
+    //报告顶层的单个值，如工程文件、加载耗时
+    void setValue(const QString& key, const QJsonValue& value);
+
+public slots:
+    void start();
+
+private slots:
+    void runScript();
+
+private:
+    struct Stats {
+        QVector<double> samples;
+        int errors = 0;
+    };
+
+    BenchmarkSuite* suiteFor(const QString& name) const;
+    void finish(int exitCode);
+    QJsonObject report() const;
+
+    QString m_scriptFile;
+    QString m_outputFile;
+    QJsonObject m_script;
+    QList<BenchmarkSuite*> m_suites;
+    QMap<QString, Stats> m_stats;
+    QMap<QString, QJsonArray> m_results;
+    QJsonObject m_values;
+    QStringList m_errors;
+};
+
+#endif // BENCHMARKRUNNER_H
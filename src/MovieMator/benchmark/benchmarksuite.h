@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BENCHMARKSUITE_H
+#define BENCHMARKSUITE_H
+
+#include "benchmarkrunner.h"
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+
+//一组相关的基准操作。runner只把 operations()里列出的 op交给 run()，
+//脚本用到这个 suite时，在回放之前先调用一次 prepare()
+class BenchmarkSuite : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BenchmarkSuite(BenchmarkRunner& runner)
+        : QObject(&runner)
+        , m_runner(runner)
+    {}
+
+    virtual QStringList operations() const = 0;
+    virtual bool prepare() { return true; }
+    virtual bool run(const QString& name, const QJsonObject& op, int iteration) = 0;
+
+protected:
+    void record(const QString& name, double ms) { m_runner.record(name, ms); }
+    void fail(const QString& message) { m_runner.fail(message); }
+
+    BenchmarkRunner& m_runner;
+};
+
+#endif // BENCHMARKSUITE_H
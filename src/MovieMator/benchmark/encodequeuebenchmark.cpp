@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "encodequeuebenchmark.h"
+#include "mltcontroller.h"
+#include "settings.h"
+#include "encodetaskqueue.h"
+#include "jobs/melttask.h"
+#include <Logger.h>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QDir>
+#include <QDomDocument>
+#include <QThread>
+#include <Mlt.h>
+
+EncodeQueueBenchmark::EncodeQueueBenchmark(BenchmarkRunner& runner)
+    : BenchmarkSuite(runner)
+    , m_tasksFinished(0)
+    , m_tasksFailed(0)
+{
+}
+
+QStringList EncodeQueueBenchmark::operations() const
+{
+    return QStringList() << "encode-queue";
+}
+
+void EncodeQueueBenchmark::onTaskFinished(AbstractTask* task, bool isSuccess)
+{
+    Q_UNUSED(task);
+    m_tasksFinished++;
+    if (!isSuccess)
+        m_tasksFailed++;
+}
+
+//把任务加入 ENCODETASKS，等全部结束后移出队列，返回总耗时；peak返回同时运行的最多任务数
+qint64 EncodeQueueBenchmark::runEncodeTasks(const QStringList& xmls, int* peak)
+{
+    m_tasksFinished = m_tasksFailed = 0;
+    *peak = 0;
+    int firstRow = ENCODETASKS.rowCount();
+    QList<AbstractTask*> tasks;
+    QElapsedTimer clock;
+    clock.start();
+    for (int i = 0; i < xmls.size(); i++) {
+        MeltTask* task = new MeltTask(QString("encode %1").arg(i), xmls.at(i));
+        connect(task, SIGNAL(finished(AbstractTask*, bool)), this, SLOT(onTaskFinished(AbstractTask*, bool)));
+        tasks << task;
+        ENCODETASKS.addTask(task);
+    }
+    const int cores = QThread::idealThreadCount();
+    bool overweight = false;
+    while (m_tasksFinished < xmls.size() && clock.elapsed() < 600000) {
+        int running = 0;
+        int weight = 0;
+        foreach (AbstractTask* task, tasks) {
+            if (task->running()) {
+                running++;
+                weight += qMin(task->threadWeight(), cores);
+            }
+        }
+        *peak = qMax(*peak, running);
+        if (running > 1 && weight > cores)
+            overweight = true;
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 20);
+    }
+    qint64 wall = clock.elapsed();
+    if (overweight)
+        fail("encode-queue: concurrent tasks used more threads than cores");
+    if (m_tasksFinished < xmls.size())
+        ENCODETASKS.stopTasks();
+    for (int row = firstRow + xmls.size() - 1; row >= firstRow; row--)
+        ENCODETASKS.remove(ENCODETASKS.index(row, 0));
+    return wall;
+}
+
+//同一批长短不同、线程数不同的导出任务先按并发设置跑一遍，再限制为一次一个跑一遍
+bool EncodeQueueBenchmark::run(const QString& name, const QJsonObject& op, int iteration)
+{
+    Q_UNUSED(name);
+    Q_UNUSED(iteration);
+    int count = qMax(1, op.value("count").toInt(8));
+    QJsonArray seconds = op.value("seconds").toArray();
+    if (seconds.isEmpty())
+        seconds << 1 << 4;
+    QJsonArray threads = op.value("threads").toArray();
+    if (threads.isEmpty())
+        threads << 0 << 1 << 2;
+
+    QDir dir(QDir::temp().absoluteFilePath("moviemator-encode-benchmark"));
+    if (!dir.mkpath(".")) {
+        fail(QString("encode-queue: cannot create %1").arg(dir.absolutePath()));
+        return false;
+    }
+    QStringList xmls;
+    for (int i = 0; i < count; i++) {
+        int frames = qMax(1, int(seconds.at(i % seconds.size()).toDouble() * MLT.profile().fps()));
+        QString color = QString("#%1").arg((0x304050 + i * 0x0b0705) & 0xffffff, 6, 16, QChar('0'));
+        Mlt::Producer producer(MLT.profile(), "color", color.toLatin1().constData());
+        if (!producer.is_valid()) {
+            fail("encode-queue: cannot create color producer");
+            return false;
+        }
+        producer.set("length", frames);
+        producer.set_in_and_out(0, frames - 1);
+
+        QDomDocument dom;
+        dom.setContent(MLT.XML(&producer));
+        QDomElement consumer = dom.createElement("consumer");
+        consumer.setAttribute("mlt_service", "avformat");
+        consumer.setAttribute("target", dir.absoluteFilePath(QString("encode-%1.mkv").arg(i)));
+        consumer.setAttribute("vcodec", "libx264");
+        consumer.setAttribute("preset", "medium");
+        consumer.setAttribute("an", 1);
+        consumer.setAttribute("real_time", -1);
+        consumer.setAttribute("threads", threads.at(i % threads.size()).toInt());
+        QDomElement root = dom.documentElement();
+        root.insertAfter(consumer, root.firstChildElement("profile"));
+        xmls << dom.toString();
+    }
+
+    int savedMax = Settings.encodeConcurrentTasks();
+    bool wasPaused = ENCODETASKS.isPaused();
+    ENCODETASKS.resume();
+
+    ENCODETASKS.setMaxConcurrentTasks(op.value("max").toInt(0));
+    int maxTasks = ENCODETASKS.maxConcurrentTasks();
+    int peak = 0;
+    qint64 wall = runEncodeTasks(xmls, &peak);
+    int failed = m_tasksFailed + xmls.size() - m_tasksFinished;
+
+    ENCODETASKS.setMaxConcurrentTasks(1);
+    int serialPeak = 0;
+    qint64 serial = runEncodeTasks(xmls, &serialPeak);
+    failed += m_tasksFailed + xmls.size() - m_tasksFinished;
+
+    ENCODETASKS.setMaxConcurrentTasks(savedMax);
+    if (wasPaused)
+        ENCODETASKS.pause();
+    dir.removeRecursively();
+
+    QJsonObject result;
+    result["count"] = count;
+    result["maxConcurrent"] = maxTasks;
+    result["peakConcurrent"] = peak;
+    result["wallMs"] = double(wall);
+    result["serialMs"] = double(serial);
+    result["tasksPerMinute"] = wall > 0 ? count * 60000.0 / wall : 0.0;
+    result["speedup"] = wall > 0 ? double(serial) / wall : 0.0;
+    m_runner.addResult("encodeQueue", result);
+    record("encode-queue", wall);
+    record("encode-queue-serial", serial);
+    LOG_INFO() << "encode-queue:" << count << "tasks in" << wall << "ms, serial" << serial << "ms, peak" << peak;
+
+    if (failed > 0) {
+        fail(QString("encode-queue: %1 tasks failed").arg(failed));
+        return false;
+    }
+    return true;
+}
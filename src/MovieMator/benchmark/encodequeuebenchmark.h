@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef ENCODEQUEUEBENCHMARK_H
+#define ENCODEQUEUEBENCHMARK_H
+
+#include "benchmarksuite.h"
+#include <QStringList>
+
+class AbstractTask;
+
+//导出队列吞吐量：同一批长短不同、线程数不同的导出任务先按并发设置跑一遍，再限制为一次一个跑一遍
+//  {"op": "encode-queue", "count": 8, "seconds": [1, 4], "threads": [0, 1, 2], "max": 0}
+class EncodeQueueBenchmark : public BenchmarkSuite
+{
+    Q_OBJECT
+public:
+    explicit EncodeQueueBenchmark(BenchmarkRunner& runner);
+
+    QStringList operations() const;
+    bool run(const QString& name, const QJsonObject& op, int iteration);
+
+private slots:
+    void onTaskFinished(AbstractTask* task, bool isSuccess);
+
+private:
+    qint64 runEncodeTasks(const QStringList& xmls, int* peak);
+
+    int m_tasksFinished;
+    int m_tasksFailed;
+};
+
+#endif // ENCODEQUEUEBENCHMARK_H
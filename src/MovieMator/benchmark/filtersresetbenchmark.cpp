@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "filtersresetbenchmark.h"
+#include "mltcontroller.h"
+#include "shotcut_mlt_properties.h"
+#include "models/metadatamodel.h"
+#include "models/attachedfiltersmodel.h"
+#include "qmlmetadata.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <Mlt.h>
+
+FiltersResetBenchmark::FiltersResetBenchmark(BenchmarkRunner& runner)
+    : BenchmarkSuite(runner)
+{
+}
+
+QStringList FiltersResetBenchmark::operations() const
+{
+    return QStringList() << "filters-reset";
+}
+
+//合成一个 catalogue条元数据的目录，两个 clip各挂 filters个滤镜且布局不同，
+//来回切换选中的 clip，分别用逐行查找和索引查找元数据，统计每次 AttachedFiltersModel::reset的耗时
+bool FiltersResetBenchmark::run(const QString& name, const QJsonObject& op, int iteration)
+{
+    Q_UNUSED(iteration);
+    int filterCount = qMax(1, op.value("filters").toInt(30));
+    int catalogueSize = qMax(filterCount * 2, op.value("catalogue").toInt(300));
+    int switches = qMax(1, op.value("switches").toInt(200));
+
+    MetadataModel metadata;
+    for (int i = 0; i < catalogueSize; i++) {
+        QmlMetadata* meta = new QmlMetadata;
+        meta->setObjectName(QString("benchmarkFilter%1").arg(i));
+        meta->set_mlt_service("brightness");
+        meta->setName(QString("Filter %1").arg(i, 4, 10, QChar('0')));
+        metadata.add(meta);
+    }
+
+    //两个 clip的滤镜取自目录的不同位置，逐行查找时要扫描大半个目录
+    Mlt::Producer clips[2] = {
+        Mlt::Producer(MLT.profile(), "color:#202020"),
+        Mlt::Producer(MLT.profile(), "color:#404040")
+    };
+    for (int c = 0; c < 2; c++) {
+        if (!clips[c].is_valid()) {
+            fail(QString("%1: cannot create color producer").arg(name));
+            return false;
+        }
+        clips[c].set(kMultitrackItemProperty, 1);
+        for (int i = 0; i < filterCount; i++) {
+            Mlt::Filter filter(MLT.profile(), "brightness");
+            if (!filter.is_valid()) {
+                fail(QString("%1: cannot create brightness filter").arg(name));
+                return false;
+            }
+            int id = catalogueSize - 1 - (i * 2 + c);
+            filter.set(kShotcutFilterProperty, QString("benchmarkFilter%1").arg(id).toUtf8().constData());
+            clips[c].attach(filter);
+        }
+    }
+
+    bool ok = true;
+    for (int indexed = 0; indexed < 2; indexed++) {
+        AttachedFiltersModel model;
+        model.setMetadataModel(&metadata);
+        metadata.setIndexEnabled(indexed);
+        QString pass = indexed ? "filters-reset-index" : "filters-reset-scan";
+        for (int i = 0; i < switches; i++) {
+            QElapsedTimer timer;
+            timer.start();
+            model.reset(&clips[i % 2]);
+            record(pass, timer.nsecsElapsed() / 1000000.0);
+            if (model.rowCount() != filterCount) {
+                fail(QString("%1: %2 rows for %3 filters").arg(pass).arg(model.rowCount()).arg(filterCount));
+                ok = false;
+                break;
+            }
+        }
+        QCoreApplication::processEvents();
+    }
+    metadata.setIndexEnabled(true);
+    return ok;
+}
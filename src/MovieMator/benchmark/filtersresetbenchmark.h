@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef FILTERSRESETBENCHMARK_H
+#define FILTERSRESETBENCHMARK_H
+
+#include "benchmarksuite.h"
+
+//滤镜列表重置：在两个各挂 filters个滤镜的 clip之间切换，比较逐行查找与索引查找元数据时 AttachedFiltersModel::reset的耗时
+//  {"op": "filters-reset", "filters": 30, "catalogue": 300, "switches": 200}
+class FiltersResetBenchmark : public BenchmarkSuite
+{
+    Q_OBJECT
+public:
+    explicit FiltersResetBenchmark(BenchmarkRunner& runner);
+
+    QStringList operations() const;
+    bool run(const QString& name, const QJsonObject& op, int iteration);
+};
+
+#endif // FILTERSRESETBENCHMARK_H
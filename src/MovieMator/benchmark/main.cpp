@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "benchmarkrunner.h"
+#include "timelinebenchmark.h"
+#include "scopefanoutbenchmark.h"
+#include "probebenchmark.h"
+#include "encodequeuebenchmark.h"
+#include "filtersresetbenchmark.h"
+#include <mltcontroller.h>
+#include <Logger.h>
+#include <ConsoleAppender.h>
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QTimer>
+
+//moviemator-benchmark script.json [-o report.json]
+//不创建主窗口、QML和 OpenGL：脚本直接在模型和 MLT上回放，报告写到标准输出或 -o指定的文件
+int main(int argc, char **argv)
+{
+    //没有显示器的机器上也能运行
+    if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication a(argc, argv);
+    a.setOrganizationName("effectmatrix");
+    a.setOrganizationDomain("effectmatrix.com");
+    //设置单独存放，基准里修改的并发数等设置不会影响编辑器
+    a.setApplicationName("MovieMator Benchmark");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replay a benchmark script against the timeline model and MLT without any user interface.");
+    parser.addHelpOption();
+    QCommandLineOption outputOption(QStringList() << "o" << "output",
+        "Write the report to a file instead of stdout.", "file");
+    parser.addOption(outputOption);
+    parser.addPositionalArgument("script", "Benchmark script (JSON).");
+    parser.process(a);
+    if (parser.positionalArguments().isEmpty())
+        parser.showHelp(1);
+
+    //报告占用标准输出，日志写到标准错误
+    ConsoleAppender* consoleAppender = new ConsoleAppender();
+    consoleAppender->setFormat("[%-7l] <%c> %m\n");
+    Logger::registerAppender(consoleAppender);
+
+    //消费者相关的调用都是空操作，不会创建 GLWidget
+    Mlt::Controller::createHeadless();
+
+    BenchmarkRunner runner(parser.positionalArguments().first(), parser.value(outputOption));
+    runner.addSuite(new TimelineBenchmark(runner));
+    runner.addSuite(new ScopeFanoutBenchmark(runner));
+    runner.addSuite(new ProbeBenchmark(runner));
+    runner.addSuite(new EncodeQueueBenchmark(runner));
+    runner.addSuite(new FiltersResetBenchmark(runner));
+    QTimer::singleShot(0, &runner, SLOT(start()));
+    return a.exec();
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "probebenchmark.h"
+#include "mltcontroller.h"
+#include "mediaprobe.h"
+#include <Logger.h>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QDir>
+#include <QFileInfo>
+#include <Mlt.h>
+
+ProbeBenchmark::ProbeBenchmark(BenchmarkRunner& runner)
+    : BenchmarkSuite(runner)
+{
+}
+
+QStringList ProbeBenchmark::operations() const
+{
+    return QStringList() << "probe";
+}
+
+//依次测量：不用缓存、只有数据库缓存、内存缓存，最后在线程池里批量探测一次（不用缓存）
+bool ProbeBenchmark::run(const QString& name, const QJsonObject& op, int iteration)
+{
+    Q_UNUSED(name);
+    Q_UNUSED(iteration);
+    int count = qMax(1, op.value("count").toInt(20));
+    double seconds = qMax(0.2, op.value("seconds").toDouble(1.0));
+    QString dirName = op.value("dir").toString();
+    QDir dir = dirName.isEmpty() ? QDir(QDir::temp().absoluteFilePath("moviemator-probe-benchmark"))
+                                 : QDir(m_runner.scriptDir().absoluteFilePath(dirName));
+    QStringList files;
+    foreach (const QFileInfo& fileInfo, dir.entryInfoList(QDir::Files, QDir::Name))
+        files << fileInfo.absoluteFilePath();
+
+    if (files.isEmpty()) {
+        //生成只有视频的 mjpeg短片，每个颜色和长度不同
+        if (!dir.mkpath(".")) {
+            fail(QString("probe: cannot create %1").arg(dir.absolutePath()));
+            return false;
+        }
+        int frames = qMax(1, int(seconds * MLT.profile().fps()));
+        for (int i = 0; i < count; i++) {
+            QString file = dir.absoluteFilePath(QString("probe-%1.mkv").arg(i, 3, 10, QChar('0')));
+            QString color = QString("#%1").arg((0x203040 + i * 0x0a0604) & 0xffffff, 6, 16, QChar('0'));
+            Mlt::Producer producer(MLT.profile(), "color", color.toLatin1().constData());
+            Mlt::Consumer consumer(MLT.profile(), "avformat", file.toUtf8().constData());
+            if (!producer.is_valid() || !consumer.is_valid()) {
+                fail("probe: cannot create media");
+                return false;
+            }
+            producer.set("length", frames + i);
+            producer.set_in_and_out(0, frames + i - 1);
+            consumer.set("f", "matroska");
+            consumer.set("vcodec", "mjpeg");
+            consumer.set("an", 1);
+            consumer.set("real_time", -1);
+            consumer.set("terminate_on_pause", 1);
+            consumer.connect(producer);
+            consumer.run();
+            files << file;
+        }
+    }
+
+    bool ok = true;
+    QList<QJsonObject> cold;
+    qint64 coldNs = 0, databaseNs = 0, warmNs = 0;
+    PROBE.clearMemoryCache();
+    foreach (const QString& file, files) {
+        QElapsedTimer timer;
+        timer.start();
+        MediaInfo info = PROBE.probe(file, true);
+        coldNs += timer.nsecsElapsed();
+        record("probe-cold", timer.nsecsElapsed() / 1000000.0);
+        if (!info.valid) {
+            fail(QString("probe: %1: %2").arg(file).arg(info.error));
+            ok = false;
+        }
+        cold << info.toJson();
+    }
+    PROBE.clearMemoryCache();
+    foreach (const QString& file, files) {
+        QElapsedTimer timer;
+        timer.start();
+        PROBE.probe(file);
+        databaseNs += timer.nsecsElapsed();
+        record("probe-database", timer.nsecsElapsed() / 1000000.0);
+    }
+    int databaseHits = PROBE.databaseHits();
+    for (int i = 0; i < files.size(); i++) {
+        QElapsedTimer timer;
+        timer.start();
+        MediaInfo info = PROBE.probe(files.at(i));
+        warmNs += timer.nsecsElapsed();
+        record("probe-warm", timer.nsecsElapsed() / 1000000.0);
+        if (info.toJson() != cold.at(i)) {
+            fail(QString("probe: cached result differs for %1").arg(files.at(i)));
+            ok = false;
+        }
+    }
+    int memoryHits = PROBE.memoryHits();
+
+    PROBE.clearMemoryCache();
+    QElapsedTimer batch;
+    batch.start();
+    PROBE.probeAsync(files, true);
+    while (PROBE.isBusy())
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    double batchMs = batch.nsecsElapsed() / 1000000.0;
+    record("probe-batch", batchMs);
+
+    QJsonObject result;
+    result["dir"] = dir.absolutePath();
+    result["files"] = files.size();
+    result["coldMs"] = coldNs / 1000000.0;
+    result["databaseMs"] = databaseNs / 1000000.0;
+    result["warmMs"] = warmNs / 1000000.0;
+    result["batchColdMs"] = batchMs;
+    result["databaseHits"] = databaseHits;
+    result["memoryHits"] = memoryHits;
+    m_runner.addResult("probes", result);
+    LOG_INFO() << "probe:" << files.size() << "files, cold" << coldNs / 1000000.0 << "ms, database"
+               << databaseNs / 1000000.0 << "ms, warm" << warmNs / 1000000.0 << "ms, batch" << batchMs << "ms";
+    return ok;
+}
@@ -1,6 +1,6 @@
 /*
- * Copyright (c) 2016 Meltytech, LLC
- * Author: Dan Dennedy <dan@dennedy.org>
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -16,25 +16,22 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#ifndef FFPROBEJOB_H
-#define FFPROBEJOB_H
 
-#include "abstractjob.h"
-#include <QStringList>
+#ifndef PROBEBENCHMARK_H
+#define PROBEBENCHMARK_H
 
-class FfprobeJob : public AbstractJob
+#include "benchmarksuite.h"
+
+//素材探测：dir里的素材（dir为空时生成）分别在无缓存、只有数据库缓存、内存缓存下探测一遍，最后在线程池里批量探测
+//  {"op": "probe", "dir": "", "count": 20, "seconds": 1}
+class ProbeBenchmark : public BenchmarkSuite
 {
     Q_OBJECT
 public:
-    FfprobeJob(const QString& name, const QStringList& args);
-    virtual ~FfprobeJob();
-    void start();
-
-private slots:
-    virtual void onFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    explicit ProbeBenchmark(BenchmarkRunner& runner);
 
-private:
-    QStringList m_args;
+    QStringList operations() const;
+    bool run(const QString& name, const QJsonObject& op, int iteration);
 };
 
-#endif // FFPROBEJOB_H
+#endif // PROBEBENCHMARK_H
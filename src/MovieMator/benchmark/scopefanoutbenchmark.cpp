@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "scopefanoutbenchmark.h"
+#include "mltcontroller.h"
+#include "framefanout.h"
+#include "sharedframe.h"
+#include <QElapsedTimer>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QScopedPointer>
+#include <QVector>
+#include <Mlt.h>
+
+//模拟一个示波器：不停取帧，每帧耗时 workMs
+class FanoutConsumer : public QRunnable
+{
+public:
+    FanoutConsumer(FrameFanout<SharedFrame>& frames, int id, int workMs, QAtomicInt& stop)
+        : m_frames(frames), m_id(id), m_workMs(workMs), m_stop(stop)
+    {}
+    void run()
+    {
+        SharedFrame frame;
+        while (!m_stop.loadAcquire()) {
+            if (m_frames.next(m_id, frame)) {
+                if (m_workMs > 0)
+                    QThread::msleep(m_workMs);
+            } else {
+                QThread::usleep(500);
+            }
+        }
+    }
+private:
+    FrameFanout<SharedFrame>& m_frames;
+    int m_id;
+    int m_workMs;
+    QAtomicInt& m_stop;
+};
+
+ScopeFanoutBenchmark::ScopeFanoutBenchmark(BenchmarkRunner& runner)
+    : BenchmarkSuite(runner)
+{
+}
+
+QStringList ScopeFanoutBenchmark::operations() const
+{
+    return QStringList() << "scope-fanout";
+}
+
+bool ScopeFanoutBenchmark::run(const QString& name, const QJsonObject& op, int iteration)
+{
+    Q_UNUSED(name);
+    Q_UNUSED(iteration);
+    int fps = qMax(1, op.value("fps").toInt(240));
+    int consumerCount = qBound(1, op.value("consumers").toInt(6), int(FrameFanout<SharedFrame>::kMaxConsumers));
+    double seconds = qMax(0.1, op.value("seconds").toDouble(5.0));
+
+    //预先准备几帧循环使用，推送过程中不再分配
+    QVector<SharedFrame> frames;
+    Mlt::Producer producer(MLT.profile(), "color:#808080");
+    for (int i = 0; i < 4 && producer.is_valid(); i++) {
+        QScopedPointer<Mlt::Frame> frame(producer.get_frame());
+        if (frame)
+            frames << SharedFrame(*frame);
+    }
+    if (frames.isEmpty()) {
+        fail("scope-fanout: cannot create frames");
+        return false;
+    }
+
+    FrameFanout<SharedFrame> fanout;
+    QThreadPool pool;
+    pool.setMaxThreadCount(consumerCount);
+    QAtomicInt stop;
+    for (int i = 0; i < consumerCount; i++) {
+        int id = fanout.addConsumer(i == 0);
+        fanout.setActive(id, true);
+        //每个消费者的处理速度不同，慢的会丢帧
+        pool.start(new FanoutConsumer(fanout, id, i * 2, stop));
+    }
+
+    int total = int(seconds * fps);
+    qint64 interval = 1000000000LL / fps;
+    QElapsedTimer clock;
+    clock.start();
+    for (int i = 0; i < total; i++) {
+        while (clock.nsecsElapsed() < i * interval)
+            QThread::usleep(100);
+        QElapsedTimer timer;
+        timer.start();
+        fanout.push(frames.at(i % frames.size()));
+        record("scope-fanout-push", timer.nsecsElapsed() / 1000000.0);
+    }
+    stop.storeRelease(1);
+    pool.waitForDone();
+
+    QJsonArray consumers;
+    for (int i = 0; i < consumerCount; i++) {
+        FrameFanout<SharedFrame>::Statistics stats = fanout.statistics(i);
+        QJsonObject consumer;
+        consumer["workMs"] = i * 2;
+        consumer["latestOnly"] = i == 0;
+        consumer["delivered"] = stats.delivered;
+        consumer["dropped"] = stats.dropped;
+        consumer["retries"] = stats.retries;
+        consumers.append(consumer);
+    }
+    QJsonObject result;
+    result["fps"] = fps;
+    result["seconds"] = clock.nsecsElapsed() / 1000000000.0;
+    result["pushed"] = fanout.pushed();
+    result["writerRetries"] = fanout.writerRetries();
+    result["writerDrops"] = fanout.writerDrops();
+    result["consumers"] = consumers;
+    m_runner.addResult("scopeFanout", result);
+    return true;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SCOPEFANOUTBENCHMARK_H
+#define SCOPEFANOUTBENCHMARK_H
+
+#include "benchmarksuite.h"
+
+//示波器帧分发的压力测试：按 fps推送帧给 consumers个处理速度不同的消费者，统计推送耗时和各消费者的丢帧
+//  {"op": "scope-fanout", "fps": 240, "consumers": 6, "seconds": 5}
+class ScopeFanoutBenchmark : public BenchmarkSuite
+{
+    Q_OBJECT
+public:
+    explicit ScopeFanoutBenchmark(BenchmarkRunner& runner);
+
+    QStringList operations() const;
+    bool run(const QString& name, const QJsonObject& op, int iteration);
+};
+
+#endif // SCOPEFANOUTBENCHMARK_H
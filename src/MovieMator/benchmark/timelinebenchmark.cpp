@@ -0,0 +1,416 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "timelinebenchmark.h"
+#include "mltcontroller.h"
+#include "shotcut_mlt_properties.h"
+#include "settings.h"
+#include "commands/timelinecommands.h"
+#include "timelineexporter.h"
+#include <Logger.h>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QDir>
+#include <QBuffer>
+#include <Mlt.h>
+
+static const char* kDefaultKind = "short-clips";
+
+TimelineBenchmark::TimelineBenchmark(BenchmarkRunner& runner)
+    : BenchmarkSuite(runner)
+{
+}
+
+QStringList TimelineBenchmark::operations() const
+{
+    return QStringList() << "insert" << "overwrite" << "append" << "remove" << "lift"
+                         << "trim-in" << "trim-out" << "move" << "split" << "undo" << "redo"
+                         << "render" << "export" << "delete-alternate";
+}
+
+QStringList TimelineBenchmark::projectKinds()
+{
+    return QStringList() << "short-clips" << "many-tracks" << "heavy-filters";
+}
+
+bool TimelineBenchmark::generateProject(const QString& kind, int count, const QString& fileName)
+{
+    int trackCount = 1;
+    int clipsPerTrack = 0;
+    int clipFrames = 50;
+    int filtersPerClip = 0;
+    if (kind == "short-clips") {
+        clipsPerTrack = count > 0 ? count : 500;
+        clipFrames = 0; //每个片段 10~30帧
+    } else if (kind == "many-tracks") {
+        trackCount = count > 0 ? count : 16;
+        clipsPerTrack = 20;
+    } else if (kind == "heavy-filters") {
+        clipsPerTrack = 50;
+        clipFrames = 100;
+        filtersPerClip = count > 0 ? count : 8;
+    } else {
+        LOG_WARNING() << "unknown project kind" << kind;
+        return false;
+    }
+
+    static const char* filterServices[] = { "brightness", "gamma", "greyscale", "sepia" };
+    static const int filterServiceCount = int(sizeof(filterServices) / sizeof(filterServices[0]));
+
+    Mlt::Tractor tractor(MLT.profile());
+    if (!tractor.is_valid())
+        return false;
+
+    //与 MultitrackModel::addBackgroundTrack()一致的背景轨道
+    Mlt::Playlist background(MLT.profile());
+    background.set("id", kBackgroundTrackId);
+    Mlt::Producer black(MLT.profile(), "color:black");
+    black.set("length", 1);
+    black.set("id", "black");
+    black.set("set.test_audio", 0);
+    background.append(black);
+    tractor.set_track(background, 0);
+
+    int lastVideoIndex = 0;
+    for (int t = 0; t < trackCount; ++t) {
+        int mltIndex = t + 1;
+        Mlt::Playlist playlist(MLT.profile());
+        playlist.set(kVideoTrackProperty, 1);
+        playlist.set(kTrackNameProperty, QString("V%1").arg(t + 1).toUtf8().constData());
+        for (int c = 0; c < clipsPerTrack; ++c) {
+            int frames = clipFrames > 0 ? clipFrames : 10 + (c % 21);
+            int rgb = (c * 0x2f1b37 + t * 0x13579b) & 0xffffff;
+            Mlt::Producer producer(MLT.profile(),
+                QString("color:#%1").arg(rgb, 6, 16, QChar('0')).toUtf8().constData());
+            if (!producer.is_valid())
+                return false;
+            producer.set("length", frames);
+            producer.set_in_and_out(0, frames - 1);
+            for (int f = 0; f < filtersPerClip; ++f) {
+                Mlt::Filter filter(MLT.profile(), filterServices[f % filterServiceCount]);
+                if (filter.is_valid())
+                    producer.attach(filter);
+            }
+            playlist.append(producer);
+        }
+        tractor.set_track(playlist, mltIndex);
+
+        //与 MultitrackModel::addVideoTrack()一致的 mix和 composite转场
+        Mlt::Transition mix(MLT.profile(), "mix");
+        if (mix.is_valid()) {
+            mix.set("always_active", 1);
+            mix.set("combine", 1);
+            tractor.plant_transition(mix, 0, mltIndex);
+        }
+        Mlt::Transition composite(MLT.profile(), Settings.playerGPU()? "movit.overlay" : "frei0r.cairoblend");
+        if (composite.is_valid()) {
+            composite.set("disable", t == 0 ? 1 : 0);
+            tractor.plant_transition(composite, lastVideoIndex, mltIndex);
+        }
+        lastVideoIndex = mltIndex;
+    }
+
+    MLT.saveXML(fileName, &tractor, false);
+    LOG_INFO() << "generated" << kind << "project" << fileName << "tracks" << trackCount << "clips per track" << clipsPerTrack;
+    return QFile::exists(fileName);
+}
+
+bool TimelineBenchmark::prepare()
+{
+    const QJsonObject& script = m_runner.script();
+    QDir scriptDir = m_runner.scriptDir();
+    if (script.contains("project")) {
+        m_projectFile = scriptDir.absoluteFilePath(script.value("project").toString());
+    } else {
+        QJsonObject generate = script.value("generate").toObject();
+        QString kind = generate.value("kind").toString(kDefaultKind);
+        QString name = generate.value("file").toString(QString("benchmark-%1.mmp").arg(kind));
+        m_projectFile = scriptDir.absoluteFilePath(name);
+        if (!generateProject(kind, generate.value("count").toInt(), m_projectFile)) {
+            fail(QString("cannot generate %1 project").arg(kind));
+            return false;
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!loadProject(m_projectFile)) {
+        fail(QString("cannot load project %1").arg(m_projectFile));
+        return false;
+    }
+    double loadMs = timer.nsecsElapsed() / 1000000.0;
+    LOG_INFO() << "benchmark project" << m_projectFile << "loaded in" << loadMs << "ms";
+    m_runner.setValue("project", m_projectFile);
+    m_runner.setValue("loadMs", loadMs);
+    m_runner.setValue("tracks", m_model.trackList().count());
+    return true;
+}
+
+bool TimelineBenchmark::run(const QString& name, const QJsonObject& op, int iteration)
+{
+    int trackIndex = op.value("track").toInt(0);
+    int clipIndex = op.value("clip").toInt(0) + iteration * op.value("stride").toInt(0);
+    bool ripple = op.value("ripple").toBool(false);
+
+    if (!m_model.tractor()) {
+        fail(QString("%1: project %2 is not loaded").arg(name).arg(m_projectFile));
+        return false;
+    }
+    if (name == "render")
+        return render(op);
+    if (name == "export")
+        return exportTimeline(op);
+    if (name == "delete-alternate")
+        return deleteAlternate(op);
+
+    if (trackIndex < 0 || trackIndex >= m_model.trackList().count()) {
+        fail(QString("%1: no track %2").arg(name).arg(trackIndex));
+        m_runner.recordError(name);
+        return false;
+    }
+    bool needsClip = name == "remove" || name == "lift" || name == "trim-in" || name == "trim-out"
+            || name == "move" || name == "split";
+    if (needsClip && !clipExists(trackIndex, clipIndex)) {
+        fail(QString("%1: no clip %2 on track %3").arg(name).arg(clipIndex).arg(trackIndex));
+        m_runner.recordError(name);
+        return false;
+    }
+    //剪辑内容在计时之外准备好
+    QString xml;
+    if (name == "insert" || name == "overwrite" || name == "append")
+        xml = colorClipXml(op.value("frames").toInt(25));
+
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = true;
+    if (name == "insert") {
+        m_undoStack.push(new Timeline::InsertClipCommand(m_model, trackIndex, op.value("position").toInt(0), xml));
+    } else if (name == "overwrite") {
+        m_undoStack.push(new Timeline::OverwriteClipCommand(m_model, trackIndex, op.value("position").toInt(0), xml));
+    } else if (name == "append") {
+        m_undoStack.push(new Timeline::AppendClipCommand(m_model, trackIndex, xml));
+    } else if (name == "remove") {
+        m_undoStack.push(new Timeline::RemoveClipsCommand(m_model, trackIndex, QList<int>() << clipIndex, false));
+    } else if (name == "lift") {
+        m_undoStack.push(new Timeline::RemoveClipsCommand(m_model, trackIndex, QList<int>() << clipIndex, true));
+    } else if (name == "trim-in" || name == "trim-out") {
+        int delta = op.value("delta").toInt(5);
+        if (name == "trim-in") {
+            ok = m_model.trimClipInValid(trackIndex, clipIndex, delta, ripple);
+            if (ok)
+                m_undoStack.push(new Timeline::TrimClipInCommand(m_model, trackIndex, clipIndex, delta, ripple));
+        } else {
+            ok = m_model.trimClipOutValid(trackIndex, clipIndex, delta, ripple);
+            if (ok)
+                m_undoStack.push(new Timeline::TrimClipOutCommand(m_model, trackIndex, clipIndex, delta, ripple));
+        }
+    } else if (name == "move") {
+        int toTrack = op.value("toTrack").toInt(trackIndex);
+        int position = op.value("position").toInt(0);
+        ok = m_model.moveClipValid(trackIndex, toTrack, clipIndex, position);
+        if (ok)
+            m_undoStack.push(new Timeline::MoveClipCommand(m_model, trackIndex, toTrack, clipIndex, position));
+    } else if (name == "split") {
+        QModelIndex index = m_model.index(clipIndex, 0, m_model.index(trackIndex));
+        int start = m_model.data(index, MultitrackModel::StartRole).toInt();
+        int duration = m_model.data(index, MultitrackModel::DurationRole).toInt();
+        int position = op.contains("position") ? op.value("position").toInt() : start + duration / 2;
+        ok = duration > 1 && position > start && position < start + duration;
+        if (ok)
+            m_undoStack.push(new Timeline::SplitCommand(m_model, trackIndex, clipIndex, position));
+    } else if (name == "undo") {
+        ok = m_undoStack.canUndo();
+        if (ok)
+            m_undoStack.undo();
+    } else if (name == "redo") {
+        ok = m_undoStack.canRedo();
+        if (ok)
+            m_undoStack.redo();
+    }
+    //排队的模型通知（缩略图、波形、刷新消费者）也算在这次编辑的延迟里
+    QCoreApplication::processEvents();
+    double ms = timer.nsecsElapsed() / 1000000.0;
+
+    if (!ok) {
+        fail(QString("%1: operation not valid at iteration %2").arg(name).arg(iteration));
+        m_runner.recordError(name);
+        return false;
+    }
+    record(name, ms);
+    return true;
+}
+
+bool TimelineBenchmark::render(const QJsonObject& op)
+{
+    Mlt::Tractor* tractor = m_model.tractor();
+    int in = qMax(0, op.value("in").toInt(0));
+    int out = op.value("out").toInt(tractor->get_playtime() - 1);
+    out = qMin(out, tractor->get_playtime() - 1);
+    QString target = op.value("target").toString();
+    if (out < in) {
+        fail(QString("render: empty range %1-%2").arg(in).arg(out));
+        return false;
+    }
+
+    //渲染工程的副本，不影响播放器正在使用的 tractor
+    QString xml = MLT.XML(tractor);
+    Mlt::Producer producer(MLT.profile(), "xml-string", xml.toUtf8().constData());
+    Mlt::Consumer consumer(MLT.profile(), target.isEmpty() ? "null" : "avformat",
+                           target.isEmpty() ? nullptr : target.toUtf8().constData());
+    if (!producer.is_valid() || !consumer.is_valid()) {
+        fail(QString("render: cannot create %1 consumer").arg(target.isEmpty() ? "null" : target));
+        return false;
+    }
+    producer.set_in_and_out(in, out);
+    consumer.set("real_time", op.value("realTime").toInt(-1));
+    consumer.set("terminate_on_pause", 1);
+    consumer.connect(producer);
+
+    QElapsedTimer timer;
+    timer.start();
+    consumer.run();
+    double seconds = timer.nsecsElapsed() / 1000000000.0;
+    int frames = out - in + 1;
+
+    QJsonObject result;
+    result["in"] = in;
+    result["out"] = out;
+    result["frames"] = frames;
+    result["consumer"] = target.isEmpty() ? QString("null") : target;
+    result["seconds"] = seconds;
+    result["fps"] = seconds > 0.0 ? frames / seconds : 0.0;
+    m_runner.addResult("renders", result);
+    LOG_INFO() << "rendered" << frames << "frames in" << seconds << "s";
+    return true;
+}
+
+bool TimelineBenchmark::exportTimeline(const QJsonObject& op)
+{
+    QString format = op.value("format").toString("edl");
+    QString name = QString("export-%1").arg(format);
+    TimelineExporter::Options options;
+    QElapsedTimer timer;
+    timer.start();
+    qint64 size = 0;
+    if (format == "edl-js") {
+        QString error;
+        size = TimelineExporter::legacyEdl(MLT.XML(m_model.tractor()), options, &error).size();
+        if (!error.isEmpty()) {
+            fail(QString("%1: %2").arg(name).arg(error));
+            m_runner.recordError(name);
+            return false;
+        }
+    } else if (format == "edl" || format == "json") {
+        TimelineExporter exporter(*m_model.tractor(), options);
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        if (format == "edl")
+            exporter.writeEdl(buffer);
+        else
+            exporter.writeJson(buffer);
+        size = buffer.size();
+    } else {
+        fail(QString("unknown export format %1").arg(format));
+        return false;
+    }
+    record(name, timer.nsecsElapsed() / 1000000.0);
+    LOG_INFO() << name << "wrote" << size << "bytes";
+    return true;
+}
+
+bool TimelineBenchmark::loadProject(const QString& fileName)
+{
+    m_undoStack.clear();
+    if (MLT.open(fileName))
+        return false;
+    m_model.load();
+    return m_model.tractor() != nullptr;
+}
+
+//在单独生成的 clips个片段的轨道上删除所有奇数位置的片段：逐个删除（每个片段一条撤销命令）和一次批量删除各做一遍，
+//每遍之前重新加载，结束后换回脚本的工程
+bool TimelineBenchmark::deleteAlternate(const QJsonObject& op)
+{
+    int count = qMax(2, op.value("clips").toInt(1000));
+    QString fileName = QDir::temp().absoluteFilePath("moviemator-delete-alternate.mmp");
+    if (!generateProject("short-clips", count, fileName)) {
+        fail("delete-alternate: cannot generate project");
+        return false;
+    }
+
+    bool ok = true;
+    int remaining[2] = {0, 0};
+    int duration[2] = {0, 0};
+    for (int batched = 0; batched < 2 && ok; batched++) {
+        if (!loadProject(fileName)) {
+            fail("delete-alternate: cannot load project");
+            ok = false;
+            break;
+        }
+        QList<int> indexes;
+        for (int i = count - 1 - (count % 2 == 0 ? 0 : 1); i > 0; i -= 2)
+            indexes << i;
+        QString name = batched ? "delete-alternate-batched" : "delete-alternate-single";
+        QElapsedTimer timer;
+        timer.start();
+        if (batched) {
+            m_undoStack.push(new Timeline::RemoveClipsCommand(m_model, 0, indexes, false));
+        } else {
+            //从后往前删，前面片段的下标不变
+            foreach (int i, indexes)
+                m_undoStack.push(new Timeline::RemoveClipsCommand(m_model, 0, QList<int>() << i, false));
+        }
+        QCoreApplication::processEvents();
+        record(name, timer.nsecsElapsed() / 1000000.0);
+        remaining[batched] = clipCount(0);
+        duration[batched] = m_model.trackList().isEmpty() ? 0 : m_model.tractor()->get_playtime();
+    }
+    if (ok && (remaining[0] != remaining[1] || duration[0] != duration[1] || remaining[1] != count - count / 2)) {
+        fail(QString("delete-alternate: results differ, %1/%2 clips and %3/%4 frames")
+             .arg(remaining[0]).arg(remaining[1]).arg(duration[0]).arg(duration[1]));
+        ok = false;
+    }
+
+    if (!loadProject(m_projectFile)) {
+        fail(QString("delete-alternate: cannot reload %1").arg(m_projectFile));
+        ok = false;
+    }
+    QFile::remove(fileName);
+    return ok;
+}
+
+int TimelineBenchmark::clipCount(int trackIndex) const
+{
+    return m_model.rowCount(m_model.index(trackIndex));
+}
+
+bool TimelineBenchmark::clipExists(int trackIndex, int clipIndex) const
+{
+    return clipIndex >= 0 && clipIndex < clipCount(trackIndex);
+}
+
+QString TimelineBenchmark::colorClipXml(int frames) const
+{
+    frames = qMax(1, frames);
+    Mlt::Producer producer(MLT.profile(), "color:#336699");
+    producer.set("length", frames);
+    producer.set_in_and_out(0, frames - 1);
+    return MLT.XML(&producer);
+}
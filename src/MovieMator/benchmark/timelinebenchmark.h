@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef TIMELINEBENCHMARK_H
+#define TIMELINEBENCHMARK_H
+
+#include "benchmarksuite.h"
+#include <QUndoStack>
+#include "models/multitrackmodel.h"
+
+//时间线编辑与渲染：打开脚本的工程（或生成合成工程）加载到自己的 MultitrackModel，
+//回放插入、裁剪、移动、切分、撤销/重做等编辑命令，命令推到自己的撤销栈，
+//再用 null或文件 consumer渲染一段区间。
+//  {"op": "insert", "track": 0, "position": 0, "frames": 25, "repeat": 20},
+//  {"op": "trim-in", "track": 0, "clip": 0, "delta": 5, "ripple": true},
+//  {"op": "move", "track": 0, "toTrack": 0, "clip": 3, "position": 400},
+//  {"op": "split", "track": 0, "clip": 10, "repeat": 10, "stride": 2},
+//  {"op": "undo", "repeat": 10}, {"op": "redo", "repeat": 10},
+//  {"op": "render", "in": 0, "out": 499, "target": ""},          //target为空用 null consumer
+//  {"op": "export", "format": "edl"},                            //edl、json或 edl-js（旧的 JavaScript导出器）
+//  {"op": "delete-alternate", "clips": 1000}                     //在单独生成的轨道上隔一个删一个，比较批量与逐个删除
+//op还支持 overwrite、append、remove、lift、trim-out；stride为每次重复时 clip的增量。
+class TimelineBenchmark : public BenchmarkSuite
+{
+    Q_OBJECT
+public:
+    explicit TimelineBenchmark(BenchmarkRunner& runner);
+
+    //生成合成工程：short-clips（单轨大量短片段）、many-tracks（多轨）、heavy-filters（每个片段挂多个滤镜）
+    static bool generateProject(const QString& kind, int count, const QString& fileName);
+    static QStringList projectKinds();
+
+    QStringList operations() const;
+    bool prepare();
+    bool run(const QString& name, const QJsonObject& op, int iteration);
+
+private:
+    bool render(const QJsonObject& op);
+    bool exportTimeline(const QJsonObject& op);
+    bool deleteAlternate(const QJsonObject& op);
+    bool loadProject(const QString& fileName);
+    bool clipExists(int trackIndex, int clipIndex) const;
+    int clipCount(int trackIndex) const;
+    QString colorClipXml(int frames) const;
+
+    MultitrackModel m_model;
+    QUndoStack m_undoStack;
+    QString m_projectFile;
+};
+
+#endif // TIMELINEBENCHMARK_H
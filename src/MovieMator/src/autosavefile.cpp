@@ -23,6 +23,7 @@
 #include <QtCore/QDir>
 #include <QtCore/QStandardPaths>
 #include <QtCore/QCryptographicHash>
+#include <QtCore/QSaveFile>
 
 static const QLatin1String subdir("/autosave");
 static const QLatin1String extension(".mmp");
@@ -72,6 +73,24 @@ bool AutoSaveFile::open(OpenMode openmode)
     return QFile::open(openmode);
 }
 
+bool AutoSaveFile::replaceWith(const QString &tempFileName)
+{
+    QFile temp(tempFileName);
+    bool ok = temp.open(QIODevice::ReadOnly) && temp.size() > 0;
+    if (ok) {
+        // QSaveFile 提交时用重命名替换目标文件；先关闭自己，Windows 上打开的文件不能被替换
+        if (isOpen())
+            close();
+        QSaveFile file(fileName());
+        ok = file.open(QIODevice::WriteOnly)
+                && file.write(temp.readAll()) == temp.size()
+                && file.commit();
+        temp.close();
+    }
+    temp.remove();
+    return ok;
+}
+
 AutoSaveFile* AutoSaveFile::getFile(const QString &filename)
 {
     AutoSaveFile* result = nullptr;
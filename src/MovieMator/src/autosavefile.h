@@ -35,6 +35,8 @@ public:
     void changeManagedFile(const QString &filename);
 
     virtual bool open(OpenMode openmode);
+    // 用写好的临时文件整体替换自动保存文件，并删除临时文件
+    bool replaceWith(const QString &tempFileName);
     static AutoSaveFile* getFile(const QString &filename);
     static QString path();
 
@@ -189,6 +189,67 @@ void RemoveClipCommand::undo_impl()
     m_undoHelper.undoChanges();
 }
 
+RemoveClipsCommand::RemoveClipsCommand(MultitrackModel &model, int trackIndex,
+    const QList<int>& clipIndexes, bool lift, AbstractCommand *parent)
+    : AbstractCommand(model, parent)
+    , m_model(model)
+    , m_trackIndex(trackIndex)
+    , m_clipIndexes(clipIndexes)
+    , m_lift(lift)
+    , m_undoHelper(m_model)
+{
+    if (m_lift)
+        setText(QObject::tr("Lift from track"));
+    else
+        setText(QObject::tr("Remove from track"));
+}
+
+void RemoveClipsCommand::redo_impl()
+{
+    LOG_DEBUG() << "trackIndex" << m_trackIndex << "clips" << m_clipIndexes.count() << "lift" << m_lift;
+    m_undoHelper.recordBeforeState();
+    if (m_lift)
+        m_model.liftClips(m_trackIndex, m_clipIndexes);
+    else
+        m_model.removeClips(m_trackIndex, m_clipIndexes);
+    m_undoHelper.recordAfterState();
+}
+
+void RemoveClipsCommand::undo_impl()
+{
+    LOG_DEBUG() << "trackIndex" << m_trackIndex << "clips" << m_clipIndexes.count() << "lift" << m_lift;
+    m_undoHelper.undoChanges();
+}
+
+
+LoudnessGainCommand::LoudnessGainCommand(MultitrackModel &model, const QList<LoudnessGain>& gains,
+    double targetLufs, AbstractCommand *parent)
+    : AbstractCommand(model, parent)
+    , m_model(model)
+    , m_gains(gains)
+    , m_targetLufs(targetLufs)
+    , m_undoHelper(m_model)
+{
+    setText(QObject::tr("Normalize loudness"));
+}
+
+void LoudnessGainCommand::redo_impl()
+{
+    LOG_DEBUG() << "clips" << m_gains.count() << "target" << m_targetLufs;
+    m_undoHelper.recordBeforeState();
+    m_model.beginBatch();
+    foreach (const LoudnessGain& gain, m_gains)
+        m_model.setLoudnessGain(gain.trackIndex, gain.clipIndex, gain.gainDb, m_targetLufs);
+    m_model.endBatch();
+    m_undoHelper.recordAfterState();
+}
+
+void LoudnessGainCommand::undo_impl()
+{
+    LOG_DEBUG() << "clips" << m_gains.count() << "target" << m_targetLufs;
+    m_undoHelper.undoChanges();
+}
+
 
 NameTrackCommand::NameTrackCommand(MultitrackModel &model, int trackIndex,
     const QString &name, AbstractCommand *parent)
@@ -318,7 +379,7 @@ void MoveClipCommand::redo_impl()
 {
     LOG_DEBUG() << "fromTrack" << m_fromTrackIndex << "toTrack" << m_toTrackIndex;
     m_undoHelper.recordBeforeState();
-    MAIN.timelineDock()->setCurrentTrack(m_toTrackIndex);
+    emit m_model.currentTrackRequested(m_toTrackIndex);
     m_model.moveClip(m_fromTrackIndex, m_toTrackIndex, m_fromClipIndex, m_toStart);
     m_undoHelper.recordAfterState();
     qDebug()<<"redo ends";
@@ -327,7 +388,7 @@ void MoveClipCommand::redo_impl()
 void MoveClipCommand::undo_impl()
 {
     LOG_DEBUG() << "fromTrack" << m_fromTrackIndex << "toTrack" << m_toTrackIndex;
-    MAIN.timelineDock()->setCurrentTrack(m_fromTrackIndex);
+    emit m_model.currentTrackRequested(m_fromTrackIndex);
     m_undoHelper.undoChanges();
 }
 
@@ -1204,7 +1265,7 @@ bool FilterCommand::mergeWith(const QUndoCommand *other)
 
 void FilterCommand::notify()
 {
-    MLT.refreshConsumer();
+    MAIN.timelineDock()->model()->refreshService(m_attachedFiltersModel.producer());
     MAIN.filterController()->refreshCurrentFilter(m_filterIndex);
 
 
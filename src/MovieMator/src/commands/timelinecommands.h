@@ -133,6 +133,41 @@ private:
     TimelineDock& m_timeline;
 };
 
+//批量移除或提起同一轨道上的多个clip，整个操作只记录一次撤销状态
+class RemoveClipsCommand : public AbstractCommand
+{
+public:
+    RemoveClipsCommand(MultitrackModel& model, int trackIndex, const QList<int>& clipIndexes, bool lift, AbstractCommand * parent = nullptr);
+    void redo_impl();
+    void undo_impl();
+private:
+    MultitrackModel& m_model;
+    int m_trackIndex;
+    QList<int> m_clipIndexes;
+    bool m_lift;
+    UndoHelper m_undoHelper;
+};
+
+//响度标准化：一次给多个clip设置增益，作为一个撤销步骤
+struct LoudnessGain {
+    int trackIndex;
+    int clipIndex;
+    double gainDb;
+};
+
+class LoudnessGainCommand : public AbstractCommand
+{
+public:
+    LoudnessGainCommand(MultitrackModel& model, const QList<LoudnessGain>& gains, double targetLufs, AbstractCommand * parent = nullptr);
+    void redo_impl();
+    void undo_impl();
+private:
+    MultitrackModel& m_model;
+    QList<LoudnessGain> m_gains;
+    double m_targetLufs;
+    UndoHelper m_undoHelper;
+};
+
 //设置轨道名字
 class NameTrackCommand : public AbstractCommand
 {
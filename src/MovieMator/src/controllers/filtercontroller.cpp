@@ -36,6 +36,7 @@
 #include <MltFilter.h>
 #include <map>
 #include "mainwindow.h"
+#include "docks/timelinedock.h"
 #include "util.h"
 #include <assert.h>
 
@@ -44,12 +45,15 @@ FilterController::FilterController(QObject* parent) : QObject(parent),
  m_attachedModel(this),
  m_currentFilterIndex(-1)
 {
+    m_attachedModel.setMetadataModel(&m_metadataModel);
     startTimer(0);
 
     connect(&m_attachedModel, SIGNAL(changed()), this, SLOT(handleAttachedModelChange()));
     connect(&m_attachedModel, SIGNAL(modelAboutToBeReset()), this, SLOT(handleAttachedModelAboutToReset()));
-    connect(&m_attachedModel, SIGNAL(rowsRemoved(const QModelIndex&,int,int)), this, SLOT(handleAttachedRowsRemoved(const QModelIndex&,int,int)));
-    connect(&m_attachedModel, SIGNAL(rowsInserted(const QModelIndex&,int,int)), this, SLOT(handleAttachedRowsInserted(const QModelIndex&,int,int)), Qt::QueuedConnection);
+    connect(&m_attachedModel, SIGNAL(producerAboutToChange()), this, SLOT(handleAttachedModelAboutToReset()));
+    // 切换clip时model也会增删行，所以只响应添加、删除滤镜的操作
+    connect(&m_attachedModel, SIGNAL(filterRemoved(int)), this, SLOT(handleAttachedFilterRemoved(int)));
+    connect(&m_attachedModel, SIGNAL(filterAdded(int)), this, SLOT(handleAttachedFilterAdded(int)), Qt::QueuedConnection);
     connect(&m_attachedModel, SIGNAL(duplicateAddFailed(int)), this, SLOT(handleAttachDuplicateFailed(int)));
 }
 
@@ -341,27 +345,7 @@ void FilterController::loadFrei0rFilterMetadata()
 
 QmlMetadata *FilterController::metadataForService(Mlt::Service *service)
 {
-    Q_ASSERT(service);
-
-    QmlMetadata* meta = nullptr;
-    int rowCount = m_metadataModel.rowCount();
-    QString uniqueId = service->get(kShotcutFilterProperty);
-
-    // Fallback to mlt_service for legacy filters
-    if (uniqueId.isEmpty()) {
-        uniqueId = service->get("mlt_service");
-    }
-
-    for (int i = 0; i < rowCount; i++) {
-        QmlMetadata* tmpMeta = m_metadataModel.get(i);
-        Q_ASSERT(tmpMeta);
-        if (tmpMeta->uniqueId() == uniqueId) {
-            meta = tmpMeta;
-            break;
-        }
-    }
-
-    return meta;
+    return m_metadataModel.metadataForService(service);
 }
 
 QString FilterController::getFilterThumbnailPath(QString filterName, bool isAudio)
@@ -652,6 +636,9 @@ void FilterController::refreshCurrentFilter(int filterIndex)
     QmlMetadata* meta = m_attachedModel.getMetadata(m_currentFilterIndex);
     Q_ASSERT(meta);
 
+    // 撤销命令直接修改了 Mlt::Filter
+    if (m_currentFilter)
+        m_currentFilter->invalidateKeyFrameIndex();
     emit currentFilterChanged(m_currentFilter.data(), meta, m_currentFilterIndex);
 }
 
@@ -696,6 +683,8 @@ void FilterController::insertKeyFrame(Mlt::Filter *filter, const QVector<key_fra
     Q_ASSERT(mltFilter);
     if(mltFilter->get_filter() != filter->get_filter())     return;
 
+    //按属性分组后批量写入
+    QMap<QString, QPair<QList<int>, QStringList> > keyFrames;
     for(int nIndex = 0; nIndex < listKeyFrame.count(); nIndex++)
     {
         key_frame_item para = listKeyFrame.at(nIndex);
@@ -703,10 +692,14 @@ void FilterController::insertKeyFrame(Mlt::Filter *filter, const QVector<key_fra
         QMap<QString, QString>::Iterator iter = para.paraMap.begin();
         while(iter != para.paraMap.end())
         {
-            qmlFilter->cache_setKeyFrameParaValue(para.keyFrame, iter.key(), iter.value(), true);
+            keyFrames[iter.key()].first << para.keyFrame;
+            keyFrames[iter.key()].second << iter.value();
             iter++;
         }
     }
+    QMap<QString, QPair<QList<int>, QStringList> >::ConstIterator iter = keyFrames.constBegin();
+    for (; iter != keyFrames.constEnd(); ++iter)
+        qmlFilter->cache_setKeyFrameParaValues(iter.value().first, iter.key(), iter.value().second, true);
     qmlFilter->syncCacheToProject();
 }
 
@@ -721,6 +714,8 @@ void FilterController::removeKeyFrame(Mlt::Filter *filter, const QVector<key_fra
     Q_ASSERT(mltFilter);
     if(mltFilter->get_filter() != filter->get_filter())     return;
 
+    //按属性分组后批量删除
+    QMap<QString, QList<int> > keyFrames;
     for(int nIndex = 0; nIndex < listKeyFrame.count(); nIndex++)
     {
         key_frame_item para = listKeyFrame.at(nIndex);
@@ -728,10 +723,13 @@ void FilterController::removeKeyFrame(Mlt::Filter *filter, const QVector<key_fra
         QMap<QString, QString>::Iterator iter = para.paraMap.begin();
         while(iter != para.paraMap.end())
         {
-            qmlFilter->removeAnimationKeyFrame(para.keyFrame, iter.key(), true);
+            keyFrames[iter.key()] << para.keyFrame;
             iter++;
         }
     }
+    QMap<QString, QList<int> >::ConstIterator iter = keyFrames.constBegin();
+    for (; iter != keyFrames.constEnd(); ++iter)
+        qmlFilter->removeAnimationKeyFrames(iter.value(), iter.key(), true);
     qmlFilter->syncCacheToProject();
 }
 
@@ -752,7 +750,7 @@ void FilterController::updateKeyFrame(Mlt::Filter *filter, int nFrame, QString n
 
 void FilterController::handleAttachedModelChange()
 {
-    MLT.refreshConsumer();
+    MAIN.timelineDock()->model()->refreshService(m_attachedModel.producer());
 }
 
 void FilterController::handleAttachedModelAboutToReset()
@@ -760,7 +758,7 @@ void FilterController::handleAttachedModelAboutToReset()
     setCurrentFilter(-1);
 }
 
-void FilterController::handleAttachedRowsRemoved(const QModelIndex&, int first, int)
+void FilterController::handleAttachedFilterRemoved(int first)
 {
     int newFilterIndex = first;
     if (newFilterIndex >= m_attachedModel.rowCount()) {
@@ -770,7 +768,7 @@ void FilterController::handleAttachedRowsRemoved(const QModelIndex&, int first,
     setCurrentFilter(newFilterIndex);
 }
 
-void FilterController::handleAttachedRowsInserted(const QModelIndex&, int first, int)
+void FilterController::handleAttachedFilterAdded(int first)
 {
     Q_ASSERT(first >= 0);
     Q_ASSERT(first < m_attachedModel.rowCount());
@@ -889,20 +887,7 @@ QmlMetadata *FilterController::metadataForUniqueId(const char *uniqueId)
 {
     Q_ASSERT(uniqueId);
 
-    QmlMetadata* meta = nullptr;
-    int rowCount = m_metadataModel.rowCount();
-    QString qstrUniqueId(uniqueId);
-
-    for (int i = 0; i < rowCount; i++) {
-        QmlMetadata* tmpMeta = m_metadataModel.get(i);
-        Q_ASSERT(tmpMeta);
-        if (tmpMeta->uniqueId() == qstrUniqueId) {
-            meta = tmpMeta;
-            break;
-        }
-    }
-
-    return meta;
+    return m_metadataModel.metadataForUniqueId(QString(uniqueId));
 }
 
 void FilterController::addFilter(int nFilterIndex)
@@ -122,10 +122,10 @@ private slots:
     void handleAttachedModelAboutToReset();
     //添加QmlMetadata到m_metadataModel中
     void addMetadata(QmlMetadata*);
-    //接收m_attachedModel的rowsRemoved信号，即当m_attachedModel中有filter删除时触发，并更新当前的滤镜
-    void handleAttachedRowsRemoved(const QModelIndex & parent, int first, int last);
-    //接收m_attachedModel的rowsInserted信号，即当m_attachedModel中增加filter时触发，并设置插入的滤镜为当前滤镜
-    void handleAttachedRowsInserted(const QModelIndex & parent, int first, int last);
+    //接收m_attachedModel的filterRemoved信号，即当m_attachedModel中有filter删除时触发，并更新当前的滤镜
+    void handleAttachedFilterRemoved(int first);
+    //接收m_attachedModel的filterAdded信号，即当m_attachedModel中增加filter时触发，并设置插入的滤镜为当前滤镜
+    void handleAttachedFilterAdded(int first);
     //接收m_attachedModel的duplicateAddFailed信号，即当m_attachedModel中重复添加filter失败时触发，并设置当前滤镜为index
     void handleAttachDuplicateFailed(int index);
 
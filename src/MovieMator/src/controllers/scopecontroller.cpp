@@ -29,6 +29,7 @@
 
 ScopeController::ScopeController(QMainWindow* mainWindow, QMenu* menu)
   : QObject(mainWindow)
+  , m_scopeCount(0)
 {
     LOG_DEBUG() << "begin";
     QMenu* scopeMenu = menu->addMenu(tr("Scopes"));
@@ -42,12 +43,34 @@ ScopeController::ScopeController(QMainWindow* mainWindow, QMenu* menu)
     LOG_DEBUG() << "end";
 }
 
+ScopeController::~ScopeController()
+{
+    LOG_INFO() << "frames pushed" << m_frames.pushed()
+               << "writer retries" << m_frames.writerRetries()
+               << "writer drops" << m_frames.writerDrops();
+    for (int i = 0; i < m_scopeCount; i++) {
+        FrameFanout<SharedFrame>::Statistics stats = m_frames.statistics(i);
+        LOG_INFO() << "scope" << i << "delivered" << stats.delivered
+                   << "dropped" << stats.dropped << "retries" << stats.retries;
+    }
+}
+
+void ScopeController::onFrameDisplayed(const SharedFrame& frame)
+{
+    if (!m_frames.activeCount())
+        return;
+    m_frames.push(frame);
+    emit framesAvailable();
+}
+
 template<typename ScopeTYPE> void ScopeController::createScopeDock(QMainWindow* mainWindow, QMenu* menu)
 {
     Q_ASSERT(mainWindow);
     Q_ASSERT(menu);
 
     ScopeWidget* scopeWidget = new ScopeTYPE();
+    scopeWidget->setFrameSource(&m_frames);
+    ++m_scopeCount;
     ScopeDock* scopeDock = new ScopeDock(this, scopeWidget);
 
     Q_ASSERT(scopeWidget);
@@ -22,6 +22,7 @@
 #include <QObject>
 #include <QString>
 #include "sharedframe.h"
+#include "framefanout.h"
 
 class QMainWindow;
 class QMenu;
@@ -33,13 +34,22 @@ class ScopeController Q_DECL_FINAL : public QObject
 
 public:
     ScopeController(QMainWindow* mainWindow, QMenu* menu);
+    ~ScopeController();
 
 signals:
-    void newFrame(const SharedFrame& frame);
+    //! Emitted after a frame was published to the active scopes.
+    void framesAvailable();
+
+public slots:
+    void onFrameDisplayed(const SharedFrame& frame);
 
 private:
     template<typename ScopeTYPE> void createScopeDock(QMainWindow* mainWindow, QMenu* menu);
 
+    // 所有示波器共享一个无锁环形缓冲，隐藏的示波器不接收帧
+    FrameFanout<SharedFrame> m_frames;
+    int m_scopeCount;
+
 };
 
 #endif // SCOPECONTROLLER_H
@@ -31,6 +31,8 @@
 #include "shotcut_mlt_properties.h"
 #include "registrationchecker.h"
 #include "jobs/encodetask.h"
+#include "jobs/segmentedencodetask.h"
+#include "jobs/melttask.h"
 #include "encodetaskqueue.h"
 
 #include <Logger.h>
@@ -693,140 +695,285 @@ typedef struct {
     int nFrameRateDen;
 } FRAME_RATE;
 
-static int timeStringToFrames(const char *strTime, FRAME_RATE framerate)
+//把旧帧率下的时间换算为新帧率下的帧数
+//整个导出 XML共用一个实例，避免每个时间值都创建 Mlt::Profile
+class FrameRateConverter
 {
-    Q_ASSERT(strTime);
-    Q_ASSERT(framerate.nFrameRateDen > 0 && framerate.nFrameRateNum > 0);
-
-    Mlt::Properties mltProperties;
-    Mlt::Profile    mltProfile;
-
-    mltProfile.set_frame_rate(framerate.nFrameRateNum, framerate.nFrameRateDen);
-    mltProperties.set("_profile", mltProfile.get_profile(), 0);
-
-    return mltProperties.time_to_frames(strTime);
-}
-
-
-static int convertTimeToFramesWithNewFps(QString strOldTime, FRAME_RATE framerateOld, FRAME_RATE framerateNew)
-{
-    //clock格式（hh:mm:ss.sss）不转换
-//    if ( (strOldTime.contains(":") && strOldTime.contains("."))
-//         || (strOldTime.contains(":") && strOldTime.contains(","))
-//         )
-//        return -1;
-
-    int nFramesNew = 0;
-    int nFrameOld = timeStringToFrames(strOldTime.toUtf8().constData(), framerateOld);
+public:
+    FrameRateConverter(FRAME_RATE framerateOld, FRAME_RATE framerateNew)
+    {
+        Q_ASSERT(framerateOld.nFrameRateDen > 0 && framerateOld.nFrameRateNum > 0);
+        Q_ASSERT(framerateNew.nFrameRateDen > 0 && framerateNew.nFrameRateNum > 0);
 
-    double dFpsOld = framerateOld.nFrameRateNum * 1.0 / framerateOld.nFrameRateDen;
-    double dFpsNew = framerateNew.nFrameRateNum * 1.0 / framerateNew.nFrameRateDen;
+        m_profile.set_frame_rate(framerateOld.nFrameRateNum, framerateOld.nFrameRateDen);
+        m_properties.set("_profile", m_profile.get_profile(), 0);
 
-    double dFramesNew =  nFrameOld * dFpsNew / dFpsOld;
+        double dFpsOld = framerateOld.nFrameRateNum * 1.0 / framerateOld.nFrameRateDen;
+        double dFpsNew = framerateNew.nFrameRateNum * 1.0 / framerateNew.nFrameRateDen;
+        m_ratio = dFpsNew / dFpsOld;
 
-    srand(time(NULL));
+        //小数部分大于该阈值时向上取整
+        srand(time(NULL));
+        m_threshold = rand() * 1.0 / RAND_MAX;
+    }
 
-    if (qFuzzyIsNull(dFramesNew - floor(dFramesNew)))
-        nFramesNew = floor(dFramesNew);
-    else if(rand()*1.0/RAND_MAX > dFramesNew - floor(dFramesNew))
-        nFramesNew = floor(dFramesNew);
-    else
-        nFramesNew = floor(dFramesNew) + 1;
+    int timeToFrames(const QString& strTime)
+    {
+        bool ok = false;
+        int frames = strTime.toInt(&ok);
+        if (ok)
+            return frames;
+        return m_properties.time_to_frames(strTime.toUtf8().constData());
+    }
 
-    return nFramesNew;
-}
+    int convert(int nFrameOld)
+    {
+        double dFramesNew = nFrameOld * m_ratio;
 
-static void recaculateTimeAttribute(QDomElement &domElement, FRAME_RATE framerateOld, FRAME_RATE framerateNew)
-{
-    Q_ASSERT(!domElement.isNull());
+        if (qFuzzyIsNull(dFramesNew - floor(dFramesNew)))
+            return int(floor(dFramesNew));
+        else if (m_threshold > dFramesNew - floor(dFramesNew))
+            return int(floor(dFramesNew));
+        else
+            return int(floor(dFramesNew)) + 1;
+    }
 
-    //处理dom in out属性
-    QDomAttr domAttrOut = domElement.attributeNode("out");
-    if (!domAttrOut.isNull())
+    int convert(const QString& strOldTime)
     {
-        int nFrameIn = 0;
-        int nFrameOut = 0;
-        int nFrameLength = 0;
-
-        QString strOldTimeOut = domAttrOut.value();
-        nFrameOut = timeStringToFrames(strOldTimeOut.toUtf8().constData(), framerateOld);
+        return convert(timeToFrames(strOldTime));
+    }
 
-        QDomAttr domAttrIn = domElement.attributeNode("in");
-        if (!domAttrIn.isNull())
-        {
-            QString strOldTimeIn = domAttrIn.value();
-            nFrameIn = timeStringToFrames(strOldTimeIn.toUtf8().constData(), framerateOld);
+    //换算元素的 in、out、length属性
+    QXmlStreamAttributes convertAttributes(const QXmlStreamAttributes& attributes)
+    {
+        if (!attributes.hasAttribute("out") && !attributes.hasAttribute("length"))
+            return attributes;
+
+        QXmlStreamAttributes result;
+        bool hasIn = attributes.hasAttribute("in");
+        int nFrameInNew = 0;
+        int nFrameOutNew = 0;
+        if (attributes.hasAttribute("out")) {
+            int nFrameIn = 0;
+            int nFrameLength = 0;
+            int nFrameOut = timeToFrames(attributes.value("out").toString());
+            if (hasIn)
+                nFrameIn = timeToFrames(attributes.value("in").toString());
+            if (nFrameOut > 0)
+                nFrameLength = nFrameOut - nFrameIn + 1;
+
+            int nFrameLengthNew = convert(nFrameLength);
+            nFrameInNew = convert(nFrameIn);
+            nFrameOutNew = nFrameInNew + nFrameLengthNew - 1;
         }
 
-        if (nFrameOut > 0)
-            nFrameLength = nFrameOut - nFrameIn + 1;
-
-        int nFrameLengthNew = convertTimeToFramesWithNewFps(QString::number(nFrameLength), framerateOld, framerateNew);
-        int nFrameInNew = convertTimeToFramesWithNewFps(QString::number(nFrameIn), framerateOld, framerateNew);
-        int nFrameOutNew = nFrameInNew + nFrameLengthNew - 1;
-
-        domAttrOut.setValue(QString::number(nFrameOutNew));
-        if (!domAttrIn.isNull())
-            domAttrIn.setValue(QString::number(nFrameInNew));
+        foreach (const QXmlStreamAttribute& attribute, attributes) {
+            const QStringRef name = attribute.qualifiedName();
+            if (name == QLatin1String("out")) {
+                result.append(name.toString(), QString::number(nFrameOutNew));
+            } else if (name == QLatin1String("in") && attributes.hasAttribute("out")) {
+                result.append(name.toString(), QString::number(nFrameInNew));
+            } else if (name == QLatin1String("length")) {
+                int nFramesLengthNew = convert(attribute.value().toString());
+                if (nFramesLengthNew >= 0)
+                    result.append(name.toString(), QString::number(nFramesLengthNew));
+                else
+                    result.append(attribute);
+            } else {
+                result.append(attribute);
+            }
+        }
+        return result;
     }
 
-    //处理length属性
-    QDomAttr domAttrLength = domElement.attributeNode("length");
-    if (!domAttrLength.isNull())
-    {
-        QString strOldTimeLength = domAttrLength.value();
+private:
+    Mlt::Profile    m_profile;
+    Mlt::Properties m_properties;
+    double          m_ratio;
+    double          m_threshold;
+};
 
-        int nFramesLengthNew = convertTimeToFramesWithNewFps(strOldTimeLength, framerateOld, framerateNew);
-        if (nFramesLengthNew >= 0 )
-            domAttrLength.setValue(QString::number(nFramesLengthNew));
+//扫描导出 XML，得到 profile的个数和最后一个 profile的帧率
+static int scanProfiles(QIODevice* input, FRAME_RATE& framerate)
+{
+    int count = 0;
+    framerate.nFrameRateNum = 0;
+    framerate.nFrameRateDen = 0;
+    QXmlStreamReader reader(input);
+    while (!reader.atEnd()) {
+        if (reader.readNext() == QXmlStreamReader::StartElement && reader.name() == QLatin1String("profile")) {
+            count++;
+            framerate.nFrameRateNum = reader.attributes().value("frame_rate_num").toInt();
+            framerate.nFrameRateDen = reader.attributes().value("frame_rate_den").toInt();
+        }
     }
+    return count;
 }
 
-
-static int recalculateTimeInDomElement(QDomElement domElement, FRAME_RATE framerateOld, FRAME_RATE framerateNew)
+static void writeConsumerElement(QXmlStreamWriter& writer, const QDomElement& consumerNode)
 {
-    Q_ASSERT(!domElement.isNull());
-    Q_ASSERT(framerateOld.nFrameRateDen > 0 && framerateOld.nFrameRateNum > 0);
-    Q_ASSERT(framerateNew.nFrameRateDen > 0 && framerateNew.nFrameRateNum > 0);
-
-    int nErrorCode = 1;
-
-    if ((framerateOld.nFrameRateDen == framerateNew.nFrameRateDen)
-            && (framerateOld.nFrameRateNum == framerateNew.nFrameRateNum))
-        return nErrorCode;
+    writer.writeStartElement(consumerNode.tagName());
+    QDomNamedNodeMap attributes = consumerNode.attributes();
+    for (int i = 0; i < attributes.count(); i++) {
+        QDomAttr attribute = attributes.item(i).toAttr();
+        writer.writeAttribute(attribute.name(), attribute.value());
+    }
+    writer.writeEndElement();
+}
 
-    if (framerateOld.nFrameRateDen <= 0 || framerateOld.nFrameRateNum <= 0)
-        return nErrorCode;
+//缓存中的一个 property元素
+struct PendingProperty {
+    QXmlStreamAttributes attributes;
+    QString text;
+};
 
-    if (framerateNew.nFrameRateDen <= 0 || framerateNew.nFrameRateNum <= 0)
-        return nErrorCode;
+//producer的 property都在滤镜等子元素之前。代理素材把原始文件记在 kOriginalResourceProperty里，
+//导出时换回原始文件，代替 Controller::saveXML()之后再用 QDom改写一遍
+static void restoreOriginalResource(QList<PendingProperty>& properties)
+{
+    QHash<QString, int> byName;
+    for (int i = 0; i < properties.size(); i++)
+        byName.insert(properties.at(i).attributes.value("name").toString(), i);
+    if (!byName.contains(kOriginalResourceProperty))
+        return;
 
+    if (byName.contains("resource"))
+        properties[byName.value("resource")].text = properties.at(byName.value(kOriginalResourceProperty)).text;
+    if (byName.contains(kOriginalVideoIndexProperty) && byName.contains("video_index"))
+        properties[byName.value("video_index")].text = properties.at(byName.value(kOriginalVideoIndexProperty)).text;
+    if (byName.contains(kOriginalAudioIndexProperty) && byName.contains("audio_index"))
+        properties[byName.value("audio_index")].text = properties.at(byName.value(kOriginalAudioIndexProperty)).text;
+    for (int i = properties.size() - 1; i >= 0; i--) {
+        const QStringRef name = properties.at(i).attributes.value("name");
+        if (name == QLatin1String(kOriginalResourceProperty) || name == QLatin1String(kOriginalVideoIndexProperty)
+                || name == QLatin1String(kOriginalAudioIndexProperty))
+            properties.removeAt(i);
+    }
+}
 
-    //process attributes of element
-    recaculateTimeAttribute(domElement, framerateOld, framerateNew);
+//写出缓存的 property，lastOpen为 true时最后一个 property还没有结束，只写开始标签和已读到的文本
+static void flushProperties(QXmlStreamWriter& writer, QList<PendingProperty>& properties, bool lastOpen)
+{
+    restoreOriginalResource(properties);
+    for (int i = 0; i < properties.size(); i++) {
+        writer.writeStartElement("property");
+        writer.writeAttributes(properties.at(i).attributes);
+        writer.writeCharacters(properties.at(i).text);
+        if (!lastOpen || i + 1 < properties.size())
+            writer.writeEndElement();
+    }
+    properties.clear();
+}
 
+//流式转换导出用的 XML：在最后一个 profile后插入 consumer，给 playlist加上 autoclose，
+//代理素材换回原始文件，converter不为空时按输出帧率换算所有帧数并更新最后一个 profile的帧率
+static void transformExportXml(QIODevice* input, QIODevice* output, const QDomElement& consumerNode,
+                               int profileCount, FrameRateConverter* converter, FRAME_RATE framerateNew)
+{
+    QXmlStreamReader reader(input);
+    QXmlStreamWriter writer(output);
+    int depth = 0;
+    int profilesSeen = 0;
+    bool convertText = false;
+    int producerDepth = -1;     // 正在缓存 property的 producer的层级，-1表示没有缓存
+    bool propertyOpen = false;  // 缓存中的最后一个 property还没有读完
+    QList<PendingProperty> properties;
+
+    while (!reader.atEnd()) {
+        QXmlStreamReader::TokenType token = reader.readNext();
+        //producer的直接 property先缓存，其它内容出现时写出
+        if (producerDepth >= 0) {
+            if (token == QXmlStreamReader::StartElement && !propertyOpen && depth == producerDepth
+                    && reader.name() == QLatin1String("property")) {
+                depth++;
+                PendingProperty property;
+                property.attributes = converter? converter->convertAttributes(reader.attributes()) : reader.attributes();
+                convertText = converter
+                        && property.attributes.value("name").compare(QLatin1String("length"), Qt::CaseInsensitive) == 0;
+                properties.append(property);
+                propertyOpen = true;
+                continue;
+            }
+            //property之间的缩进不影响 MLT，直接丢掉
+            if (token == QXmlStreamReader::Characters && !propertyOpen && reader.isWhitespace())
+                continue;
+            if (token == QXmlStreamReader::Characters && propertyOpen) {
+                int nFramesNew = (convertText && !reader.isWhitespace())? converter->convert(reader.text().toString()) : -1;
+                properties.last().text += (nFramesNew > 0)? QString::number(nFramesNew) : reader.text().toString();
+                continue;
+            }
+            if (token == QXmlStreamReader::EndElement && propertyOpen && depth == producerDepth + 1) {
+                depth--;
+                convertText = false;
+                propertyOpen = false;
+                continue;
+            }
+            flushProperties(writer, properties, propertyOpen);
+            producerDepth = -1;
+            propertyOpen = false;
+        }
 
-    //process dom text of element
-    QString strElementName = domElement.attribute("name");
-    if (strElementName.compare("length", Qt::CaseInsensitive) == 0)
-    {
-        QDomNode   domNodeText = domElement.firstChild();
-        QString    strOldTime  = domNodeText.nodeValue();
+        switch (token) {
+        case QXmlStreamReader::StartElement: {
+            depth++;
+            QXmlStreamAttributes attributes = reader.attributes();
+            if (converter)
+                attributes = converter->convertAttributes(attributes);
+
+            if (reader.name() == QLatin1String("playlist")) {
+                QXmlStreamAttributes playlistAttributes;
+                foreach (const QXmlStreamAttribute& attribute, attributes)
+                    if (attribute.qualifiedName() != QLatin1String("autoclose"))
+                        playlistAttributes.append(attribute);
+                playlistAttributes.append("autoclose", "1");
+                attributes = playlistAttributes;
+            } else if (converter && reader.name() == QLatin1String("profile") && profilesSeen + 1 == profileCount) {
+                QXmlStreamAttributes profileAttributes;
+                foreach (const QXmlStreamAttribute& attribute, attributes)
+                    if (attribute.qualifiedName() != QLatin1String("frame_rate_num")
+                            && attribute.qualifiedName() != QLatin1String("frame_rate_den"))
+                        profileAttributes.append(attribute);
+                profileAttributes.append("frame_rate_num", QString::number(framerateNew.nFrameRateNum));
+                profileAttributes.append("frame_rate_den", QString::number(framerateNew.nFrameRateDen));
+                attributes = profileAttributes;
+            }
 
-        int nFramesNew = convertTimeToFramesWithNewFps(strOldTime, framerateOld, framerateNew);
-        if (nFramesNew > 0)
-            domNodeText.setNodeValue(QString::number(nFramesNew));
-    }
+            convertText = converter && reader.name() == QLatin1String("property")
+                    && attributes.value("name").compare(QLatin1String("length"), Qt::CaseInsensitive) == 0;
 
-    //process child elements
-    QDomNodeList nodeListChildNode = domElement.childNodes();
-    for (int i = 0; i < nodeListChildNode.count(); i++)
-    {
-        QDomElement childElement = nodeListChildNode.at(i).toElement();
-        if (!childElement.isNull())
-            recalculateTimeInDomElement(childElement, framerateOld, framerateNew);
+            writer.writeStartElement(reader.qualifiedName().toString());
+            writer.writeAttributes(attributes);
+            if (depth == 1 && profileCount == 0)
+                writeConsumerElement(writer, consumerNode);
+            if (reader.name() == QLatin1String("producer") || reader.name() == QLatin1String("chain"))
+                producerDepth = depth;
+            break;
+        }
+        case QXmlStreamReader::EndElement:
+            writer.writeEndElement();
+            depth--;
+            convertText = false;
+            if (reader.name() == QLatin1String("profile") && ++profilesSeen == profileCount)
+                writeConsumerElement(writer, consumerNode);
+            break;
+        case QXmlStreamReader::Characters:
+            if (convertText && !reader.isWhitespace()) {
+                int nFramesNew = converter->convert(reader.text().toString());
+                if (nFramesNew > 0)
+                    writer.writeCharacters(QString::number(nFramesNew));
+                else
+                    writer.writeCurrentToken(reader);
+            } else {
+                writer.writeCurrentToken(reader);
+            }
+            break;
+        default:
+            writer.writeCurrentToken(reader);
+            break;
+        }
     }
-    return 0;
+    if (reader.hasError())
+        LOG_WARNING() << "export xml:" << reader.errorString() << "at line" << reader.lineNumber();
 }
 
 //static int recalculateTimeInProjectFile(QString strProjectFile)
@@ -882,6 +1029,17 @@ static int recalculateTimeInDomElement(QDomElement domElement, FRAME_RATE framer
 
 MeltJob* EncodeDock::createMeltJob(Mlt::Service* service, const QString& target, int realtime, int pass)
 {
+    QTemporaryFile* xml = createMeltXml(service, target, realtime, pass);
+    return xml? new EncodeJob(target, xml) : nullptr;
+}
+
+QTemporaryFile* EncodeDock::createMeltXml(Mlt::Service* service, const QString& target, int realtime, int pass,
+                                  int in, int out, ExportStreams streams, int threads,
+                                  FrameRateConverter* sharedConverter)
+{
+    QElapsedTimer timer;
+    timer.start();
+
     // if image sequence, change filename to include number
     QString mytarget = target;
     if (!ui->disableVideoCheckbox->isChecked()) {
@@ -893,30 +1051,24 @@ MeltJob* EncodeDock::createMeltJob(Mlt::Service* service, const QString& target,
         }
     }
 
-    // get temp filename
-    QTemporaryFile tmp;
-
-    tmp.open();
-    tmp.close();
+    //工程只由 MLT序列化一次，结果留在 xml consumer的 string属性里；
+    //与 Controller::saveXML()的设置相同，不使用相对路径
+    Mlt::Consumer projectXml(MLT.profile(), "xml", "string");
+    projectXml.set("time_format", "clock");
+    projectXml.set("no_meta", 1);
+    projectXml.set("store", "moviemator");
+    projectXml.set("root", "MovieMator");
 
     //添加水印
-    addWatermark(service, tmp);
-
-    // parse xml
-    QFile f1(tmp.fileName());
-    f1.open(QIODevice::ReadOnly);
-    QDomDocument dom(tmp.fileName());
-    dom.setContent(&f1);
-    f1.close();
-
-
-    // add consumer element
-    QDomElement consumerNode = dom.createElement("consumer");
-    QDomNodeList profiles = dom.elementsByTagName("profile");
-    if (profiles.isEmpty())
-        dom.documentElement().insertAfter(consumerNode, dom.documentElement());
-    else
-        dom.documentElement().insertAfter(consumerNode, profiles.at(profiles.length() - 1));
+    addWatermark(service, projectXml);
+    const char* projectString = projectXml.get("string");
+    if (!projectString)
+        return nullptr;
+    QByteArray project = QByteArray::fromRawData(projectString, int(qstrlen(projectString)));
+
+    // consumer element is built on its own and streamed into the project XML
+    QDomDocument consumerDom;
+    QDomElement consumerNode = consumerDom.createElement("consumer");
     consumerNode.setAttribute("mlt_service", "avformat");
     consumerNode.setAttribute("target", mytarget);
     collectProperties(consumerNode, realtime);
@@ -939,29 +1091,38 @@ MeltJob* EncodeDock::createMeltJob(Mlt::Service* service, const QString& target,
             consumerNode.removeAttribute("fastfirstpass");
         }
     }
+    if (threads > 0 && consumerNode.attribute("threads").toInt() <= 0)
+        consumerNode.setAttribute("threads", threads);
+    //分段导出时视频段和音频分别编码
+    if (streams == VideoOnly) {
+        consumerNode.removeAttribute("acodec");
+        consumerNode.setAttribute("an", 1);
+    } else if (streams == AudioOnly) {
+        consumerNode.removeAttribute("vcodec");
+        consumerNode.removeAttribute("pass");
+        consumerNode.removeAttribute("passlogfile");
+        consumerNode.setAttribute("vn", 1);
+        //音频编码器基本是单线程的
+        consumerNode.setAttribute("threads", 1);
+    }
     if (ui->formatCombo->currentIndex() == 0 &&
             ui->audioCodecCombo->currentIndex() == 0 &&
             (mytarget.endsWith(".mp4") || mytarget.endsWith(".mov")))
         consumerNode.setAttribute("strict", "experimental");
 
-    // Add autoclose to playlists.
-    QDomNodeList playlists = dom.elementsByTagName("playlist");
-    for (int i = 0; i < playlists.length();++i)
-        playlists.item(i).toElement().setAttribute("autoclose", 1);
+    QBuffer f1(&project);
+    if (!f1.open(QIODevice::ReadOnly))
+        return nullptr;
+
+    FRAME_RATE  framerateOld;
+    FRAME_RATE  framerateNew = {0, 0};
+    int profileCount = scanProfiles(&f1, framerateOld);
+    QScopedPointer<FrameRateConverter> ownConverter;
+    FrameRateConverter* converter = nullptr;
 
     if(!ui->disableVideoCheckbox->isChecked())
     {
-        FRAME_RATE  framerateOld;
-        FRAME_RATE  framerateNew;
-
-        QDomElement domElementProfile;
-        if (!profiles.isEmpty())
-        {
-            domElementProfile = profiles.at(profiles.length() - 1).toElement();
-            framerateOld.nFrameRateNum = domElementProfile.attribute("frame_rate_num").toInt();
-            framerateOld.nFrameRateDen = domElementProfile.attribute("frame_rate_den").toInt();
-        }
-        else
+        if (profileCount == 0)
         {
             Q_ASSERT(false);
         }
@@ -979,26 +1140,43 @@ MeltJob* EncodeDock::createMeltJob(Mlt::Service* service, const QString& target,
         else
         {
             Q_ASSERT(false);
+            framerateNew = framerateOld;
         }
 
-
         //根据输出帧率转换xml中保存的帧数
-        int nRet = recalculateTimeInDomElement(dom.documentElement(), framerateOld, framerateNew);
-        if (nRet == 0)
+        if (framerateOld.nFrameRateNum > 0 && framerateOld.nFrameRateDen > 0
+                && framerateNew.nFrameRateNum > 0 && framerateNew.nFrameRateDen > 0
+                && (framerateOld.nFrameRateNum != framerateNew.nFrameRateNum
+                    || framerateOld.nFrameRateDen != framerateNew.nFrameRateDen))
         {
-            if (!domElementProfile.isNull())
-            {
-                domElementProfile.setAttribute("frame_rate_num", framerateNew.nFrameRateNum);
-                domElementProfile.setAttribute("frame_rate_den", framerateNew.nFrameRateDen);
-            }
+            //分段导出的各段共用一个转换器，取整方式一致，各段的时长才能对上
+            if (!sharedConverter)
+                ownConverter.reset(new FrameRateConverter(framerateOld, framerateNew));
+            converter = sharedConverter? sharedConverter : ownConverter.data();
         }
     }
 
-    return new EncodeJob(target, dom.toString(2));
+    //in、out为输出帧率下的帧数，不参与帧率转换
+    if (in >= 0 && out >= in) {
+        consumerNode.setAttribute("in", in);
+        consumerNode.setAttribute("out", out);
+    }
+
+    //直接写入 MeltJob/MeltTask使用的文件
+    QScopedPointer<QTemporaryFile> xml(MeltTask::createXmlFile());
+    if (!xml->open())
+        return nullptr;
+    f1.seek(0);
+    transformExportXml(&f1, xml.data(), consumerNode, profileCount, converter, framerateNew);
+    f1.close();
+    xml->close();
+
+    LOG_DEBUG() << "export xml for" << target << "built in" << timer.elapsed() << "ms," << xml->size() << "bytes";
+    return xml.take();
 }
 
-//添加水印
-void EncodeDock::addWatermark(Mlt::Service* pService, QTemporaryFile& tmpProjectXml)
+//添加水印后用 xmlConsumer序列化工程，再移除水印
+void EncodeDock::addWatermark(Mlt::Service* pService, Mlt::Consumer& xmlConsumer)
 {
     Q_ASSERT(pService);
     if (!pService)
@@ -1094,8 +1272,15 @@ void EncodeDock::addWatermark(Mlt::Service* pService, QTemporaryFile& tmpProject
     }
 #endif
 
-    //保存已添加水印的工程为xml工程文件
-    MLT.saveXML(tmpProjectXml.fileName(), pService, false /* without relative paths */);
+    //序列化已添加水印的工程
+    Mlt::Service service(pService->get_service());
+    int ignore = service.get_int("ignore_points");
+    if (ignore)
+        service.set("ignore_points", 0);
+    xmlConsumer.connect(service);
+    xmlConsumer.start();
+    if (ignore)
+        service.set("ignore_points", ignore);
 
     //从当前工程中移除水印
 #if SHARE_VERSION
@@ -1195,6 +1380,92 @@ void EncodeDock::enqueueMelt(const QString& target, int realtime)
     }
 }
 
+//每段至少包含的 GOP数，太短的工程分段得不偿失
+static const int kMinGopsPerSegment = 10;
+static const int kMaxSegments = 8;
+
+bool EncodeDock::enqueueSegmentedMelt(const QString& target, int realtime)
+{
+    Mlt::Service* service = fromProducer();
+    if (!service)
+        service = MLT.producer();
+    if (!service || !service->is_valid() || ui->disableVideoCheckbox->isChecked())
+        return false;
+
+    //图片序列没有可以拼接的容器
+    const QString& codec = ui->videoCodecCombo->currentText();
+    if (codec == "bmp" || codec == "dpx" || codec == "png" || codec == "ppm" ||
+            codec == "targa" || codec == "tiff" || ui->formatCombo->currentText() == "image2")
+        return false;
+
+    //按输出帧率计算总帧数。各段 XML都用这个转换器换算帧数，
+    //取整方式相同，总帧数与导出的 tractor长度一致
+    FRAME_RATE framerateOld = {MLT.profile().frame_rate_num(), MLT.profile().frame_rate_den()};
+    FRAME_RATE framerateNew = framerateOld;
+    Mlt::Properties* p = collectProperties(realtime);
+    if (p->get_int("frame_rate_num") > 0 && p->get_int("frame_rate_den") > 0) {
+        framerateNew.nFrameRateNum = p->get_int("frame_rate_num");
+        framerateNew.nFrameRateDen = p->get_int("frame_rate_den");
+    } else if (p->get_int("r") > 0) {
+        framerateNew.nFrameRateNum = p->get_int("r");
+        framerateNew.nFrameRateDen = 1;
+    }
+    delete p;
+    QScopedPointer<FrameRateConverter> converter;
+    if (framerateOld.nFrameRateNum != framerateNew.nFrameRateNum
+            || framerateOld.nFrameRateDen != framerateNew.nFrameRateDen)
+        converter.reset(new FrameRateConverter(framerateOld, framerateNew));
+    Mlt::Producer producer(*service);
+    int length = converter? converter->convert(producer.get_length()) : producer.get_length();
+
+    int gop = qMax(1, ui->gopSpinner->value());
+    int segments = qMin(QThread::idealThreadCount() / 2, kMaxSegments);
+    segments = qMin(segments, length / (gop * kMinGopsPerSegment));
+    if (segments < 2)
+        return false;
+
+    QFileInfo fi(target);
+    int pass = ui->dualPassCheckbox->isEnabled() && ui->dualPassCheckbox->isChecked()? 1 : 0;
+    SegmentedEncodeTask* task = new SegmentedEncodeTask(target);
+    //自动线程数时把核平分给各段，否则每段都按全部核计算，只能一段一段地编码
+    int threads = qMax(1, QThread::idealThreadCount() / segments);
+
+    //分段起点对齐到 GOP边界，每段以关键帧开始；in、out都是输出帧率下的帧数
+    int in = 0;
+    int total = 0;
+    for (int i = 0; i < segments; i++) {
+        int out = length - 1;
+        if (i + 1 < segments)
+            out = int(qint64(length) * (i + 1) / segments / gop * gop) - 1;
+        QString path = QString("%1/.%2.part%3.%4").arg(fi.path()).arg(fi.completeBaseName()).arg(i).arg(fi.suffix());
+        QList<QTemporaryFile*> passXml;
+        passXml << createMeltXml(service, path, -1, pass, in, out, VideoOnly, threads, converter.data());
+        if (pass)
+            passXml << createMeltXml(service, path, -1, 2, in, out, VideoOnly, threads, converter.data());
+        if (passXml.contains(nullptr)) {
+            qDeleteAll(passXml);
+            delete task;
+            return false;
+        }
+        task->addSegment(passXml, path, out - in + 1);
+        total += out - in + 1;
+        in = out + 1;
+    }
+    Q_ASSERT(total == length);
+    if (!ui->disableAudioCheckbox->isChecked()) {
+        QString path = QString("%1/.%2.audio.%3").arg(fi.path()).arg(fi.completeBaseName()).arg(fi.suffix());
+        QTemporaryFile* xml = createMeltXml(service, path, -1, 0, -1, -1, AudioOnly, 0, converter.data());
+        if (!xml) {
+            delete task;
+            return false;
+        }
+        task->setAudio(xml, path, length);
+    }
+    task->setLabel(fi.fileName());
+    ENCODETASKS.addTask(task);
+    return true;
+}
+
 void EncodeDock::encode(const QString& target)
 {
     bool isMulti = true;
@@ -1492,7 +1763,9 @@ void EncodeDock::on_encodeButton_clicked()
                 threadCount = qMin(threadCount - 1, 4);
             else
                 threadCount = 1;
-            enqueueMelt(m_outputFilename, Settings.playerGPU()? -1 : -threadCount);
+            if (!ui->segmentedCheckbox->isChecked()
+                    || !enqueueSegmentedMelt(m_outputFilename, Settings.playerGPU()? -1 : -threadCount))
+                enqueueMelt(m_outputFilename, Settings.playerGPU()? -1 : -threadCount);
 
             this->hide();
 
@@ -36,8 +36,10 @@ namespace Ui {
 class AbstractJob;
 class MeltJob;
 class QTemporaryFile;
+class FrameRateConverter;
 namespace Mlt {
     class Service;
+    class Consumer;
 }
 
 class PresetsProxyModel : public QSortFilterProxyModel
@@ -169,12 +171,27 @@ private:
     Mlt::Properties* collectProperties(int realtime);
     // 从界面配置给 node设定个属性值
     void collectProperties(QDomElement& node, int realtime);
+    // 导出的流，分段导出时视频和音频分开编码
+    enum ExportStreams {
+        AllStreams = 0,
+        VideoOnly,
+        AudioOnly
+    };
     // 创建 MeltJob
     MeltJob* createMeltJob(Mlt::Service* service, const QString& target, int realtime, int pass = 0);
+    // 生成导出用的 MLT XML，直接写入 MeltJob/MeltTask使用的临时文件，由调用者接管，失败时返回 nullptr
+    // in、out为输出帧率下的导出范围（-1表示全部），threads > 0时代替自动（0）的编码线程数
+    // sharedConverter不为空时用它换算帧率，分段导出的各段取整一致
+    QTemporaryFile* createMeltXml(Mlt::Service* service, const QString& target, int realtime, int pass = 0,
+                          int in = -1, int out = -1, ExportStreams streams = AllStreams, int threads = 0,
+                          FrameRateConverter* sharedConverter = nullptr);
+    // 把时间线按 GOP对齐分成若干段并行编码，再无损拼接，音频单独连续编码
+    // 返回 false表示当前设置不适合分段导出
+    bool enqueueSegmentedMelt(const QString& target, int realtime);
     // 执行 m_immediateJob
     void runMelt(const QString& target, int realtime = -1);
-    // 添加水印
-    void addWatermark(Mlt::Service* pService, QTemporaryFile& tmpProjectXml);
+    // 添加水印并用 xmlConsumer序列化工程
+    void addWatermark(Mlt::Service* pService, Mlt::Consumer& xmlConsumer);
 
     // ???
     void encode(const QString& target);
@@ -19,6 +19,7 @@
 #include "encodetaskdock.h"
 #include "ui_encodetaskdock.h"
 #include "encodetaskqueue.h"
+#include "settings.h"
 #include <QMenu>
 #include <QMessageBox>
 #include "iratetransport.h"
@@ -34,6 +35,10 @@ EncodeTaskDock::EncodeTaskDock(QWidget *parent) :
     header->setStretchLastSection(false);
     header->setSectionResizeMode(0, QHeaderView::Stretch);
     header->setSectionResizeMode(1, QHeaderView::ResizeToContents);
+
+    ui->concurrentSpinBox->blockSignals(true);
+    ui->concurrentSpinBox->setValue(Settings.encodeConcurrentTasks());
+    ui->concurrentSpinBox->blockSignals(false);
 }
 
 EncodeTaskDock::~EncodeTaskDock()
@@ -55,6 +60,11 @@ void EncodeTaskDock::on_treeView_customContextMenuRequested(const QPoint &pos)
 
         if (!task->ran() || task->stopped())
             menu.addAction(ui->actionRemove);
+
+        if (!task->ran()) {
+            menu.addAction(ui->actionRaisePriority);
+            menu.addAction(ui->actionLowerPriority);
+        }
     }
     menu.exec(mapToGlobal(pos));
 }
@@ -75,6 +85,22 @@ void EncodeTaskDock::on_actionRemove_triggered()
     ENCODETASKS.remove(index);
 }
 
+void EncodeTaskDock::on_actionRaisePriority_triggered()
+{
+    QModelIndex index = ui->treeView->currentIndex();
+    if (!index.isValid()) return;
+    AbstractTask* task = ENCODETASKS.taskFromIndex(index);
+    if (task) ENCODETASKS.setPriority(index, task->priority() + 1);
+}
+
+void EncodeTaskDock::on_actionLowerPriority_triggered()
+{
+    QModelIndex index = ui->treeView->currentIndex();
+    if (!index.isValid()) return;
+    AbstractTask* task = ENCODETASKS.taskFromIndex(index);
+    if (task) ENCODETASKS.setPriority(index, task->priority() - 1);
+}
+
 void EncodeTaskDock::on_closeButton_clicked()
 {
         bool showDialog = false;
@@ -117,3 +143,16 @@ void EncodeTaskDock::on_stopButton_clicked()
 {
     on_actionStopTask_triggered();
 }
+
+void EncodeTaskDock::on_pauseButton_toggled(bool checked)
+{
+    if (checked)
+        ENCODETASKS.pause();
+    else
+        ENCODETASKS.resume();
+}
+
+void EncodeTaskDock::on_concurrentSpinBox_valueChanged(int value)
+{
+    ENCODETASKS.setMaxConcurrentTasks(value);
+}
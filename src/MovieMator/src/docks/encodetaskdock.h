@@ -40,7 +40,11 @@ private slots:
     void on_treeView_customContextMenuRequested(const QPoint &pos);
     void on_actionStopTask_triggered();
     void on_actionRemove_triggered();
+    void on_actionRaisePriority_triggered();
+    void on_actionLowerPriority_triggered();
     void on_stopButton_clicked();
+    void on_pauseButton_toggled(bool checked);
+    void on_concurrentSpinBox_valueChanged(int value);
     void on_closeButton_clicked();
 };
 
@@ -22,6 +22,7 @@
 #include "jobsdock.h"
 #include "ui_jobsdock.h"
 #include "jobqueue.h"
+#include "settings.h"
 #include <QtWidgets>
 #include <Logger.h>
 #include "dialogs/textviewerdialog.h"
@@ -42,6 +43,9 @@ JobsDock::JobsDock(QWidget *parent) :
     header->setSectionResizeMode(0, QHeaderView::Stretch);
     header->setSectionResizeMode(1, QHeaderView::ResizeToContents);
     ui->cleanButton->hide();
+    ui->concurrentSpinBox->blockSignals(true);
+    ui->concurrentSpinBox->setValue(Settings.jobsConcurrentJobs());
+    ui->concurrentSpinBox->blockSignals(false);
     LOG_DEBUG() << "end";
     ui->pauseButton->hide();
 
@@ -80,6 +84,10 @@ void JobsDock::on_treeView_customContextMenuRequested(const QPoint &pos)
             menu.addAction(ui->actionStopJob);
         else
             menu.addAction(ui->actionRemove);
+        if (!job->ran() && !job->stopped()) {
+            menu.addAction(ui->actionRaisePriority);
+            menu.addAction(ui->actionLowerPriority);
+        }
 //        if (job->ran())
 //            menu.addAction(ui->actionViewLog);
 //        menu.addActions(job->standardActions());
@@ -117,6 +125,11 @@ void JobsDock::on_pauseButton_toggled(bool checked)
         JOBS.resume();
 }
 
+void JobsDock::on_concurrentSpinBox_valueChanged(int value)
+{
+    JOBS.setMaxConcurrentJobs(value);
+}
+
 void JobsDock::on_actionRun_triggered()
 {
     QModelIndex index = ui->treeView->currentIndex();
@@ -149,6 +162,22 @@ void JobsDock::on_actionRemove_triggered()
     if (!index.isValid()) return;
     JOBS.remove(index);
 }
+
+void JobsDock::on_actionRaisePriority_triggered()
+{
+    QModelIndex index = ui->treeView->currentIndex();
+    if (!index.isValid()) return;
+    AbstractJob* job = JOBS.jobFromIndex(index);
+    if (job) JOBS.setPriority(index, job->priority() + 1);
+}
+
+void JobsDock::on_actionLowerPriority_triggered()
+{
+    QModelIndex index = ui->treeView->currentIndex();
+    if (!index.isValid()) return;
+    AbstractJob* job = JOBS.jobFromIndex(index);
+    if (job) JOBS.setPriority(index, job->priority() - 1);
+}
 void JobsDock::on_stopButton_clicked()
 {
 //    QModelIndex index = ui->treeView->currentIndex();
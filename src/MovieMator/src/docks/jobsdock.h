@@ -46,10 +46,13 @@ private slots:
     void on_actionStopJob_triggered();
     void on_actionViewLog_triggered();
     void on_pauseButton_toggled(bool checked);
+    void on_concurrentSpinBox_valueChanged(int value);
     void on_actionRun_triggered();
     void onMenuButtonClicked();
     void on_treeView_doubleClicked(const QModelIndex &index);
     void on_actionRemove_triggered();
+    void on_actionRaisePriority_triggered();
+    void on_actionLowerPriority_triggered();
     void on_stopButton_clicked();
     void on_closeButton_clicked();
 };
@@ -58,9 +58,10 @@ void ScopeDock::onActionToggled(bool checked)
     Q_ASSERT(m_scopeController);
     Q_ASSERT(m_scopeWidget);
 
+    m_scopeWidget->setActive(checked);
     if(checked) {
-        connect(m_scopeController, SIGNAL(newFrame(const SharedFrame&)), m_scopeWidget, SLOT(onNewFrame(const SharedFrame&)));
+        connect(m_scopeController, SIGNAL(framesAvailable()), m_scopeWidget, SLOT(onFramesAvailable()));
     } else {
-        disconnect(m_scopeController, SIGNAL(newFrame(const SharedFrame&)), m_scopeWidget, SLOT(onNewFrame(const SharedFrame&)));
+        disconnect(m_scopeController, SIGNAL(framesAvailable()), m_scopeWidget, SLOT(onFramesAvailable()));
     }
 }
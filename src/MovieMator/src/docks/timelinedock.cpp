@@ -24,6 +24,7 @@
 #include "timelinedock.h"
 #include "ui_timelinedock.h"
 #include "models/audiolevelstask.h"
+#include "models/loudnessmeter.h"
 #include "models/multitrackmodel.h"
 #include "qmltypes/thumbnailprovider.h"
 #include <qmlapplication.h>
@@ -44,6 +45,8 @@
 #include <QMessageBox>
 #include <QAction>
 #include <QFileDialog>
+#include <algorithm>
+#include <functional>
 
 #include "../maincontroller.h"
 
@@ -91,7 +94,8 @@ TimelineDock::TimelineDock(QWidget *parent) :
     m_position(-1),
     m_updateCommand(nullptr),
     m_ignoreNextPositionChange(false),
-    m_filterSettingsView(QmlUtilities::sharedEngine(), nullptr)
+    m_filterSettingsView(QmlUtilities::sharedEngine(), nullptr),
+    m_loudnessTarget(-23.0)
 {
     LOG_DEBUG() << "begin";
 
@@ -129,6 +133,11 @@ TimelineDock::TimelineDock(QWidget *parent) :
 #endif
 
     connect(&m_model, SIGNAL(selectionChanged(TIMELINE_SELECTION, TIMELINE_SELECTION)), this, SLOT(onSelectionChanged(TIMELINE_SELECTION, TIMELINE_SELECTION)));
+    connect(&m_loudnessAnalysis, SIGNAL(finished(QList<LoudnessResult>)), this, SLOT(onLoudnessAnalyzed(QList<LoudnessResult>)));
+    connect(&m_loudnessAnalysis, SIGNAL(progress(int,int)), this, SLOT(onLoudnessProgress(int,int)));
+    connect(&m_model, SIGNAL(closed()), &m_loudnessAnalysis, SLOT(cancel()));
+    connect(&m_model, SIGNAL(currentTrackRequested(int)), this, SLOT(setCurrentTrack(int)));
+    connect(&m_model, SIGNAL(invalidClipRejected()), this, SLOT(onInvalidClipRejected()));
     LOG_DEBUG() << "end";
 
 
@@ -229,23 +238,9 @@ int TimelineDock::clipIndexAtPosition(int trackIndex, int position)
     Q_ASSERT(trackIndex >= 0);
     Q_ASSERT(trackIndex < m_model.trackList().size());
     if (trackIndex >= 0 && trackIndex < m_model.trackList().size()) {
-        int i = m_model.trackList().at(trackIndex).mlt_index;
-        Q_ASSERT(m_model.tractor());
-        if (!m_model.tractor()) {
-            return result;
-        }
-        QScopedPointer<Mlt::Producer> track(m_model.tractor()->track(i));
-        Q_ASSERT(track);
-        if (track) {
-            Mlt::Playlist playlist(*track);
-            Q_ASSERT(playlist.is_valid());
-            if (!playlist.is_valid()) {
-                return result;
-            }
-            result = playlist.get_clip_index_at(position);
-            if (result > playlist.count() - 1)
-                result = -1;
-        }
+        result = m_model.clipIndexAt(trackIndex, position);
+        if (result > m_model.clipCount(trackIndex) - 1)
+            result = -1;
     }
     return result;
 }
@@ -254,8 +249,7 @@ bool TimelineDock::isBlank(int trackIndex, int clipIndex)
 {
 //    Q_ASSERT(trackIndex >= 0);
 //    Q_ASSERT(clipIndex >= 0);
-    return m_model.index(clipIndex, 0, m_model.index(trackIndex))
-        .data(MultitrackModel::IsBlankRole).toBool();
+    return m_model.isBlankClip(trackIndex, clipIndex);
 }
 
 void TimelineDock::pulseLockButtonOnTrack(int trackIndex)
@@ -635,6 +629,20 @@ void TimelineDock::removeTrack()
         setCurrentTrack(trackIndex-1);
 }
 
+void TimelineDock::onInvalidClipRejected()
+{
+    QMessageBox dialog(QMessageBox::Critical,
+                       qApp->applicationName(),
+                       tr("<p>The time code of the file cannot be read. Please convert it to MP4 before adding the file. </p>"
+                          "<p>Recommend:<a href=\"http://www.effectmatrix.com/total-video-converter\">Total Video Converter</a></p>"),
+                       QMessageBox::Ok, &(MAIN));
+
+    dialog.setIconPixmap(QPixmap(":/icons/moviemator-pro-logo-64.png"));
+    dialog.setWindowModality(Qt::WindowModal);
+    dialog.setDefaultButton(QMessageBox::Ok);
+    dialog.exec();
+}
+
 void TimelineDock::onProducerChanged(Mlt::Producer* after)
 {
     Q_ASSERT(after);
@@ -890,6 +898,10 @@ void TimelineDock::removeSelection(bool withCopy)
 
     if (withCopy)
         copyClip(currentTrack(), selection().first());
+    if (selection().count() > 1) {
+        removeClips(currentTrack(), selection(), false);
+        return;
+    }
     foreach (int index, selection())
         remove(currentTrack(), index);
 }
@@ -904,10 +916,44 @@ void TimelineDock::liftSelection()
         selectClipUnderPlayhead();
     if (selection().isEmpty())
         return;
+    if (selection().count() > 1) {
+        removeClips(currentTrack(), selection(), true);
+        return;
+    }
     foreach (int index, selection())
         lift(currentTrack(), index);
 }
 
+void TimelineDock::removeClips(int trackIndex, const QList<int>& clipIndexes, bool lift)
+{
+    LOG_DEBUG() << "trackIndex" << trackIndex << "clips" << clipIndexes.count() << "lift" << lift;
+    if (!m_model.trackList().count())
+        return;
+
+    // 从后往前去掉转场，去掉转场只影响 clipIndex - 1 之后的剪辑，已记录的下标整体前移
+    QList<int> indexes = clipIndexes;
+    std::sort(indexes.begin(), indexes.end(), std::greater<int>());
+    MAIN.undoStack()->beginMacro(lift? tr("Lift from track") : tr("Remove from track"));
+    QList<int> newIndexes;
+    foreach (int clipIndex, indexes) {
+        if (clipIndex < 0 || clipIndex >= clipCount(trackIndex))
+            continue;
+        if (lift && isBlank(trackIndex, clipIndex))
+            continue;
+        int countBefore = clipCount(trackIndex);
+        int newClipIndex = removeTransitionOnClipWithUndo(trackIndex, clipIndex);
+        int removed = countBefore - clipCount(trackIndex);
+        for (int i = 0; i < newIndexes.count(); ++i)
+            newIndexes[i] -= removed;
+        newIndexes.append(newClipIndex);
+    }
+    if (!newIndexes.isEmpty())
+        MAIN.pushCommand(new Timeline::RemoveClipsCommand(m_model, trackIndex, newIndexes, lift));
+    MAIN.undoStack()->endMacro();
+
+    setSelection(QList<int>(), trackIndex);
+}
+
 void TimelineDock::selectTrack(int by)
 {
     int newTrack = currentTrack();
@@ -1274,22 +1320,8 @@ void TimelineDock::seekPreviousEdit()
     Q_ASSERT(m_model.tractor());
     if (!m_model.tractor()) return;
 
-    int newPosition = -1;
-    int n = m_model.tractor()->count();
-    for (int i = 0; i < n; i++) {
-        QScopedPointer<Mlt::Producer> track(m_model.tractor()->track(i));
-        Q_ASSERT(track);
-        if (track) {
-            Mlt::Playlist playlist(*track);
-            Q_ASSERT(playlist.is_valid());
-            int clipIndex = playlist.get_clip_index_at(m_position);
-            if (clipIndex >= 0 && m_position == playlist.clip_start(clipIndex))
-                --clipIndex;
-            if (clipIndex >= 0)
-                newPosition = qMax(newPosition, playlist.clip_start(clipIndex));
-        }
-    }
-    if (newPosition != m_position)
+    int newPosition = m_model.previousEdit(m_position);
+    if (newPosition >= 0 && newPosition != m_position)
         setPosition(newPosition);
 }
 
@@ -1299,22 +1331,8 @@ void TimelineDock::seekNextEdit()
     Q_ASSERT(m_model.tractor());
     if (!m_model.tractor()) return;
 
-    int newPosition = std::numeric_limits<int>::max();
-    int n = m_model.tractor()->count();
-    for (int i = 0; i < n; i++) {
-        QScopedPointer<Mlt::Producer> track(m_model.tractor()->track(i));
-        Q_ASSERT(track);
-        if (track) {
-            Mlt::Playlist playlist(*track);
-            Q_ASSERT(playlist.is_valid());
-            int clipIndex = playlist.get_clip_index_at(m_position) + 1;
-            if (clipIndex < playlist.count())
-                newPosition = qMin(newPosition, playlist.clip_start(clipIndex));
-            else if (clipIndex == playlist.count())
-                newPosition = qMin(newPosition, playlist.clip_start(clipIndex) + playlist.clip_length(clipIndex));
-        }
-    }
-    if (newPosition != m_position)
+    int newPosition = m_model.nextEdit(m_position);
+    if (newPosition >= 0 && newPosition != m_position)
         setPosition(newPosition);
 }
 
@@ -2288,6 +2306,137 @@ void TimelineDock::exportAsTemplate(int trackIndex, int clipIndex)
     }
 }
 
+// 响度测量用原始素材，使用代理文件时取原来的路径
+static QString clipResource(Mlt::Producer& producer)
+{
+    if (producer.get(kOriginalResourceProperty))
+        return QString::fromUtf8(producer.get(kOriginalResourceProperty));
+    return QString::fromUtf8(producer.get("resource"));
+}
+
+void TimelineDock::normalizeLoudness(double targetLufs)
+{
+    if (!m_model.tractor())
+        return;
+    if (m_loudnessAnalysis.isRunning()) {
+        emit showStatusMessage(tr("Loudness analysis is already running"));
+        return;
+    }
+
+    // 选中的剪辑，没有选中时为所有轨道上的剪辑
+    QList<QPair<int, int> > clips;
+    int selectedTrack = m_model.selection().nIndexOfSelectedTrack;
+    int selectedClip = m_model.selection().nIndexOfSelectedClip;
+    if (selectedTrack >= 0 && selectedClip >= 0) {
+        clips << qMakePair(selectedTrack, selectedClip);
+    } else {
+        for (int trackIndex = 0; trackIndex < m_model.trackList().size(); trackIndex++) {
+            int count = m_model.rowCount(m_model.index(trackIndex));
+            for (int clipIndex = 0; clipIndex < count; clipIndex++)
+                clips << qMakePair(trackIndex, clipIndex);
+        }
+    }
+
+    QList<LoudnessResult> requests;
+    for (int i = 0; i < clips.size(); i++) {
+        int trackIndex = clips.at(i).first;
+        int clipIndex = clips.at(i).second;
+        if (isBlank(trackIndex, clipIndex))
+            continue;
+        QScopedPointer<Mlt::ClipInfo> info(getClipInfo(trackIndex, clipIndex));
+        if (!info || !info->producer || !info->producer->is_valid())
+            continue;
+        Mlt::Producer parent = info->producer->parent();
+        if (parent.get(kShotcutTransitionProperty))
+            continue;
+        QString service = parent.get("mlt_service");
+        // 和波形一样跳过没有声音的素材
+        if (service == "pixbuf" || service == "qimage" || service == "webvfx"
+                || service == "color" || service.startsWith("frei0r"))
+            continue;
+        LoudnessResult request;
+        request.trackIndex = trackIndex;
+        request.clipIndex = clipIndex;
+        request.service = service;
+        request.resource = clipResource(parent);
+        request.hash = QString::fromUtf8(parent.get(kShotcutHashProperty));
+        if (parent.get("audio_index")) {
+            // -1表示关掉了这个素材的声音
+            if (parent.get_int("audio_index") < 0)
+                continue;
+            request.audioIndex = QString::fromUtf8(parent.get("audio_index"));
+        }
+        // 剪辑上已有的增益、淡入淡出等音量滤镜也参与测量，标准化的增益是在它们之后再加的
+        for (int j = 0; j < info->producer->filter_count(); j++) {
+            QScopedPointer<Mlt::Filter> filter(info->producer->filter(j));
+            if (!filter || !filter->is_valid() || filter->get(kLoudnessTargetProperty)
+                    || qstrcmp(filter->get("mlt_service"), "volume"))
+                continue;
+            LoudnessFilter properties;
+            for (int k = 0; k < filter->count(); k++) {
+                const char* name = filter->get_name(k);
+                if (name && name[0] != '_' && filter->get(k))
+                    properties.insert(QString::fromUtf8(name), QString::fromUtf8(filter->get(k)));
+            }
+            request.filters << properties;
+        }
+        request.in = info->frame_in;
+        request.out = info->frame_out;
+        requests << request;
+    }
+    if (requests.isEmpty()) {
+        emit showStatusMessage(tr("No clips with audio to normalize"));
+        return;
+    }
+    m_loudnessTarget = targetLufs;
+    m_loudnessAnalysis.start(requests);
+    emit showStatusMessage(tr("Measuring loudness of %1 clip(s)...").arg(requests.size()));
+}
+
+void TimelineDock::onLoudnessProgress(int done, int total)
+{
+    emit showStatusMessage(tr("Measuring loudness... %1/%2").arg(done).arg(total));
+}
+
+void TimelineDock::onLoudnessAnalyzed(const QList<LoudnessResult>& results)
+{
+    static const double kMaxGainDb = 24.0;
+    static const double kPeakCeilingDb = -1.0;
+    QList<Timeline::LoudnessGain> gains;
+    int skipped = 0;
+    foreach (const LoudnessResult& result, results) {
+        if (!result.valid || result.integrated <= LoudnessMeter::kSilence) {
+            ++skipped;
+            continue;
+        }
+        // 测量期间时间线可能被编辑过，只处理位置上仍是同一个剪辑的结果
+        QScopedPointer<Mlt::ClipInfo> info(getClipInfo(result.trackIndex, result.clipIndex));
+        if (!info || !info->producer || info->frame_in != result.in || info->frame_out != result.out
+                || clipResource(info->producer->parent()) != result.resource) {
+            ++skipped;
+            continue;
+        }
+        double gainDb = qBound(-kMaxGainDb, m_loudnessTarget - result.integrated, kMaxGainDb);
+        // 提升音量时不让采样峰值超过 -1 dBFS
+        if (gainDb > 0.0 && result.peak + gainDb > kPeakCeilingDb)
+            gainDb = qMax(0.0, kPeakCeilingDb - result.peak);
+        LOG_INFO() << result.resource << "integrated" << result.integrated << "LUFS"
+                   << "short-term max" << result.shortTermMax << "momentary max" << result.momentaryMax
+                   << "LRA" << result.range << "peak" << result.peak << "gain" << gainDb << "dB";
+        Timeline::LoudnessGain gain = { result.trackIndex, result.clipIndex, gainDb };
+        gains << gain;
+    }
+    if (gains.isEmpty()) {
+        emit showStatusMessage(tr("No clips were normalized"));
+        return;
+    }
+    MAIN.pushCommand(new Timeline::LoudnessGainCommand(m_model, gains, m_loudnessTarget));
+    if (skipped)
+        emit showStatusMessage(tr("Normalized %1 clip(s) to %2 LUFS, skipped %3").arg(gains.size()).arg(m_loudnessTarget).arg(skipped));
+    else
+        emit showStatusMessage(tr("Normalized %1 clip(s) to %2 LUFS").arg(gains.size()).arg(m_loudnessTarget));
+}
+
 void TimelineDock::exportSelectedClipAsTemplate()
 {
     if(!isAClipSelected())
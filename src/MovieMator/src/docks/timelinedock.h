@@ -29,6 +29,7 @@
 #include "models/multitrackmodel.h"
 #include "sharedframe.h"
 #include "qmltypes/qmlfilter.h"
+#include "models/loudnesstask.h"
 
 namespace Ui {
 class TimelineDock;
@@ -79,8 +80,6 @@ public:
     // 主要是传值给 trackIndex和 clipIndex
     // assignIndexsByPosition()
     void chooseClipAtPosition(int position, int * trackIndex, int * clipIndex);
-    // 设定轨道 currentTrack为当前轨道（传递给 qml使用）
-    void setCurrentTrack(int currentTrack);
     // 从 qml界面中获取当前轨道序号
     int currentTrack() const;
     // 获取轨道 trackIndex上的剪辑数量
@@ -159,6 +158,8 @@ public:
     Q_INVOKABLE void exportAsTemplate(int trackIndex, int clipIndex);
     //将选中的clip导出为xml模版
     void exportSelectedClipAsTemplate();
+    // 测量选中剪辑（没有选中时为整个时间线）的 EBU R128响度，完成后一步调整到目标响度
+    void normalizeLoudness(double targetLufs);
 
     // 发送 sizeAndPositionFilterSelected()信号
     void selectSizeAndPositionFilter(int index);
@@ -237,6 +238,8 @@ signals:
 
 
 public slots:
+    // 设定轨道 currentTrack为当前轨道（传递给 qml使用）
+    void setCurrentTrack(int currentTrack);
     // 添加音频轨道
     void addAudioTrack();
     // 添加视频轨道
@@ -418,6 +421,8 @@ protected:
 private:
     // 轨道 trackIndex的剪辑 clipIndex是否是空白（blank）
     bool isBlank(int trackIndex, int clipIndex);
+    // 批量移除或提起轨道 trackIndex上的多个剪辑，只生成一个撤销步骤
+    void removeClips(int trackIndex, const QList<int>& clipIndexes, bool lift);
     // 操作锁定的轨道时播放锁定按钮缩放的动画
     void pulseLockButtonOnTrack(int trackIndex);
     // 加载 timeline.qml界面
@@ -441,10 +446,20 @@ private:
     // 被选中的 Producer
     // 只有 onTextSettings()使用
     Mlt::Producer* m_selectedTextProducer;
+    // 后台响度测量
+    LoudnessAnalysis m_loudnessAnalysis;
+    // 响度标准化的目标响度（LUFS）
+    double m_loudnessTarget;
 
 private slots:
     // timelinedock的 visibilityChanged()信号的响应槽函数
     void onVisibilityChanged(bool visible);
+    // 响度测量完成，生成标准化的撤销命令
+    void onLoudnessAnalyzed(const QList<LoudnessResult>& results);
+    // 显示响度测量进度
+    void onLoudnessProgress(int done, int total);
+    // 时间线模型拒绝了时长无法读取的剪辑，提示用户转换格式
+    void onInvalidClipRejected();
 };
 
 #endif // TIMELINEDOCK_H
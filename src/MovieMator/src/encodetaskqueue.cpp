@@ -17,9 +17,16 @@
  */
 
 #include "encodetaskqueue.h"
+#include <QThread>
+#include <algorithm>
+#include <Logger.h>
+#include "settings.h"
 
 EncodeTaskQueue::EncodeTaskQueue(QObject *parent)
     : QStandardItemModel(0, COLUMN_COUNT, parent)
+    , m_paused(false)
+    , m_maxConcurrentTasks(Settings.encodeConcurrentTasks())
+    , m_batchFinished(0)
 {
 
 }
@@ -61,18 +68,47 @@ void EncodeTaskQueue::addTask(AbstractTask *task)
 void EncodeTaskQueue::startNextTask()
 {
     QMutexLocker locker(&m_mutex);
-    if (!m_tasks.isEmpty()) {
-        foreach(AbstractTask* task, m_tasks) {
-            // if there is already a job started or running, then exit
-            if (task->ran() && !task->stopped())
-                break;
-            // otherwise, start first non-started job and exit
-            if (!task->ran()) {
-                task->start();
-                break;
-            }
+    //onFinished可能在其它线程里调用，暂停标记和 m_tasks在同一把锁下读取
+    if (m_paused) return;
+
+    //统计正在运行的任务数以及它们占用的线程数
+    int running = 0;
+    int threadsInUse = 0;
+    const int cores = QThread::idealThreadCount();
+    QList<AbstractTask *> pending;
+    foreach(AbstractTask* task, m_tasks) {
+        if (task->ran() && !task->stopped()) {
+            running++;
+            threadsInUse += qMin(task->threadWeight(), cores);
+        } else if (!task->ran() && !task->killed()) {
+            pending.append(task);
         }
     }
+    if (pending.isEmpty())
+        return;
+
+    if (running == 0 && !m_batchTimer.isValid()) {
+        m_batchTimer.start();
+        m_batchFinished = 0;
+    }
+
+    //优先级高的先执行，相同优先级按加入队列的顺序
+    std::stable_sort(pending.begin(), pending.end(), [](AbstractTask *a, AbstractTask *b) {
+        return a->priority() > b->priority();
+    });
+
+    const int maxTasks = maxConcurrentTasks();
+    foreach(AbstractTask* task, pending) {
+        if (running >= maxTasks)
+            break;
+        //没有任务在运行时总是启动一个，否则只在剩余的核数足够时才启动
+        int weight = qMin(task->threadWeight(), cores);
+        if (running > 0 && threadsInUse + weight > cores)
+            break;
+        task->start();
+        running++;
+        threadsInUse += weight;
+    }
 }
 
 bool EncodeTaskQueue::hasIncomplete() const
@@ -85,6 +121,50 @@ bool EncodeTaskQueue::hasIncomplete() const
     return false;
 }
 
+void EncodeTaskQueue::pause()
+{
+    QMutexLocker locker(&m_mutex);
+    m_paused = true;
+}
+
+void EncodeTaskQueue::resume()
+{
+    m_mutex.lock();
+    m_paused = false;
+    m_mutex.unlock();
+    startNextTask();
+}
+
+bool EncodeTaskQueue::isPaused() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_paused;
+}
+
+void EncodeTaskQueue::setPriority(const QModelIndex &index, int priority)
+{
+    if (!index.isValid() || index.row() >= m_tasks.size())
+        return;
+    m_mutex.lock();
+    m_tasks.at(index.row())->setPriority(priority);
+    m_mutex.unlock();
+    startNextTask();
+}
+
+void EncodeTaskQueue::setMaxConcurrentTasks(int count)
+{
+    m_maxConcurrentTasks = qMax(0, count);
+    Settings.setEncodeConcurrentTasks(m_maxConcurrentTasks);
+    startNextTask();
+}
+
+int EncodeTaskQueue::maxConcurrentTasks() const
+{
+    if (m_maxConcurrentTasks > 0)
+        return m_maxConcurrentTasks;
+    return qMax(1, QThread::idealThreadCount());
+}
+
 
 void EncodeTaskQueue::cleanup()
 {
@@ -145,6 +225,15 @@ void EncodeTaskQueue::onFinished(AbstractTask *task, bool isSuccess)
         else
             item->setText(tr("failed"));
     }
+    LOG_INFO() << task->label() << (isSuccess ? "done" : "stopped") << "in" << task->elapsed() << "ms";
+
+    m_batchFinished++;
+    if (!hasIncomplete() && m_batchTimer.isValid()) {
+        qint64 ms = qMax(qint64(1), m_batchTimer.elapsed());
+        LOG_INFO() << "encode queue drained:" << m_batchFinished << "tasks in" << ms << "ms,"
+                   << (m_batchFinished * 60000.0 / ms) << "tasks/min, max concurrent" << maxConcurrentTasks();
+        m_batchTimer.invalidate();
+    }
     startNextTask();
 }
 
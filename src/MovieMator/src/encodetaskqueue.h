@@ -20,6 +20,7 @@
 #define ENCODETASKQUEUE_H
 #include <QStandardItemModel>
 #include <QMutex>
+#include <QElapsedTimer>
 #include "jobs/encodetask.h"
 #include "jobs/abstracttask.h"
 
@@ -51,6 +52,17 @@ public:
 
     bool hasIncomplete() const;
 
+    //暂停后不再启动新的任务，正在运行的任务不受影响
+    void pause();
+    void resume();
+    bool isPaused() const;
+
+    void setPriority(const QModelIndex &index, int priority);
+
+    //同时运行的任务数上限，0表示根据CPU核数和任务的线程数自动决定
+    void setMaxConcurrentTasks(int count);
+    int maxConcurrentTasks() const;
+
 
 signals:
     void taskAdded(); //通知主窗口显示TaskDock
@@ -61,7 +73,11 @@ public slots:
 
 private:
     QList<AbstractTask *>m_tasks;
-    QMutex m_mutex;
+    mutable QMutex m_mutex;     // 保护 m_tasks和 m_paused
+    bool m_paused;
+    int m_maxConcurrentTasks;
+    QElapsedTimer m_batchTimer; //统计一批任务的总耗时
+    int m_batchFinished;
 };
 
 #define ENCODETASKS EncodeTaskQueue::singleton()
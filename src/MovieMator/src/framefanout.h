@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FRAMEFANOUT_H
+#define FRAMEFANOUT_H
+
+#include <QAtomicInt>
+
+/*!
+  \class FrameFanout
+  \brief The FrameFanout passes the newest items from one producer thread to
+  several consumer threads without locking.
+
+  \threadsafe
+
+  FrameFanout replaces a mutex protected queue per consumer with one ring of
+  preallocated slots shared by all consumers. The producer calls push(); each
+  registered consumer keeps its own read cursor and calls next() from its own
+  thread. Nothing is allocated per item: push() only assigns into a free slot.
+
+  A consumer that falls behind loses the oldest items (latest item wins). A
+  consumer registered with latestOnly always jumps straight to the newest item.
+  Inactive consumers are skipped entirely and, when there are no active
+  consumers, push() returns immediately.
+
+  Slots are protected by a small pin/state handshake: a reader pins a slot and
+  then re-checks that it still holds the expected sequence; the writer marks a
+  slot busy and then checks that nobody pinned it. With kMaxConsumers + 2 slots
+  the writer always finds a free slot, since each consumer pins at most one.
+
+  Consumers must be registered from one thread before items are pushed.
+*/
+
+template <class T>
+class FrameFanout
+{
+public:
+    enum {
+        kMaxConsumers = 8,
+        kSlotCount = kMaxConsumers + 2
+    };
+
+    //! Per-consumer counters, readable from any thread.
+    struct Statistics {
+        int delivered;  //!< Items returned by next()
+        int dropped;    //!< Items the consumer never saw
+        int retries;    //!< Reads that raced with the writer
+    };
+
+    FrameFanout();
+
+    /*!
+      Registers a consumer and returns its id, or -1 when all kMaxConsumers ids
+      are in use. New consumers start inactive.
+    */
+    int addConsumer(bool latestOnly = false);
+
+    /*!
+      Activates or deactivates a consumer. An activated consumer starts at the
+      newest item so it does not replay what it missed while inactive.
+    */
+    void setActive(int consumer, bool active);
+
+    //! Returns the number of active consumers.
+    int activeCount() const;
+
+    //! Publishes an item. Only one thread may call push().
+    void push(const T& item);
+
+    /*!
+      Copies the next unseen item for \a consumer into \a item. Returns false
+      when the consumer has already seen the newest item. Only the consumer's
+      own thread may call next() for a given id.
+    */
+    bool next(int consumer, T& item);
+
+    //! Returns the counters for \a consumer.
+    Statistics statistics(int consumer) const;
+
+    //! Returns the number of items pushed.
+    int pushed() const { return m_published.loadAcquire(); }
+
+    //! Returns the number of times push() had to skip a pinned slot.
+    int writerRetries() const { return m_writerRetries.loadAcquire(); }
+
+    //! Returns the number of items push() discarded because no slot was free.
+    int writerDrops() const { return m_writerDrops.loadAcquire(); }
+
+private:
+    enum { kEmpty = 0, kBusy = -1 };
+
+    struct Slot {
+        T item;
+        QAtomicInt state;   //!< kEmpty, kBusy or the sequence held
+        QAtomicInt pins;
+    };
+
+    struct Consumer {
+        Consumer() : cursor(0), latestOnly(false) {}
+        int cursor;         //!< Only touched by the consumer thread
+        bool latestOnly;
+        QAtomicInt active;
+        QAtomicInt resync;  //!< Set on activation, consumed by next()
+        QAtomicInt delivered;
+        QAtomicInt dropped;
+        QAtomicInt retries;
+    };
+
+    bool copy(int sequence, T& item, Consumer& consumer);
+
+    Slot m_slots[kSlotCount];
+    Consumer m_consumers[kMaxConsumers];
+    QAtomicInt m_consumerCount;
+    QAtomicInt m_activeCount;
+    QAtomicInt m_published;
+    QAtomicInt m_writerRetries;
+    QAtomicInt m_writerDrops;
+    int m_sequence;     //!< Only touched by the writer
+    int m_latestSlot;   //!< Only touched by the writer
+    int m_nextSlot;     //!< Only touched by the writer
+};
+
+template <class T>
+FrameFanout<T>::FrameFanout()
+  : m_sequence(0)
+  , m_latestSlot(-1)
+  , m_nextSlot(0)
+{
+}
+
+template <class T>
+int FrameFanout<T>::addConsumer(bool latestOnly)
+{
+    int id = m_consumerCount.fetchAndAddOrdered(1);
+    if (id >= kMaxConsumers) {
+        m_consumerCount.fetchAndAddOrdered(-1);
+        return -1;
+    }
+    m_consumers[id].latestOnly = latestOnly;
+    return id;
+}
+
+template <class T>
+void FrameFanout<T>::setActive(int consumer, bool active)
+{
+    if (consumer < 0 || consumer >= m_consumerCount.loadAcquire())
+        return;
+    Consumer& c = m_consumers[consumer];
+    if (c.active.fetchAndStoreOrdered(active ? 1 : 0) == (active ? 1 : 0))
+        return;
+    if (active) {
+        c.resync.fetchAndStoreOrdered(1);
+        m_activeCount.fetchAndAddOrdered(1);
+    } else {
+        m_activeCount.fetchAndAddOrdered(-1);
+    }
+}
+
+template <class T>
+int FrameFanout<T>::activeCount() const
+{
+    return m_activeCount.loadAcquire();
+}
+
+template <class T>
+void FrameFanout<T>::push(const T& item)
+{
+    if (!m_activeCount.loadAcquire())
+        return;
+
+    int sequence = m_sequence + 1;
+    for (int attempt = 0; attempt < kSlotCount; ++attempt) {
+        int i = m_nextSlot;
+        m_nextSlot = (m_nextSlot + 1) % kSlotCount;
+        if (i == m_latestSlot)
+            continue;
+        Slot& slot = m_slots[i];
+        if (slot.pins.fetchAndAddOrdered(0) != 0) {
+            m_writerRetries.fetchAndAddOrdered(1);
+            continue;
+        }
+        int old = slot.state.fetchAndStoreOrdered(kBusy);
+        if (slot.pins.fetchAndAddOrdered(0) != 0) {
+            // A reader pinned the slot between the two checks.
+            slot.state.fetchAndStoreOrdered(old);
+            m_writerRetries.fetchAndAddOrdered(1);
+            continue;
+        }
+        slot.item = item;
+        slot.state.fetchAndStoreOrdered(sequence);
+        m_sequence = sequence;
+        m_latestSlot = i;
+        m_published.fetchAndStoreOrdered(sequence);
+        return;
+    }
+    m_writerDrops.fetchAndAddOrdered(1);
+}
+
+template <class T>
+bool FrameFanout<T>::copy(int sequence, T& item, Consumer& consumer)
+{
+    for (int i = 0; i < kSlotCount; ++i) {
+        Slot& slot = m_slots[i];
+        if (slot.state.loadAcquire() != sequence)
+            continue;
+        slot.pins.fetchAndAddOrdered(1);
+        bool ok = slot.state.fetchAndAddOrdered(0) == sequence;
+        if (ok)
+            item = slot.item;
+        slot.pins.fetchAndAddOrdered(-1);
+        if (!ok)
+            consumer.retries.fetchAndAddOrdered(1);
+        return ok;
+    }
+    return false;
+}
+
+template <class T>
+bool FrameFanout<T>::next(int consumer, T& item)
+{
+    if (consumer < 0 || consumer >= m_consumerCount.loadAcquire())
+        return false;
+    Consumer& c = m_consumers[consumer];
+    if (!c.active.loadAcquire())
+        return false;
+
+    if (c.resync.fetchAndStoreOrdered(0)) {
+        // Skip what was pushed while the consumer was inactive.
+        c.cursor = qMax(c.cursor, m_published.loadAcquire() - 1);
+    }
+
+    forever {
+        int latest = m_published.loadAcquire();
+        if (latest <= c.cursor)
+            return false;
+        int wanted = c.latestOnly ? latest : c.cursor + 1;
+        int got = 0;
+        if (copy(wanted, item, c))
+            got = wanted;
+        else if (wanted != latest && copy(latest, item, c))
+            got = latest;
+        if (got) {
+            if (got > c.cursor + 1)
+                c.dropped.fetchAndAddOrdered(got - c.cursor - 1);
+            c.cursor = got;
+            c.delivered.fetchAndAddOrdered(1);
+            return true;
+        }
+        // The writer replaced both slots while we looked; try the new latest.
+    }
+}
+
+template <class T>
+typename FrameFanout<T>::Statistics FrameFanout<T>::statistics(int consumer) const
+{
+    Statistics s = { 0, 0, 0 };
+    if (consumer >= 0 && consumer < m_consumerCount.loadAcquire()) {
+        const Consumer& c = m_consumers[consumer];
+        s.delivered = c.delivered.loadAcquire();
+        s.dropped = c.dropped.loadAcquire();
+        s.retries = c.retries.loadAcquire();
+    }
+    return s;
+}
+
+#endif // FRAMEFANOUT_H
@@ -21,13 +21,16 @@
 
 #include "jobqueue.h"
 #include <QtWidgets>
+#include <algorithm>
 #include <Logger.h>
-#include "mainwindow.h"
 #include "settings.h"
 
 JobQueue::JobQueue(QObject *parent) :
     QStandardItemModel(0, COLUMN_COUNT, parent),
-    m_paused(false)
+    m_paused(false),
+    m_maxConcurrentJobs(Settings.jobsConcurrentJobs()),
+    m_batchFinished(0),
+    m_batchCpuTime(0)
 {
     showFirst = true;
 }
@@ -86,6 +89,19 @@ void JobQueue::onFinished(AbstractJob* job, bool isSuccess)
         else
             item->setText(tr("failed"));
     }
+    LOG_INFO() << job->label() << (isSuccess ? "done" : "stopped") << "in" << job->elapsed() << "ms, cpu"
+               << job->cpuTime() << "ms";
+
+    m_batchFinished++;
+    if (job->cpuTime() > 0)
+        m_batchCpuTime += job->cpuTime();
+    if (!hasIncomplete() && m_batchTimer.isValid()) {
+        qint64 ms = qMax(qint64(1), m_batchTimer.elapsed());
+        LOG_INFO() << "job queue drained:" << m_batchFinished << "jobs in" << ms << "ms, cpu" << m_batchCpuTime
+                   << "ms, average load" << (double(m_batchCpuTime) / ms) << "cores, max concurrent"
+                   << maxConcurrentJobs();
+        m_batchTimer.invalidate();
+    }
     startNextJob();
 }
 
@@ -93,18 +109,47 @@ void JobQueue::startNextJob()
 {
     if (m_paused) return;
     QMutexLocker locker(&m_mutex);
-    if (!m_jobs.isEmpty()) {
-        foreach(AbstractJob* job, m_jobs) {
-            // if there is already a job started or running, then exit
-            if (job->ran() && job->state() != QProcess::NotRunning)
-                break;
-            // otherwise, start first non-started job and exit
-            if (!job->ran()) {
-                job->start();
-                break;
-            }
+
+    //统计正在运行的任务数以及它们占用的线程数
+    int running = 0;
+    int threadsInUse = 0;
+    const int cores = QThread::idealThreadCount();
+    QList<AbstractJob*> pending;
+    foreach(AbstractJob* job, m_jobs) {
+        if (job->ran() && job->state() != QProcess::NotRunning) {
+            running++;
+            threadsInUse += qMin(job->threadWeight(), cores);
+        } else if (!job->ran() && !job->stopped()) {
+            pending.append(job);
         }
     }
+    if (pending.isEmpty())
+        return;
+
+    if (running == 0 && !m_batchTimer.isValid()) {
+        m_batchTimer.start();
+        m_batchFinished = 0;
+        m_batchCpuTime = 0;
+    }
+
+    //优先级高的先执行，相同优先级按加入队列的顺序
+    std::stable_sort(pending.begin(), pending.end(), [](AbstractJob* a, AbstractJob* b) {
+        return a->priority() > b->priority();
+    });
+
+    const int maxJobs = maxConcurrentJobs();
+    foreach(AbstractJob* job, pending) {
+        if (running >= maxJobs)
+            break;
+        //没有任务在运行时总是启动一个，否则只在剩余的核数足够时才启动，
+        //排在前面的重任务不会被后面的轻任务一直插队
+        int weight = qMin(job->threadWeight(), cores);
+        if (running > 0 && threadsInUse + weight > cores)
+            break;
+        job->start();
+        running++;
+        threadsInUse += weight;
+    }
 }
 
 AbstractJob* JobQueue::jobFromIndex(const QModelIndex& index) const
@@ -131,12 +176,36 @@ bool JobQueue::isPaused() const
 bool JobQueue::hasIncomplete() const
 {
     foreach (AbstractJob* job, m_jobs) {
-        if (!job->ran() || job->state() == QProcess::Running)
+        if ((!job->ran() && !job->stopped()) || job->state() != QProcess::NotRunning)
             return true;
     }
     return false;
 }
 
+void JobQueue::setPriority(const QModelIndex& index, int priority)
+{
+    if (!index.isValid() || index.row() >= m_jobs.size())
+        return;
+    m_mutex.lock();
+    m_jobs.at(index.row())->setPriority(priority);
+    m_mutex.unlock();
+    startNextJob();
+}
+
+void JobQueue::setMaxConcurrentJobs(int count)
+{
+    m_maxConcurrentJobs = qMax(0, count);
+    Settings.setJobsConcurrentJobs(m_maxConcurrentJobs);
+    startNextJob();
+}
+
+int JobQueue::maxConcurrentJobs() const
+{
+    if (m_maxConcurrentJobs > 0)
+        return m_maxConcurrentJobs;
+    return qMax(1, QThread::idealThreadCount());
+}
+
 void JobQueue::remove(const QModelIndex& index)
 {
     int row = index.row();
@@ -164,7 +233,13 @@ void JobQueue::remove(const QModelIndex& index)
  void JobQueue::stopJobs()
  {
      foreach (AbstractJob* job, m_jobs) {
-         if (!job->ran() || job->state() == QProcess::Running)
+         if (!job->ran() || job->state() != QProcess::NotRunning)
              job->stop();
+         //还没启动的任务不会再有finished，直接更新状态
+         if (!job->ran()) {
+             QStandardItem* item = itemFromIndex(job->modelIndex());
+             if (item)
+                 item->setText(tr("stopped"));
+         }
      }
  }
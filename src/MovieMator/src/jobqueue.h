@@ -22,6 +22,7 @@
 #include "jobs/abstractjob.h"
 #include <QStandardItemModel>
 #include <QMutex>
+#include <QElapsedTimer>
 
 class JobQueue : public QStandardItemModel
 {
@@ -41,6 +42,7 @@ public:
     void cleanup();
     AbstractJob* add(AbstractJob *job);
     AbstractJob* jobFromIndex(const QModelIndex& index) const;
+    //暂停后不再启动新的任务，正在运行的任务不受影响
     void pause();
     void resume();
     bool isPaused() const;
@@ -49,6 +51,12 @@ public:
     void setShowFirst(bool value);
     void stopJobs();
 
+    void setPriority(const QModelIndex& index, int priority);
+
+    //同时运行的任务数上限，0表示根据CPU核数和任务的线程数自动决定
+    void setMaxConcurrentJobs(int count);
+    int maxConcurrentJobs() const;
+
 signals:
     void jobAdded();
 
@@ -61,6 +69,10 @@ private:
     QMutex m_mutex; // protects m_jobs
     bool m_paused;
     bool showFirst;
+    int m_maxConcurrentJobs;
+    QElapsedTimer m_batchTimer; //统计一批任务的总耗时
+    int m_batchFinished;
+    qint64 m_batchCpuTime;
 };
 
 #define JOBS JobQueue::singleton()
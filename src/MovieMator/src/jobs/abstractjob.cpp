@@ -19,7 +19,16 @@
 #include "abstractjob.h"
 #include <QApplication>
 #include <QTimer>
+#include <QFile>
 #include <Logger.h>
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#elif defined(Q_OS_MAC)
+#include <libproc.h>
+#include <mach/mach_time.h>
+#elif defined(Q_OS_LINUX)
+#include <unistd.h>
+#endif
 
 AbstractJob::AbstractJob(const QString& name)
     : QProcess(nullptr)
@@ -27,15 +36,86 @@ AbstractJob::AbstractJob(const QString& name)
     , m_killed(false)
     , m_jobFinishedNormally(false)
     , m_label(name)
+    , m_priority(0)
+    , m_elapsed(-1)
+    , m_cpuTime(-1)
 {
     setObjectName(name);
     connect(this, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(onFinished(int, QProcess::ExitStatus)));
     connect(this, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    connect(this, SIGNAL(error(QProcess::ProcessError)), this, SLOT(onError(QProcess::ProcessError)));
+    m_cpuTimer.setInterval(500);
+    connect(&m_cpuTimer, SIGNAL(timeout()), this, SLOT(sampleCpuTime()));
 }
 
 void AbstractJob::start()
 {
     m_ran = true;
+    m_elapsed = -1;
+    m_cpuTime = -1;
+    m_timer.start();
+    m_cpuTimer.start();
+}
+
+void AbstractJob::setPriority(int priority)
+{
+    m_priority = priority;
+}
+
+qint64 AbstractJob::elapsed() const
+{
+    if (m_elapsed >= 0)
+        return m_elapsed;
+    return m_timer.isValid() ? m_timer.elapsed() : 0;
+}
+
+void AbstractJob::stopTiming()
+{
+    m_cpuTimer.stop();
+    if (m_timer.isValid() && m_elapsed < 0)
+        m_elapsed = m_timer.elapsed();
+}
+
+//读取子进程已经用掉的CPU时间，采样间隔内的那一点在进程退出后会丢失
+void AbstractJob::sampleCpuTime()
+{
+    qint64 pid = processId();
+    if (pid <= 0)
+        return;
+    qint64 ms = -1;
+#if defined(Q_OS_WIN)
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, DWORD(pid));
+    if (process) {
+        FILETIME creation, exitTime, kernel, user;
+        if (GetProcessTimes(process, &creation, &exitTime, &kernel, &user)) {
+            quint64 k = (quint64(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime;
+            quint64 u = (quint64(user.dwHighDateTime) << 32) | user.dwLowDateTime;
+            ms = qint64((k + u) / 10000);
+        }
+        CloseHandle(process);
+    }
+#elif defined(Q_OS_MAC)
+    rusage_info_v0 info;
+    if (proc_pid_rusage(int(pid), RUSAGE_INFO_V0, reinterpret_cast<rusage_info_t*>(&info)) == 0) {
+        mach_timebase_info_data_t timebase;
+        mach_timebase_info(&timebase);
+        quint64 ticks = info.ri_user_time + info.ri_system_time;
+        ms = qint64(ticks * timebase.numer / timebase.denom / 1000000);
+    }
+#elif defined(Q_OS_LINUX)
+    QFile stat(QString("/proc/%1/stat").arg(pid));
+    if (stat.open(QIODevice::ReadOnly)) {
+        //进程名可能包含空格，从最后一个')'之后开始解析，utime/stime是第14、15个字段
+        QByteArray line = stat.readAll();
+        QList<QByteArray> fields = line.mid(line.lastIndexOf(')') + 2).split(' ');
+        if (fields.size() > 12) {
+            qint64 ticks = fields.at(11).toLongLong() + fields.at(12).toLongLong();
+            ms = ticks * 1000 / qMax(1L, sysconf(_SC_CLK_TCK));
+        }
+    }
+#endif
+    if (ms >= 0)
+        m_cpuTime = ms;
 }
 
 void AbstractJob::setModelIndex(const QModelIndex& index)
@@ -89,6 +169,7 @@ void AbstractJob::stop()
 
 void AbstractJob::onFinished(int exitCode, QProcess::ExitStatus exitStatus)
 {
+    stopTiming();
     m_log.append(readAll());
     if (exitStatus == QProcess::NormalExit && exitCode == 0) {
         LOG_DEBUG() << "job succeeeded";
@@ -106,3 +187,20 @@ void AbstractJob::onReadyRead()
     QString msg = readLine();
     appendToLog(msg);
 }
+
+void AbstractJob::onError(QProcess::ProcessError error)
+{
+    //进程没能启动就不会有finished(int, ExitStatus)，JobQueue会一直等它；
+    //error可能在QProcess::start()里同步发出，延后到事件循环里再通知
+    if (error == QProcess::FailedToStart)
+        QTimer::singleShot(0, this, SLOT(onFailedToStart()));
+}
+
+void AbstractJob::onFailedToStart()
+{
+    stopTiming();
+    LOG_WARN() << "job failed to start:" << label() << errorString();
+    appendToLog(errorString());
+    m_jobFinishedNormally = false;
+    emit finished(this, false);
+}
@@ -22,6 +22,8 @@
 #include <QProcess>
 #include <QModelIndex>
 #include <QList>
+#include <QElapsedTimer>
+#include <QTimer>
 
 class QAction;
 
@@ -43,6 +45,16 @@ public:
     QList<QAction*> standardActions() const { return m_standardActions; }
     QList<QAction*> successActions() const { return m_successActions; }
 
+    //优先级，数值越大越先执行，默认为0
+    int priority() const { return m_priority; }
+    void setPriority(int priority);
+    //子进程预计占用的CPU核数，JobQueue 据此决定能同时运行多少个任务
+    virtual int threadWeight() const { return 1; }
+    //从start()开始到现在（或到结束时）经过的毫秒数
+    qint64 elapsed() const;
+    //子进程占用的CPU时间（用户态+内核态，毫秒），无法获取时返回-1
+    qint64 cpuTime() const { return m_cpuTime; }
+
 public slots:
     virtual void start();
     virtual void stop();
@@ -60,12 +72,24 @@ protected slots:
     virtual void onFinished(int exitCode, QProcess::ExitStatus exitStatus);
     virtual void onReadyRead();
 
+private slots:
+    void onError(QProcess::ProcessError error);
+    void onFailedToStart();
+    void sampleCpuTime();
+
 private:
+    void stopTiming();
+
     bool m_ran;
     bool m_killed;
     bool m_jobFinishedNormally;
     QString m_log;
     QString m_label;
+    int m_priority;
+    QElapsedTimer m_timer;
+    qint64 m_elapsed; //结束时记录的耗时，-1表示还未结束
+    qint64 m_cpuTime;
+    QTimer m_cpuTimer; //子进程退出后就读不到它的CPU时间了，所以运行期间定时采样
 };
 
 #endif // ABSTRACTJOB_H
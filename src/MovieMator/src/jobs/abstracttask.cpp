@@ -24,6 +24,8 @@ AbstractTask::AbstractTask(const QString &name) : QObject()
     , m_killed(false)
     , m_stopped(false)
     , m_label(name)
+    , m_priority(0)
+    , m_elapsed(-1)
 {
 
 }
@@ -32,11 +34,17 @@ AbstractTask::AbstractTask(const QString &name) : QObject()
 void AbstractTask::start()
 {
     m_ran = true;
+    m_timer.start();
 }
 
 void AbstractTask::stop()
 {
     m_killed = true;
+    //还未启动的任务直接标记为结束，不再被EncodeTaskQueue调度
+    if (!m_ran) {
+        m_stopped = true;
+        emit finished(this, false);
+    }
 }
 
 
@@ -60,9 +68,23 @@ void AbstractTask::setLabel(const QString& name)
 void AbstractTask::setStopped(bool stopped)
 {
     m_stopped = stopped;
+    if (stopped && m_timer.isValid())
+        m_elapsed = m_timer.elapsed();
 }
 
 void AbstractTask::setFinishedNormally(bool finishedNormally)
 {
     m_finishedNormally = finishedNormally;
 }
+
+void AbstractTask::setPriority(int priority)
+{
+    m_priority = priority;
+}
+
+qint64 AbstractTask::elapsed() const
+{
+    if (m_elapsed >= 0)
+        return m_elapsed;
+    return m_timer.isValid() ? m_timer.elapsed() : 0;
+}
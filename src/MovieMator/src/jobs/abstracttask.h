@@ -20,6 +20,7 @@
 
 #include <QObject>
 #include <QModelIndex>
+#include <QElapsedTimer>
 
 class AbstractTask : public QObject
 {
@@ -43,6 +44,14 @@ public:
     void setStopped(bool stopped);
     void setFinishedNormally(bool finishedNormally);
 
+    //优先级，数值越大越先执行，默认为0
+    int priority() const {return m_priority;}
+    void setPriority(int priority);
+    //任务预计占用的线程数，EncodeTaskQueue 据此决定能同时运行多少个任务
+    virtual int threadWeight() const {return 1;}
+    //从start()开始到现在（或到结束时）经过的毫秒数
+    qint64 elapsed() const;
+
 signals:
     void progressUpdated(QModelIndex index, uint percent);
     void finished(AbstractTask *task, bool isSuccess);
@@ -61,6 +70,9 @@ private:
     bool            m_killed; //强制stop
     bool            m_stopped;//停止状态(可能正常执行完成，也可能是killed)
     QString         m_label;
+    int             m_priority;
+    QElapsedTimer   m_timer;
+    qint64          m_elapsed; //结束时记录的耗时，-1表示还未结束
 
 };
 
@@ -31,7 +31,7 @@
 #include "jobqueue.h"
 #include "jobs/videoqualityjob.h"
 
-EncodeJob::EncodeJob(const QString &name, const QString &xml)
+EncodeJob::EncodeJob(const QString &name, QTemporaryFile *xml)
     : MeltJob(name, xml)
 {
     QAction* action = new QAction(tr("Open"), this);
@@ -25,7 +25,7 @@ class EncodeJob : public MeltJob
 {
     Q_OBJECT
 public:
-    EncodeJob(const QString& name, const QString& xml);
+    EncodeJob(const QString& name, QTemporaryFile* xml);
 
 private slots:
     void onOpenTiggered();
@@ -27,6 +27,7 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QRegularExpression>
+#include <QThread>
 #include <Logger.h>
 
 FfmpegJob::FfmpegJob(const QString& name, const QStringList& args)
@@ -46,18 +47,33 @@ FfmpegJob::~FfmpegJob()
 }
 
 void FfmpegJob::start()
+{
+    setReadChannel(QProcess::StandardError);
+    startFfmpeg(*this, m_args);
+    AbstractJob::start();
+}
+
+void FfmpegJob::startFfmpeg(QProcess& process, const QStringList& args)
 {
     QString shotcutPath = qApp->applicationDirPath();
     QFileInfo ffmpegPath(shotcutPath, "ffmpeg");
-    setReadChannel(QProcess::StandardError);
-    LOG_DEBUG() << ffmpegPath.absoluteFilePath() << m_args;
+    LOG_DEBUG() << ffmpegPath.absoluteFilePath() << args;
 #ifdef Q_OS_WIN
-    QProcess::start(ffmpegPath.absoluteFilePath(), m_args);
+    process.start(ffmpegPath.absoluteFilePath(), args);
 #else
-    m_args.prepend(ffmpegPath.absoluteFilePath());
-    QProcess::start("/usr/bin/nice", m_args);
+    process.start("/usr/bin/nice", QStringList() << ffmpegPath.absoluteFilePath() << args);
 #endif
-    AbstractJob::start();
+}
+
+//ffmpeg 不指定 -threads 时由编解码器自己决定线程数，按一半核数计，
+//避免一个代理或转码任务把其它任务都挡在队列里
+int FfmpegJob::threadWeight() const
+{
+    int i = m_args.indexOf("-threads");
+    int threads = (i >= 0 && i + 1 < m_args.size()) ? m_args.at(i + 1).toInt() : 0;
+    if (threads <= 0)
+        threads = QThread::idealThreadCount() / 2;
+    return qMax(1, threads);
 }
 
 void FfmpegJob::onOpenTriggered()
@@ -29,6 +29,9 @@ public:
     FfmpegJob(const QString& name, const QStringList& args);
     virtual ~FfmpegJob();
     void start();
+    int threadWeight() const;
+    //按 FfmpegJob 的方式启动随程序发布的 ffmpeg（非 Windows下通过 nice降低优先级）
+    static void startFfmpeg(QProcess& process, const QStringList& args);
 
 private slots:
     void onOpenTriggered();
@@ -32,20 +32,24 @@
 #include <Logger.h>
 #include "mainwindow.h"
 #include "dialogs/textviewerdialog.h"
+#include "melttask.h"
 
 MeltJob::MeltJob(const QString& name, const QString& xml)
+    : MeltJob(name, MeltTask::createXmlFile(xml.toUtf8()))
+{
+}
+
+MeltJob::MeltJob(const QString& name, QTemporaryFile* xml)
     : AbstractJob(name)
-    , m_xml(QDir::tempPath().append("/MovieMator-XXXXXX.mmp"))
+    , m_xml(xml)
     , m_isStreaming(false)
+    , m_threadWeight(MeltTask::threadWeightFromXml(xml))
 {
+    Q_ASSERT(xml);
     QAction* action = new QAction(tr("View XML"), this);
     action->setToolTip(tr("View the MLT XML for this job"));
     connect(action, SIGNAL(triggered()), this, SLOT(onViewXmlTriggered()));
     m_standardActions << action;
-    m_xml.open();
-    m_xml.write(xml.toUtf8());
-    m_xml.close();
-    m_standardActions << action;
 }
 
 MeltJob::~MeltJob()
@@ -103,9 +107,9 @@ void MeltJob::start()
 
 QString MeltJob::xml()
 {
-    m_xml.open();
-    QString s(m_xml.readAll());
-    m_xml.close();
+    m_xml->open();
+    QString s(m_xml->readAll());
+    m_xml->close();
     return s;
 }
 
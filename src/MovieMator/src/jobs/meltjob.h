@@ -21,25 +21,30 @@
 
 #include "abstractjob.h"
 #include <QTemporaryFile>
+#include <QScopedPointer>
 
 class MeltJob : public AbstractJob
 {
     Q_OBJECT
 public:
     MeltJob(const QString& name, const QString& xml);
+    //xml为已经写好的 MLT XML文件，由 MeltJob接管
+    MeltJob(const QString& name, QTemporaryFile* xml);
     virtual ~MeltJob();
     void start();
     QString xml();
-    QString xmlPath() const { return m_xml.fileName(); }
+    QString xmlPath() const { return m_xml->fileName(); }
     void setIsStreaming(bool streaming);
+    int threadWeight() const { return m_threadWeight; }
 
 public slots:
     void onViewXmlTriggered();
 
 private:
     void onReadyRead();
-    QTemporaryFile m_xml;
+    QScopedPointer<QTemporaryFile> m_xml;
     bool m_isStreaming;
+    int m_threadWeight;
 };
 
 #endif // MELTJOB_H
@@ -21,14 +21,13 @@
 #include <QDir>
 #include <QIODevice>
 #include <QThread>
+#include <QXmlStreamReader>
 
 #include "melt/melt.h"
 
 extern "C" int melt_main(int argc, char** argv, MELT_CALLBACK callback, void *callback_obj);
 //int qmelt(int argc, char** argv);
 
-volatile static int stop_melt_thread = 0;
-
 
 class MeltThread : public QThread
 {
@@ -77,18 +76,34 @@ void MeltThread::run() {
 
 }
 
-MeltTask::MeltTask(const QString& name, const QString& xml) : AbstractTask(name)
-    , m_xml(QDir::tempPath().append("/MovieMator-XXXXXX.mmp"))
+MeltTask::MeltTask(const QString& name, const QString& xml)
+    : MeltTask(name, createXmlFile(xml.toUtf8()))
+{
+}
+
+MeltTask::MeltTask(const QString& name, QTemporaryFile* xml) : AbstractTask(name)
+    , m_xml(xml)
+    , m_stopRequested(0)
+    , m_threadWeight(threadWeightFromXml(xml))
 {
-    m_xml.open();
-    m_xml.write(xml.toUtf8());
-    m_xml.close();
+    Q_ASSERT(xml);
+    m_meltThread = new MeltThread(m_xml->fileName(), meltCallback, static_cast<void *>(this));
+}
 
-    m_meltThread = new MeltThread(m_xml.fileName(), meltCallback, static_cast<void *>(this));
+QTemporaryFile* MeltTask::createXmlFile(const QByteArray& xml)
+{
+    QTemporaryFile* file = new QTemporaryFile(QDir::tempPath().append("/MovieMator-XXXXXX.mmp"));
+    file->open();
+    file->write(xml);
+    file->close();
+    return file;
 }
 
 MeltTask::~MeltTask()
 {
+    //melt线程可能还在运行（例如刚发出finished），先让它退出再释放
+    m_stopRequested.storeRelease(1);
+    m_meltThread->wait();
     delete m_meltThread;
 }
 
@@ -104,21 +119,18 @@ void MeltTask::start()
 
 void MeltTask::stop()
 {
-    stop_melt_thread = 1;
+    m_stopRequested.storeRelease(1);
     AbstractTask::stop();
 
 }
 
 int MeltTask::meltCallback(int done, int success, int percent, void *callbackObj)
 {
-    if (stop_melt_thread)
-    {
-        stop_melt_thread = 0;
-        return 1;
-    }
-
     MeltTask *task = static_cast<MeltTask *>(callbackObj);
 
+    if (!done && task->m_stopRequested.loadAcquire())
+        return 1;
+
     emit task->progressUpdated(task->modelIndex(), uint(percent));
 
 
@@ -134,4 +146,40 @@ int MeltTask::meltCallback(int done, int success, int percent, void *callbackObj
     return 0;
 }
 
+//根据consumer的threads属性估计任务占用的线程数。
+//threads为0或未设置时（x264/x265默认如此）编码器自己决定线程数，但单个编码器很难长时间占满所有核，
+//按一半核数计，这样短的导出可以和长的导出同时进行
+static int threadWeightFromReader(QXmlStreamReader& reader)
+{
+    while (!reader.atEnd()) {
+        if (reader.readNext() != QXmlStreamReader::StartElement)
+            continue;
+        if (reader.name() != QLatin1String("consumer"))
+            continue;
+        QXmlStreamAttributes attributes = reader.attributes();
+        if (attributes.value("mlt_service") != QLatin1String("avformat"))
+            return 1;
+        int threads = attributes.value("threads").toInt();
+        if (threads <= 0)
+            threads = QThread::idealThreadCount() / 2;
+        return qMax(1, threads);
+    }
+    return 1;
+}
+
+int MeltTask::threadWeightFromXml(const QString& xml)
+{
+    QXmlStreamReader reader(xml);
+    return threadWeightFromReader(reader);
+}
 
+//consumer在 profile后面，只读到 consumer为止
+int MeltTask::threadWeightFromXml(QIODevice* xml)
+{
+    if (!xml || !xml->open(QIODevice::ReadOnly))
+        return 1;
+    QXmlStreamReader reader(xml);
+    int weight = threadWeightFromReader(reader);
+    xml->close();
+    return weight;
+}
@@ -20,6 +20,8 @@
 
 #include "abstracttask.h"
 #include <QTemporaryFile>
+#include <QScopedPointer>
+#include <QAtomicInt>
 
 class MeltThread;
 
@@ -27,17 +29,27 @@ class MeltTask : public AbstractTask
 {
 public:
     explicit MeltTask(const QString& name, const QString& xml);
+    //xml为已经写好的 MLT XML文件，由 MeltTask接管
+    MeltTask(const QString& name, QTemporaryFile* xml);
     ~MeltTask();
 
     void start();
     void stop();
 
-    QString xmlPath() const {return m_xml.fileName();}
+    QString xmlPath() const {return m_xml->fileName();}
+    int threadWeight() const {return m_threadWeight;}
 
     static int meltCallback(int done, int success, int percent, void *callbackObj);
+    //MeltJob 也用它估计 qmelt 子进程占用的线程数
+    static int threadWeightFromXml(const QString& xml);
+    static int threadWeightFromXml(QIODevice* xml);
+    //创建任务使用的临时 XML文件并写入 xml，导出时为空，由调用者直接写入
+    static QTemporaryFile* createXmlFile(const QByteArray& xml = QByteArray());
 private:
-    QTemporaryFile m_xml;
+    QScopedPointer<QTemporaryFile> m_xml;
     MeltThread *m_meltThread;
+    QAtomicInt m_stopRequested; //每个任务独立的停止标记，由melt线程在回调中读取
+    int m_threadWeight;
 
 };
 
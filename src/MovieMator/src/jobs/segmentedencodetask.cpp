@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "segmentedencodetask.h"
+#include "melttask.h"
+#include "ffmpegjob.h"
+#include <QTimer>
+#include <QDir>
+#include <QFileInfo>
+#include <QThread>
+#include <Logger.h>
+
+//拼接阶段在总进度中所占的比例
+static const uint kConcatPercent = 5;
+
+SegmentedEncodeTask::SegmentedEncodeTask(const QString& target) : AbstractTask(target)
+    , m_target(target)
+    , m_audioPart(-1)
+    , m_runningChildren(0)
+    , m_failed(false)
+    , m_percent(0)
+    , m_concatList(QDir::tempPath().append("/MovieMator-XXXXXX.txt"))
+{
+    connect(&m_concat, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(onConcatFinished(int, QProcess::ExitStatus)));
+    connect(&m_concat, SIGNAL(error(QProcess::ProcessError)), this, SLOT(onConcatError(QProcess::ProcessError)));
+}
+
+SegmentedEncodeTask::~SegmentedEncodeTask()
+{
+    if (m_concat.state() != QProcess::NotRunning) {
+        m_concat.kill();
+        m_concat.waitForFinished();
+    }
+    qDeleteAll(m_children);
+    foreach (const Part& part, m_parts)
+        qDeleteAll(part.passXml);
+}
+
+void SegmentedEncodeTask::addSegment(const QList<QTemporaryFile*>& passXml, const QString& path, int frames)
+{
+    Part part;
+    part.passXml = passXml;
+    part.path = path;
+    part.frames = frames;
+    part.pass = 0;
+    part.percent = 0;
+    part.task = nullptr;
+    part.running = false;
+    part.done = false;
+    part.weight = 0;
+    if (m_audioPart >= 0)
+        m_parts.insert(m_audioPart++, part);
+    else
+        m_parts.append(part);
+}
+
+void SegmentedEncodeTask::setAudio(QTemporaryFile* xml, const QString& path, int frames)
+{
+    Part part;
+    part.passXml << xml;
+    part.path = path;
+    //音频编码比视频快得多，按帧数的十分之一计入进度
+    part.frames = qMax(1, frames / 10);
+    part.pass = 0;
+    part.percent = 0;
+    part.task = nullptr;
+    part.running = false;
+    part.done = false;
+    part.weight = 0;
+    m_parts.append(part);
+    m_audioPart = m_parts.size() - 1;
+}
+
+int SegmentedEncodeTask::threadWeight() const
+{
+    return QThread::idealThreadCount();
+}
+
+void SegmentedEncodeTask::start()
+{
+    AbstractTask::start();
+    LOG_INFO() << "segmented export of" << m_target << "with" << m_parts.size() << "parts";
+    startPendingParts();
+}
+
+void SegmentedEncodeTask::stop()
+{
+    AbstractTask::stop();
+    m_failed = true;
+    foreach (MeltTask *task, m_children) {
+        if (task->ran() && !task->stopped())
+            task->stop();
+    }
+    if (m_concat.state() != QProcess::NotRunning)
+        m_concat.kill();
+}
+
+//和 EncodeTaskQueue 一样按线程数调度：正在运行的分段占用的线程数不超过本任务的 threadWeight，
+//没有分段在运行时总是启动一个
+void SegmentedEncodeTask::startPendingParts()
+{
+    const int budget = threadWeight();
+    int inUse = 0;
+    foreach (const Part& part, m_parts) {
+        if (part.running)
+            inUse += part.weight;
+    }
+    for (int i = 0; i < m_parts.size(); i++) {
+        Part& part = m_parts[i];
+        if (part.running || part.done)
+            continue;
+        int weight = qMin(MeltTask::threadWeightFromXml(part.passXml.at(part.pass)), budget);
+        if (inUse > 0 && inUse + weight > budget)
+            break;
+        part.weight = weight;
+        inUse += weight;
+        startPass(part);
+    }
+}
+
+void SegmentedEncodeTask::startPass(Part& part)
+{
+    MeltTask *task = new MeltTask(part.path, part.passXml.at(part.pass));
+    part.passXml[part.pass] = nullptr;
+    part.task = task;
+    part.percent = 0;
+    part.running = true;
+    m_children.append(task);
+    connect(task, SIGNAL(progressUpdated(QModelIndex, uint)), this, SLOT(onChildProgress(QModelIndex, uint)));
+    connect(task, SIGNAL(finished(AbstractTask *, bool)), this, SLOT(onChildFinished(AbstractTask *, bool)));
+    m_runningChildren++;
+    task->start();
+}
+
+void SegmentedEncodeTask::onChildProgress(QModelIndex index, uint percent)
+{
+    Q_UNUSED(index)
+    for (int i = 0; i < m_parts.size(); i++) {
+        if (m_parts[i].task == sender()) {
+            m_parts[i].percent = percent;
+            break;
+        }
+    }
+    updateProgress();
+}
+
+void SegmentedEncodeTask::onChildFinished(AbstractTask *task, bool isSuccess)
+{
+    m_runningChildren--;
+
+    if (!isSuccess && !m_failed) {
+        //任意一段失败则整个导出失败，停止其它分段
+        LOG_WARNING() << "segment failed:" << task->label();
+        m_failed = true;
+        foreach (MeltTask *child, m_children) {
+            if (child != task && child->ran() && !child->stopped())
+                child->stop();
+        }
+    }
+
+    for (int i = 0; i < m_parts.size(); i++) {
+        Part& part = m_parts[i];
+        if (part.task != task)
+            continue;
+        part.running = false;
+        if (m_failed)
+            break;
+        if (part.pass + 1 < part.passXml.size()) {
+            part.pass++;
+            part.percent = 0;
+        } else {
+            part.percent = 100;
+            part.done = true;
+        }
+        break;
+    }
+
+    if (!m_failed) {
+        updateProgress();
+        startPendingParts();
+    }
+
+    if (m_runningChildren > 0)
+        return;
+
+    if (m_failed)
+        finish(false);
+    else
+        startConcat();
+}
+
+void SegmentedEncodeTask::startConcat()
+{
+    //concat demuxer的列表文件
+    m_concatList.open();
+    for (int i = 0; i < m_parts.size(); i++) {
+        if (i == m_audioPart)
+            continue;
+        QString path = m_parts.at(i).path;
+        path.replace("'", "'\\''");
+        m_concatList.write(QString("file '%1'\n").arg(path).toUtf8());
+    }
+    m_concatList.close();
+
+    QStringList args;
+    args << "-hide_banner" << "-y";
+    args << "-f" << "concat" << "-safe" << "0" << "-i" << m_concatList.fileName();
+    if (m_audioPart >= 0)
+        args << "-i" << m_parts.at(m_audioPart).path;
+    args << "-map" << "0:v";
+    if (m_audioPart >= 0)
+        args << "-map" << "1:a";
+    args << "-c" << "copy" << m_target;
+
+    FfmpegJob::startFfmpeg(m_concat, args);
+}
+
+void SegmentedEncodeTask::onConcatError(QProcess::ProcessError error)
+{
+    //ffmpeg没能启动就不会有 finished，任务会一直占着队列；
+    //error可能在 start()里同步发出，延后到事件循环里再结束
+    if (error == QProcess::FailedToStart)
+        QTimer::singleShot(0, this, SLOT(onConcatFailedToStart()));
+}
+
+void SegmentedEncodeTask::onConcatFailedToStart()
+{
+    LOG_WARNING() << "concat failed to start:" << m_concat.errorString();
+    finish(false);
+}
+
+void SegmentedEncodeTask::onConcatFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    bool isSuccess = !m_failed && exitStatus == QProcess::NormalExit && exitCode == 0;
+    if (!isSuccess)
+        LOG_WARNING() << "concat failed:" << m_concat.readAllStandardError();
+    finish(isSuccess);
+}
+
+void SegmentedEncodeTask::updateProgress()
+{
+    qint64 total = 0;
+    double done = 0.0;
+    foreach (const Part& part, m_parts) {
+        int passes = part.passXml.size();
+        total += part.frames;
+        done += part.frames * (part.pass + part.percent / 100.0) / passes;
+    }
+    if (total <= 0)
+        return;
+    uint percent = uint(done * (100 - kConcatPercent) / total);
+    if (percent != m_percent) {
+        m_percent = percent;
+        emit progressUpdated(m_index, percent);
+    }
+}
+
+void SegmentedEncodeTask::removeIntermediateFiles()
+{
+    //分段文件及其双遍编码的日志文件都以分段文件名开头
+    foreach (const Part& part, m_parts) {
+        QFileInfo fi(part.path);
+        QDir dir(fi.path());
+        foreach (const QString& name, dir.entryList(QStringList() << fi.fileName() + "*", QDir::Files | QDir::Hidden))
+            dir.remove(name);
+    }
+}
+
+void SegmentedEncodeTask::finish(bool isSuccess)
+{
+    removeIntermediateFiles();
+    if (isSuccess) {
+        setFinishedNormally(true);
+        emit progressUpdated(m_index, 100);
+    }
+    setStopped(true);
+    LOG_INFO() << "segmented export of" << m_target << (isSuccess ? "done" : "failed") << "in" << elapsed() << "ms";
+    emit finished(this, isSuccess);
+}
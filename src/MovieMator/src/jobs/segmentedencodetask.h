@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SEGMENTEDENCODETASK_H
+#define SEGMENTEDENCODETASK_H
+
+#include "abstracttask.h"
+#include <QProcess>
+#include <QStringList>
+#include <QTemporaryFile>
+
+class MeltTask;
+
+//分段并行导出：视频按 GOP对齐分成若干段同时编码，音频单独连续编码，
+//全部完成后用 ffmpeg的 concat无损拼接成目标文件
+class SegmentedEncodeTask : public AbstractTask
+{
+    Q_OBJECT
+public:
+    explicit SegmentedEncodeTask(const QString& target);
+    ~SegmentedEncodeTask();
+
+    //passXml为该段每一遍编码的 XML文件，双遍编码时有两个，由本任务接管
+    void addSegment(const QList<QTemporaryFile*>& passXml, const QString& path, int frames);
+    void setAudio(QTemporaryFile* xml, const QString& path, int frames);
+
+    void start();
+    void stop();
+    //分段在这个预算内并行运行，占满全部核
+    int threadWeight() const;
+
+private slots:
+    void onChildProgress(QModelIndex index, uint percent);
+    void onChildFinished(AbstractTask *task, bool isSuccess);
+    void onConcatFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onConcatError(QProcess::ProcessError error);
+    void onConcatFailedToStart();
+
+private:
+    struct Part {
+        QList<QTemporaryFile*> passXml;  //交给 MeltTask后置为空
+        QString     path;
+        int         frames;
+        int         pass;       //正在执行第几遍（从0开始）
+        uint        percent;    //当前这一遍的进度
+        MeltTask    *task;
+        bool        running;
+        bool        done;       //所有遍都已完成
+        int         weight;     //正在运行的这一遍占用的线程数
+    };
+
+    void startPendingParts();
+    void startPass(Part& part);
+    void startConcat();
+    void updateProgress();
+    void removeIntermediateFiles();
+    void finish(bool isSuccess);
+
+    QString             m_target;
+    QList<Part>         m_parts;
+    int                 m_audioPart;    //音频在 m_parts中的位置，-1表示没有音频
+    QList<MeltTask *>   m_children;
+    int                 m_runningChildren;
+    bool                m_failed;
+    uint                m_percent;
+    QProcess            m_concat;
+    QTemporaryFile      m_concatList;
+};
+
+#endif // SEGMENTEDENCODETASK_H
@@ -27,6 +27,7 @@
 #include "controllers/filtercontroller.h"
 #include "templateeidtor.h"
 #include "util.h"
+#include "proxymanager.h"
 #include <QDomDocument>
 #include <Logger.h>
 #include <cmath>
@@ -46,6 +47,14 @@ FILE_HANDLE MainInterface::openFile(QString filepath)
 //    Q_ASSERT(producer->is_valid());
     if (producer && producer->is_valid()) {
         MLT.setImageDurationFromDefault(producer);
+        // 代理文件已生成时预览直接使用代理文件
+        if (PROXY.prepare(*producer)) {
+            Mlt::Producer* proxy = PROXY.proxied(*producer);
+            if (proxy) {
+                delete producer;
+                producer = proxy;
+            }
+        }
         //if (filepath.endsWith(".mlt"))
         //    producer->set(kShotcutVirtualClip, 1);
     }
@@ -65,6 +65,10 @@
 #include "qmltypes/mmqmlutilities.h"
 #include <qmlapplication.h>
 #include "autosavefile.h"
+#include "servicesnapshot.h"
+#include "previewrendercache.h"
+#include "projectloader.h"
+#include "proxymanager.h"
 //#include <commands/playlistcommands.h>
 #include "shotcut_mlt_properties.h"
 #include "widgets/avfoundationproducerwidget.h"
@@ -93,6 +97,7 @@
 #include "containerdock.h"
 #include "templateeidtor.h"
 #include <util.h>
+#include "timelineexporter.h"
 
 #include <QtWidgets>
 #include <Logger.h>
@@ -102,7 +107,7 @@
 #include <QQuickItem>
 #include <QtNetwork>
 #include <QJsonDocument>
-#include <QJSEngine>
+#include <QElapsedTimer>
 #include <QQmlEngine>
 #include <QQmlContext>
 
@@ -344,7 +349,8 @@ MainWindow::MainWindow()
 
     // Add the docks.
     LOG_DEBUG() << "Add the docks";
-//    m_scopeController = new ScopeController(this, ui->menuView);
+    //没有“视图”菜单，示波器放在设置菜单下
+    m_scopeController = new ScopeController(this, ui->menuSettings);
     QDockWidget* audioMeterDock = findChild<QDockWidget*>("AudioPeakMeterDock");
     if (audioMeterDock) {
         connect(ui->actionAudioMeter, SIGNAL(triggered()), audioMeterDock->toggleViewAction(), SLOT(trigger()));
@@ -409,6 +415,17 @@ MainWindow::MainWindow()
     connect(m_timelineDock->model(), SIGNAL(showStatusMessage(QString)), this, SLOT(showStatusMessage(QString)));
     connect(m_timelineDock->model(), SIGNAL(created()), SLOT(onMultitrackCreated()));
     connect(m_timelineDock->model(), SIGNAL(closed()), SLOT(onMultitrackClosed()));
+    m_previewRenderCache = new PreviewRenderCache(*m_timelineDock->model(), this);
+    connect(m_previewRenderCache, SIGNAL(showStatusMessage(QString)), this, SLOT(showStatusMessage(QString)));
+    connect(m_timelineDock->model(), SIGNAL(closed()), m_previewRenderCache, SLOT(clear()));
+    connect(MLT.videoWidget(), SIGNAL(contentInvalidated()), m_previewRenderCache, SLOT(invalidate()));
+    connect(m_timelineDock->model(), SIGNAL(loaded()), this, SLOT(useProxies()));
+    m_projectLoader = new ProjectLoader(*m_timelineDock->model(), this);
+    connect(m_projectLoader, SIGNAL(showStatusMessage(QString)), this, SLOT(showStatusMessage(QString)));
+    connect(m_timelineDock->model(), SIGNAL(loaded()), m_projectLoader, SLOT(onTimelineLoaded()));
+    connect(m_timelineDock->model(), SIGNAL(closed()), m_projectLoader, SLOT(cancel()));
+    connect(MLT.videoWidget(), SIGNAL(frameDisplayed(const SharedFrame&)), m_projectLoader, SLOT(onFrameDisplayed()));
+    connect(&PROXY, SIGNAL(proxyReady(QString)), this, SLOT(useProxies(QString)));
     //sll：modify放在一个地方建立连接，保证数据操作及更新都在界面更新之前
     connect(m_timelineDock->model(), SIGNAL(modified()), m_timelineDock, SLOT(clearSelectionIfInvalid()));
     connect(m_timelineDock->model(), SIGNAL(modified()), m_timelineDock->model(), SLOT(adjustBackgroundDuration()));
@@ -436,6 +453,10 @@ MainWindow::MainWindow()
     m_filterController = new FilterController(this);
 
     connect(m_filterController,SIGNAL(filtersInfoLoaded()),this,SLOT(onFiltersInfoLoaded()));
+    // 变速后时间线模型换了新的 producer，界面跟着刷新
+    connect(m_timelineDock->model(), SIGNAL(producerChanged(Mlt::Producer*)), SLOT(onProducerChanged()));
+    connect(m_timelineDock->model(), SIGNAL(producerChanged(Mlt::Producer*)), m_filterController, SLOT(setProducer(Mlt::Producer*)));
+    connect(m_timelineDock->model(), SIGNAL(producerChanged(Mlt::Producer*)), m_timelineDock, SLOT(onProducerChanged(Mlt::Producer*)));
 
     m_propertiesVideoFilterDock = new FiltersDock(m_filterController->metadataModel(), m_filterController->attachedModel(),true, this);
     m_propertiesVideoFilterDock->setExtraQmlContextProperty("mainwindow", this);
@@ -586,7 +607,7 @@ MainWindow::MainWindow()
     connect(videoWidget, SIGNAL(seekTo(int)), m_player, SLOT(seek(int)));
     connect(videoWidget, SIGNAL(gpuNotSupported()), this, SLOT(onGpuNotSupported()));
 //    connect(videoWidget, SIGNAL(frameDisplayed(const SharedFrame&)), m_scopeController, SIGNAL(newFrame(const SharedFrame&)));
- //   connect(videoWidget, SIGNAL(frameDisplayed(const SharedFrame&)), m_scopeController, SLOT(onFrameDisplayed(const SharedFrame&)));
+    connect(videoWidget, SIGNAL(frameDisplayed(const SharedFrame&)), m_scopeController, SLOT(onFrameDisplayed(const SharedFrame&)));
 
     //connect(m_filterController, SIGNAL(currentFilterChanged(QObject*, QmlMetadata*, int)), videoWidget, SLOT(setCurrentFilter(QObject*, QmlMetadata*)), Qt::QueuedConnection);
 //    connect(m_filterController, SIGNAL(currentFilterChanged(QObject*, QmlMetadata*, int)), this, SLOT(setCurrentFilterForVideoWidget(QObject*, QmlMetadata*)), Qt::QueuedConnection);
@@ -1336,12 +1357,16 @@ void MainWindow::stepLeftBySeconds(int sec)
     m_player->seek(m_player->position() + sec * qRound(MLT.profile().fps()));
 }
 
-void MainWindow::doAutosave()
+void MainWindow::doAutosave(Mlt::Producer* snapshot)
 {
     m_autosaveMutex.lock();
-    if (m_autosaveFile) {
+    if (m_autosaveFile && snapshot) {
         if (m_autosaveFile->isOpen() || m_autosaveFile->open(QIODevice::ReadWrite)) {
-            saveXML(m_autosaveFile->fileName(), false /* without relative paths */);
+            // 先写临时文件再整体替换，写到一半崩溃时上一次的自动保存仍然完整
+            QString tempFileName = m_autosaveFile->fileName() + ".part";
+            MLT.saveXML(tempFileName, snapshot, false /* without relative paths */);
+            if (!m_autosaveFile->replaceWith(tempFileName))
+                LOG_ERROR() << "failed to write autosave file" << m_autosaveFile->fileName();
         } else {
             LOG_ERROR() << "failed to open autosave file for writing" << m_autosaveFile->fileName();
         }
@@ -1407,17 +1432,41 @@ void MainWindow::setProjectAspectRatio()
     aspectRationSettingsDialog.exec();
 }
 
-static void autosaveTask(MainWindow* p)
+static void autosaveTask(MainWindow* p, Mlt::Producer* snapshot, QAtomicInt* busy)
 {
     Q_ASSERT(p);
     LOG_DEBUG() << "running";
-    p->doAutosave();
+    p->doAutosave(snapshot);
+    delete snapshot;
+    busy->store(0);
 }
 
 void MainWindow::onAutosaveTimeout()
 {
-    if (isWindowModified())
-        QtConcurrent::run(autosaveTask, this);
+    if (!isWindowModified())
+        return;
+    // 上一次还没写完，稍后再保存
+    if (!m_autosaveBusy.testAndSetOrdered(0, 1)) {
+        m_autosaveTimer.start();
+        return;
+    }
+    // 在界面线程上复制工程结构和属性，不打开素材，代价远小于序列化；
+    // 工作线程只序列化这份副本，不会与编辑同时访问时间线
+    Mlt::Producer* snapshot = nullptr;
+    if (multitrack()) {
+        snapshot = ServiceSnapshot::take(*multitrack());
+    } else if (playlist()) {
+        snapshot = ServiceSnapshot::take(*playlist());
+        if (snapshot)
+            snapshot->set_in_and_out(0, snapshot->get_length() - 1);
+    } else if (MLT.producer()) {
+        snapshot = ServiceSnapshot::take(*MLT.producer());
+    }
+    if (!snapshot) {
+        m_autosaveBusy.store(0);
+        return;
+    }
+    QtConcurrent::run(autosaveTask, this, snapshot, &m_autosaveBusy);
 }
 
 void MainWindow::updateAutoSave()
@@ -1490,6 +1539,8 @@ void MainWindow::open(QString url, const Mlt::Properties* properties)
             m_timelineDock->model()->close();
         if (!isXmlRepaired(checker, url))
             return;
+        // 开始统计可交互时间
+        m_projectLoader->begin(url);
         modified = checkAutoSave(url);
         // let the new project change the profile
         if (modified || QFile::exists(url)) {
@@ -1775,6 +1826,10 @@ void MainWindow::readPlayerSettings()
     ui->actionRealtime->setChecked(Settings.playerRealtime());
     ui->actionProgressive->setChecked(Settings.playerProgressive());
     ui->actionScrubAudio->setChecked(Settings.playerScrubAudio());
+    ui->actionPreviewStats->setChecked(Settings.playerPreviewStats());
+    m_player->setPreviewStatsVisible(Settings.playerPreviewStats());
+    ui->actionFrameCache->setChecked(Settings.playerFrameCache());
+    ui->actionUseProxies->setChecked(Settings.proxyEnabled());
     if (ui->actionJack)
         ui->actionJack->setChecked(Settings.playerJACK());
     if (ui->actionGPU) {
@@ -3394,6 +3449,97 @@ void MainWindow::on_actionProgressive_triggered(bool checked)
     Settings.setPlayerProgressive(checked);
 }
 
+void MainWindow::on_actionPreviewStats_triggered(bool checked)
+{
+    m_player->setPreviewStatsVisible(checked);
+    Settings.setPlayerPreviewStats(checked);
+}
+
+void MainWindow::on_actionSavePreviewTrace_triggered()
+{
+    QString path = Settings.savePath();
+    path.append("/preview-trace.csv");
+    QString saveFileName = QFileDialog::getSaveFileName(this, tr("Save Preview Trace"), path, tr("CSV (*.csv)"));
+    if (saveFileName.isEmpty())
+        return;
+    if (QFileInfo(saveFileName).suffix() != "csv")
+        saveFileName += ".csv";
+    Mlt::GLWidget* videoWidget = static_cast<Mlt::GLWidget*>(&(MLT));
+    if (videoWidget->writePreviewTrace(saveFileName))
+        showStatusMessage(tr("Saved %1").arg(saveFileName));
+    else
+        showStatusMessage(tr("Failed to save %1").arg(saveFileName));
+}
+
+void MainWindow::on_actionFrameCache_triggered(bool checked)
+{
+    Settings.setPlayerFrameCache(checked);
+    static_cast<Mlt::GLWidget*>(&(MLT))->setFrameCacheEnabled(checked);
+}
+
+void MainWindow::on_actionUseProxies_triggered(bool checked)
+{
+    Settings.setProxyEnabled(checked);
+    if (checked)
+        useProxies();
+}
+
+// 时间线上的片段换成已生成的代理文件
+void MainWindow::useProxies(const QString& hash)
+{
+    if (m_timelineDock->model()->useProxies(hash) > 0)
+        MLT.refreshConsumer();
+}
+
+void MainWindow::on_actionRenderPreview_triggered()
+{
+    MultitrackModel* model = m_timelineDock->model();
+    if (!model->tractor())
+        return;
+    // 优先渲染选中的片段，否则渲染时间线的入点到出点
+    TIMELINE_SELECTION selection = model->selection();
+    if (selection.nIndexOfSelectedTrack >= 0 && selection.nIndexOfSelectedClip >= 0) {
+        QModelIndex clip = model->index(selection.nIndexOfSelectedClip, 0, model->index(selection.nIndexOfSelectedTrack));
+        int start = clip.data(MultitrackModel::StartRole).toInt();
+        int duration = clip.data(MultitrackModel::DurationRole).toInt();
+        if (duration > 0) {
+            m_previewRenderCache->addRange(start, start + duration - 1);
+            return;
+        }
+    }
+    int in = model->tractor()->get_in();
+    int out = model->tractor()->get_out();
+    if (in > 0 || out < model->tractor()->get_length() - 1)
+        m_previewRenderCache->addRange(in, out);
+    else
+        showStatusMessage(tr("Select a clip or set the in and out points to render a preview"));
+}
+
+void MainWindow::on_actionRenderHeavyPreviews_triggered()
+{
+    if (!m_previewRenderCache->addHeavyRanges())
+        showStatusMessage(tr("No sections of the timeline need a preview render"));
+}
+
+void MainWindow::on_actionClearPreviewRenders_triggered()
+{
+    m_previewRenderCache->removeFiles();
+    showStatusMessage(tr("Preview renders removed"));
+}
+
+void MainWindow::on_actionNormalizeLoudness_triggered()
+{
+    QStringList targets;
+    targets << tr("-23 LUFS (EBU R128 broadcast)") << tr("-16 LUFS (podcast)") << tr("-14 LUFS (streaming)");
+    static const double targetValues[] = { -23.0, -16.0, -14.0 };
+    bool ok = false;
+    QString target = QInputDialog::getItem(this, tr("Normalize Loudness"),
+        tr("Target loudness for the selected clip, or for all clips if none is selected:"),
+        targets, 0, false, &ok);
+    if (ok && targets.contains(target))
+        m_timelineDock->normalizeLoudness(targetValues[targets.indexOf(target)]);
+}
+
 void MainWindow::changeDeinterlacer(bool checked, const char* method)
 {
     if (checked) {
@@ -4023,55 +4169,39 @@ void MainWindow::onClipCopied()
 
 void MainWindow::on_actionExportEDL_triggered()
 {
+    if (!multitrack())
+        return;
     // Dialog to get export file name.
     QString path = Settings.savePath();
     path.append("/.edl");
-    QString saveFileName = QFileDialog::getSaveFileName(this, tr("Export EDL"), path, tr("EDL (*.edl)"));
+    QString edlFilter = tr("EDL (*.edl)");
+    QString jsonFilter = tr("Timeline JSON (*.json)");
+    QString selectedFilter = edlFilter;
+    QString saveFileName = QFileDialog::getSaveFileName(this, tr("Export EDL"), path,
+                                                        edlFilter + ";;" + jsonFilter, &selectedFilter);
     if (!saveFileName.isEmpty()) {
+        bool asJson = selectedFilter == jsonFilter || saveFileName.endsWith(".json", Qt::CaseInsensitive);
         QFileInfo fi(saveFileName);
-        if (fi.suffix() != "edl")
+        if (asJson && fi.suffix() != "json")
+            saveFileName += ".json";
+        else if (!asJson && fi.suffix() != "edl")
             saveFileName += ".edl";
 
-        // Locate the JavaScript file in the filesystem.
-        QDir qmlDir = QmlUtilities::qmlDir();
-        qmlDir.cd("export-edl");
-        QString jsFileName = qmlDir.absoluteFilePath("export-edl.js");
-        QFile scriptFile(jsFileName);
-        if (scriptFile.open(QIODevice::ReadOnly)) {
-            // Read JavaScript into a string.
-            QTextStream stream(&scriptFile);
-            QString contents = stream.readAll();
-            scriptFile.close();
-
-            // Evaluate JavaScript.
-            QJSEngine jsEngine;
-            QJSValue result = jsEngine.evaluate(contents, jsFileName);
-            if (!result.isError()) {
-                // Call the JavaScript main function.
-                QJSValue options = jsEngine.newObject();
-                options.setProperty("useBaseNameForReelName", true);
-                options.setProperty("useBaseNameForClipComment", true);
-                options.setProperty("channelsAV", "AA/V");
-                QJSValueList args;
-                args << MLT.XML() << options;
-                result = result.call(args);
-                if (!result.isError()) {
-                    // Save the result with the export file name.
-                    QFile f(saveFileName);
-                    f.open(QIODevice::WriteOnly | QIODevice::Text);
-                    f.write(result.toString().toLatin1());
-                    f.close();
-                }
-            }
-            if (result.isError()) {
-                LOG_ERROR() << "Uncaught exception at line"
-                            << result.property("lineNumber").toInt()
-                            << ":" << result.toString();
-                showStatusMessage(tr("A JavaScript error occurred during export."));
-            }
-        } else {
-            showStatusMessage(tr("Failed to open export-edl.js"));
-        }
+        QElapsedTimer timer;
+        timer.start();
+        TimelineExporter::Options options;
+        options.useBaseNameForReelName = true;
+        options.useBaseNameForClipComment = true;
+        options.channelsAV = "AA/V";
+        TimelineExporter exporter(*m_timelineDock->model()->tractor(), options);
+        QFile f(saveFileName);
+        bool ok = f.open(QIODevice::WriteOnly | QIODevice::Text);
+        if (ok)
+            ok = asJson ? exporter.writeJson(f) : exporter.writeEdl(f);
+        f.close();
+        LOG_INFO() << "exported" << saveFileName << "in" << timer.elapsed() << "ms";
+        if (!ok)
+            showStatusMessage(tr("Failed to write %1").arg(saveFileName));
     }
 }
 
@@ -24,6 +24,7 @@
 
 #include <QMainWindow>
 #include <QMutex>
+#include <QAtomicInt>
 #include <QTimer>
 #include <QUrl>
 #include <QNetworkAccessManager>
@@ -61,6 +62,8 @@ class FiltersDock;
 //class HtmlEditor;
 class TimelineDock;
 class AutoSaveFile;
+class PreviewRenderCache;
+class ProjectLoader;
 class QNetworkReply;
 class FilterWidget;
 class QmlMetadata;
@@ -107,8 +110,8 @@ public:
     Mlt::Playlist* playlist() const;
     //获取当前整个时间线对象，即Tractor
     Mlt::Producer* multitrack() const;
-    //自动保存工程文件
-    void doAutosave();
+    //自动保存工程文件，snapshot 为界面线程上取的工程副本
+    void doAutosave(Mlt::Producer* snapshot);
     //设置主窗口全屏
     void setFullScreen(bool isFullScreen);
     //获取无标题的工程文件名
@@ -232,7 +235,10 @@ private:
     QActionGroup* m_languagesGroup;//语言设置菜单的所有操作
 //    HtmlEditor* m_htmlEditor;
     AutoSaveFile* m_autosaveFile;//自动保存工程文件对象
+    PreviewRenderCache* m_previewRenderCache;//时间线区间的预渲染
+    ProjectLoader* m_projectLoader;//分阶段打开工程
     QMutex m_autosaveMutex;//自动保存互斥锁
+    QAtomicInt m_autosaveBusy;//自动保存正在写文件
     QTimer m_autosaveTimer;//自动保存定时器
     int m_exitCode;//程序退出码，可查看是否异常退出
     int m_navigationPosition;
@@ -441,6 +447,15 @@ private slots:
     void on_actionEnter_Full_Screen_triggered();
     void on_actionRealtime_triggered(bool checked);
     void on_actionProgressive_triggered(bool checked);
+    void on_actionPreviewStats_triggered(bool checked);
+    void on_actionSavePreviewTrace_triggered();
+    void on_actionFrameCache_triggered(bool checked);
+    void on_actionUseProxies_triggered(bool checked);
+    void useProxies(const QString& hash = QString());
+    void on_actionRenderPreview_triggered();
+    void on_actionRenderHeavyPreviews_triggered();
+    void on_actionClearPreviewRenders_triggered();
+    void on_actionNormalizeLoudness_triggered();
     void on_actionOneField_triggered(bool checked);
     void on_actionLinearBlend_triggered(bool checked);
     void on_actionYadifTemporal_triggered(bool checked);
@@ -0,0 +1,370 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "mediaprobe.h"
+#include "database.h"
+#include "util.h"
+#include <Logger.h>
+#include <Mlt.h>
+#include <QFileInfo>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QElapsedTimer>
+#include <QRunnable>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <QThread>
+
+QJsonObject MediaInfo::toJson() const
+{
+    QJsonObject json;
+    json["resource"] = resource;
+    json["hash"] = hash;
+    json["size"] = double(size);
+    json["modified"] = modified.toMSecsSinceEpoch() / 1000.0;
+    json["valid"] = valid;
+    if (!error.isEmpty())
+        json["error"] = error;
+    json["duration"] = duration;
+    json["width"] = width;
+    json["height"] = height;
+    json["frameRate"] = frameRate;
+    json["sampleAspectRatio"] = sampleAspectRatio;
+    json["progressive"] = progressive;
+    json["videoIndex"] = videoIndex;
+    json["audioIndex"] = audioIndex;
+
+    QJsonArray streamArray;
+    foreach (const MediaStreamInfo& stream, streams) {
+        QJsonObject s;
+        s["index"] = stream.index;
+        s["type"] = stream.type;
+        s["codec"] = stream.codec;
+        s["codecLongName"] = stream.codecLongName;
+        s["bitRate"] = double(stream.bitRate);
+        if (stream.type == "video") {
+            s["width"] = stream.width;
+            s["height"] = stream.height;
+            s["frameRate"] = stream.frameRate;
+            s["pixelFormat"] = stream.pixelFormat;
+        } else if (stream.type == "audio") {
+            s["channels"] = stream.channels;
+            s["sampleRate"] = stream.sampleRate;
+            s["sampleFormat"] = stream.sampleFormat;
+        }
+        streamArray.append(s);
+    }
+    json["streams"] = streamArray;
+
+    QJsonObject tagObject;
+    for (QMap<QString, QString>::const_iterator i = tags.constBegin(); i != tags.constEnd(); ++i)
+        tagObject[i.key()] = i.value();
+    json["tags"] = tagObject;
+    return json;
+}
+
+MediaInfo MediaInfo::fromJson(const QJsonObject& json)
+{
+    MediaInfo info;
+    info.resource = json["resource"].toString();
+    info.hash = json["hash"].toString();
+    info.size = qint64(json["size"].toDouble());
+    info.modified = QDateTime::fromMSecsSinceEpoch(qint64(json["modified"].toDouble() * 1000.0));
+    info.valid = json["valid"].toBool();
+    info.error = json["error"].toString();
+    info.duration = json["duration"].toDouble();
+    info.width = json["width"].toInt();
+    info.height = json["height"].toInt();
+    info.frameRate = json["frameRate"].toDouble();
+    info.sampleAspectRatio = json["sampleAspectRatio"].toDouble(1.0);
+    info.progressive = json["progressive"].toBool(true);
+    info.videoIndex = json["videoIndex"].toInt(-1);
+    info.audioIndex = json["audioIndex"].toInt(-1);
+
+    foreach (const QJsonValue& value, json["streams"].toArray()) {
+        QJsonObject s = value.toObject();
+        MediaStreamInfo stream;
+        stream.index = s["index"].toInt(-1);
+        stream.type = s["type"].toString();
+        stream.codec = s["codec"].toString();
+        stream.codecLongName = s["codecLongName"].toString();
+        stream.bitRate = qint64(s["bitRate"].toDouble());
+        stream.width = s["width"].toInt();
+        stream.height = s["height"].toInt();
+        stream.frameRate = s["frameRate"].toDouble();
+        stream.pixelFormat = s["pixelFormat"].toString();
+        stream.channels = s["channels"].toInt();
+        stream.sampleRate = s["sampleRate"].toInt();
+        stream.sampleFormat = s["sampleFormat"].toString();
+        info.streams << stream;
+    }
+
+    QJsonObject tagObject = json["tags"].toObject();
+    for (QJsonObject::const_iterator i = tagObject.constBegin(); i != tagObject.constEnd(); ++i)
+        info.tags[i.key()] = i.value().toString();
+    return info;
+}
+
+QString MediaInfo::toText() const
+{
+    QString text;
+    QTextStream stream(&text);
+    if (!valid) {
+        stream << "[error]\n" << "file=" << resource << "\n" << "message=" << error << "\n";
+        return text;
+    }
+    foreach (const MediaStreamInfo& s, streams) {
+        stream << "[streams.stream." << s.index << "]\n";
+        stream << "index=" << s.index << "\n";
+        stream << "codec_name=" << s.codec << "\n";
+        stream << "codec_long_name=" << s.codecLongName << "\n";
+        stream << "codec_type=" << s.type << "\n";
+        if (s.type == "video") {
+            stream << "width=" << s.width << "\n";
+            stream << "height=" << s.height << "\n";
+            stream << "pix_fmt=" << s.pixelFormat << "\n";
+            stream << "frame_rate=" << s.frameRate << "\n";
+        } else if (s.type == "audio") {
+            stream << "sample_fmt=" << s.sampleFormat << "\n";
+            stream << "sample_rate=" << s.sampleRate << " Hz\n";
+            stream << "channels=" << s.channels << "\n";
+        }
+        if (s.bitRate > 0)
+            stream << "bit_rate=" << (s.bitRate / 1000) << " Kbit/s\n";
+        stream << "\n";
+    }
+    stream << "[format]\n";
+    stream << "filename=" << resource << "\n";
+    stream << "nb_streams=" << streams.size() << "\n";
+    stream << "duration=" << QString::number(duration, 'f', 3) << " s\n";
+    stream << "size=" << QString::number(size / 1024.0, 'f', 1) << " KiB\n";
+    if (duration > 0.0)
+        stream << "bit_rate=" << qRound64(size * 8 / duration / 1000) << " Kbit/s\n";
+    for (QMap<QString, QString>::const_iterator i = tags.constBegin(); i != tags.constEnd(); ++i)
+        stream << "tags." << i.key() << "=" << i.value() << "\n";
+    return text;
+}
+
+class MediaProbeTask : public QRunnable
+{
+public:
+    MediaProbeTask(MediaProbe* probe, const QString& path, bool refresh)
+        : m_probe(probe), m_path(path), m_refresh(refresh)
+    {}
+    void run()
+    {
+        MediaInfo info = m_probe->probe(m_path, m_refresh);
+        QMetaObject::invokeMethod(m_probe, "onProbed", Qt::QueuedConnection, Q_ARG(MediaInfo, info));
+    }
+private:
+    MediaProbe* m_probe;
+    QString m_path;
+    bool m_refresh;
+};
+
+MediaProbe& MediaProbe::singleton()
+{
+    static MediaProbe* instance = new MediaProbe();
+    return *instance;
+}
+
+MediaProbe::MediaProbe(QObject* parent)
+    : QObject(parent)
+    , m_pending(0)
+    , m_memoryHits(0)
+    , m_databaseHits(0)
+    , m_misses(0)
+{
+    qRegisterMetaType<MediaInfo>("MediaInfo");
+    //打开文件主要在等磁盘，至少用两个线程
+    m_threadPool.setMaxThreadCount(qMax(2, QThread::idealThreadCount()));
+}
+
+MediaInfo MediaProbe::probe(const QString& path, bool refresh)
+{
+    QFileInfo fileInfo(path);
+    QString key = fileInfo.absoluteFilePath();
+    qint64 size = fileInfo.size();
+    QDateTime modified = fileInfo.lastModified();
+
+    //大小和修改时间都没变就直接用内存里的结果，不用计算哈希
+    if (!refresh) {
+        QMutexLocker locker(&m_mutex);
+        QHash<QString, MediaInfo>::const_iterator i = m_cache.constFind(key);
+        if (i != m_cache.constEnd() && i->size == size && i->modified == modified) {
+            m_memoryHits++;
+            return i.value();
+        }
+    }
+
+    MediaInfo info;
+    QString hash = Util::getFileHash(path);
+    QString dbKey = cacheKey(hash, modified);
+    if (refresh || hash.isEmpty() || !readCache(dbKey, info)) {
+        QElapsedTimer timer;
+        timer.start();
+        info = probeFile(path);
+        info.hash = hash;
+        if (info.valid && !hash.isEmpty())
+            writeCache(dbKey, info);
+        LOG_DEBUG() << "probed" << path << "in" << timer.elapsed() << "ms";
+        QMutexLocker locker(&m_mutex);
+        m_misses++;
+    } else {
+        QMutexLocker locker(&m_mutex);
+        m_databaseHits++;
+    }
+    //同一文件可能被移动或复制过，路径、大小、时间以当前的为准
+    info.resource = path;
+    info.size = size;
+    info.modified = modified;
+
+    QMutexLocker locker(&m_mutex);
+    if (info.valid)
+        m_cache.insert(key, info);
+    else
+        m_cache.remove(key);
+    return info;
+}
+
+void MediaProbe::probeAsync(const QStringList& paths, bool refresh)
+{
+    if (paths.isEmpty())
+        return;
+    m_pending += paths.size();
+    foreach (const QString& path, paths)
+        m_threadPool.start(new MediaProbeTask(this, path, refresh));
+}
+
+bool MediaProbe::isBusy() const
+{
+    return m_pending > 0;
+}
+
+void MediaProbe::clearMemoryCache()
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache.clear();
+    m_memoryHits = m_databaseHits = m_misses = 0;
+}
+
+void MediaProbe::onProbed(const MediaInfo& info)
+{
+    m_pending--;
+    emit probed(info);
+    if (m_pending == 0)
+        emit batchFinished();
+}
+
+MediaInfo MediaProbe::probeFile(const QString& path)
+{
+    MediaInfo info;
+    info.resource = path;
+    if (!QFileInfo(path).isFile()) {
+        info.error = QObject::tr("File not found");
+        return info;
+    }
+
+    //每次用独立的 profile，不受工程 profile影响，也可以在工作线程里使用
+    Mlt::Profile profile;
+    Mlt::Producer producer(profile, "avformat", path.toUtf8().constData());
+    if (!producer.is_valid()) {
+        info.error = QObject::tr("Unsupported or damaged file");
+        return info;
+    }
+    info.valid = true;
+    if (profile.fps() > 0.0)
+        info.duration = producer.get_length() / profile.fps();
+    info.width = producer.get_int("meta.media.width");
+    info.height = producer.get_int("meta.media.height");
+    if (producer.get_double("meta.media.frame_rate_den") > 0.0)
+        info.frameRate = producer.get_double("meta.media.frame_rate_num") / producer.get_double("meta.media.frame_rate_den");
+    if (producer.get_double("meta.media.sample_aspect_den") > 0.0)
+        info.sampleAspectRatio = producer.get_double("meta.media.sample_aspect_num") / producer.get_double("meta.media.sample_aspect_den");
+    if (producer.get("meta.media.progressive"))
+        info.progressive = producer.get_int("meta.media.progressive");
+    info.videoIndex = producer.get_int("video_index");
+    info.audioIndex = producer.get_int("audio_index");
+
+    int n = producer.get_int("meta.media.nb_streams");
+    for (int i = 0; i < n; i++) {
+        QString prefix = QString("meta.media.%1.").arg(i);
+        auto property = [&prefix](const char* name) { return (prefix + name).toLatin1(); };
+        MediaStreamInfo stream;
+        stream.index = i;
+        stream.type = QString::fromUtf8(producer.get(property("stream.type").constData()));
+        stream.codec = QString::fromUtf8(producer.get(property("codec.name").constData()));
+        stream.codecLongName = QString::fromUtf8(producer.get(property("codec.long_name").constData()));
+        stream.bitRate = producer.get_int64(property("codec.bit_rate").constData());
+        if (stream.type == "video") {
+            stream.width = producer.get_int(property("codec.width").constData());
+            stream.height = producer.get_int(property("codec.height").constData());
+            stream.frameRate = producer.get_double(property("stream.frame_rate").constData());
+            stream.pixelFormat = QString::fromUtf8(producer.get(property("codec.pix_fmt").constData()));
+        } else if (stream.type == "audio") {
+            stream.channels = producer.get_int(property("codec.channels").constData());
+            stream.sampleRate = producer.get_int(property("codec.sample_rate").constData());
+            stream.sampleFormat = QString::fromUtf8(producer.get(property("codec.sample_fmt").constData()));
+        }
+        info.streams << stream;
+    }
+
+    //容器的元数据在 meta.attr.<名字>.markup里
+    for (int i = 0; i < producer.count(); i++) {
+        QString name = QString::fromUtf8(producer.get_name(i));
+        if (name.startsWith("meta.attr.") && name.endsWith(".markup"))
+            info.tags[name.mid(10, name.length() - 17)] = QString::fromUtf8(producer.get(i));
+    }
+    return info;
+}
+
+QString MediaProbe::cacheKey(const QString& hash, const QDateTime& modified)
+{
+    return QString("%1 probe %2").arg(hash).arg(modified.toMSecsSinceEpoch());
+}
+
+//和波形、响度一样借用缩略图数据库：第一个像素是 JSON的字节数，后面是 JSON本身
+bool MediaProbe::readCache(const QString& key, MediaInfo& info)
+{
+    QImage image = DB.getThumbnail(key);
+    if (image.isNull() || image.byteCount() < 4)
+        return false;
+    quint32 length = 0;
+    memcpy(&length, image.constBits(), sizeof(length));
+    if (length == 0 || int(length) > image.byteCount() - 4)
+        return false;
+    QByteArray data(reinterpret_cast<const char*>(image.constBits()) + 4, int(length));
+    QJsonDocument document = QJsonDocument::fromJson(data);
+    if (!document.isObject())
+        return false;
+    info = MediaInfo::fromJson(document.object());
+    return info.valid;
+}
+
+void MediaProbe::writeCache(const QString& key, const MediaInfo& info)
+{
+    QByteArray data = QJsonDocument(info.toJson()).toJson(QJsonDocument::Compact);
+    quint32 length = quint32(data.size());
+    QImage image(1 + (data.size() + 3) / 4, 1, QImage::Format_ARGB32);
+    image.fill(0);
+    memcpy(image.bits(), &length, sizeof(length));
+    memcpy(image.bits() + 4, data.constData(), size_t(data.size()));
+    DB.putThumbnail(key, image);
+}
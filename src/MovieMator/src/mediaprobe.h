@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MEDIAPROBE_H
+#define MEDIAPROBE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QMap>
+#include <QHash>
+#include <QMutex>
+#include <QDateTime>
+#include <QJsonObject>
+#include <QThreadPool>
+#include <QMetaType>
+
+struct MediaStreamInfo
+{
+    int index = -1;
+    QString type;           //video、audio或其他
+    QString codec;
+    QString codecLongName;
+    qint64 bitRate = 0;
+    //视频
+    int width = 0;
+    int height = 0;
+    double frameRate = 0.0;
+    QString pixelFormat;
+    //音频
+    int channels = 0;
+    int sampleRate = 0;
+    QString sampleFormat;
+};
+
+struct MediaInfo
+{
+    QString resource;
+    QString hash;
+    qint64 size = 0;
+    QDateTime modified;
+    bool valid = false;
+    QString error;
+
+    double duration = 0.0;  //秒
+    int width = 0;
+    int height = 0;
+    double frameRate = 0.0;
+    double sampleAspectRatio = 1.0;
+    bool progressive = true;
+    int videoIndex = -1;
+    int audioIndex = -1;
+    QList<MediaStreamInfo> streams;
+    QMap<QString, QString> tags;    //容器的元数据（标题、创建时间等）
+
+    QJsonObject toJson() const;
+    static MediaInfo fromJson(const QJsonObject& json);
+    //给“更多信息”对话框用的文本，格式和以前 ffprobe -print_format ini相近
+    QString toText() const;
+};
+
+Q_DECLARE_METATYPE(MediaInfo)
+
+//进程内的素材探测服务：通过 MLT的 avformat producer读取容器和流的信息，不再为每次查询启动 ffprobe。
+//结果按路径+大小+修改时间缓存在内存里，并按文件哈希+修改时间缓存在缩略图数据库中，
+//文件没有变化时再次查询不需要打开文件。
+class MediaProbe : public QObject
+{
+    Q_OBJECT
+public:
+    static MediaProbe& singleton();
+
+    //同步探测，可以在任何线程调用；refresh为 true时忽略已有的缓存
+    MediaInfo probe(const QString& path, bool refresh = false);
+    //在线程池里并行探测一批文件，每个结果用 probed()送回调用者所在的主线程
+    void probeAsync(const QStringList& paths, bool refresh = false);
+    bool isBusy() const;
+    //只清空内存里的缓存，数据库里的不受影响
+    void clearMemoryCache();
+
+    int memoryHits() const { return m_memoryHits; }
+    int databaseHits() const { return m_databaseHits; }
+    int misses() const { return m_misses; }
+
+signals:
+    void probed(const MediaInfo& info);
+    void batchFinished();
+
+private slots:
+    void onProbed(const MediaInfo& info);
+
+private:
+    explicit MediaProbe(QObject* parent = nullptr);
+    static MediaInfo probeFile(const QString& path);
+    static QString cacheKey(const QString& hash, const QDateTime& modified);
+    static bool readCache(const QString& key, MediaInfo& info);
+    static void writeCache(const QString& key, const MediaInfo& info);
+
+    QThreadPool m_threadPool;
+    mutable QMutex m_mutex;
+    QHash<QString, MediaInfo> m_cache;  //按路径
+    int m_pending;
+    int m_memoryHits;
+    int m_databaseHits;
+    int m_misses;
+};
+
+#define PROBE MediaProbe::singleton()
+
+#endif // MEDIAPROBE_H
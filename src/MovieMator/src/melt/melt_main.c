@@ -39,7 +39,8 @@
 #include "io.h"
 #include "melt.h"
 
-static mlt_producer melt = NULL;
+// melt_main() runs concurrently on several render threads, so the melt
+// producer is local to each call rather than file-static.
 
 // 未使用的函数
 //static void stop_handler(int signum)
@@ -711,7 +712,7 @@ static void on_fatal_error( mlt_properties owner, mlt_consumer consumer )
 int melt_main( int argc, char **argv, MELT_CALLBACK callback, void *callback_obj)
 {
 	int i;
-    melt = NULL;
+    mlt_producer melt = NULL;
 	mlt_consumer consumer = NULL;
 	FILE *store = NULL;
 	char *name = NULL;
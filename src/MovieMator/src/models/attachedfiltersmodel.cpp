@@ -23,6 +23,7 @@
 #include "mltcontroller.h"
 #include "mainwindow.h"
 #include "controllers/filtercontroller.h"
+#include "models/metadatamodel.h"
 #include "qmlmetadata.h"
 #include "shotcut_mlt_properties.h"
 #include "util.h"
@@ -56,7 +57,9 @@ static bool sortIsLess (const QmlMetadata* lhs, const QmlMetadata* rhs) {
 AttachedFiltersModel::AttachedFiltersModel(QObject *parent)
     : QAbstractListModel(parent)
     , m_dropRow(-1)
+    , m_syncQueued(0)
     , m_filter(VideoFilter)
+    , m_metadataModel(nullptr)
 {
 }
 
@@ -135,10 +138,8 @@ bool AttachedFiltersModel::isProducerSelected() const
 
 int AttachedFiltersModel::rowCount(const QModelIndex &) const
 {
-    if (m_producer && m_producer->is_valid())
-        return m_metaList.count();
-    else
-        return 0;
+    // 没有producer时m_metaList为空
+    return m_metaList.count();
 }
 
 Qt::ItemFlags AttachedFiltersModel::flags(const QModelIndex &index) const
@@ -156,7 +157,7 @@ QVariant AttachedFiltersModel::data(const QModelIndex &index, int role) const
    //          || index.row() >= m_producer->filter_count());
 
     if ( !m_producer || !m_producer->is_valid()
-        || index.row() >= m_producer->filter_count())
+        || index.row() < 0 || index.row() >= m_metaList.count())
         return QVariant();
     switch (role ) {
     case Qt::DisplayRole: {
@@ -179,15 +180,8 @@ QVariant AttachedFiltersModel::data(const QModelIndex &index, int role) const
             }
             return result;
         }
-    case Qt::CheckStateRole: {
-            Mlt::Filter* filter = getFilter(index.row());
-            Q_ASSERT(filter);
-            QVariant result = Qt::Unchecked;
-            if (filter && filter->is_valid() && !filter->get_int("disable"))
-                result = Qt::Checked;
-            delete filter;
-            return result;
-        }
+    case Qt::CheckStateRole:
+        return m_enabledList[index.row()]? Qt::Checked : Qt::Unchecked;
 //        break;
     case TypeDisplayRole: {
             QVariant result;
@@ -226,6 +220,7 @@ bool AttachedFiltersModel::setData(const QModelIndex& index, const QVariant& , i
         Q_ASSERT(filter);
         if (filter && filter->is_valid()) {
             filter->set("disable", !filter->get_int("disable"));
+            m_enabledList[index.row()] = !filter->get_int("disable");
             emit changed();
             emit dataChanged(createIndex(index.row(), 0), createIndex(index.row(), 0));
         }
@@ -311,6 +306,7 @@ bool AttachedFiltersModel::moveRows(const QModelIndex & sourceParent, int source
             }
             m_mltIndexMap.insert(destinationRow, mltDstIndex);
             m_metaList.move(sourceRow, destinationRow);
+            m_enabledList.move(sourceRow, destinationRow);
             endMoveRows();
             emit changed();
             emit filterMoved(sourceRow, destinationRow);
@@ -427,6 +423,7 @@ void AttachedFiltersModel::add(QmlMetadata* meta, bool bFromUndo)
         }
         m_mltIndexMap.insert(insertIndex, mltIndex);
         m_metaList.insert(insertIndex, meta);
+        m_enabledList.insert(insertIndex, !filter->get_int("disable"));
 
         endInsertRows();
 
@@ -480,6 +477,7 @@ void AttachedFiltersModel::remove(int row, bool bFromUndo)
     QmlMetadata *metaData = (m_metaList.at(row));
     Q_ASSERT(metaData);
     m_metaList.removeAt(row);
+    m_enabledList.removeAt(row);
 
     endRemoveRows();
 
@@ -533,7 +531,7 @@ void AttachedFiltersModel::reset(Mlt::Producer* producer)
 //    Q_ASSERT(m_producer);
 //    Q_ASSERT(m_event);
 
-    beginResetModel();
+    emit producerAboutToChange();
     m_event.reset();
 
     //only load filter ui when selected the timeline item
@@ -543,26 +541,53 @@ void AttachedFiltersModel::reset(Mlt::Producer* producer)
 //        m_producer.reset(new Mlt::Producer(MLT.producer()));
     else
         m_producer.reset();
-    m_metaList.clear();
-    m_mltIndexMap.clear();
-
-//    int selectIndex = -1;
 
    //  Q_ASSERT(producer && producer->is_valid());
     if (m_producer && m_producer->is_valid()) {
         Mlt::Event* event = m_producer->listen("service-changed", this, reinterpret_cast<mlt_listener>(AttachedFiltersModel::producerChanged));
         Q_ASSERT(event);
         m_event.reset(event);
+    }
+
+    // 滤镜布局相同的clip之间切换时不会有行增删，QML中的delegate得以保留
+    syncFilters();
+
+    //如果当前的producer是模板，且其中有sizeAndProducer滤镜时，自动选中sizeAndProducer滤镜
+    if (m_producer && QString(m_producer->get("moviemator:template")) == "template") {
+        for (int i = 0; i < m_metaList.count(); i++) {
+            if (m_metaList[i] && m_metaList[i]->uniqueId() == "affineSizePosition") {
+                MAIN.onShowPropertiesVideoFilterDock();
+                MAIN.timelineDock()->selectSizeAndPositionFilter(i);
+                break;
+            }
+        }
+    }
+
+    emitFiltersLoaded();
+
+    emit trackTitleChanged();
+    emit isProducerSelectedChanged();
+    emit readyChanged();
+}
+
+bool AttachedFiltersModel::syncFilters()
+{
+    MetadataList metaList;
+    IndexMap mltIndexMap;
+    StateList enabledList;
+
+    if (m_producer && m_producer->is_valid()) {
+        Q_ASSERT(m_metadataModel);
         int count = m_producer->filter_count();
         for (int i = 0; i < count; i++) {
             Mlt::Filter* filter = m_producer->filter(i);
             Q_ASSERT(filter);
             if (filter && filter->is_valid() && !filter->get_int("_loader")) {
-                QmlMetadata* newMeta = MAIN.filterController()->metadataForService(filter);
+                QmlMetadata* newMeta = m_metadataModel->metadataForService(filter);
                 Q_ASSERT(newMeta);
-                int newIndex = m_metaList.count();
+                int newIndex = metaList.count();
                 for (int j = newIndex - 1; j >= 0; j--) {
-                    const QmlMetadata* prevMeta = m_metaList[j];
+                    const QmlMetadata* prevMeta = metaList[j];
                     Q_ASSERT(prevMeta);
                     if (sortIsLess(prevMeta, newMeta)) {
                         newIndex = j;
@@ -570,39 +595,77 @@ void AttachedFiltersModel::reset(Mlt::Producer* producer)
                         break;
                     }
                 }
-                m_metaList.insert(newIndex, newMeta);
-                m_mltIndexMap.insert(newIndex, i);
-
-                //如果当前的producer是模板，且其中有sizeAndProducer滤镜时，自动选中sizeAndProducer滤镜
-                QString templateFlag = QString(m_producer->get("moviemator:template"));
-                if (templateFlag == "template")
-                {
-                    char* filter_name = filter->get("moviemator:filter");
-                    if (QString(filter_name) == "affineSizePosition")
-                    {
-                        MAIN.onShowPropertiesVideoFilterDock();
-                        MAIN.timelineDock()->selectSizeAndPositionFilter(newIndex);
-//                        selectIndex = newIndex;
-                    }
-                }
+                metaList.insert(newIndex, newMeta);
+                mltIndexMap.insert(newIndex, i);
+                enabledList.insert(newIndex, !filter->get_int("disable"));
             }
             delete filter;
         }
     }
 
-    endResetModel();
+    // 找出前后相同的部分，只对中间不同的行发出删除、插入通知
+    int oldCount = m_metaList.count();
+    int newCount = metaList.count();
+    int prefix = 0;
+    while (prefix < oldCount && prefix < newCount && m_metaList[prefix] == metaList[prefix])
+        prefix++;
+    int suffix = 0;
+    while (suffix < oldCount - prefix && suffix < newCount - prefix
+           && m_metaList[oldCount - 1 - suffix] == metaList[newCount - 1 - suffix])
+        suffix++;
+
+    // 保留的行先更新为新的mlt索引和启用状态
+    QList<int> changedRows;
+    for (int i = 0; i < prefix + suffix; i++) {
+        int oldRow = i < prefix? i : oldCount - suffix + (i - prefix);
+        int newRow = i < prefix? i : newCount - suffix + (i - prefix);
+        m_mltIndexMap[oldRow] = mltIndexMap[newRow];
+        if (m_enabledList[oldRow] != enabledList[newRow]) {
+            m_enabledList[oldRow] = enabledList[newRow];
+            changedRows.append(newRow);
+        }
+    }
 
-    emitFiltersLoaded();
+    bool rowsChanged = false;
+    if (oldCount - prefix - suffix > 0) {
+        beginRemoveRows(QModelIndex(), prefix, oldCount - suffix - 1);
+        for (int i = prefix; i < oldCount - suffix; i++) {
+            m_metaList.removeAt(prefix);
+            m_mltIndexMap.removeAt(prefix);
+            m_enabledList.removeAt(prefix);
+        }
+        endRemoveRows();
+        rowsChanged = true;
+    }
+    if (newCount - prefix - suffix > 0) {
+        beginInsertRows(QModelIndex(), prefix, newCount - suffix - 1);
+        for (int i = prefix; i < newCount - suffix; i++) {
+            m_metaList.insert(i, metaList[i]);
+            m_mltIndexMap.insert(i, mltIndexMap[i]);
+            m_enabledList.insert(i, enabledList[i]);
+        }
+        endInsertRows();
+        rowsChanged = true;
+    }
+    foreach (int row, changedRows)
+        emit dataChanged(createIndex(row, 0), createIndex(row, 0));
 
-    emit trackTitleChanged();
-    emit isProducerSelectedChanged();
-    emit readyChanged();
+    return rowsChanged;
 }
 
 void AttachedFiltersModel::producerChanged(mlt_properties, AttachedFiltersModel* model)
 {
-    Q_UNUSED(model);
-//    model->reset(model->m_producer.data());
+    // 滤镜参数变化也会触发service-changed，可能来自其他线程，合并成一次同步
+    if (model->m_syncQueued.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(model, "onProducerChanged", Qt::QueuedConnection);
+}
+
+void AttachedFiltersModel::onProducerChanged()
+{
+    m_syncQueued.store(0);
+    // 其他地方增删了滤镜时，通知界面重新加载列表
+    if (syncFilters())
+        emitFiltersLoaded();
 }
 
 
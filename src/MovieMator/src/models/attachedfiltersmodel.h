@@ -26,8 +26,10 @@
 #include <MltFilter.h>
 #include <MltProducer.h>
 #include <MltEvent.h>
+#include <QAtomicInt>
 
 class QmlMetadata;
+class MetadataModel;
 
 //存储已添加到producer上的filter元数据类
 class AttachedFiltersModel : public QAbstractListModel
@@ -63,6 +65,11 @@ public:
 
     //目前没有实质作用，直接调用的是reset函数
     void setProducer(Mlt::Producer* producer = nullptr);
+    Mlt::Producer* producer() const { return m_producer.data(); }
+    //当前的producer发生改变时，更新attachedfiltersmodel
+    void reset(Mlt::Producer *producer = nullptr);
+    //查找滤镜元数据用的model
+    void setMetadataModel(MetadataModel* model) { m_metadataModel = model; }
     //获取当前producer的标题，
     QString producerTitle() const;
     //判断producer是否被选中
@@ -108,6 +115,8 @@ signals:
     void filterAdded(int nAttachedFilterIndex);
     void filterRemoved(int nAttachedFilterIndex);
     void filterMoved(int nAttachedFilterIndexFrom, int nAttachedFilterIndexTo);
+    //切换producer前发出此信号，切换时不再重置整个model
+    void producerAboutToChange();
 
 
 public slots:
@@ -119,11 +128,15 @@ public slots:
     //移动已添加到m_metaList中的第toRow个滤镜到fromRow位置，目前只处理qml来的手动操作即undo、redo的移除滤镜操作
     bool move(int fromRow, int toRow, bool bFromUndo = false);
 
+private slots:
+    //producer上的滤镜发生变化后（service-changed），在GUI线程中同步滤镜列表
+    void onProducerChanged();
+
 private:
-    //此函数为空函数，暂未使用—
+    //监听producer的service-changed事件，合并后转到GUI线程处理
     static void producerChanged(mlt_properties owner, AttachedFiltersModel* model);
-    //当前的producer发生改变时，重置attachedfiltersmodel
-    void reset(Mlt::Producer *producer = nullptr);
+    //按当前producer上的滤镜更新列表，只对变化的行发出插入、删除、dataChanged通知，返回是否有行增删
+    bool syncFilters();
 
     //给新添加的滤镜设置缺省参数
     void setDefaultValueForAllParemeters(Mlt::Filter* pFilter,QmlMetadata* pMetadata);
@@ -146,9 +159,17 @@ private:
     typedef QList<int> IndexMap;
     //用于存放已添加到producer中的滤镜对应在mlt中的索引
     IndexMap m_mltIndexMap;
+    //定义一个存放bool类型数据的list类型
+    typedef QList<bool> StateList;
+    //缓存每个滤镜是否启用，避免data()中每次创建Mlt::Filter
+    StateList m_enabledList;
+    //是否已有待处理的service-changed事件
+    QAtomicInt m_syncQueued;
 
     //当前filter的类型
     AttachedMetadataFilter m_filter;
+    //查找滤镜元数据用的model，由FilterController设置
+    MetadataModel* m_metadataModel;
 };
 
 #endif // ATTACHEDFILTERSMODEL_H
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "loudnessmeter.h"
+#include <QtMath>
+#include <algorithm>
+
+const double LoudnessMeter::kSilence = -70.0;
+
+static const int kMomentaryBlocks = 4;     //400ms
+static const int kShortTermBlocks = 30;    //3s
+
+LoudnessMeter::LoudnessMeter(int sampleRate, int channels)
+    : m_channels(qMax(1, channels))
+    , m_subBlockSize(qMax(1, sampleRate / 10))
+    , m_shelfState(m_channels)
+    , m_highPassState(m_channels)
+    , m_weights(m_channels, 1.0)
+    , m_subBlockEnergy(0.0)
+    , m_subBlockSamples(0)
+    , m_recent(kShortTermBlocks, 0.0)
+    , m_recentCount(0)
+    , m_momentaryMax(kSilence)
+    , m_shortTermMax(kSilence)
+    , m_peak(0.0)
+{
+    //BS.1770的两级 K加权滤波器，按采样率重新计算系数（48kHz时与标准给出的系数一致）
+    double fs = qMax(1, sampleRate);
+    double f0 = 1681.974450955533;
+    double gain = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = qTan(M_PI * f0 / fs);
+    double vh = qPow(10.0, gain / 20.0);
+    double vb = qPow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    m_shelf.b0 = (vh + vb * k / q + k * k) / a0;
+    m_shelf.b1 = 2.0 * (k * k - vh) / a0;
+    m_shelf.b2 = (vh - vb * k / q + k * k) / a0;
+    m_shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+    m_shelf.a2 = (1.0 - k / q + k * k) / a0;
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = qTan(M_PI * f0 / fs);
+    a0 = 1.0 + k / q + k * k;
+    m_highPass.b0 = 1.0;
+    m_highPass.b1 = -2.0;
+    m_highPass.b2 = 1.0;
+    m_highPass.a1 = 2.0 * (k * k - 1.0) / a0;
+    m_highPass.a2 = (1.0 - k / q + k * k) / a0;
+
+    State zero = { 0.0, 0.0, 0.0, 0.0 };
+    m_shelfState.fill(zero);
+    m_highPassState.fill(zero);
+
+    //5.1：LFE不计入，环绕声道加权 1.41
+    if (m_channels == 6) {
+        m_weights[3] = 0.0;
+        m_weights[4] = 1.41;
+        m_weights[5] = 1.41;
+    }
+}
+
+double LoudnessMeter::filter(const Biquad& f, State& s, double x)
+{
+    double y = f.b0 * x + f.b1 * s.x1 + f.b2 * s.x2 - f.a1 * s.y1 - f.a2 * s.y2;
+    s.x2 = s.x1;
+    s.x1 = x;
+    s.y2 = s.y1;
+    s.y1 = y;
+    return y;
+}
+
+double LoudnessMeter::energyToLoudness(double energy)
+{
+    if (energy <= 0.0)
+        return -HUGE_VAL;
+    return -0.691 + 10.0 * std::log10(energy);
+}
+
+void LoudnessMeter::addSamples(const float* samples, int frames)
+{
+    for (int i = 0; i < frames; i++) {
+        for (int c = 0; c < m_channels; c++) {
+            double x = samples[i * m_channels + c];
+            m_peak = qMax(m_peak, qAbs(x));
+            double y = filter(m_highPass, m_highPassState[c], filter(m_shelf, m_shelfState[c], x));
+            m_subBlockEnergy += m_weights.at(c) * y * y;
+        }
+        if (++m_subBlockSamples == m_subBlockSize)
+            endSubBlock();
+    }
+}
+
+void LoudnessMeter::endSubBlock()
+{
+    m_recent[m_recentCount % kShortTermBlocks] = m_subBlockEnergy;
+    ++m_recentCount;
+    m_subBlockEnergy = 0.0;
+    m_subBlockSamples = 0;
+
+    if (m_recentCount >= kMomentaryBlocks) {
+        double sum = 0.0;
+        for (int i = 1; i <= kMomentaryBlocks; i++)
+            sum += m_recent.at((m_recentCount - i) % kShortTermBlocks);
+        double energy = sum / (kMomentaryBlocks * m_subBlockSize);
+        m_momentary.append(energy);
+        m_momentaryMax = qMax(m_momentaryMax, energyToLoudness(energy));
+    }
+    if (m_recentCount >= kShortTermBlocks) {
+        double sum = 0.0;
+        for (int i = 0; i < kShortTermBlocks; i++)
+            sum += m_recent.at(i);
+        double energy = sum / (kShortTermBlocks * m_subBlockSize);
+        m_shortTerm.append(energy);
+        m_shortTermMax = qMax(m_shortTermMax, energyToLoudness(energy));
+    }
+}
+
+double LoudnessMeter::integrated() const
+{
+    //绝对门限
+    double sum = 0.0;
+    int count = 0;
+    foreach (double energy, m_momentary) {
+        if (energyToLoudness(energy) > kSilence) {
+            sum += energy;
+            ++count;
+        }
+    }
+    if (!count)
+        return kSilence;
+    //相对门限
+    double threshold = energyToLoudness(sum / count) - 10.0;
+    sum = 0.0;
+    count = 0;
+    foreach (double energy, m_momentary) {
+        double loudness = energyToLoudness(energy);
+        if (loudness > kSilence && loudness > threshold) {
+            sum += energy;
+            ++count;
+        }
+    }
+    return count ? energyToLoudness(sum / count) : kSilence;
+}
+
+double LoudnessMeter::momentaryMax() const
+{
+    return m_momentaryMax;
+}
+
+double LoudnessMeter::shortTermMax() const
+{
+    return m_shortTermMax;
+}
+
+double LoudnessMeter::range() const
+{
+    double sum = 0.0;
+    int count = 0;
+    foreach (double energy, m_shortTerm) {
+        if (energyToLoudness(energy) > kSilence) {
+            sum += energy;
+            ++count;
+        }
+    }
+    if (!count)
+        return 0.0;
+    double threshold = energyToLoudness(sum / count) - 20.0;
+    QVector<double> gated;
+    foreach (double energy, m_shortTerm) {
+        double loudness = energyToLoudness(energy);
+        if (loudness > kSilence && loudness > threshold)
+            gated.append(loudness);
+    }
+    if (gated.isEmpty())
+        return 0.0;
+    std::sort(gated.begin(), gated.end());
+    int last = gated.size() - 1;
+    double low = gated.at(qRound(last * 0.10));
+    double high = gated.at(qRound(last * 0.95));
+    return high - low;
+}
+
+double LoudnessMeter::samplePeak() const
+{
+    return m_peak > 0.0 ? 20.0 * std::log10(m_peak) : -HUGE_VAL;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOUDNESSMETER_H
+#define LOUDNESSMETER_H
+
+#include <QVector>
+
+//按 ITU-R BS.1770 / EBU R128测量响度：K加权、400ms瞬时块、3s短期块，
+//综合响度使用 -70 LUFS绝对门限和 -10 LU相对门限，响度范围（LRA）按 EBU Tech 3342计算。
+//不依赖 MLT的 loudness_meter滤镜，结果只由输入的采样决定。
+class LoudnessMeter
+{
+public:
+    //没有可测的音频时返回的响度
+    static const double kSilence;
+
+    LoudnessMeter(int sampleRate, int channels);
+
+    //交错排列的浮点采样，frames为每声道的采样数
+    void addSamples(const float* samples, int frames);
+
+    double integrated() const;      //LUFS
+    double momentaryMax() const;    //LUFS
+    double shortTermMax() const;    //LUFS
+    double range() const;           //LU
+    double samplePeak() const;      //dBFS
+
+private:
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+    };
+    struct State {
+        double x1, x2, y1, y2;
+    };
+
+    static double filter(const Biquad& f, State& s, double x);
+    static double energyToLoudness(double energy);
+    void endSubBlock();
+
+    int m_channels;
+    int m_subBlockSize;             //100ms的采样数
+    Biquad m_shelf;
+    Biquad m_highPass;
+    QVector<State> m_shelfState;
+    QVector<State> m_highPassState;
+    QVector<double> m_weights;
+
+    double m_subBlockEnergy;
+    int m_subBlockSamples;
+    QVector<double> m_recent;       //最近 30个 100ms子块的能量
+    int m_recentCount;
+    QVector<double> m_momentary;    //每 100ms一个 400ms块的能量
+    QVector<double> m_shortTerm;    //每 100ms一个 3s块的能量
+    double m_momentaryMax;
+    double m_shortTermMax;
+    double m_peak;
+};
+
+#endif // LOUDNESSMETER_H
@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "loudnesstask.h"
+#include "loudnessmeter.h"
+#include "database.h"
+#include "mltcontroller.h"
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMetaObject>
+#include <QScopedPointer>
+#include <QThread>
+#include <Logger.h>
+#include <Mlt.h>
+
+class LoudnessTask : public QRunnable
+{
+public:
+    LoudnessTask(LoudnessAnalysis* analysis, int index, const LoudnessResult& clip)
+        : QRunnable()
+        , m_analysis(analysis)
+        , m_index(index)
+        , m_clip(clip)
+    {}
+
+protected:
+    void run()
+    {
+        int fpsNum = m_analysis->m_fpsNum;
+        int fpsDen = m_analysis->m_fpsDen;
+        if (!LoudnessAnalysis::readCache(m_clip, fpsNum, fpsDen)
+                && LoudnessAnalysis::measure(m_clip, fpsNum, fpsDen, m_analysis->m_canceled))
+            LoudnessAnalysis::writeCache(m_clip, fpsNum, fpsDen);
+        m_analysis->setResult(m_index, m_clip);
+        QMetaObject::invokeMethod(m_analysis, "onTaskFinished", Qt::QueuedConnection);
+    }
+
+private:
+    LoudnessAnalysis* m_analysis;
+    int m_index;
+    LoudnessResult m_clip;
+};
+
+LoudnessAnalysis::LoudnessAnalysis(QObject *parent)
+    : QObject(parent)
+    , m_pending(0)
+    , m_fpsNum(25)
+    , m_fpsDen(1)
+{
+    qRegisterMetaType< QList<LoudnessResult> >("QList<LoudnessResult>");
+    // 解码和测量都是 CPU密集的，每个核心一个片段
+    m_threadPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+}
+
+LoudnessAnalysis::~LoudnessAnalysis()
+{
+    cancel();
+    m_threadPool.waitForDone();
+}
+
+bool LoudnessAnalysis::start(const QList<LoudnessResult>& clips)
+{
+    if (isRunning() || clips.isEmpty())
+        return false;
+    m_canceled.store(0);
+    m_fpsNum = MLT.profile().frame_rate_num();
+    m_fpsDen = MLT.profile().frame_rate_den();
+    m_results = clips;
+    m_pending = clips.size();
+    for (int i = 0; i < clips.size(); i++)
+        m_threadPool.start(new LoudnessTask(this, i, clips.at(i)));
+    return true;
+}
+
+void LoudnessAnalysis::cancel()
+{
+    m_canceled.store(1);
+}
+
+void LoudnessAnalysis::setResult(int index, const LoudnessResult& result)
+{
+    QMutexLocker locker(&m_mutex);
+    m_results[index] = result;
+}
+
+void LoudnessAnalysis::onTaskFinished()
+{
+    --m_pending;
+    emit progress(m_results.size() - m_pending, m_results.size());
+    if (m_pending == 0 && !m_canceled.load()) {
+        QMutexLocker locker(&m_mutex);
+        QList<LoudnessResult> results = m_results;
+        locker.unlock();
+        emit finished(results);
+    }
+}
+
+QString LoudnessAnalysis::cacheKey(const LoudnessResult& clip, int fpsNum, int fpsDen)
+{
+    QString key = QString("%1 loudness %2 %3 %4/%5 %6 %7");
+    if (!clip.hash.isEmpty()) {
+        key = key.arg(clip.hash);
+    } else {
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(clip.resource.toUtf8());
+        key = key.arg(QString(hash.result().toHex()));
+    }
+    //音量滤镜的设置也影响测量结果，把它们的属性一起算进 key
+    QCryptographicHash filters(QCryptographicHash::Sha1);
+    foreach (const LoudnessFilter& filter, clip.filters) {
+        QMapIterator<QString, QString> i(filter);
+        while (i.hasNext()) {
+            i.next();
+            filters.addData(i.key().toUtf8());
+            filters.addData("=", 1);
+            filters.addData(i.value().toUtf8());
+            filters.addData("\n", 1);
+        }
+        filters.addData("\n", 1);
+    }
+    // in/out是工程帧，帧率不同时区间也不同
+    return key.arg(clip.in).arg(clip.out).arg(fpsNum).arg(fpsDen)
+              .arg(clip.audioIndex.isEmpty() ? QString("default") : clip.audioIndex)
+              .arg(clip.filters.isEmpty() ? QString("unfiltered") : QString(filters.result().toHex()));
+}
+
+bool LoudnessAnalysis::readCache(LoudnessResult& clip, int fpsNum, int fpsDen)
+{
+    QJsonObject values = QJsonDocument::fromJson(DB.getValue(cacheKey(clip, fpsNum, fpsDen))).object();
+    if (!values.contains("integrated"))
+        return false;
+    clip.integrated = values.value("integrated").toDouble();
+    clip.momentaryMax = values.value("momentaryMax").toDouble();
+    clip.shortTermMax = values.value("shortTermMax").toDouble();
+    clip.range = values.value("range").toDouble();
+    clip.peak = values.value("peak").toDouble();
+    clip.valid = true;
+    return true;
+}
+
+void LoudnessAnalysis::writeCache(const LoudnessResult& clip, int fpsNum, int fpsDen)
+{
+    QJsonObject values;
+    values["integrated"] = clip.integrated;
+    values["momentaryMax"] = clip.momentaryMax;
+    values["shortTermMax"] = clip.shortTermMax;
+    values["range"] = clip.range;
+    values["peak"] = clip.peak;
+    DB.putValue(cacheKey(clip, fpsNum, fpsDen), QJsonDocument(values).toJson(QJsonDocument::Compact));
+}
+
+bool LoudnessAnalysis::measure(LoudnessResult& clip, int fpsNum, int fpsDen, const QAtomicInt& canceled)
+{
+    QElapsedTimer timer;
+    timer.start();
+    QString service = clip.service;
+    if (service == "avformat-novalidate")
+        service = "avformat";
+    else if (service.startsWith("xml"))
+        service = "xml-nogl";
+    Mlt::Profile profile;
+    profile.set_frame_rate(fpsNum, fpsDen);
+    Mlt::Producer source(profile, service.toUtf8().constData(), clip.resource.toUtf8().constData());
+    if (!source.is_valid())
+        return false;
+    if (!clip.audioIndex.isEmpty())
+        source.set("audio_index", clip.audioIndex.toUtf8().constData());
+    int out = clip.out >= 0 ? clip.out : source.get_length() - 1;
+    //和时间线一样在 cut上挂剪辑的音量滤镜，滤镜的 in/out和关键帧按同样的位置计算
+    QScopedPointer<Mlt::Producer> producer(source.cut(clip.in, out));
+    if (!producer || !producer->is_valid())
+        return false;
+    foreach (const LoudnessFilter& properties, clip.filters) {
+        Mlt::Filter filter(profile, properties.value("mlt_service").toUtf8().constData());
+        if (!filter.is_valid())
+            return false;
+        QMapIterator<QString, QString> i(properties);
+        while (i.hasNext()) {
+            i.next();
+            if (i.key() != "mlt_service" && i.key() != "mlt_type")
+                filter.set(i.key().toUtf8().constData(), i.value().toUtf8().constData());
+        }
+        producer->attach(filter);
+    }
+    Mlt::Filter channels(profile, "audiochannels");
+    Mlt::Filter converter(profile, "audioconvert");
+    producer->attach(channels);
+    producer->attach(converter);
+    producer->seek(0);
+
+    double fps = double(fpsNum) / qMax(1, fpsDen);
+    QScopedPointer<LoudnessMeter> meter;
+    int n = producer->get_playtime();
+    for (int i = 0; i < n && !canceled.load(); i++) {
+        QScopedPointer<Mlt::Frame> frame(producer->get_frame());
+        if (!frame || !frame->is_valid() || frame->get_int("test_audio"))
+            continue;
+        mlt_audio_format format = mlt_audio_f32le;
+        int frequency = 48000;
+        int channelCount = 2;
+        int samples = mlt_sample_calculator(float(fps), frequency, clip.in + i);
+        const float* data = static_cast<const float*>(frame->get_audio(format, frequency, channelCount, samples));
+        if (!data || format != mlt_audio_f32le || samples <= 0)
+            continue;
+        if (!meter)
+            meter.reset(new LoudnessMeter(frequency, channelCount));
+        meter->addSamples(data, samples);
+    }
+    if (canceled.load() || !meter)
+        return false;
+
+    clip.integrated = meter->integrated();
+    clip.momentaryMax = meter->momentaryMax();
+    clip.shortTermMax = meter->shortTermMax();
+    clip.range = meter->range();
+    clip.peak = meter->samplePeak();
+    clip.valid = true;
+    LOG_DEBUG() << "loudness" << clip.resource << clip.in << out << "integrated" << clip.integrated
+                << "LRA" << clip.range << "in" << timer.elapsed() << "ms";
+    return true;
+}
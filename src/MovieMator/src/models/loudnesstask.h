@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOUDNESSTASK_H
+#define LOUDNESSTASK_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QList>
+#include <QMap>
+#include <QString>
+
+//剪辑上一个滤镜的全部属性，测量时在工作线程里按这些属性重新创建
+typedef QMap<QString, QString> LoudnessFilter;
+
+//一个片段（资源的 in~out区间）的响度测量结果
+struct LoudnessResult {
+    LoudnessResult()
+        : trackIndex(-1), clipIndex(-1), in(0), out(-1), valid(false)
+        , integrated(0.0), momentaryMax(0.0), shortTermMax(0.0), range(0.0), peak(0.0)
+    {}
+    int trackIndex;
+    int clipIndex;
+    QString service;
+    QString resource;
+    QString hash;
+    QString audioIndex;     //素材的 audio_index，空表示由 producer自己选择音轨
+    QList<LoudnessFilter> filters;  //剪辑上已有的音量滤镜，不含响度标准化自己的那个
+    int in;
+    int out;
+    bool valid;
+    double integrated;      //LUFS
+    double momentaryMax;    //LUFS
+    double shortTermMax;    //LUFS
+    double range;           //LU
+    double peak;            //dBFS
+};
+
+//并行解码多个片段并测量 EBU R128响度，结果按素材、区间和音量滤镜缓存在数据库的 cache表中
+class LoudnessAnalysis : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LoudnessAnalysis(QObject *parent = nullptr);
+    ~LoudnessAnalysis();
+
+    //clips中填好 trackIndex、clipIndex、service、resource、hash、audioIndex、filters、in、out
+    bool start(const QList<LoudnessResult>& clips);
+    bool isRunning() const { return m_pending > 0; }
+
+    //在工作线程里测量一个片段，in/out按工程帧率 fpsNum/fpsDen计算，返回是否测量成功
+    static bool measure(LoudnessResult& clip, int fpsNum, int fpsDen, const QAtomicInt& canceled);
+
+public slots:
+    void cancel();
+
+signals:
+    void progress(int done, int total);
+    void finished(const QList<LoudnessResult>& results);
+
+private slots:
+    void onTaskFinished();
+
+private:
+    friend class LoudnessTask;
+    //帧率在 GUI线程的 start()里取好再传进来，工作线程不访问 MLT.profile()
+    static QString cacheKey(const LoudnessResult& clip, int fpsNum, int fpsDen);
+    static bool readCache(LoudnessResult& clip, int fpsNum, int fpsDen);
+    static void writeCache(const LoudnessResult& clip, int fpsNum, int fpsDen);
+    void setResult(int index, const LoudnessResult& result);
+
+    QThreadPool m_threadPool;
+    QMutex m_mutex;
+    QList<LoudnessResult> m_results;
+    int m_pending;
+    QAtomicInt m_canceled;
+    int m_fpsNum;
+    int m_fpsDen;
+};
+
+#endif // LOUDNESSTASK_H
@@ -23,12 +23,15 @@
 #include "metadatamodel.h"
 #include "qmlmetadata.h"
 #include "settings.h"
+#include "shotcut_mlt_properties.h"
 #include <Logger.h>
+#include <Mlt.h>
 
 MetadataModel::MetadataModel(QObject *parent)
     : QAbstractListModel(parent)
     , m_metadataFilterType(FavoritesFilter)
     , m_isClipProducer(true)
+    , m_indexEnabled(true)
 {
 }
 
@@ -160,6 +163,9 @@ void MetadataModel::add(QmlMetadata* data)
     beginInsertRows(QModelIndex(), i, i);
     m_list.insert(i, data);
     endInsertRows();
+    //uniqueId重复时保留先加载的
+    if (!m_index.contains(data->uniqueId()))
+        m_index.insert(data->uniqueId(), data);
 
     data->setParent(this);
 }
@@ -172,6 +178,32 @@ QmlMetadata* MetadataModel::get(int index) const
     return nullptr;
 }
 
+QmlMetadata* MetadataModel::metadataForUniqueId(const QString& uniqueId) const
+{
+    if (m_indexEnabled)
+        return m_index.value(uniqueId, nullptr);
+
+    foreach (QmlMetadata* meta, m_list) {
+        if (meta->uniqueId() == uniqueId)
+            return meta;
+    }
+    return nullptr;
+}
+
+QmlMetadata* MetadataModel::metadataForService(Mlt::Service* service) const
+{
+    Q_ASSERT(service);
+
+    QString uniqueId = service->get(kShotcutFilterProperty);
+
+    // Fallback to mlt_service for legacy filters
+    if (uniqueId.isEmpty()) {
+        uniqueId = service->get("mlt_service");
+    }
+
+    return metadataForUniqueId(uniqueId);
+}
+
 void MetadataModel::setMetadataFilterType(MetadataFilterType type)
 {
     beginResetModel();
@@ -25,8 +25,12 @@
 
 #include <QAbstractListModel>
 #include <QList>
+#include <QHash>
 
 class QmlMetadata;
+namespace Mlt {
+    class Service;
+}
 
 //存放已加载到moviemator中的所有滤镜的元数据类
 class MetadataModel : public QAbstractListModel
@@ -75,6 +79,12 @@ public:
     void add(QmlMetadata* data);
     //获取model中的第index个滤镜的元数据
     Q_INVOKABLE QmlMetadata* get(int index) const;
+    //通过uniqueId获取滤镜的元数据
+    QmlMetadata* metadataForUniqueId(const QString& uniqueId) const;
+    //获取滤镜对应的元数据，旧工程的滤镜没有moviemator:filter属性，按mlt_service查找
+    QmlMetadata* metadataForService(Mlt::Service* service) const;
+    //关闭索引后按行逐个比较uniqueId，只用于基准测试对比
+    void setIndexEnabled(bool enabled) { m_indexEnabled = enabled; }
     //获取当前filter的类型（音频、视频、喜爱的滤镜）
     MetadataFilterType metadataFilterType() const { return m_metadataFilterType; }
     //设置当前filter的类型
@@ -92,6 +102,9 @@ private:
     typedef QList<QmlMetadata*> MetadataList;
     //存放已加载到moviemator中的所有滤镜的元数据
     MetadataList m_list;
+    //uniqueId到元数据的索引，随add更新
+    QHash<QString, QmlMetadata*> m_index;
+    bool m_indexEnabled;
     //当前滤镜的类型
     //命名修改——m_metadataType
     MetadataFilterType m_metadataFilterType;
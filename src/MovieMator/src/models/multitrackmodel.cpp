@@ -27,14 +27,15 @@
 #include "util.h"
 #include "audiolevelstask.h"
 #include "shotcut_mlt_properties.h"
+#include "proxymanager.h"
 #include <QScopedPointer>
 #include <QApplication>
 #include <qmath.h>
 #include <QTimer>
 
 #include <Logger.h>
-#include <QMessageBox>
 #include <QtDebug>
+#include <algorithm>
 #include "../maincontroller.h"
 
 #include "../controllers/filtercontroller.h"
@@ -88,9 +89,21 @@ MultitrackModel::MultitrackModel(QObject *parent)
     , m_isMakingTransition(false)
     , m_copiedProducer(nullptr)
     , m_selectedProducer(nullptr)
+    , m_batchDepth(0)
+    , m_batchModified(false)
+    , m_batchRefresh(false)
+    , m_batchRefreshIn(0)
+    , m_batchRefreshOut(-1)
 {
 //    connect(this, SIGNAL(modified()), SLOT(adjustBackgroundDuration()));//sll:将modify放在mainwindow中建立连接，防止界面更新与数据操作顺序问题
     connect(this, SIGNAL(reloadRequested()), SLOT(reload()), Qt::QueuedConnection);
+    // 片段缓存跟随模型自己发出的变更通知更新；要先于视图连接，视图刷新时缓存已是最新
+    connect(this, SIGNAL(rowsInserted(QModelIndex,int,int)), SLOT(onRowsInserted(QModelIndex,int,int)));
+    connect(this, SIGNAL(rowsRemoved(QModelIndex,int,int)), SLOT(onRowsRemoved(QModelIndex,int,int)));
+    connect(this, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)), SLOT(onDataChanged(QModelIndex,QModelIndex,QVector<int>)));
+    connect(this, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)), SLOT(onLayoutReset()));
+    connect(this, SIGNAL(layoutChanged()), SLOT(onLayoutReset()));
+    connect(this, SIGNAL(modelReset()), SLOT(onLayoutReset()));
 
     m_selection.nIndexOfSelectedClip = -1;
     m_selection.nIndexOfSelectedTrack = -1;
@@ -141,123 +154,84 @@ QVariant MultitrackModel::data(const QModelIndex &index, int role) const
         return QVariant();
     if (index.parent().isValid()) {
         // Get data for a clip.
-        int count = m_trackList.count();
-        Q_ASSERT(int(index.internalId()) < count);
-
-        int i = m_trackList.at(int(index.internalId())).mlt_index;
-        QScopedPointer<Mlt::Producer> track(m_tractor->track(i));
-        Q_ASSERT(track);
-        if (track) {
-            Mlt::Playlist playlist(*track);
-            Q_ASSERT(playlist.is_valid());
-            QScopedPointer<Mlt::ClipInfo> info(playlist.clip_info(index.row()));
-            Q_ASSERT(info);
-            if (info)
+        int trackIndex = int(index.internalId());
+        Q_ASSERT(trackIndex < m_trackList.count());
+        if (trackIndex >= m_trackList.count())
+            return QVariant();
+
+        switch (role) {
+        case IsAudioRole:
+            return m_trackList[trackIndex].type == AudioTrackType;
+        case IsVideoRole:
+            return m_trackList[trackIndex].type == VideoTrackType;
+        case IsFilterRole:
+            return m_trackList[trackIndex].type == FilterTrackType;
+        case IsTextRole:
+            return m_trackList[trackIndex].type == TextTrackType;
+        case TrackTypeRole:
+            return m_trackList[trackIndex].type;
+        case IsDefaultTrackRole:
+            return m_trackList[trackIndex].number == 0;
+        case AudioLevelsRole:
+        case FileHashRole: {
+            // 这两项直接读 producer 上的数据，不放进缓存
+            QScopedPointer<Mlt::Playlist> playlist(trackPlaylist(trackIndex));
+            if (!playlist)
+                break;
+            QScopedPointer<Mlt::ClipInfo> info(playlist->clip_info(index.row()));
+            if (!info || !info->producer)
+                break;
+            if (role == FileHashRole)
+                return MLT.getHash(*info->producer);
+            if (info->producer->get_data(kAudioLevelsProperty))
+                return QVariant::fromValue(*(static_cast<QVariantList*>(info->producer->get_data(kAudioLevelsProperty))));
+            break;
+        }
+        default: {
+            const ClipRecord* record = clipRecord(trackIndex, index.row());
+            if (!record)
+                break;
             switch (role) {
-            case NameRole: {
-                QString result;
-                if (info->producer && info->producer->is_valid())
-                    result = info->producer->get(kShotcutCaptionProperty);
-                if (result.isNull())
-                    result = Util::baseName(QString::fromUtf8(info->resource));
-                if (result == "<producer>" && info->producer && info->producer->is_valid())
-                    result = QString::fromUtf8(info->producer->get("mlt_service"));
-                if (result == "<tractor>") {
-                    result = QString::fromUtf8(info->producer->get("moviemator:imageName"));
-                    result += "-" + QString::fromUtf8(info->producer->get("moviemator:animationName"));
-                }
-
-                //获取clip在时间线上显示的名字
-                QString strClipCaption;
-                if (info->producer && info->producer->is_valid())
-                    strClipCaption = getClipCaption(*(info->producer));
-
-                if (!strClipCaption.isEmpty())
-                    result = strClipCaption;
-
-                return result;
-            }
+            case NameRole:
+                return record->name;
             case ResourceRole:
-            case Qt::DisplayRole: {
-                QString result = QString::fromUtf8(info->resource);
-                if (result == "<producer>" && info->producer
-                        && info->producer->is_valid() && info->producer->get("mlt_service"))
-                    result = QString::fromUtf8(info->producer->get("mlt_service"));
-                return result;
-            }
+            case Qt::DisplayRole:
+                return record->resource;
             case ServiceRole:
-                if (info->producer && info->producer->is_valid())
-                    return QString::fromUtf8(info->producer->get("mlt_service"));
+                if (!record->service.isNull())
+                    return record->service;
                 break;
             case IsBlankRole:
-                return playlist.is_blank(index.row());
+                return record->isBlank;
             case StartRole:
-                return info->start;
+                return record->start;
             case DurationRole:
-                return info->frame_count;
+                return record->duration;
             case InPointRole:
-                return info->frame_in;
+                return record->in;
             case OutPointRole:
-                return info->frame_out;
+                return record->out;
             case FramerateRole:
-                return info->fps;
-            case IsAudioRole:
-                return m_trackList[int(index.internalId())].type == AudioTrackType;
-            case IsVideoRole:
-                return m_trackList[int(index.internalId())].type == VideoTrackType;
-            case IsFilterRole:
-                return m_trackList[int(index.internalId())].type == FilterTrackType;
-            case IsTextRole:
-                return m_trackList[int(index.internalId())].type == TextTrackType;
-            case TrackTypeRole:
-                return m_trackList[int(index.internalId())].type;
-            case IsDefaultTrackRole:
-                return m_trackList[int(index.internalId())].number == 0;
-            case AudioLevelsRole:
-                if (info->producer->get_data(kAudioLevelsProperty))
-                    return QVariant::fromValue(*(static_cast<QVariantList*>(info->producer->get_data(kAudioLevelsProperty))));
-                else
-                    return QVariant();
-            case FadeInRole: {
-                QScopedPointer<Mlt::Filter> filter(getFilter("fadeInVolume", info->producer));
-                if (!filter || !filter->is_valid())
-                    filter.reset(getFilter("fadeInBrightness", info->producer));
-                if (!filter || !filter->is_valid())
-                    filter.reset(getFilter("fadeInMovit", info->producer));
-                return (filter && filter->is_valid())? filter->get_length() : 0;
-            }
-            case FadeOutRole: {
-                QScopedPointer<Mlt::Filter> filter(getFilter("fadeOutVolume", info->producer));
-                if (!filter || !filter->is_valid())
-                    filter.reset(getFilter("fadeOutBrightness", info->producer));
-                if (!filter || !filter->is_valid())
-                    filter.reset(getFilter("fadeOutMovit", info->producer));
-                return (filter && filter->is_valid())? filter->get_length() : 0;
-            }
+                return record->fps;
+            case FadeInRole:
+                return record->fadeIn;
+            case FadeOutRole:
+                return record->fadeOut;
             case IsTransitionRole:
-                return isTransition(playlist, index.row());
-            case FileHashRole:
-                return MLT.getHash(*info->producer);
-            case SpeedRole: {
-                double speed = 1.0;
-                if (info->producer && info->producer->is_valid()) {
-                    if (!qstrcmp("timewarp", info->producer->get("mlt_service")))
-                        speed = info->producer->get_double("warp_speed");
-                }
-                return speed;
-            }
+                return record->isTransition;
+            case SpeedRole:
+                return record->speed;
             case ThumbnailRole:
-                return QString("..") + QString(info->producer->get("thumbnail"));
+                return record->thumbnail;
             case HasFilterRole:
-                return hasFilterApplied(info->producer);
+                return record->hasFilter;
             case IsAnimStickerRole:
-            {
-                QString resource = QString::fromUtf8(info->resource);
-                return resource == "<tractor>";
-            }
+                return record->isAnimSticker;
             default:
                 break;
             }
+            break;
+        }
         }
     }
     else {
@@ -398,7 +372,7 @@ void MultitrackModel::setTrackName(int row, const QString &value)
             QVector<int> roles;
             roles << NameRole;
             emit dataChanged(modelIndex, modelIndex, roles);
-            emit modified();
+            notifyModified();
         }
     }
 }
@@ -425,7 +399,7 @@ void MultitrackModel::setTrackMute(int row, bool mute)
             QVector<int> roles;
             roles << IsMuteRole;
             emit dataChanged(modelIndex, modelIndex, roles);
-            emit modified();
+            notifyModified();
         }
     }
 }
@@ -448,13 +422,13 @@ void MultitrackModel::setTrackHidden(int row, bool hidden)
             else
                 hide ^= 1;
             track->set("hide", hide);
-            MLT.refreshConsumer();
+            refreshConsumer();
 
             QModelIndex modelIndex = index(row, 0);
             QVector<int> roles;
             roles << IsHiddenRole;
             emit dataChanged(modelIndex, modelIndex, roles);
-            emit modified();
+            notifyModified();
         }
     }
 }
@@ -477,13 +451,13 @@ void MultitrackModel::setTrackComposite(int row, Qt::CheckState composite)
             if (transition)
                 transition->set("disable", (composite == Qt::Unchecked));
         }
-        MLT.refreshConsumer();
+        refreshConsumer();
 
         QModelIndex modelIndex = index(row, 0);
         QVector<int> roles;
         roles << IsCompositeRole;
         emit dataChanged(modelIndex, modelIndex, roles);
-        emit modified();
+        notifyModified();
     }
 }
 
@@ -507,7 +481,7 @@ void MultitrackModel::setTrackLock(int row, bool lock)
         QVector<int> roles;
         roles << IsLockedRole;
         emit dataChanged(modelIndex, modelIndex, roles);
-        emit modified();
+        notifyModified();
     }
 }
 
@@ -640,7 +614,7 @@ int MultitrackModel::trimClipIn(int trackIndex, int clipIndex, int delta, bool r
                 ++result;
             }
         }
-        emit modified();
+        notifyModified();
     }
     foreach (int idx, tracksToRemoveRegionFrom) {
         Q_ASSERT(whereToRemoveRegion != -1);
@@ -661,7 +635,7 @@ void MultitrackModel::notifyClipIn(int trackIndex, int clipIndex)
         Q_UNUSED(index);
         QVector<int> roles;
         roles << AudioLevelsRole;
-        MLT.refreshConsumer();
+        refreshRange(editStart(trackIndex, clipIndex), -1);
     }
     m_isMakingTransition = false;
 }
@@ -823,7 +797,7 @@ int MultitrackModel::trimClipOut(int trackIndex, int clipIndex, int delta, bool
         roles << DurationRole;
         roles << OutPointRole;
         emit dataChanged(index, index, roles);
-        emit modified();
+        notifyModified();
     }
     foreach (int idx, tracksToRemoveRegionFrom) {
         Q_ASSERT(whereToRemoveRegion != -1);
@@ -843,7 +817,7 @@ void MultitrackModel::notifyClipOut(int trackIndex, int clipIndex)
         Q_UNUSED(index);
         QVector<int> roles;
         roles << AudioLevelsRole;
-        MLT.refreshConsumer();
+        refreshRange(editStart(trackIndex, clipIndex), -1);
     }
     m_isMakingTransition = false;
 }
@@ -934,6 +908,8 @@ bool MultitrackModel::moveClip(int fromTrack, int toTrack, int clipIndex, int po
 
     LOG_DEBUG() << __FUNCTION__ << clipIndex << "fromTrack" << fromTrack << "toTrack" << toTrack;
     bool result = false;
+    // 移动前的位置之后的内容都可能变化
+    int fromStart = (clipIndex < clipCount(fromTrack))? getStartPositionOfClip(fromTrack, clipIndex) : position;
 
     int i = m_trackList.at(toTrack).mlt_index;
     QScopedPointer<Mlt::Producer> track(m_tractor->track(i));
@@ -994,8 +970,8 @@ bool MultitrackModel::moveClip(int fromTrack, int toTrack, int clipIndex, int po
     }
     if (result) {
         setSelection(toTrack, getClipOfPosition(toTrack, position));
-        emit modified();
-        MLT.refreshConsumer();
+        notifyModified();
+        refreshRange(qMin(fromStart, position), -1);
     }
     return result;
 }
@@ -1098,7 +1074,7 @@ int MultitrackModel::overwriteClip(int trackIndex, Mlt::Producer& clip, int posi
         if (result >= 0) {
             QModelIndex index = createIndex(result, 0, quintptr(trackIndex));
             AudioLevelsTask::start(clip.parent(), this, index);
-            emit modified();
+            notifyModified();
             if (seek)
             {
                 emit seeked(playlist.clip_start(result) /*+ playlist.clip_length(result)*/);
@@ -1206,7 +1182,7 @@ QString MultitrackModel::overwrite(int trackIndex, Mlt::Producer& clip, int posi
 
         QModelIndex index = createIndex(targetIndex, 0, quintptr(trackIndex));
         AudioLevelsTask::start(clip.parent(), this, index);
-        emit modified();
+        notifyModified();
         if (seek)
             emit seeked(playlist.clip_start(targetIndex));
     }
@@ -1309,7 +1285,7 @@ void MultitrackModel::updateTransition(int trackIndex, int clipIndex) {
             roles << OutPointRole;
             emit dataChanged(modelIndex, modelIndex, roles);
             AudioLevelsTask::start(clip->parent(), this, modelIndex);
-            emit modified();
+            notifyModified();
         }
     }
 }
@@ -1410,7 +1386,7 @@ int MultitrackModel::insertClip(int trackIndex, Mlt::Producer &clip, int positio
 
             QModelIndex index = createIndex(result, 0, quintptr(trackIndex));
             AudioLevelsTask::start(clip.parent(), this, index);
-            emit modified();
+            notifyModified();
             emit seeked(playlist.clip_start(result));
         }
 
@@ -1454,7 +1430,7 @@ int MultitrackModel::appendClip(int trackIndex, Mlt::Producer &clip)
 
         setSelection(trackIndex, i);
 
-        emit modified();
+        notifyModified();
         emit seeked(playlist.clip_start(i));
         return i;
     }
@@ -1515,7 +1491,7 @@ void MultitrackModel::removeClip(int trackIndex, int clipIndex)
                     removeRegion(j, clipStart, clipPlaytime);
                 }
             }
-            emit modified();
+            notifyModified();
 
             // 删除后不选中任何 clip
             setSelection(trackIndex, -1);
@@ -1556,7 +1532,7 @@ void MultitrackModel::liftClip(int trackIndex, int clipIndex)
 
             consolidateBlanks(playlist, trackIndex);
 
-            emit modified();
+            notifyModified();
 
             // 删除后不选中任何 clip
             setSelection(trackIndex, -1);
@@ -1564,6 +1540,29 @@ void MultitrackModel::liftClip(int trackIndex, int clipIndex)
     }
 }
 
+void MultitrackModel::removeClips(int trackIndex, const QList<int>& clipIndexes)
+{
+    // 从后往前删，前面 clip 的下标不受影响
+    QList<int> indexes = clipIndexes;
+    std::sort(indexes.begin(), indexes.end());
+    indexes.erase(std::unique(indexes.begin(), indexes.end()), indexes.end());
+    beginBatch();
+    for (int i = indexes.count() - 1; i >= 0; --i)
+        removeClip(trackIndex, indexes.at(i));
+    endBatch();
+}
+
+void MultitrackModel::liftClips(int trackIndex, const QList<int>& clipIndexes)
+{
+    QList<int> indexes = clipIndexes;
+    std::sort(indexes.begin(), indexes.end());
+    indexes.erase(std::unique(indexes.begin(), indexes.end()), indexes.end());
+    beginBatch();
+    for (int i = indexes.count() - 1; i >= 0; --i)
+        liftClip(trackIndex, indexes.at(i));
+    endBatch();
+}
+
 void MultitrackModel::splitClip(int trackIndex, int clipIndex, int position)
 {
     Q_ASSERT(trackIndex >= 0);
@@ -1609,7 +1608,7 @@ void MultitrackModel::splitClip(int trackIndex, int clipIndex, int position)
             modelIndex = createIndex(clipIndex + 1, 0, quintptr(trackIndex));
             AudioLevelsTask::start(producer.parent(), this, modelIndex);
         }
-        emit modified();
+        notifyModified();
     }
 }
 
@@ -1666,7 +1665,7 @@ void MultitrackModel::joinClips(int trackIndex, int clipIndex)
         playlist.remove(clipIndex + 1);
         endRemoveRows();
 
-        emit modified();
+        notifyModified();
     }
 }
 
@@ -1705,7 +1704,7 @@ void MultitrackModel::appendFromPlaylist(Mlt::Playlist *from, int trackIndex)
             }
         }
         endInsertRows();
-        emit modified();
+        notifyModified();
         emit seeked(nPlaylistTime);
     }
 }
@@ -1758,7 +1757,7 @@ void MultitrackModel::overwriteFromPlaylist(Mlt::Playlist& from, int trackIndex,
             endInsertRows();
         }
         consolidateBlanks(playlist, trackIndex);
-        emit modified();
+        notifyModified();
         emit seeked(position);
     }
 
@@ -1862,9 +1861,50 @@ void MultitrackModel::fadeIn(int trackIndex, int clipIndex, int duration)
             QVector<int> roles;
             roles << FadeInRole;
             emit dataChanged(modelIndex, modelIndex, roles);
-            emit modified();
+            notifyModified();
+        }
+    }
+}
+
+void MultitrackModel::setLoudnessGain(int trackIndex, int clipIndex, double gainDb, double targetLufs)
+{
+    Q_ASSERT(trackIndex >= 0);
+    Q_ASSERT(trackIndex < m_trackList.size());
+    Q_ASSERT(clipIndex >= 0);
+    Q_ASSERT(m_tractor);
+
+    if (!m_tractor || trackIndex < 0 || trackIndex >= m_trackList.size())
+        return;
+    int i = m_trackList.at(trackIndex).mlt_index;
+    QScopedPointer<Mlt::Producer> track(m_tractor->track(i));
+    if (!track)
+        return;
+    Mlt::Playlist playlist(*track);
+    QScopedPointer<Mlt::ClipInfo> info(playlist.clip_info(clipIndex));
+    if (!info || !info->producer || !info->producer->is_valid())
+        return;
+
+    // 复用之前标准化添加的音量滤镜，它在滤镜面板里显示为"Gain / Volume"
+    QScopedPointer<Mlt::Filter> filter;
+    for (int j = 0; j < info->producer->filter_count(); j++) {
+        QScopedPointer<Mlt::Filter> f(info->producer->filter(j));
+        if (f && f->is_valid() && f->get(kLoudnessTargetProperty)) {
+            filter.reset(f.take());
+            break;
         }
     }
+    if (!filter) {
+        Mlt::Filter f(MLT.profile(), "volume");
+        f.set(kShotcutFilterProperty, "audioGainVolume");
+        info->producer->attach(f);
+        filter.reset(new Mlt::Filter(f));
+    }
+    filter->set("gain", qPow(10.0, gainDb / 20.0));
+    filter->set(kLoudnessTargetProperty, targetLufs);
+
+    QModelIndex modelIndex = createIndex(clipIndex, 0, quintptr(trackIndex));
+    emit dataChanged(modelIndex, modelIndex);
+    notifyModified();
 }
 
 void MultitrackModel::fadeOut(int trackIndex, int clipIndex, int duration)
@@ -1958,7 +1998,7 @@ void MultitrackModel::fadeOut(int trackIndex, int clipIndex, int duration)
             QVector<int> roles;
             roles << FadeOutRole;
             emit dataChanged(modelIndex, modelIndex, roles);
-            emit modified();
+            notifyModified();
         }
     }
 }
@@ -2077,7 +2117,7 @@ int MultitrackModel::addTransition(int trackIndex, int clipIndex, int position)
             roles << InPointRole;
             roles << DurationRole;
             emit dataChanged(modelIndex, modelIndex, roles);
-            emit modified();
+            notifyModified();
             emit seeked(playlist.clip_start(targetIndex + 1));
             return targetIndex + 1;
         }
@@ -2219,7 +2259,7 @@ void MultitrackModel::removeTransition(int trackIndex, int clipIndex)
         roles << InPointRole;
         roles << DurationRole;
         emit dataChanged(modelIndex, modelIndex, roles);
-        emit modified();
+        notifyModified();
 
         // 删除后不选中任何 clip
         setSelection(trackIndex, -1);
@@ -2345,7 +2385,7 @@ void MultitrackModel::trimTransitionIn(int trackIndex, int clipIndex, int delta)
         roles << DurationRole;
         emit dataChanged(createIndex(clipIndex, 0, quintptr(trackIndex)),
                          createIndex(clipIndex + 1, 0, quintptr(trackIndex)), roles);
-        emit modified();
+        notifyModified();
     }
 }
 
@@ -2450,7 +2490,7 @@ void MultitrackModel::trimTransitionOut(int trackIndex, int clipIndex, int delta
         roles << DurationRole;
         emit dataChanged(createIndex(clipIndex, 0, quintptr(trackIndex)),
                          createIndex(clipIndex, 0, quintptr(trackIndex)), roles);
-        emit modified();
+        notifyModified();
     }
 }
 
@@ -2526,7 +2566,7 @@ void MultitrackModel::addTransitionByTrimIn(int trackIndex, int clipIndex, int d
             roles << OutPointRole;
             roles << DurationRole;
             emit dataChanged(modelIndex, modelIndex, roles);
-            emit modified();
+            notifyModified();
             m_isMakingTransition = true;
         } else if (m_isMakingTransition) {
             // Adjust a transition addition already in progress.
@@ -2616,7 +2656,7 @@ void MultitrackModel::addTransitionByTrimOut(int trackIndex, int clipIndex, int
             roles << InPointRole;
             roles << DurationRole;
             emit dataChanged(modelIndex, modelIndex, roles);
-            emit modified();
+            notifyModified();
             m_isMakingTransition = true;
         } else if (m_isMakingTransition) {
             // Adjust a transition addition already in progress.
@@ -2878,6 +2918,11 @@ void MultitrackModel::consolidateBlanks(Mlt::Playlist &playlist, int trackIndex)
     Q_ASSERT(trackIndex >= 0);
     Q_ASSERT(trackIndex < m_trackList.size());
 
+    if (m_batchDepth > 0) {
+        m_batchTracks.insert(trackIndex);
+        return;
+    }
+
     for (int i = 1; i < playlist.count(); i++) {
         if (playlist.is_blank(i - 1) && playlist.is_blank(i)) {
             int out = playlist.clip_length(i - 1) + playlist.clip_length(i) - 1;
@@ -2933,6 +2978,315 @@ void MultitrackModel::audioLevelsReady(const QModelIndex& index)
     emit dataChanged(index, index, roles);
 }
 
+Mlt::Playlist* MultitrackModel::trackPlaylist(int trackIndex) const
+{
+    if (!m_tractor || trackIndex < 0 || trackIndex >= m_trackList.count())
+        return nullptr;
+    QScopedPointer<Mlt::Producer> track(m_tractor->track(m_trackList.at(trackIndex).mlt_index));
+    if (!track || !track->is_valid())
+        return nullptr;
+    Mlt::Playlist* playlist = new Mlt::Playlist(*track);
+    if (!playlist->is_valid()) {
+        delete playlist;
+        return nullptr;
+    }
+    return playlist;
+}
+
+MultitrackModel::ClipRecord MultitrackModel::makeClipRecord(Mlt::Playlist& playlist, int clipIndex) const
+{
+    ClipRecord record;
+    record.isBlank = true;
+    record.isTransition = false;
+    record.isAnimSticker = false;
+    record.hasFilter = false;
+    record.start = 0;
+    record.duration = 0;
+    record.in = 0;
+    record.out = 0;
+    record.fadeIn = 0;
+    record.fadeOut = 0;
+    record.fps = 0.0;
+    record.speed = 1.0;
+
+    QScopedPointer<Mlt::ClipInfo> info(playlist.clip_info(clipIndex));
+    Q_ASSERT(info);
+    if (!info)
+        return record;
+
+    Mlt::Producer* producer = (info->producer && info->producer->is_valid())? info->producer : nullptr;
+    QString resource = QString::fromUtf8(info->resource);
+
+    record.isBlank = playlist.is_blank(clipIndex);
+    record.start = info->start;
+    record.duration = info->frame_count;
+    record.in = info->frame_in;
+    record.out = info->frame_out;
+    record.fps = info->fps;
+    record.isAnimSticker = resource == "<tractor>";
+
+    // 名称
+    QString name;
+    if (producer)
+        name = producer->get(kShotcutCaptionProperty);
+    if (name.isNull())
+        name = Util::baseName(resource);
+    if (name == "<producer>" && producer)
+        name = QString::fromUtf8(producer->get("mlt_service"));
+    if (name == "<tractor>" && producer) {
+        name = QString::fromUtf8(producer->get("moviemator:imageName"));
+        name += "-" + QString::fromUtf8(producer->get("moviemator:animationName"));
+    }
+    //获取clip在时间线上显示的名字
+    if (producer) {
+        QString strClipCaption = getClipCaption(*producer);
+        if (!strClipCaption.isEmpty())
+            name = strClipCaption;
+    }
+    record.name = name;
+
+    record.resource = resource;
+    if (resource == "<producer>" && producer && producer->get("mlt_service"))
+        record.resource = QString::fromUtf8(producer->get("mlt_service"));
+
+    if (!producer)
+        return record;
+
+    record.service = QString::fromUtf8(producer->get("mlt_service"));
+    record.thumbnail = QString("..") + QString(producer->get("thumbnail"));
+    record.hasFilter = hasFilterApplied(producer);
+    record.isTransition = isTransition(playlist, clipIndex);
+    if (!qstrcmp("timewarp", producer->get("mlt_service")))
+        record.speed = producer->get_double("warp_speed");
+
+    QScopedPointer<Mlt::Filter> filter(getFilter("fadeInVolume", producer));
+    if (!filter || !filter->is_valid())
+        filter.reset(getFilter("fadeInBrightness", producer));
+    if (!filter || !filter->is_valid())
+        filter.reset(getFilter("fadeInMovit", producer));
+    record.fadeIn = (filter && filter->is_valid())? filter->get_length() : 0;
+
+    filter.reset(getFilter("fadeOutVolume", producer));
+    if (!filter || !filter->is_valid())
+        filter.reset(getFilter("fadeOutBrightness", producer));
+    if (!filter || !filter->is_valid())
+        filter.reset(getFilter("fadeOutMovit", producer));
+    record.fadeOut = (filter && filter->is_valid())? filter->get_length() : 0;
+
+    return record;
+}
+
+// 返回已生成的轨道缓存，没有生成或轨道下标无效时返回 nullptr
+MultitrackModel::ClipTable* MultitrackModel::builtClipTable(int trackIndex) const
+{
+    if (m_clipTable.size() != m_trackList.count()) {
+        invalidateClipTable();
+        return nullptr;
+    }
+    if (trackIndex < 0 || trackIndex >= m_clipTable.size() || !m_clipTable.at(trackIndex).valid)
+        return nullptr;
+    return &m_clipTable[trackIndex];
+}
+
+void MultitrackModel::rebuildClipTable(int trackIndex) const
+{
+    ClipTable& table = m_clipTable[trackIndex];
+    table.valid = false;
+    table.clips.clear();
+    QScopedPointer<Mlt::Playlist> playlist(trackPlaylist(trackIndex));
+    if (!playlist)
+        return;
+    int n = playlist->count();
+    table.clips.reserve(n);
+    for (int i = 0; i < n; ++i)
+        table.clips.append(makeClipRecord(*playlist, i));
+    table.valid = true;
+}
+
+void MultitrackModel::invalidateClipTable() const
+{
+    m_clipTable.clear();
+    m_clipTable.resize(m_trackList.count());
+}
+
+// 返回轨道缓存，还没生成时先从 MLT 生成
+const MultitrackModel::ClipTable* MultitrackModel::clipTable(int trackIndex) const
+{
+    if (!m_tractor || trackIndex < 0 || trackIndex >= m_trackList.count())
+        return nullptr;
+    if (m_clipTable.size() != m_trackList.count())
+        invalidateClipTable();
+    if (!m_clipTable.at(trackIndex).valid)
+        rebuildClipTable(trackIndex);
+    return m_clipTable.at(trackIndex).valid? &m_clipTable.at(trackIndex) : nullptr;
+}
+
+const MultitrackModel::ClipRecord* MultitrackModel::clipRecord(int trackIndex, int clipIndex) const
+{
+    const ClipTable* table = clipTable(trackIndex);
+    if (!table || clipIndex < 0 || clipIndex >= table->clips.size())
+        return nullptr;
+    return &table->clips.at(clipIndex);
+}
+
+// 开始位置 <= position 的最后一个 clip，position 在第一个 clip 之前时返回 -1
+int MultitrackModel::clipAtOrBefore(const ClipTable& table, int position)
+{
+    int low = 0;
+    int high = table.clips.size();
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (table.clips.at(middle).start <= position)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low - 1;
+}
+
+int MultitrackModel::trackEnd(const ClipTable& table)
+{
+    if (table.clips.isEmpty())
+        return 0;
+    const ClipRecord& last = table.clips.last();
+    return last.start + last.duration;
+}
+
+// clip 的开始位置就是前面所有 clip 长度之和
+void MultitrackModel::updateClipStarts(ClipTable& table)
+{
+    int start = 0;
+    for (int i = 0; i < table.clips.size(); ++i) {
+        table.clips[i].start = start;
+        start += table.clips.at(i).duration;
+    }
+}
+
+void MultitrackModel::onRowsInserted(const QModelIndex& parent, int first, int last)
+{
+    if (!parent.isValid()) {
+        // 轨道增加，轨道下标都可能变化
+        invalidateClipTable();
+        return;
+    }
+    if (parent.internalId() != NO_PARENT_ID)
+        return;
+    ClipTable* table = builtClipTable(parent.row());
+    if (!table)
+        return;
+    QScopedPointer<Mlt::Playlist> playlist(trackPlaylist(parent.row()));
+    if (!playlist || first > table->clips.size() || last >= playlist->count()) {
+        table->valid = false;
+        return;
+    }
+    for (int i = first; i <= last; ++i)
+        table->clips.insert(i, makeClipRecord(*playlist, i));
+    if (table->clips.size() != playlist->count()) {
+        // 通知与 MLT 当前状态对不上（例如先通知后修改），等下次读取时重新生成
+        table->valid = false;
+        return;
+    }
+    updateClipStarts(*table);
+}
+
+void MultitrackModel::onRowsRemoved(const QModelIndex& parent, int first, int last)
+{
+    if (!parent.isValid()) {
+        invalidateClipTable();
+        return;
+    }
+    if (parent.internalId() != NO_PARENT_ID)
+        return;
+    ClipTable* table = builtClipTable(parent.row());
+    if (!table)
+        return;
+    QScopedPointer<Mlt::Playlist> playlist(trackPlaylist(parent.row()));
+    if (!playlist || last >= table->clips.size()) {
+        table->valid = false;
+        return;
+    }
+    table->clips.remove(first, last - first + 1);
+    if (table->clips.size() != playlist->count()) {
+        table->valid = false;
+        return;
+    }
+    updateClipStarts(*table);
+}
+
+void MultitrackModel::onDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles)
+{
+    // 轨道本身的数据不在缓存里
+    if (!topLeft.isValid() || !topLeft.parent().isValid())
+        return;
+    // 音频波形不在缓存里
+    if (roles.count() == 1 && roles.first() == AudioLevelsRole)
+        return;
+    ClipTable* table = builtClipTable(int(topLeft.internalId()));
+    if (!table)
+        return;
+    QScopedPointer<Mlt::Playlist> playlist(trackPlaylist(int(topLeft.internalId())));
+    if (!playlist || table->clips.size() != playlist->count()) {
+        table->valid = false;
+        return;
+    }
+    for (int i = topLeft.row(); i <= bottomRight.row() && i < table->clips.size(); ++i)
+        table->clips[i] = makeClipRecord(*playlist, i);
+    updateClipStarts(*table);
+}
+
+void MultitrackModel::onLayoutReset()
+{
+    invalidateClipTable();
+}
+
+bool MultitrackModel::checkClipTable() const
+{
+    if (!m_tractor || m_clipTable.size() != m_trackList.count())
+        return true;
+
+    bool result = true;
+    for (int t = 0; t < m_clipTable.size(); ++t) {
+        const ClipTable& table = m_clipTable.at(t);
+        if (!table.valid)
+            continue;
+        QScopedPointer<Mlt::Playlist> playlist(trackPlaylist(t));
+        if (!playlist)
+            continue;
+        if (table.clips.size() != playlist->count()) {
+            LOG_WARNING() << "clip table of track" << t << "has" << table.clips.size()
+                          << "clips, playlist has" << playlist->count();
+            result = false;
+            continue;
+        }
+        for (int i = 0; i < table.clips.size(); ++i) {
+            const ClipRecord& cached = table.clips.at(i);
+            ClipRecord live = makeClipRecord(*playlist, i);
+            QStringList fields;
+            if (cached.name != live.name) fields << "name";
+            if (cached.resource != live.resource) fields << "resource";
+            if (cached.service != live.service) fields << "service";
+            if (cached.thumbnail != live.thumbnail) fields << "thumbnail";
+            if (cached.isBlank != live.isBlank) fields << "blank";
+            if (cached.isTransition != live.isTransition) fields << "transition";
+            if (cached.isAnimSticker != live.isAnimSticker) fields << "animSticker";
+            if (cached.hasFilter != live.hasFilter) fields << "hasFilter";
+            if (cached.start != live.start) fields << "start";
+            if (cached.duration != live.duration) fields << "duration";
+            if (cached.in != live.in) fields << "in";
+            if (cached.out != live.out) fields << "out";
+            if (cached.fadeIn != live.fadeIn) fields << "fadeIn";
+            if (cached.fadeOut != live.fadeOut) fields << "fadeOut";
+            if (!qFuzzyCompare(cached.fps + 1.0, live.fps + 1.0)) fields << "fps";
+            if (!qFuzzyCompare(cached.speed, live.speed)) fields << "speed";
+            if (!fields.isEmpty()) {
+                LOG_WARNING() << "clip table of track" << t << "clip" << i << "is stale:" << fields.join(", ");
+                result = false;
+            }
+        }
+    }
+    return result;
+}
+
 bool MultitrackModel::createIfNeeded()
 {
     if (!m_tractor) {
@@ -3013,7 +3367,7 @@ int MultitrackModel::addAudioTrack()
         addBackgroundTrack();
         addAudioTrack();
         emit created();
-        emit modified();
+        notifyModified();
         return 0;
     }
 
@@ -3053,8 +3407,8 @@ int MultitrackModel::addAudioTrack()
     beginInsertRows(QModelIndex(), m_trackList.count(), m_trackList.count());
     m_trackList.append(t);
 
-    emit modified();
-    MAIN.setCurrentTrack(m_trackList.count() - 1);
+    notifyModified();
+    emit currentTrackRequested(m_trackList.count() - 1);
 
     endInsertRows();
     return m_trackList.count() - 1;
@@ -3126,8 +3480,8 @@ int MultitrackModel::addVideoTrack()
     m_trackList.prepend(t);
 
 
-    emit modified();
-    MAIN.setCurrentTrack(0);
+    notifyModified();
+    emit currentTrackRequested(0);
     endInsertRows();
 
     return 0;
@@ -3145,7 +3499,7 @@ int MultitrackModel::addFilterTrack()
         addBackgroundTrack();
         addFilterTrack();
         emit created();
-        emit modified();
+        notifyModified();
         return 0;
     }
 
@@ -3176,7 +3530,7 @@ int MultitrackModel::addFilterTrack()
     beginInsertRows(QModelIndex(), m_trackList.count(), m_trackList.count());
     m_trackList.append(t);
     endInsertRows();
-    emit modified();
+    notifyModified();
     return m_trackList.count() - 1;
 }
 
@@ -3193,7 +3547,7 @@ int MultitrackModel::addTextTrack()
         addBackgroundTrack();
         addTextTrack();
         emit created();
-        emit modified();
+        notifyModified();
         return 0;
     }
 
@@ -3225,7 +3579,7 @@ int MultitrackModel::addTextTrack()
     beginInsertRows(QModelIndex(), m_trackList.count(), m_trackList.count());
     m_trackList.append(t);
     endInsertRows();
-    emit modified();
+    notifyModified();
     return m_trackList.count() - 1;
 }
 
@@ -3284,7 +3638,7 @@ void MultitrackModel::removeTrack(int trackIndex)
             ++row;
         }
     }
-    emit modified();
+    notifyModified();
 }
 
 void MultitrackModel::renameTrack(Track t, int trackIndex,bool emitSignal)
@@ -3494,9 +3848,9 @@ void MultitrackModel::insertTrack(int trackIndex, TrackType type)
     beginInsertRows(QModelIndex(), trackIndex, trackIndex);
     m_trackList.insert(trackIndex, t);
     endInsertRows();
-    emit modified();
+    notifyModified();
 
-    MAIN.setCurrentTrack(trackIndex);
+    emit currentTrackRequested(trackIndex);
 }
 
 void MultitrackModel::insertOrAdjustBlankAt(QList<int> tracks, int position, int length)
@@ -3567,7 +3921,8 @@ void MultitrackModel::load()
     if (m_trackList.count() > 0) {
         beginInsertRows(QModelIndex(), 0, m_trackList.count() - 1);
         endInsertRows();
-        getAudioLevels();
+        // 先让时间线显示出轨道结构，波形在下一轮事件循环再开始生成
+        QTimer::singleShot(0, this, SLOT(getDeferredAudioLevels()));
     }
     emit loaded();
 }
@@ -3625,6 +3980,8 @@ void MultitrackModel::refreshTrackList()
 {
     Q_ASSERT(m_tractor);
 
+    invalidateClipTable();
+
     int n = m_tractor->count();
     int a = 0;
     int v = 0;
@@ -3711,6 +4068,12 @@ void MultitrackModel::getAudioLevels()
     }
 }
 
+void MultitrackModel::getDeferredAudioLevels()
+{
+    if (m_tractor)
+        getAudioLevels();
+}
+
 void MultitrackModel::addBlackTrackIfNeeded()
 {
     return;
@@ -3920,7 +4283,7 @@ void MultitrackModel::addFilter(int trackIndex, Mlt::Producer *filter)
         beginInsertRows(index(trackIndex), i, i);
         playlist.append(*filter, 0, 100);
         endInsertRows();
-        emit modified();
+        notifyModified();
         emit seeked(playlist.clip_start(i));
     }
 }
@@ -3951,7 +4314,7 @@ void MultitrackModel::addText(int trackIndex, Mlt::Producer *filter)
         beginInsertRows(index(trackIndex), i, i);
         playlist.append(*producer);
         endInsertRows();
-        emit modified();
+        notifyModified();
         emit seeked(playlist.clip_start(i));
     }
 }
@@ -3963,23 +4326,8 @@ bool MultitrackModel::checkClip(Mlt::Producer &clip)
     int len = clip.get_length();
     if (len <= 0)
     {
-//        QMessageBox dialog(QMessageBox::Critical, qApp->applicationName(), tr("Failed to Add Clip\nInvalid Time Code!"), QMessageBox::Ok, &(MAIN));
-        QMessageBox dialog(QMessageBox::Critical,
-                           qApp->applicationName(),
-                           tr("<p>The time code of the file cannot be read. Please convert it to MP4 before adding the file. </p>"
-                              "<p>Recommend:<a href=\"http://www.effectmatrix.com/total-video-converter\">Total Video Converter</a></p>"),
-                           QMessageBox::Ok, &(MAIN));
-
-        dialog.setIconPixmap(QPixmap(":/icons/moviemator-pro-logo-64.png"));
-//#if MOVIEMATOR_PRO
-//        dialog.setIconPixmap(QPixmap(":/icons/moviemator-pro-logo-64.png"));
-//#else
-//        dialog.setIconPixmap(QPixmap(":/icons/moviemator-logo-64.png"));
-//#endif
-        dialog.setWindowModality(Qt::WindowModal);
-        dialog.setDefaultButton(QMessageBox::Ok);
-        int r = dialog.exec();
-        Q_UNUSED(r)
+        // 提示框由界面层弹出，模型本身不依赖主窗口
+        emit invalidClipRejected();
         return false;
     }
     return true;
@@ -4051,7 +4399,7 @@ void MultitrackModel::setTransitionDuration(int trackIndex, int clipIndex, int d
             roles << InPointRole;
             roles << DurationRole;
             emit dataChanged(modelIndex, modelIndex, roles);
-            emit modified();
+            notifyModified();
         }
     }
 }
@@ -4210,7 +4558,7 @@ int MultitrackModel::moveInsertClip(int fromTrack, int toTrack, int clipIndex, i
     }
 
     consolidateBlanksAllTracks();
-    emit modified();
+    notifyModified();
 
     return 0;
 }
@@ -4269,10 +4617,6 @@ void MultitrackModel::setClipSpeed(int trackIndex, int clipIndex, double speed)
     Q_ASSERT(clipIndex >= 0);
     Q_ASSERT(m_tractor);
 
-    connect(this, SIGNAL(producerChanged(Mlt::Producer*)), &MAIN, SLOT(onProducerChanged()));
-    connect(this, SIGNAL(producerChanged(Mlt::Producer*)), MAIN.filterController(), SLOT(setProducer(Mlt::Producer*)));
-    connect(this, SIGNAL(producerChanged(Mlt::Producer*)), MAIN.timelineDock(), SLOT(onProducerChanged(Mlt::Producer*)));
-
     int i = m_trackList.at(trackIndex).mlt_index;
     QScopedPointer<Mlt::Producer> track(m_tractor->track(i));
     Q_ASSERT(track);
@@ -4383,6 +4727,7 @@ void MultitrackModel::debugPrintState()
         }
     }
     qDebug("}");
+    checkClipTable();
 }
 
 Mlt::Producer *MultitrackModel::getClipProducer(int trackIndex, int clipIndex)
@@ -4451,7 +4796,7 @@ void MultitrackModel::setTransitionProperty(int trackIndex, int clipIndex, const
     Q_ASSERT(transition);
     transition->set(propertyName.toUtf8().constData(), propertyValue.toUtf8().constData());
 
-    MLT.refreshConsumer();
+    refreshRange(editStart(trackIndex, clipIndex), editEnd(trackIndex, clipIndex));
 }
 
 int MultitrackModel::setSelection(TIMELINE_SELECTION selectionNew)
@@ -4503,19 +4848,100 @@ int MultitrackModel::getClipOfPosition(int nIndexOfTrack, int nFramePostion)
 
     Q_ASSERT(m_tractor);
 
-    int nResult = -1;
+    return clipIndexAt(nIndexOfTrack, nFramePostion);
+}
 
-    int nTrackIndexMlt = m_trackList.at(nIndexOfTrack).mlt_index;
+int MultitrackModel::clipCount(int trackIndex) const
+{
+    const ClipTable* table = clipTable(trackIndex);
+    return table? table->clips.size() : 0;
+}
 
-    QScopedPointer<Mlt::Producer> trackProducer(m_tractor->track(nTrackIndexMlt));
-    Q_ASSERT(trackProducer);
-    if (trackProducer)
-    {
-        Mlt::Playlist mltPlaylist(*trackProducer);
-        Q_ASSERT(mltPlaylist.is_valid());
-        nResult = mltPlaylist.get_clip_index_at(nFramePostion);
+int MultitrackModel::clipIndexAt(int trackIndex, int position) const
+{
+    const ClipTable* table = clipTable(trackIndex);
+    if (!table)
+        return -1;
+    int n = table->clips.size();
+    if (position >= trackEnd(*table))
+        return n;
+    if (position < 0)
+        return 0;
+    return clipAtOrBefore(*table, position);
+}
+
+bool MultitrackModel::isBlankClip(int trackIndex, int clipIndex) const
+{
+    const ClipRecord* record = clipRecord(trackIndex, clipIndex);
+    return record && record->isBlank;
+}
+
+int MultitrackModel::previousEdit(int position) const
+{
+    int result = -1;
+    for (int t = 0; t < m_trackList.count(); ++t) {
+        const ClipTable* table = clipTable(t);
+        if (!table || table->clips.isEmpty())
+            continue;
+        int end = trackEnd(*table);
+        if (end < position) {
+            result = qMax(result, end);
+            continue;
+        }
+        int i = clipAtOrBefore(*table, position - 1);
+        if (i >= 0)
+            result = qMax(result, table->clips.at(i).start);
+    }
+    return result;
+}
+
+int MultitrackModel::nextEdit(int position) const
+{
+    int result = -1;
+    for (int t = 0; t < m_trackList.count(); ++t) {
+        const ClipTable* table = clipTable(t);
+        if (!table || table->clips.isEmpty())
+            continue;
+        int i = clipAtOrBefore(*table, position) + 1;
+        int edit = (i < table->clips.size())? table->clips.at(i).start : trackEnd(*table);
+        if (edit > position && (result < 0 || edit < result))
+            result = edit;
     }
-    return nResult;
+    return result;
+}
+
+int MultitrackModel::snapPosition(int position, double pixels, int excludeTrack, int excludeClip) const
+{
+    double tolerance = pixels / scaleFactor();
+    int result = -1;
+    double distance = tolerance;
+
+    for (int t = 0; t < m_trackList.count(); ++t) {
+        const ClipTable* table = clipTable(t);
+        if (!table || table->clips.isEmpty())
+            continue;
+        const QVector<ClipRecord>& clips = table->clips;
+        int n = clips.size();
+        // 第 i 个编辑点是第 i 个 clip 的开始，第 n 个是轨道末尾
+        int i = qMax(0, clipAtOrBefore(*table, qFloor(position - tolerance)));
+        for (; i <= n; ++i) {
+            int edit = (i < n)? clips.at(i).start : trackEnd(*table);
+            if (edit > position + tolerance)
+                break;
+            // 被拖动的 clip 原来的边缘，另一侧是空白或没有 clip 时不参与吸附
+            if (t == excludeTrack && (i == excludeClip || i == excludeClip + 1)) {
+                int other = (i == excludeClip)? i - 1 : i;
+                if (other < 0 || other >= n || clips.at(other).isBlank)
+                    continue;
+            }
+            double d = qAbs(edit - position);
+            if (d < distance) {
+                distance = d;
+                result = edit;
+            }
+        }
+    }
+    return result;
 }
 
 QString MultitrackModel::getClipCaption(Mlt::Producer &producerClip) const
@@ -4556,3 +4982,254 @@ QString MultitrackModel::getClipCaption(Mlt::Producer &producerClip) const
 
     return strProducerCaption;
 }
+
+// 把片段（cut）自己的属性和滤镜搬到新的 cut上，in/out和 MLT内部属性除外
+static void copyCutProperties(Mlt::Producer& from, Mlt::Producer& to)
+{
+    static const QStringList skipped = QStringList() << "in" << "out" << "length" << "eof"
+                                                     << "mlt_type" << "mlt_service" << "resource";
+    for (int i = 0; i < from.count(); ++i) {
+        const char* name = from.get_name(i);
+        if (!name || name[0] == '_' || skipped.contains(QString::fromLatin1(name)))
+            continue;
+        to.set(name, from.get(i));
+    }
+    Mlt::Controller::copyFilters(from, to);
+}
+
+// 代理文件还没生成的片段加入生成队列
+// 只影响预览，不记录撤销也不标记工程已修改
+int MultitrackModel::useProxies(const QString& hash)
+{
+    if (!m_tractor)
+        return 0;
+    int count = 0;
+    for (int trackIndex = 0; trackIndex < m_trackList.size(); ++trackIndex) {
+        QScopedPointer<Mlt::Playlist> playlist(trackPlaylist(trackIndex));
+        if (!playlist)
+            continue;
+        for (int clipIndex = 0; clipIndex < playlist->count(); ++clipIndex) {
+            QScopedPointer<Mlt::Producer> clip(playlist->get_clip(clipIndex));
+            if (!clip || clip->is_blank() || isTransition(*playlist, clipIndex))
+                continue;
+            Mlt::Producer& parent = clip->parent();
+            if (!parent.get_int(kProxyProperty) || parent.get(kOriginalResourceProperty))
+                continue;
+            if (!hash.isEmpty() && hash != parent.get(kShotcutHashProperty))
+                continue;
+            if (!PROXY.prepare(parent))
+                continue;
+            QScopedPointer<Mlt::Producer> producer(PROXY.proxied(parent));
+            if (!producer)
+                continue;
+            int in = clip->get_in();
+            int out = clip->get_out();
+
+            // avformat producer不会因为 resource改变而重新打开文件，只能换掉 parent；
+            // 片段本身的属性和滤镜原样搬到新的 cut上，行数不变，只通知数据变化
+            playlist->remove(clipIndex);
+            playlist->insert(*producer, clipIndex, in, out);
+            QScopedPointer<Mlt::Producer> cut(playlist->get_clip(clipIndex));
+            if (cut && cut->is_valid())
+                copyCutProperties(*clip, *cut);
+            QModelIndex modelIndex = createIndex(clipIndex, 0, quintptr(trackIndex));
+            emit dataChanged(modelIndex, modelIndex);
+            AudioLevelsTask::start(producer->parent(), this, modelIndex);
+            count++;
+        }
+    }
+    return count;
+}
+
+QList<Mlt::Producer*> MultitrackModel::lazyProducers() const
+{
+    QList<Mlt::Producer*> result;
+    if (!m_tractor)
+        return result;
+    QSet<mlt_producer> seen;
+    for (int trackIndex = 0; trackIndex < m_trackList.size(); ++trackIndex) {
+        QScopedPointer<Mlt::Playlist> playlist(trackPlaylist(trackIndex));
+        if (!playlist)
+            continue;
+        for (int clipIndex = 0; clipIndex < playlist->count(); ++clipIndex) {
+            QScopedPointer<Mlt::Producer> clip(playlist->get_clip(clipIndex));
+            if (!clip || clip->is_blank() || isTransition(*playlist, clipIndex))
+                continue;
+            Mlt::Producer& parent = clip->parent();
+            // 已经被 consumer按需打开过的素材有 meta.media属性
+            if (qstrcmp(parent.get("mlt_service"), "avformat-novalidate") || parent.get("meta.media.nb_streams"))
+                continue;
+            if (seen.contains(parent.get_producer()))
+                continue;
+            seen.insert(parent.get_producer());
+            result << new Mlt::Producer(parent);
+        }
+    }
+    return result;
+}
+
+int MultitrackModel::replaceProducer(Mlt::Producer& original, Mlt::Producer& opened)
+{
+    if (!m_tractor || !original.is_valid() || !opened.is_valid() || original.get("meta.media.nb_streams"))
+        return 0;
+
+    // 素材在 XML里的属性（音轨、哈希、时长等）和滤镜搬到新的 producer上；
+    // 服务名仍是 avformat-novalidate，保存的工程下次打开时也不用同步打开文件
+    for (int i = 0; i < original.count(); ++i) {
+        const char* name = original.get_name(i);
+        if (!name || name[0] == '_' || !qstrcmp(name, "mlt_type") || !qstrcmp(name, "mlt_service")
+                || !qstrcmp(name, "resource"))
+            continue;
+        opened.set(name, original.get(i));
+    }
+    opened.set("mlt_service", "avformat-novalidate");
+    Mlt::Controller::copyFilters(original, opened);
+
+    int count = 0;
+    for (int trackIndex = 0; trackIndex < m_trackList.size(); ++trackIndex) {
+        QScopedPointer<Mlt::Playlist> playlist(trackPlaylist(trackIndex));
+        if (!playlist)
+            continue;
+        for (int clipIndex = 0; clipIndex < playlist->count(); ++clipIndex) {
+            QScopedPointer<Mlt::Producer> clip(playlist->get_clip(clipIndex));
+            if (!clip || clip->is_blank() || isTransition(*playlist, clipIndex))
+                continue;
+            if (clip->parent().get_producer() != original.get_producer())
+                continue;
+            int in = clip->get_in();
+            int out = clip->get_out();
+
+            // 和 useProxies()一样换掉 parent，片段本身的属性和滤镜原样搬到新的 cut上
+            playlist->remove(clipIndex);
+            playlist->insert(opened, clipIndex, in, out);
+            QScopedPointer<Mlt::Producer> cut(playlist->get_clip(clipIndex));
+            if (cut && cut->is_valid())
+                copyCutProperties(*clip, *cut);
+            QModelIndex modelIndex = createIndex(clipIndex, 0, quintptr(trackIndex));
+            emit dataChanged(modelIndex, modelIndex);
+            // 同一个素材正在生成的波形任务会把结果也交给新的 producer，已经生成过的从缓存读取
+            if (cut && cut->is_valid() && cut->get_int("audio_index") > -1)
+                AudioLevelsTask::start(cut->parent(), this, modelIndex);
+            count++;
+        }
+    }
+    return count;
+}
+
+void MultitrackModel::beginBatch()
+{
+    ++m_batchDepth;
+}
+
+void MultitrackModel::endBatch()
+{
+    Q_ASSERT(m_batchDepth > 0);
+    if (m_batchDepth <= 0 || --m_batchDepth > 0)
+        return;
+
+    // 每条涉及的轨道只合并一次空白
+    QList<int> tracks = m_batchTracks.toList();
+    m_batchTracks.clear();
+    std::sort(tracks.begin(), tracks.end());
+    foreach (int trackIndex, tracks) {
+        QScopedPointer<Mlt::Playlist> playlist(trackPlaylist(trackIndex));
+        if (playlist && playlist->is_valid())
+            consolidateBlanks(*playlist, trackIndex);
+    }
+    if (m_batchModified) {
+        m_batchModified = false;
+        emit modified();
+    }
+    if (m_batchRefresh) {
+        m_batchRefresh = false;
+        MLT.refreshRange(m_batchRefreshIn, m_batchRefreshOut);
+    }
+}
+
+void MultitrackModel::notifyModified()
+{
+    if (m_batchDepth > 0)
+        m_batchModified = true;
+    else
+        emit modified();
+}
+
+void MultitrackModel::refreshConsumer()
+{
+    refreshRange(0, -1);
+}
+
+void MultitrackModel::refreshRange(int in, int out)
+{
+    in = qMax(in, 0);
+    if (m_batchDepth <= 0) {
+        MLT.refreshRange(in, out);
+    } else if (!m_batchRefresh) {
+        m_batchRefresh = true;
+        m_batchRefreshIn = in;
+        m_batchRefreshOut = out;
+    } else {
+        m_batchRefreshIn = qMin(m_batchRefreshIn, in);
+        m_batchRefreshOut = (m_batchRefreshOut < 0 || out < 0)? -1 : qMax(m_batchRefreshOut, out);
+    }
+}
+
+//修剪、转场只会改变 clipIndex前一项的起点之后的内容
+int MultitrackModel::editStart(int trackIndex, int clipIndex)
+{
+    int index = qMin(clipIndex - 1, clipCount(trackIndex) - 1);
+    return (index > 0)? getStartPositionOfClip(trackIndex, index) : 0;
+}
+
+//clipIndex后一项的结尾，后面没有内容时返回 -1
+int MultitrackModel::editEnd(int trackIndex, int clipIndex)
+{
+    int index = clipIndex + 2;
+    return (index < clipCount(trackIndex))? getStartPositionOfClip(trackIndex, index) - 1 : -1;
+}
+
+void MultitrackModel::refreshService(Mlt::Service* service)
+{
+    if (!service || !service->is_valid() || !m_tractor || !MLT.producer()
+            || MLT.producer()->get_producer() != m_tractor->get_producer()) {
+        MLT.refreshConsumer();
+        return;
+    }
+    // 同一个 parent的所有 cut（比如切分出来的 clip）共用滤镜
+    mlt_service target = service->get_service();
+    if (service->type() != filter_type)
+        target = MLT_PRODUCER_SERVICE(mlt_producer_cut_parent(MLT_PRODUCER(target)));
+    int in = -1;
+    int out = -1;
+    for (int trackIndex = 0; trackIndex < m_trackList.size(); trackIndex++) {
+        QScopedPointer<Mlt::Producer> track(m_tractor->track(m_trackList.at(trackIndex).mlt_index));
+        if (!track)
+            continue;
+        Mlt::Playlist playlist(*track);
+        for (int i = 0; i < playlist.count(); i++) {
+            if (playlist.is_blank(i))
+                continue;
+            QScopedPointer<Mlt::Producer> clip(playlist.get_clip(i));
+            if (!clip || !clip->is_valid())
+                continue;
+            mlt_service parent = MLT_PRODUCER_SERVICE(mlt_producer_cut_parent(clip->get_producer()));
+            bool uses = (parent == target);
+            for (int j = 0; !uses; j++) {
+                mlt_filter filter = mlt_service_filter(parent, j);
+                if (!filter)
+                    break;
+                uses = (MLT_FILTER_SERVICE(filter) == target);
+            }
+            if (uses) {
+                int start = playlist.clip_start(i);
+                int end = start + playlist.clip_length(i) - 1;
+                in = (in < 0)? start : qMin(in, start);
+                out = qMax(out, end);
+            }
+        }
+    }
+    if (in < 0)
+        refreshConsumer();
+    else
+        refreshRange(in, out);
+}
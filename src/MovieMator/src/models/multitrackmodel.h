@@ -25,6 +25,8 @@
 #include <QAbstractItemModel>
 #include <QList>
 #include <QString>
+#include <QVector>
+#include <QSet>
 #include <MltTractor.h>
 #include <MltPlaylist.h>
 
@@ -164,6 +166,30 @@ public:
     int selectMultitrack();//选中 Multitrack
     int getClipOfPosition(int nIndexOfTrack, int nFramePostion);//获取轨道 上 nFramePostion 位置的 clip 索引
 
+    // 以下查询都基于片段缓存，在每条轨道上二分查找
+    int clipCount(int trackIndex) const;
+    int clipIndexAt(int trackIndex, int position) const;    //与 Mlt::Playlist::get_clip_index_at 相同，超出轨道末尾时返回 clip 数
+    bool isBlankClip(int trackIndex, int clipIndex) const;
+    int previousEdit(int position) const;   //所有轨道上位于 position 之前最近的编辑点，没有时返回 -1
+    int nextEdit(int position) const;       //所有轨道上位于 position 之后最近的编辑点，没有时返回 -1
+    //所有轨道上与 position 距离在 pixels 像素以内最近的编辑点，不包括 excludeTrack 上 excludeClip 自己的边缘，没有时返回 -1
+    Q_INVOKABLE int snapPosition(int position, double pixels, int excludeTrack = -1, int excludeClip = -1) const;
+    //把标记为使用代理的片段换成代理文件，hash 为空时处理所有片段，返回替换的片段数
+    int useProxies(const QString& hash = QString());
+    //打开工程后还没有真正打开文件的素材（avformat-novalidate），每个 producer一个，由调用者释放
+    QList<Mlt::Producer*> lazyProducers() const;
+    //把 original的所有片段换成在后台打开好的 opened，只影响播放，不记录撤销，返回替换的片段数
+    int replaceProducer(Mlt::Producer& original, Mlt::Producer& opened);
+    //service（clip的 producer或挂在 clip上的滤镜）被修改后只刷新用到它的 clip所在的区间，
+    //找不到时（轨道、时间线滤镜或播放器显示的不是时间线）刷新全部
+    void refreshService(Mlt::Service* service);
+
+    // 批量编辑：beginBatch() 与 endBatch() 之间的编辑不立即合并空白、发出 modified() 和刷新 consumer，
+    // 而是在最外层 endBatch() 时对涉及的轨道统一处理一次。批量中的 clip 下标是合并空白之前的下标
+    void beginBatch();
+    void endBatch();
+    bool isBatching() const { return m_batchDepth > 0; }
+
 signals:
     void created();
     void loaded();
@@ -177,6 +203,10 @@ signals:
     void producerChanged(Mlt::Producer*);
     void reloadRequested();
     void selectionChanged(TIMELINE_SELECTION selectionOld, TIMELINE_SELECTION selectionNew);
+    // 编辑命令要求时间线切换当前轨道，命令本身不依赖时间线界面
+    void currentTrackRequested(int trackIndex);
+    // 剪辑时长无法读取，拒绝添加
+    void invalidClipRejected();
 
 public slots:
     void refreshTrackList();    //刷新轨道列表
@@ -198,6 +228,8 @@ public slots:
     int appendClip(int trackIndex, Mlt::Producer &clip);//拓展clip
     void removeClip(int trackIndex, int clipIndex);//移除clip
     void liftClip(int trackIndex, int clipIndex);//选中高亮显示clip
+    void removeClips(int trackIndex, const QList<int>& clipIndexes);//批量移除同一轨道上的多个clip
+    void liftClips(int trackIndex, const QList<int>& clipIndexes);//批量把同一轨道上的多个clip替换为空白
     void splitClip(int trackIndex, int clipIndex, int position);//切分clip
     void joinClips(int trackIndex, int clipIndex);//连接合并clip
     void appendFromPlaylist(Mlt::Playlist* playlist, int trackIndex);
@@ -205,6 +237,7 @@ public slots:
     void AttachedfilterChanged(int trackIndex, int clipIndex);//已选滤镜发生变化
     void fadeIn(int trackIndex, int clipIndex, int duration);//淡入
     void fadeOut(int trackIndex, int clipIndex, int duration);//淡出
+    void setLoudnessGain(int trackIndex, int clipIndex, double gainDb, double targetLufs);//设置响度标准化的增益
     bool addTransitionValid(int fromTrack, int toTrack, int clipIndex, int position);
     int addTransition(int trackIndex, int clipIndex, int position);//增加转场
     void removeTransition(int trackIndex, int clipIndex);//删除转场
@@ -233,8 +266,47 @@ public slots:
     int refreshClipFromXmlForFilter(int trackIndex, int clipIndex, QString strXml);
 
     void debugPrintState();
+    // 检查片段缓存表是否与 MLT 一致，不一致的地方打印警告
+    bool checkClipTable() const;
 
 private:
+    // data() 使用的片段缓存，每条轨道一个数组，下标与 playlist 中的 clip 一一对应
+    struct ClipRecord {
+        QString name;
+        QString resource;
+        QString service;
+        QString thumbnail;
+        bool isBlank;
+        bool isTransition;
+        bool isAnimSticker;
+        bool hasFilter;
+        int start;
+        int duration;
+        int in;
+        int out;
+        int fadeIn;
+        int fadeOut;
+        double fps;
+        double speed;
+    };
+
+    struct ClipTable {
+        ClipTable() : valid(false) {}
+        bool valid;     // false 表示需要从 MLT 重新生成
+        QVector<ClipRecord> clips;
+    };
+
+    Mlt::Playlist* trackPlaylist(int trackIndex) const;
+    ClipRecord makeClipRecord(Mlt::Playlist& playlist, int clipIndex) const;
+    const ClipTable* clipTable(int trackIndex) const;
+    const ClipRecord* clipRecord(int trackIndex, int clipIndex) const;
+    static int clipAtOrBefore(const ClipTable& table, int position);
+    static int trackEnd(const ClipTable& table);
+    ClipTable* builtClipTable(int trackIndex) const;
+    void rebuildClipTable(int trackIndex) const;
+    void invalidateClipTable() const;
+    static void updateClipStarts(ClipTable& table);
+
     Mlt::Tractor* m_tractor;
     TrackList m_trackList;
     bool m_isMakingTransition;
@@ -274,8 +346,27 @@ private:
 
     QString getClipCaption(Mlt::Producer &producerClip) const;
 
+    mutable QVector<ClipTable> m_clipTable;
+
+    void notifyModified();
+    void refreshConsumer();
+    void refreshRange(int in, int out);     // out为 -1表示到时间线结尾
+    int editStart(int trackIndex, int clipIndex);
+    int editEnd(int trackIndex, int clipIndex);
+    int m_batchDepth;
+    QSet<int> m_batchTracks;    // 批量中需要合并空白的轨道
+    bool m_batchModified;
+    bool m_batchRefresh;
+    int m_batchRefreshIn;       // 批量中需要刷新的区间
+    int m_batchRefreshOut;
+
 private slots:
     void adjustBackgroundDuration();
+    void getDeferredAudioLevels();
+    void onRowsInserted(const QModelIndex& parent, int first, int last);
+    void onRowsRemoved(const QModelIndex& parent, int first, int last);
+    void onDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles);
+    void onLayoutReset();
 
 };
 
@@ -24,11 +24,11 @@ MeltedPlaylistModel::MeltedPlaylistModel(QObject *parent)
     : QAbstractTableModel(parent)
     , m_unit(255)
     , m_list(0)
-    , m_response(0)
     , m_index(-1)
     , m_dropRow(-1)
-    , m_tokeniser(0)
 {
+    connect(&m_client, SIGNAL(responseReceived(int,int,int,QStringList)),
+            this, SLOT(onResponse(int,int,int,QStringList)));
     //XXX qt5
 //    setSupportedDragActions(Qt::MoveAction);
 }
@@ -37,8 +37,6 @@ MeltedPlaylistModel::~MeltedPlaylistModel()
 {
     mvcp_list_close(m_list);
     m_list = 0;
-    mvcp_response_close(m_response);
-    m_response = 0;
 }
 
 int MeltedPlaylistModel::rowCount(const QModelIndex &parent) const
@@ -189,144 +187,123 @@ bool MeltedPlaylistModel::dropMimeData(const QMimeData *data, Qt::DropAction act
 
 void MeltedPlaylistModel::gotoClip(int index)
 {
-    m_commands << MVCP_GOTO;
-    m_socket.write(QString("GOTO U%1 0 %2\r\n").arg(m_unit).arg(index).toLatin1());
+    send(QString("GOTO U%1 0 %2").arg(m_unit).arg(index), MVCP_GOTO);
     onClipIndexChanged(m_unit, index);
 }
 
 void MeltedPlaylistModel::append(const QString &clip, int in, int out, bool notify)
 {
-    m_commands.append(notify? MVCP_APND : MVCP_IGNORE);
-    m_socket.write(QString("APND U%1 \"%2\" %3 %4\r\n").arg(m_unit).arg(clip).arg(in).arg(out).toUtf8());
+    send(QString("APND U%1 \"%2\" %3 %4").arg(m_unit).arg(clip).arg(in).arg(out), notify? MVCP_APND : MVCP_IGNORE);
+}
+
+void MeltedPlaylistModel::append(const QStringList &clips, bool notify)
+{
+    for (int i = 0; i < clips.size(); i++) {
+        bool last = (i == clips.size() - 1);
+        send(QString("APND U%1 \"%2\" -1 -1").arg(m_unit).arg(clips.at(i)),
+             (notify && last)? MVCP_APND : MVCP_IGNORE);
+    }
 }
 
 void MeltedPlaylistModel::remove(int row, bool notify)
 {
-    m_commands.append(notify? MVCP_REMOVE : MVCP_IGNORE);
-    m_socket.write(QString("REMOVE U%1 %2\r\n").arg(m_unit).arg(row).toLatin1());
+    send(QString("REMOVE U%1 %2").arg(m_unit).arg(row), notify? MVCP_REMOVE : MVCP_IGNORE);
 }
 
 void MeltedPlaylistModel::insert(const QString &clip, int row, int in, int out, bool notify)
 {
-    m_commands.append(notify? MVCP_INSERT : MVCP_IGNORE);
-    m_socket.write(QString("INSERT U%1 \"%2\" %3 %4 %5\r\n").arg(m_unit).arg(clip).arg(row).arg(in).arg(out).toUtf8());
+    send(QString("INSERT U%1 \"%2\" %3 %4 %5").arg(m_unit).arg(clip).arg(row).arg(in).arg(out), notify? MVCP_INSERT : MVCP_IGNORE);
 }
 
 void MeltedPlaylistModel::move(int from, int to, bool notify)
 {
-    m_commands.append(notify? MVCP_MOVE : MVCP_IGNORE);
-    m_socket.write(QString("MOVE U%1 %2 %3\r\n").arg(m_unit).arg(from).arg(to).toLatin1());
+    send(QString("MOVE U%1 %2 %3").arg(m_unit).arg(from).arg(to), notify? MVCP_MOVE : MVCP_IGNORE);
 }
 
 void MeltedPlaylistModel::wipe()
 {
-    m_commands << MVCP_IGNORE;
-    m_socket.write(QString("WIPE U%1\r\n").arg(m_unit).toLatin1());
+    send(QString("WIPE U%1").arg(m_unit));
 }
 
 void MeltedPlaylistModel::clean()
 {
-    m_commands << MVCP_IGNORE;
-    m_socket.write(QString("CLEAN U%1\r\n").arg(m_unit).toLatin1());
+    send(QString("CLEAN U%1").arg(m_unit));
 }
 
 void MeltedPlaylistModel::clear()
 {
-    m_commands << MVCP_IGNORE;
-    m_socket.write(QString("CLEAR U%1\r\n").arg(m_unit).toLatin1());
+    send(QString("CLEAR U%1").arg(m_unit));
 }
 
 void MeltedPlaylistModel::play(double speed)
 {
-    m_commands << MVCP_IGNORE;
-    m_socket.write(QString("PLAY U%1 %2\r\n").arg(m_unit).arg(1000 * speed).toLatin1());
+    send(QString("PLAY U%1 %2").arg(m_unit).arg(1000 * speed));
 }
 
 void MeltedPlaylistModel::pause()
 {
-    m_commands << MVCP_IGNORE;
-    m_socket.write(QString("PAUSE U%1\r\n").arg(m_unit).toLatin1());
+    send(QString("PAUSE U%1").arg(m_unit));
 }
 
 void MeltedPlaylistModel::stop()
 {
-    m_commands << MVCP_IGNORE;
-    m_socket.write(QString("STOP U%1\r\n").arg(m_unit).toLatin1());
+    send(QString("STOP U%1").arg(m_unit));
 }
 
 void MeltedPlaylistModel::seek(int position)
 {
     pause();
-    m_commands << MVCP_IGNORE;
-    m_socket.write(QString("GOTO U%1 %2\r\n").arg(m_unit).arg(position).toLatin1());
+    send(QString("GOTO U%1 %2").arg(m_unit).arg(position));
 }
 
 void MeltedPlaylistModel::rewind()
 {
-    m_commands << MVCP_IGNORE;
-    m_socket.write(QString("REW U%1\r\n").arg(m_unit).toLatin1());
+    send(QString("REW U%1").arg(m_unit));
 }
 
 void MeltedPlaylistModel::fastForward()
 {
-    m_commands << MVCP_IGNORE;
-    m_socket.write(QString("FF U%1\r\n").arg(m_unit).toLatin1());
+    send(QString("FF U%1").arg(m_unit));
 }
 
 void MeltedPlaylistModel::previous()
 {
-    m_commands << MVCP_IGNORE;
-    m_socket.write(QString("GOTO U%1 0 -1\r\n").arg(m_unit).toLatin1());
+    send(QString("GOTO U%1 0 -1").arg(m_unit));
 }
 
 void MeltedPlaylistModel::next()
 {
-    m_commands << MVCP_IGNORE;
-    m_socket.write(QString("GOTO U%1 0 +1\r\n").arg(m_unit).toLatin1());
+    send(QString("GOTO U%1 0 +1").arg(m_unit));
 }
 
 void MeltedPlaylistModel::setIn(int in)
 {
-    m_commands << MVCP_IGNORE;
-    m_socket.write(QString("SIN U%1 %2\r\n").arg(m_unit).arg(in).toLatin1());
+    send(QString("SIN U%1 %2").arg(m_unit).arg(in));
 }
 
 void MeltedPlaylistModel::setOut(int out)
 {
-    m_commands << MVCP_IGNORE;
-    m_socket.write(QString("SOUT U%1 %2\r\n").arg(m_unit).arg(out).toLatin1());
+    send(QString("SOUT U%1 %2").arg(m_unit).arg(out));
 }
 
 void MeltedPlaylistModel::onConnected(const QString &address, quint16 port, quint8 unit)
 {
-    connect(&m_socket, SIGNAL(readyRead()), this, SLOT(readResponse()));
     m_unit = unit;
-    m_commands << MVCP_IGNORE;
-    m_response = mvcp_response_init();
-    m_tokeniser = mvcp_tokeniser_init();
-    m_socket.connectToHost(address, port);
+    m_client.connectToHost(address, port);
 }
 
 void MeltedPlaylistModel::onDisconnected()
 {
-    m_socket.disconnect(this);
-    m_socket.disconnectFromHost();
+    m_client.disconnectFromHost();
     beginResetModel();
     mvcp_list_close(m_list);
     m_list = 0;
-    mvcp_response_close(m_response);
-    m_response = 0;
-    if (m_tokeniser) {
-        mvcp_tokeniser_close(m_tokeniser);
-        m_tokeniser = 0;
-    }
     endResetModel();
 }
 
 void MeltedPlaylistModel::refresh()
 {
-    m_commands << MVCP_LIST;
-    m_socket.write(QString("LIST U%1\r\n").arg(m_unit).toLatin1());
+    send(QString("LIST U%1").arg(m_unit), MVCP_LIST);
 }
 
 void MeltedPlaylistModel::onUnitChanged(quint8 unit)
@@ -355,67 +332,40 @@ void MeltedPlaylistModel::onGenerationChanged(quint8 unit)
         onUnitChanged(m_unit);
 }
 
-void MeltedPlaylistModel::readResponse()
-{
-    QByteArray data = m_socket.readAll();
-    if (data.size() > 0 && m_tokeniser) {
-        m_data.append(data);
-        if (!m_data.contains('\n'))
-            return;
-        // There can be multiple responses in the same data block, so we use a
-        // tokeniser feeding into the mvcp_response.
-        mvcp_tokeniser_parse_new(m_tokeniser, const_cast<char*>(m_data.constData()), "\n");
-        m_data.clear();
-
-        for (int i = 0; i < mvcp_tokeniser_count(m_tokeniser); i++) {
-            char* line = mvcp_tokeniser_get_string(m_tokeniser, i);
-            // mvcp_response_write() looks for line feeds
-            if (line[strlen(line) - 1] == '\r')
-                line[strlen(line) - 1] = '\n';
-            mvcp_response_write(m_response, line, strlen(line));
-            int last_line = mvcp_response_count(m_response) - 1;
-            if (last_line < 0)
-                continue;
-            int terminated = 0;
-            int status = mvcp_response_get_error_code(m_response);
-            switch(status) {
-            case 201:
-            case 500:
-                terminated = !strcmp(mvcp_response_get_line(m_response, last_line), "");
-                break;
-            case 202:
-                terminated = last_line >= 1;
-                break;
-            default:
-                terminated = 1;
-                break;
-            }
-            if (terminated) {
-                int command = m_commands.isEmpty()? MVCP_IGNORE : m_commands.takeFirst();
-                switch (command) {
-                case MVCP_LIST: {
-                    m_list = (mvcp_list) calloc(1, sizeof(*m_list));
-                    m_list->response = mvcp_response_clone(m_response);
-                    if (mvcp_response_count(m_response ) >= 2)
-                        m_list->generation = atoi(mvcp_response_get_line(m_response, 1));
-                    beginInsertRows(QModelIndex(), 0, mvcp_list_count(m_list) - 1);
-                    endInsertRows();
-                    emit loaded();
-                    break;
-                }
-                case MVCP_APND:
-                case MVCP_REMOVE:
-                case MVCP_INSERT:
-                case MVCP_MOVE:
-                    if (status == 200)
-                        emit success();
-                    break;
-                default:
-                    break;
-                }
-                mvcp_response_close(m_response);
-                m_response = mvcp_response_init();
-            }
+void MeltedPlaylistModel::send(const QString &command, int tag)
+{
+    m_client.send(command, tag);
+}
+
+void MeltedPlaylistModel::onResponse(int id, int command, int code, const QStringList &lines)
+{
+    Q_UNUSED(id)
+    switch (command) {
+    case MVCP_LIST: {
+        // mvcp_list keeps the raw response and parses entries on demand.
+        mvcp_response response = mvcp_response_init();
+        foreach (const QString& line, lines) {
+            QByteArray data = line.toUtf8() + '\n';
+            mvcp_response_write(response, data.constData(), data.size());
         }
+        beginResetModel();
+        mvcp_list_close(m_list);
+        m_list = (mvcp_list) calloc(1, sizeof(*m_list));
+        m_list->response = response;
+        if (lines.size() >= 2)
+            m_list->generation = lines.at(1).toInt();
+        endResetModel();
+        emit loaded();
+        break;
+    }
+    case MVCP_APND:
+    case MVCP_REMOVE:
+    case MVCP_INSERT:
+    case MVCP_MOVE:
+        if (code == 200)
+            emit success();
+        break;
+    default:
+        break;
     }
 }
@@ -20,11 +20,10 @@
 #define MELTEDPLAYLISTMODEL_H
 
 #include <QAbstractTableModel>
-#include <QTcpSocket>
 #include <QStringList>
 #include <QMimeData>
 #include <mvcp.h>
-#include <mvcp_tokeniser.h>
+#include "mvcpclient.h"
 
 class MeltedPlaylistModel : public QAbstractTableModel
 {
@@ -65,6 +64,8 @@ public:
 
     void gotoClip(int);
     void append(const QString& clip, int in = -1, int out = -1, bool notify = true);
+    // Pipelines one APND per clip; success() is emitted once for the batch.
+    void append(const QStringList& clips, bool notify = true);
     void remove(int row, bool notify = true);
     void insert(const QString& clip, int row, int in = -1, int out = -1, bool notify = true);
     void move(int from, int to, bool notify = true);
@@ -97,19 +98,16 @@ public slots:
     void onGenerationChanged(quint8 unit);
 
 private slots:
-    void readResponse();
-//    void onSocketError(QAbstractSocket::SocketError socketError);
+    void onResponse(int id, int command, int code, const QStringList& lines);
 
 private:
-    QTcpSocket m_socket;
+    void send(const QString& command, int tag = MVCP_IGNORE);
+
+    MvcpClient m_client;
     quint8 m_unit;
     mvcp_list m_list;
-    mvcp_response m_response;
     int m_index;
-    QList<int> m_commands;
     int m_dropRow;
-    QByteArray m_data;
-    mvcp_tokeniser m_tokeniser;
 };
 
 #endif // MELTEDPLAYLISTMODEL_H
@@ -18,15 +18,14 @@
 
 #include "meltedunitsmodel.h"
 #include <QTimer>
-#include <mvcp_util.h>
 #include <Logger.h>
 
 MeltedUnitsModel::MeltedUnitsModel(QObject *parent)
     : QAbstractTableModel(parent)
     , m_mvcp(0)
-    , m_tokeniser(0)
     , m_statusSent(false)
 {
+    connect(&m_client, SIGNAL(statusReceived(QByteArray)), this, SLOT(onStatus(QByteArray)));
 }
 
 MeltedUnitsModel::~MeltedUnitsModel()
@@ -81,21 +80,14 @@ void MeltedUnitsModel::onConnected(MvcpThread *a_mvcp)
 
 void MeltedUnitsModel::onConnected(const QString &address, quint16 port, quint8 /*unit*/)
 {
-    m_tokeniser = mvcp_tokeniser_init();
     m_statusSent = false;
-    connect(&m_socket, SIGNAL(readyRead()), this, SLOT(readResponse()));
-    m_socket.connectToHost(address, port);
+    m_client.connectToHost(address, port);
 }
 
 void MeltedUnitsModel::onDisconnected()
 {
-    m_socket.disconnect(this);
-    m_socket.disconnectFromHost();
+    m_client.disconnectFromHost();
     m_mvcp = 0;
-    if (m_tokeniser) {
-        mvcp_tokeniser_close(m_tokeniser);
-        m_tokeniser = 0;
-    }
     if (rowCount() > 0) {
         emit beginRemoveRows(QModelIndex(), 0, rowCount() - 1);
         foreach (QObject* o, m_units)
@@ -120,55 +112,37 @@ QString MeltedUnitsModel::decodeStatus(unit_status status)
     return QString();
 }
 
-void MeltedUnitsModel::readResponse()
+// The STATUS subscription pushes a line whenever a unit changes.
+void MeltedUnitsModel::onStatus(const QByteArray &data)
 {
-    QByteArray data = m_socket.readAll();
-    if (data.size() > 0 && m_tokeniser)
-    {
-        mvcp_status_t status;
-        m_data.append(data);
-        if (m_data.contains('\n')) {
-            mvcp_tokeniser_parse_new(m_tokeniser, const_cast<char*>(m_data.constData()), "\n");
-            m_data.clear();
-            for (int i = 0; i < mvcp_tokeniser_count(m_tokeniser); i++) {
-                char* line = mvcp_tokeniser_get_string(m_tokeniser, i);
-                if (!line || strlen(line) <= 1 || !strcmp(line, "100 VTR Ready\r"))
-                    continue;
-                if (line[strlen(line) - 1] == '\r') {
-                    mvcp_util_chomp(line);
-                    mvcp_status_parse(&status, line);
-                    if (status.status != unit_unknown && status.unit < m_units.size()) {
-                        // Refresh the status table cell if changed
-                        if (!m_units[status.unit]->property("unit_status").isValid() ||
-                                m_units[status.unit]->property("unit_status").toInt() != status.status) {
-                            m_units[status.unit]->setProperty("unit_status", status.status);
-                            m_units[status.unit]->setProperty("status", decodeStatus(status.status));
-                            emit dataChanged(createIndex(status.unit, 1), createIndex(status.unit, 1));
-                        }
-                        // Inform others like the MeltedPlaylistModel when the currently playing clip has changed.
-                        if (!m_units[status.unit]->property("clip_index").isValid() ||
-                                m_units[status.unit]->property("clip_index").toInt() != status.clip_index) {
-                            m_units[status.unit]->setProperty("clip_index", status.clip_index);
-                            emit clipIndexChanged(status.unit, status.clip_index);
-                        }
-                        // Inform others like the MeltedPlaylistModel when the playlist has changed.
-                        if (!m_units[status.unit]->property("generation").isValid() ||
-                                m_units[status.unit]->property("generation").toInt() != status.generation) {
-                            m_units[status.unit]->setProperty("generation", status.generation);
-                            emit generationChanged(status.unit);
-                        }
-                        emit positionUpdated(status.unit, status.position, status.fps,
-                            status.in, status.out, status.length, status.status == unit_playing);
-                    }
-                    else if (status.status != unit_unknown && status.unit >= m_units.size()) {
-                        m_mvcp->uls();
-                    }
-                }
-                else {
-                    m_data.append(line, strlen(line));
-                }
-            }
+    QByteArray line = data;
+    mvcp_status_t status;
+    mvcp_status_parse(&status, line.data());
+    if (status.status != unit_unknown && status.unit < m_units.size()) {
+        // Refresh the status table cell if changed
+        if (!m_units[status.unit]->property("unit_status").isValid() ||
+                m_units[status.unit]->property("unit_status").toInt() != status.status) {
+            m_units[status.unit]->setProperty("unit_status", status.status);
+            m_units[status.unit]->setProperty("status", decodeStatus(status.status));
+            emit dataChanged(createIndex(status.unit, 1), createIndex(status.unit, 1));
+        }
+        // Inform others like the MeltedPlaylistModel when the currently playing clip has changed.
+        if (!m_units[status.unit]->property("clip_index").isValid() ||
+                m_units[status.unit]->property("clip_index").toInt() != status.clip_index) {
+            m_units[status.unit]->setProperty("clip_index", status.clip_index);
+            emit clipIndexChanged(status.unit, status.clip_index);
         }
+        // Inform others like the MeltedPlaylistModel when the playlist has changed.
+        if (!m_units[status.unit]->property("generation").isValid() ||
+                m_units[status.unit]->property("generation").toInt() != status.generation) {
+            m_units[status.unit]->setProperty("generation", status.generation);
+            emit generationChanged(status.unit);
+        }
+        emit positionUpdated(status.unit, status.position, status.fps,
+            status.in, status.out, status.length, status.status == unit_playing);
+    }
+    else if (status.status != unit_unknown && status.unit >= m_units.size()) {
+        m_mvcp->uls();
     }
 }
 
@@ -184,7 +158,7 @@ void MeltedUnitsModel::onUlsResult(QStringList units)
         emit dataChanged(createIndex(i, 0), createIndex(i, 0));
     }
     if (!m_statusSent) {
-        m_socket.write(QString("STATUS\r\n").toLatin1());
+        m_client.subscribeStatus();
         m_statusSent = true;
     }
 }
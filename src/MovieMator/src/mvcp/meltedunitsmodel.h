@@ -20,9 +20,8 @@
 #define MELTEDUNITSMODEL_H
 
 #include <QAbstractTableModel>
-#include <QTcpSocket>
 #include "mvcpthread.h"
-#include <mvcp_tokeniser.h>
+#include "mvcpclient.h"
 
 class QTimer;
 
@@ -50,14 +49,12 @@ public slots:
     void onDisconnected();
 
 private slots:
-    void readResponse();
+    void onStatus(const QByteArray& line);
 
 private:
     MvcpThread* m_mvcp;
-    QTcpSocket m_socket;
+    MvcpClient m_client;
     QObjectList m_units;
-    mvcp_tokeniser m_tokeniser;
-    QByteArray m_data;
     bool m_statusSent;
 
     QString decodeStatus(unit_status status);
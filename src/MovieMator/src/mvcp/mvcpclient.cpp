@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mvcpclient.h"
+#include <QMetaObject>
+#include <Logger.h>
+
+MvcpClient::MvcpClient(QObject *parent)
+    : QObject(parent)
+    , m_code(-1)
+    , m_nextId(1)
+    , m_window(64)
+    , m_flushScheduled(false)
+    , m_subscribing(false)
+    , m_statusMode(false)
+    , m_latencyTotal(0)
+    , m_latencyCount(0)
+{
+    m_socket.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    connect(&m_socket, SIGNAL(connected()), this, SLOT(onConnected()));
+    connect(&m_socket, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
+    connect(&m_socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+}
+
+MvcpClient::~MvcpClient()
+{
+    m_socket.disconnect(this);
+    m_socket.abort();
+}
+
+void MvcpClient::connectToHost(const QString &address, quint16 port)
+{
+    reset();
+    // The server greets every new connection with "100 VTR Ready".
+    Command greeting;
+    greeting.id = 0;
+    greeting.tag = 0;
+    greeting.status = false;
+    greeting.timer.start();
+    m_inFlight.enqueue(greeting);
+    m_socket.connectToHost(address, port);
+}
+
+void MvcpClient::disconnectFromHost()
+{
+    m_socket.disconnectFromHost();
+    reset();
+}
+
+bool MvcpClient::isConnected() const
+{
+    return m_socket.state() == QAbstractSocket::ConnectedState;
+}
+
+int MvcpClient::send(const QString &command, int tag)
+{
+    Command c;
+    c.id = m_nextId++;
+    c.tag = tag;
+    c.data = command.toUtf8() + "\r\n";
+    c.status = false;
+    m_pending.enqueue(c);
+    scheduleFlush();
+    return c.id;
+}
+
+int MvcpClient::subscribeStatus()
+{
+    int id = send("STATUS");
+    m_pending.last().status = true;
+    return id;
+}
+
+void MvcpClient::setWindow(int commands)
+{
+    m_window = qMax(commands, 1);
+    scheduleFlush();
+}
+
+double MvcpClient::averageLatency() const
+{
+    return m_latencyCount? double(m_latencyTotal) / m_latencyCount : 0.0;
+}
+
+void MvcpClient::clearStats()
+{
+    m_latencyTotal = 0;
+    m_latencyCount = 0;
+}
+
+void MvcpClient::scheduleFlush()
+{
+    if (!m_flushScheduled) {
+        m_flushScheduled = true;
+        QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+    }
+}
+
+void MvcpClient::flush()
+{
+    m_flushScheduled = false;
+    if (!isConnected())
+        return;
+    QByteArray data;
+    while (!m_pending.isEmpty()) {
+        if (m_statusMode) {
+            // Nothing is answered in status mode except by the status stream.
+            data.append(m_pending.dequeue().data);
+            continue;
+        }
+        if (m_subscribing)
+            break;
+        if (m_pending.head().status) {
+            // Responses still in flight would otherwise be read as status
+            // lines, so STATUS waits until they have all come back.
+            if (!m_inFlight.isEmpty())
+                break;
+            m_subscribing = true;
+        } else if (m_inFlight.size() >= m_window) {
+            break;
+        }
+        Command c = m_pending.dequeue();
+        data.append(c.data);
+        c.data.clear();
+        c.timer.start();
+        m_inFlight.enqueue(c);
+    }
+    if (!data.isEmpty())
+        m_socket.write(data);
+}
+
+void MvcpClient::onConnected()
+{
+    emit connected();
+    flush();
+}
+
+void MvcpClient::onDisconnected()
+{
+    reset();
+    emit disconnected();
+}
+
+void MvcpClient::onReadyRead()
+{
+    // Bytes kept from the previous read hold no line end, so only the new
+    // data needs to be searched for the first one.
+    int start = 0;
+    int end = m_buffer.size();
+    m_buffer.append(m_socket.readAll());
+    end = m_buffer.indexOf('\n', end);
+    while (end >= 0) {
+        QByteArray line = m_buffer.mid(start, end - start);
+        if (line.endsWith('\r'))
+            line.chop(1);
+        parseLine(line);
+        start = end + 1;
+        end = m_buffer.indexOf('\n', start);
+    }
+    m_buffer.remove(0, start);
+}
+
+void MvcpClient::parseLine(const QByteArray &line)
+{
+    if (m_statusMode) {
+        if (!line.isEmpty())
+            emit statusReceived(line);
+        return;
+    }
+    if (m_code < 0) {
+        m_code = line.left(3).toInt();
+        m_lines.clear();
+        m_lines << QString::fromUtf8(line);
+        // 201 and 500 are followed by lines up to an empty one, 202 by one line.
+        if (m_code != 201 && m_code != 202 && m_code != 500)
+            finishResponse();
+        return;
+    }
+    m_lines << QString::fromUtf8(line);
+    if ((m_code == 202 && m_lines.size() >= 2) || (m_code != 202 && line.isEmpty()))
+        finishResponse();
+}
+
+void MvcpClient::finishResponse()
+{
+    int code = m_code;
+    m_code = -1;
+    if (m_inFlight.isEmpty()) {
+        LOG_WARNING() << "unexpected MVCP response" << m_lines;
+        return;
+    }
+    Command c = m_inFlight.dequeue();
+    m_latencyTotal += c.timer.elapsed();
+    m_latencyCount++;
+    if (c.status) {
+        m_subscribing = false;
+        m_statusMode = (code == 200);
+    }
+    emit responseReceived(c.id, c.tag, code, m_lines);
+    if (!m_pending.isEmpty())
+        scheduleFlush();
+}
+
+void MvcpClient::reset()
+{
+    m_pending.clear();
+    m_inFlight.clear();
+    m_buffer.clear();
+    m_lines.clear();
+    m_code = -1;
+    m_subscribing = false;
+    m_statusMode = false;
+}
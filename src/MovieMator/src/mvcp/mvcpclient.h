@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MVCPCLIENT_H
+#define MVCPCLIENT_H
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QQueue>
+#include <QElapsedTimer>
+#include <QStringList>
+
+/*!
+  \class MvcpClient
+  \brief Asynchronous, pipelined MVCP connection.
+
+  Commands are queued and written without waiting for the previous
+  response; all commands queued during one pass of the event loop go out in
+  a single write, so a batch of APND or INSERT costs one round trip instead
+  of one per clip. At most window() commands are in flight at a time.
+
+  Responses are parsed incrementally as data arrives: only newly received
+  bytes are searched for line ends and each response is matched to the
+  oldest command in flight, in the order the server answers them.
+
+  subscribeStatus() queues STATUS behind the commands already sent and
+  holds it until all of their responses are in; once the server accepts it
+  the connection carries the unit status stream and every line is delivered
+  through statusReceived().
+*/
+
+class MvcpClient : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MvcpClient(QObject *parent = 0);
+    ~MvcpClient();
+
+    void connectToHost(const QString& address, quint16 port);
+    void disconnectFromHost();
+    bool isConnected() const;
+
+    // Returns an id for the command, echoed back in responseReceived().
+    // tag is any value the caller wants to get back with the response.
+    int send(const QString& command, int tag = 0);
+    int subscribeStatus();
+
+    int window() const { return m_window; }
+    void setWindow(int commands);
+    int pendingCount() const { return m_pending.size() + m_inFlight.size(); }
+
+    // Round trip statistics for responses received since clearStats().
+    int responseCount() const { return m_latencyCount; }
+    double averageLatency() const;  // milliseconds
+    void clearStats();
+
+signals:
+    void connected();
+    void disconnected();
+    void responseReceived(int id, int tag, int code, const QStringList& lines);
+    void statusReceived(const QByteArray& line);
+
+private slots:
+    void flush();
+    void onConnected();
+    void onDisconnected();
+    void onReadyRead();
+
+private:
+    struct Command {
+        int id;
+        int tag;
+        QByteArray data;
+        bool status;
+        QElapsedTimer timer;
+    };
+
+    void scheduleFlush();
+    void parseLine(const QByteArray& line);
+    void finishResponse();
+    void reset();
+
+    QTcpSocket m_socket;
+    QQueue<Command> m_pending;
+    QQueue<Command> m_inFlight;
+    QByteArray m_buffer;
+    int m_code;
+    QStringList m_lines;
+    int m_nextId;
+    int m_window;
+    bool m_flushScheduled;
+    bool m_subscribing;
+    bool m_statusMode;
+    qint64 m_latencyTotal;
+    int m_latencyCount;
+};
+
+#endif // MVCPCLIENT_H
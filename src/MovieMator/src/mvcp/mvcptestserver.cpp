@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mvcptestserver.h"
+#include <QTcpSocket>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QTimer>
+
+MvcpTestServer::MvcpTestServer(int units, QObject *parent)
+    : QTcpServer(parent)
+    , m_latency(0)
+    , m_commandCount(0)
+{
+    for (int i = 0; i < qMax(units, 1); i++) {
+        Unit u;
+        u.status = "not_loaded";
+        u.clipIndex = 0;
+        u.position = 0;
+        u.generation = 0;
+        m_units << u;
+    }
+    connect(this, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+}
+
+QStringList MvcpTestServer::playlist(int unit) const
+{
+    QStringList result;
+    if (unit >= 0 && unit < m_units.size()) {
+        foreach (const Clip& clip, m_units[unit].clips)
+            result << clip.resource;
+    }
+    return result;
+}
+
+void MvcpTestServer::onNewConnection()
+{
+    while (QTcpSocket* socket = nextPendingConnection()) {
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        connect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+        connect(socket, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
+        m_buffers.insert(socket, QByteArray());
+        reply(socket, "100 VTR Ready\r\n");
+    }
+}
+
+void MvcpTestServer::onDisconnected()
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    m_buffers.remove(socket);
+    m_subscribers.removeAll(socket);
+    socket->deleteLater();
+}
+
+void MvcpTestServer::onReadyRead()
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    QByteArray& buffer = m_buffers[socket];
+    buffer.append(socket->readAll());
+    QByteArray response;
+    int start = 0;
+    int end = buffer.indexOf('\n');
+    while (end >= 0) {
+        QString line = QString::fromUtf8(buffer.mid(start, end - start)).trimmed();
+        if (!line.isEmpty())
+            response.append(execute(line, socket));
+        start = end + 1;
+        end = buffer.indexOf('\n', start);
+    }
+    buffer.remove(0, start);
+    if (!response.isEmpty())
+        reply(socket, response);
+}
+
+void MvcpTestServer::reply(QTcpSocket *socket, const QByteArray &data)
+{
+    if (m_latency <= 0) {
+        socket->write(data);
+        return;
+    }
+    // Equal delays keep the responses in order.
+    QPointer<QTcpSocket> guard(socket);
+    QTimer::singleShot(m_latency, this, [guard, data]() {
+        if (guard)
+            guard->write(data);
+    });
+}
+
+MvcpTestServer::Unit* MvcpTestServer::unit(const QString &token)
+{
+    if (!token.startsWith('U', Qt::CaseInsensitive))
+        return 0;
+    bool ok = false;
+    int i = token.mid(1).toInt(&ok);
+    return (ok && i >= 0 && i < m_units.size())? &m_units[i] : 0;
+}
+
+QByteArray MvcpTestServer::statusLine(int i) const
+{
+    const Unit& u = m_units[i];
+    QString clip = (u.clipIndex < u.clips.size())? u.clips[u.clipIndex].resource : QString();
+    int in = (u.clipIndex < u.clips.size())? u.clips[u.clipIndex].in : 0;
+    int out = (u.clipIndex < u.clips.size())? u.clips[u.clipIndex].out : 0;
+    return QString("%1 %2 \"%3\" %4 %5 %6 %7 %8 %9 \"%3\" %4 %7 %8 %9 1 %10 %11\r\n")
+            .arg(i).arg(u.status).arg(clip).arg(u.position)
+            .arg(u.status == "playing"? 1000 : 0).arg(25.0)
+            .arg(in).arg(out).arg(out - in + 1)
+            .arg(u.generation).arg(u.clipIndex).toUtf8();
+}
+
+void MvcpTestServer::broadcastStatus(int i)
+{
+    QByteArray line = statusLine(i);
+    foreach (QTcpSocket* socket, m_subscribers)
+        reply(socket, line);
+}
+
+QByteArray MvcpTestServer::execute(const QString &line, QTcpSocket *socket)
+{
+    static const QRegularExpression re("\"([^\"]*)\"|(\\S+)");
+    QStringList args;
+    QRegularExpressionMatchIterator it = re.globalMatch(line);
+    while (it.hasNext()) {
+        QRegularExpressionMatch match = it.next();
+        args << (match.captured(1).isNull()? match.captured(2) : match.captured(1));
+    }
+    QString command = args.takeFirst().toUpper();
+    m_commandCount++;
+
+    if (command == "ULS") {
+        QByteArray result = "201 OK\r\n";
+        for (int i = 0; i < m_units.size(); i++)
+            result += QString("U%1 test %2 1\r\n").arg(i).arg(m_units[i].clips.isEmpty()? "" : "loaded").toUtf8();
+        return result + "\r\n";
+    }
+    if (command == "STATUS") {
+        if (!m_subscribers.contains(socket))
+            m_subscribers << socket;
+        QByteArray result = "200 OK\r\n";
+        for (int i = 0; i < m_units.size(); i++)
+            result += statusLine(i);
+        return result;
+    }
+
+    Unit* u = args.isEmpty()? 0 : unit(args.first());
+    if (!u)
+        return "400 Unknown command\r\n";
+    int i = int(u - m_units.data());
+    bool changed = false;
+
+    if (command == "LIST") {
+        QByteArray result = "201 OK\r\n";
+        result += QByteArray::number(u->generation) + "\r\n";
+        for (int j = 0; j < u->clips.size(); j++) {
+            const Clip& clip = u->clips[j];
+            int length = clip.out - clip.in + 1;
+            result += QString("%1 \"%2\" %3 %4 %5 %5 25.00\r\n")
+                    .arg(j).arg(clip.resource).arg(clip.in).arg(clip.out).arg(length).toUtf8();
+        }
+        return result + "\r\n";
+    } else if (command == "USTA") {
+        return "202 OK\r\n" + statusLine(i);
+    } else if (command == "APND" || command == "INSERT") {
+        if (args.size() < 2)
+            return "400 Unknown command\r\n";
+        Clip clip;
+        clip.resource = args.at(1);
+        int next = 2;
+        int row = u->clips.size();
+        if (command == "INSERT" && args.size() > next)
+            row = qBound(0, args.at(next++).toInt(), u->clips.size());
+        clip.in = (args.size() > next && args.at(next).toInt() >= 0)? args.at(next).toInt() : 0;
+        next++;
+        clip.out = (args.size() > next && args.at(next).toInt() >= 0)? args.at(next).toInt() : 249;
+        u->clips.insert(row, clip);
+        if (u->status == "not_loaded")
+            u->status = "stopped";
+        changed = true;
+    } else if (command == "REMOVE") {
+        int row = args.value(1).toInt();
+        if (row < 0 || row >= u->clips.size())
+            return "403 Argument out of range\r\n";
+        u->clips.removeAt(row);
+        changed = true;
+    } else if (command == "MOVE") {
+        int from = args.value(1).toInt();
+        int to = args.value(2).toInt();
+        if (from < 0 || from >= u->clips.size() || to < 0 || to >= u->clips.size())
+            return "403 Argument out of range\r\n";
+        u->clips.move(from, to);
+        changed = true;
+    } else if (command == "CLEAR" || command == "WIPE" || command == "CLEAN") {
+        u->clips.clear();
+        u->clipIndex = 0;
+        changed = true;
+    } else if (command == "PLAY") {
+        u->status = "playing";
+    } else if (command == "PAUSE") {
+        u->status = "paused";
+    } else if (command == "STOP") {
+        u->status = "stopped";
+    } else if (command == "GOTO") {
+        u->position = args.value(1).toInt();
+        if (args.size() > 2) {
+            QString index = args.at(2);
+            int clipIndex = (index.startsWith('+') || index.startsWith('-'))?
+                        u->clipIndex + index.toInt() : index.toInt();
+            u->clipIndex = qBound(0, clipIndex, qMax(u->clips.size() - 1, 0));
+        }
+    } else if (command != "SIN" && command != "SOUT" && command != "REW" && command != "FF") {
+        return "400 Unknown command\r\n";
+    }
+    if (changed)
+        u->generation++;
+    broadcastStatus(i);
+    return "200 OK\r\n";
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MVCPTESTSERVER_H
+#define MVCPTESTSERVER_H
+
+#include <QTcpServer>
+#include <QList>
+#include <QHash>
+#include <QStringList>
+
+class QTcpSocket;
+
+/*!
+  \class MvcpTestServer
+  \brief In-process stand-in for a melted server.
+
+  Speaks enough MVCP for the melted docks and MvcpClient: ULS, LIST, USTA,
+  STATUS and the playlist and transport commands of a configurable number of
+  units. Playlists only hold the resource names with their in and out
+  points; nothing is played. Every response can be delayed by a fixed
+  latency to measure pipelining against a simulated network without a real
+  server.
+*/
+
+class MvcpTestServer : public QTcpServer
+{
+    Q_OBJECT
+public:
+    explicit MvcpTestServer(int units = 1, QObject *parent = 0);
+
+    // Delay in milliseconds before each response is written.
+    void setLatency(int ms) { m_latency = ms; }
+    int commandCount() const { return m_commandCount; }
+    QStringList playlist(int unit) const;
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+
+private:
+    struct Clip {
+        QString resource;
+        int in;
+        int out;
+    };
+    struct Unit {
+        QList<Clip> clips;
+        QString status;
+        int clipIndex;
+        int position;
+        int generation;
+    };
+
+    QByteArray execute(const QString& line, QTcpSocket* socket);
+    Unit* unit(const QString& token);
+    void reply(QTcpSocket* socket, const QByteArray& data);
+    void broadcastStatus(int unit);
+    QByteArray statusLine(int unit) const;
+
+    QList<Unit> m_units;
+    QHash<QTcpSocket*, QByteArray> m_buffers;
+    QList<QTcpSocket*> m_subscribers;
+    int m_latency;
+    int m_commandCount;
+};
+
+#endif // MVCPTESTSERVER_H
@@ -137,6 +137,14 @@ Player::Player(QWidget *parent)
 
     glayout->addWidget(m_videoWidget, 0, 0);
 
+    m_previewStatsLabel = new QLabel;
+    m_previewStatsLabel->setStyleSheet("QLabel{color:white;background-color:rgba(0,0,0,160);padding:4px;font-family:monospace}");
+    m_previewStatsLabel->setAttribute(Qt::WA_TransparentForMouseEvents);
+    glayout->addWidget(m_previewStatsLabel, 0, 0, Qt::AlignLeft | Qt::AlignTop);
+    m_previewStatsLabel->hide();
+    m_previewStatsTimer.setInterval(500);
+    connect(&m_previewStatsTimer, SIGNAL(timeout()), this, SLOT(updatePreviewStats()));
+
     m_verticalScroll = new QScrollBar(Qt::Vertical);
 
     glayout->addWidget(m_verticalScroll, 0, 1);
@@ -182,8 +190,15 @@ Player::Player(QWidget *parent)
     m_durationLabel->setText(QString("<h4><font color=white>%1</font></h4>").arg("00:00:00:00"));
     m_durationLabel->setFixedWidth(100);
 
+    m_uploadTimeLabel = new QLabel(this);
+    m_uploadTimeLabel->setToolTip(tr("Preview texture upload time per frame"));
+    m_uploadTimeLabel->setStyleSheet("color:rgb(160,160,160)");
+    m_uploadTimeLabel->setFixedWidth(70);
+    m_uploadTimeLabel->hide();
+
     hBoxLayout->addWidget(m_scrubber);
     hBoxLayout->addWidget(m_durationLabel);
+    hBoxLayout->addWidget(m_uploadTimeLabel);
     hBoxLayout->setAlignment(Qt::AlignVCenter);
 
     progressWidget->setLayout(hBoxLayout);
@@ -916,6 +931,12 @@ void Player::onFrameDisplayed(const SharedFrame& frame)
     //    m_progressBar->setValue(m_duration);
 //        emit endOfStream();
     }
+
+    QVariant uploadTime = MLT.videoWidget()->property("uploadTime");
+    if (uploadTime.isValid() && uploadTime.toInt() >= 0) {
+        m_uploadTimeLabel->setText(QString("%1 ms").arg(uploadTime.toInt() / 1000.0, 0, 'f', 1));
+        m_uploadTimeLabel->show();
+    }
 }
 
 void Player::updateSelection()
@@ -1436,6 +1457,22 @@ void Player::toggleFullScreen()
 #endif
 }
 
+void Player::setPreviewStatsVisible(bool visible)
+{
+    m_previewStatsLabel->setVisible(visible);
+    if (visible) {
+        updatePreviewStats();
+        m_previewStatsTimer.start();
+    } else {
+        m_previewStatsTimer.stop();
+    }
+}
+
+void Player::updatePreviewStats()
+{
+    m_previewStatsLabel->setText(MLT.videoWidget()->property("previewStats").toString());
+}
+
 void Player::keyPressEvent(QKeyEvent *event)
 {
     switch (event->key())
@@ -116,6 +116,7 @@ public slots:
     void onTabBarClicked(int index);
     void setStatusLabel(const QString& text, int timeoutSeconds, QAction* action);
     void toggleFullScreen();
+    void setPreviewStatsVisible(bool visible);
 
     void seekPreFrame();
     void seekNextFrame();
@@ -153,6 +154,7 @@ private:
     QSlider *m_progressBar;
     TimeSpinBox* m_positionSpinner;
     QLabel* m_durationLabel;
+    QLabel* m_uploadTimeLabel;  // 预览每帧纹理上传耗时
     QLabel* m_inPointLabel;
     QLabel* m_selectedLabel;
     int m_position;
@@ -191,6 +193,8 @@ private:
     QPropertyAnimation* m_statusFadeIn;
     QPropertyAnimation* m_statusFadeOut;
     QTimer m_statusTimer;
+    QLabel* m_previewStatsLabel;    // 预览统计信息，叠加在视频左上角
+    QTimer m_previewStatsTimer;
 
     QPushButton *m_fitButton;           // 合适
     QPushButton *m_fullScreenButton;    // 全屏
@@ -212,6 +216,7 @@ private slots:
     void setZoom(float factor);//, const QIcon &icon);
     void toggleZoom(bool checked);
     void onFadeOutFinished();
+    void updatePreviewStats();
     void ZoomChanged(int index);
 
     void zoomPlayer(float fZoomFactor);
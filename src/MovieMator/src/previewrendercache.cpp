@@ -0,0 +1,472 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "previewrendercache.h"
+#include "models/multitrackmodel.h"
+#include "jobs/melttask.h"
+#include "mltcontroller.h"
+#include "glwidget.h"
+#include "settings.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDomDocument>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QStringList>
+#include <QStandardPaths>
+#include <Logger.h>
+
+//同一时刻各片段开销之和达到这个值就认为预览跟不上
+static const int kHeavyCost = 3;
+static const char* kFileSuffix = ".mov";
+static const char* kPartialSuffix = ".part";
+
+PreviewRenderCache::PreviewRenderCache(MultitrackModel& model, QObject *parent)
+    : QObject(parent)
+    , m_model(model)
+    , m_task(nullptr)
+{
+    // 连续编辑时只在停下来之后重新计算一次
+    m_revalidateTimer.setSingleShot(true);
+    m_revalidateTimer.setInterval(1000);
+    connect(&m_revalidateTimer, SIGNAL(timeout()), this, SLOT(revalidate()));
+}
+
+PreviewRenderCache::~PreviewRenderCache()
+{
+    stopRender();
+}
+
+QString PreviewRenderCache::cacheDir()
+{
+    QDir dir(QStandardPaths::standardLocations(QStandardPaths::DataLocation).first());
+    if (!dir.exists("previews"))
+        dir.mkpath("previews");
+    dir.cd("previews");
+    return dir.absolutePath();
+}
+
+QString PreviewRenderCache::filePath(const QString& key) const
+{
+    return QDir(cacheDir()).filePath(key + kFileSuffix);
+}
+
+int PreviewRenderCache::readyCount() const
+{
+    int count = 0;
+    foreach (const Range& range, m_ranges) {
+        if (range.state == Ready)
+            count++;
+    }
+    return count;
+}
+
+void PreviewRenderCache::addRange(int in, int out)
+{
+    if (!m_model.tractor() || in > out)
+        return;
+    insertRange(in, out);
+    revalidate();
+}
+
+void PreviewRenderCache::insertRange(int in, int out)
+{
+    // 与已有区间重叠时合并成一个
+    for (int i = m_ranges.size() - 1; i >= 0; --i) {
+        if (m_ranges[i].in <= out + 1 && m_ranges[i].out + 1 >= in) {
+            in = qMin(in, m_ranges[i].in);
+            out = qMax(out, m_ranges[i].out);
+            m_ranges.removeAt(i);
+        }
+    }
+    Range range;
+    range.in = in;
+    range.out = out;
+    range.state = Stale;
+    m_ranges << range;
+}
+
+int PreviewRenderCache::addHeavyRanges()
+{
+    if (!m_model.tractor())
+        return 0;
+    // 视频片段开销为1，有滤镜、是转场各加1
+    QMap<int, int> changes;
+    for (int trackIndex = 0; trackIndex < m_model.rowCount(); ++trackIndex) {
+        QModelIndex track = m_model.index(trackIndex);
+        if (track.data(MultitrackModel::IsAudioRole).toBool() || track.data(MultitrackModel::IsHiddenRole).toBool())
+            continue;
+        int count = m_model.clipCount(trackIndex);
+        for (int clipIndex = 0; clipIndex < count; ++clipIndex) {
+            QModelIndex clip = m_model.index(clipIndex, 0, track);
+            if (clip.data(MultitrackModel::IsBlankRole).toBool())
+                continue;
+            int start = clip.data(MultitrackModel::StartRole).toInt();
+            int duration = clip.data(MultitrackModel::DurationRole).toInt();
+            int cost = 1;
+            if (clip.data(MultitrackModel::HasFilterRole).toBool())
+                cost++;
+            if (clip.data(MultitrackModel::IsTransitionRole).toBool())
+                cost++;
+            changes[start] += cost;
+            changes[start + duration] -= cost;
+        }
+    }
+
+    // 太短的区间不值得单独渲染
+    int minLength = qRound(MLT.profile().fps());
+    int added = 0;
+    int cost = 0;
+    int heavyStart = -1;
+    for (QMap<int, int>::const_iterator it = changes.constBegin(); it != changes.constEnd(); ++it) {
+        cost += it.value();
+        if (cost >= kHeavyCost && heavyStart < 0) {
+            heavyStart = it.key();
+        } else if (cost < kHeavyCost && heavyStart >= 0) {
+            if (it.key() - heavyStart >= minLength) {
+                insertRange(heavyStart, it.key() - 1);
+                added++;
+            }
+            heavyStart = -1;
+        }
+    }
+    if (added)
+        revalidate();
+    return added;
+}
+
+void PreviewRenderCache::clear()
+{
+    m_revalidateTimer.stop();
+    stopRender();
+    m_ranges.clear();
+    publish();
+}
+
+void PreviewRenderCache::removeFiles()
+{
+    clear();
+    QDir dir(cacheDir());
+    foreach (const QString& name, dir.entryList(QDir::Files))
+        dir.remove(name);
+}
+
+void PreviewRenderCache::invalidate()
+{
+    // 预览已经停止使用预渲染的文件（GLWidget::contentChanged），这里等内容稳定后再检查
+    if (m_ranges.isEmpty())
+        return;
+    for (int i = 0; i < m_ranges.size(); ++i) {
+        if (m_ranges[i].state == Ready)
+            m_ranges[i].state = Stale;
+    }
+    m_revalidateTimer.start();
+}
+
+static int toFrames(const QString& value)
+{
+    bool ok = false;
+    int frames = value.toInt(&ok);
+    if (!ok && MLT.producer())
+        frames = MLT.producer()->time_to_frames(value.toLatin1().constData());
+    return frames;
+}
+
+//QDomDocument输出的属性顺序不固定，哈希用按名字排序后的文本
+static void canonicalText(const QDomNode& node, QString& text)
+{
+    if (node.isText()) {
+        text += node.nodeValue();
+        return;
+    }
+    if (!node.isElement())
+        return;
+    QDomElement element = node.toElement();
+    QDomNamedNodeMap attributes = element.attributes();
+    QStringList names;
+    for (int i = 0; i < attributes.size(); ++i)
+        names << attributes.item(i).nodeName();
+    names.sort();
+    text += '<' + element.tagName();
+    foreach (const QString& name, names)
+        text += ' ' + name + "=\"" + element.attribute(name) + '"';
+    text += '>';
+    for (QDomNode child = node.firstChild(); !child.isNull(); child = child.nextSibling())
+        canonicalText(child, text);
+    text += "</" + element.tagName() + '>';
+}
+
+//只保留区间用到的片段，这样区间外的编辑不会改变哈希
+bool PreviewRenderCache::rangeXml(QDomDocument& dom, int in, int out) const
+{
+    QDomElement root = dom.documentElement();
+    QHash<QString, QDomElement> elements;
+    for (QDomElement e = root.firstChildElement(); !e.isNull(); e = e.nextSiblingElement()) {
+        if (e.hasAttribute("id"))
+            elements.insert(e.attribute("id"), e);
+    }
+    QDomElement tractor = elements.value(root.attribute("producer"));
+    if (tractor.isNull() || tractor.tagName() != "tractor")
+        return false;
+
+    for (QDomElement track = tractor.firstChildElement("track"); !track.isNull(); track = track.nextSiblingElement("track")) {
+        QDomElement playlist = elements.value(track.attribute("producer"));
+        if (playlist.isNull() || playlist.tagName() != "playlist")
+            continue;
+        // 区间之前的片段换成等长的空白，区间之后的删掉
+        int position = 0;
+        QDomElement previousBlank;
+        QDomElement e = playlist.firstChildElement();
+        while (!e.isNull()) {
+            QDomElement next = e.nextSiblingElement();
+            int length = 0;
+            if (e.tagName() == "entry")
+                length = toFrames(e.attribute("out")) - toFrames(e.attribute("in")) + 1;
+            else if (e.tagName() == "blank")
+                length = toFrames(e.attribute("length"));
+            else {
+                e = next;
+                continue;
+            }
+            if (position > out) {
+                playlist.removeChild(e);
+            } else if (position + length <= in) {
+                if (!previousBlank.isNull()) {
+                    previousBlank.setAttribute("length", toFrames(previousBlank.attribute("length")) + length);
+                    playlist.removeChild(e);
+                } else {
+                    QDomElement blank = dom.createElement("blank");
+                    blank.setAttribute("length", length);
+                    playlist.replaceChild(blank, e);
+                    previousBlank = blank;
+                }
+            } else {
+                previousBlank = QDomElement();
+            }
+            position += length;
+            e = next;
+        }
+    }
+
+    // 删除不再被引用的 producer
+    QSet<QString> referenced;
+    QList<QDomElement> pending;
+    referenced << tractor.attribute("id");
+    pending << tractor;
+    while (!pending.isEmpty()) {
+        QDomElement element = pending.takeFirst();
+        QDomNodeList children = element.elementsByTagName("*");
+        for (int i = 0; i < children.size(); ++i) {
+            QString id = children.at(i).toElement().attribute("producer");
+            if (!id.isEmpty() && !referenced.contains(id) && elements.contains(id)) {
+                referenced << id;
+                pending << elements.value(id);
+            }
+        }
+    }
+    foreach (const QString& id, elements.keys()) {
+        if (!referenced.contains(id))
+            root.removeChild(elements.value(id));
+    }
+
+    tractor.setAttribute("in", in);
+    tractor.setAttribute("out", out);
+    return true;
+}
+
+void PreviewRenderCache::revalidate()
+{
+    m_revalidateTimer.stop();
+    Mlt::Tractor* tractor = m_model.tractor();
+    if (!tractor) {
+        clear();
+        return;
+    }
+    QString xml = MLT.XML(tractor);
+    int length = tractor->get_length();
+
+    for (int i = m_ranges.size() - 1; i >= 0; --i) {
+        Range& range = m_ranges[i];
+        range.out = qMin(range.out, length - 1);
+        if (range.in > range.out) {
+            m_ranges.removeAt(i);
+            continue;
+        }
+        QDomDocument dom;
+        if (!dom.setContent(xml) || !rangeXml(dom, range.in, range.out)) {
+            range.state = Failed;
+            continue;
+        }
+        QString text;
+        canonicalText(dom.documentElement(), text);
+        range.key = QString(QCryptographicHash::hash(text.toUtf8(), QCryptographicHash::Sha1).toHex());
+
+        if (QFile::exists(filePath(range.key))) {
+            range.state = Ready;
+            range.renderXml.clear();
+            continue;
+        }
+        if (m_task && range.key == m_taskKey) {
+            range.state = Rendering;
+            continue;
+        }
+
+        // 只有帧内编码才能在预览中随意定位
+        QDomElement consumer = dom.createElement("consumer");
+        QDomNodeList profiles = dom.elementsByTagName("profile");
+        if (profiles.isEmpty())
+            dom.documentElement().insertBefore(consumer, dom.documentElement().firstChild());
+        else
+            dom.documentElement().insertAfter(consumer, profiles.at(profiles.length() - 1));
+        consumer.setAttribute("mlt_service", "avformat");
+        consumer.setAttribute("resource", filePath(range.key) + kPartialSuffix);
+        consumer.setAttribute("f", "mov");
+        consumer.setAttribute("vcodec", "mjpeg");
+        consumer.setAttribute("qscale", 2);
+        consumer.setAttribute("pix_fmt", "yuvj422p");
+        consumer.setAttribute("acodec", "pcm_s16le");
+        consumer.setAttribute("real_time", -1);
+        consumer.setAttribute("terminate_on_pause", 1);
+        range.renderXml = dom.toString(0);
+        range.state = Queued;
+    }
+
+    // 正在渲染的内容已经没有区间需要了
+    if (m_task) {
+        bool needed = false;
+        foreach (const Range& range, m_ranges)
+            needed |= (range.state == Rendering);
+        if (!needed)
+            stopRender();
+    }
+    publish();
+    startNextRender();
+}
+
+void PreviewRenderCache::publish()
+{
+    QList<RangeSubstitution::Range> ranges;
+    foreach (const Range& range, m_ranges) {
+        if (range.state != Ready)
+            continue;
+        RangeSubstitution::Range r;
+        r.in = range.in;
+        r.out = range.out;
+        r.path = filePath(range.key);
+        ranges << r;
+    }
+    Mlt::GLWidget* videoWidget = static_cast<Mlt::GLWidget*>(&(MLT));
+    Mlt::Tractor* tractor = m_model.tractor();
+    videoWidget->rangeSubstitution()->setRanges(tractor? tractor->get_producer() : nullptr, ranges);
+}
+
+void PreviewRenderCache::startNextRender()
+{
+    if (m_task)
+        return;
+    for (int i = 0; i < m_ranges.size(); ++i) {
+        Range& range = m_ranges[i];
+        if (range.state != Queued)
+            continue;
+        m_taskKey = range.key;
+        m_task = new MeltTask(filePath(range.key), range.renderXml);
+        connect(m_task, SIGNAL(finished(AbstractTask*,bool)), this, SLOT(onTaskFinished(AbstractTask*,bool)));
+        range.state = Rendering;
+        range.renderXml.clear();
+        LOG_INFO() << "rendering preview" << range.in << range.out << range.key;
+        m_task->start();
+        return;
+    }
+}
+
+void PreviewRenderCache::stopRender()
+{
+    if (!m_task)
+        return;
+    MeltTask* task = m_task;
+    m_task = nullptr;
+    disconnect(task, nullptr, this, nullptr);
+    task->stop();
+    delete task;
+    QFile::remove(filePath(m_taskKey) + kPartialSuffix);
+    for (int i = 0; i < m_ranges.size(); ++i) {
+        if (m_ranges[i].state == Rendering)
+            m_ranges[i].state = Stale;
+    }
+    m_taskKey.clear();
+}
+
+void PreviewRenderCache::onTaskFinished(AbstractTask* task, bool isSuccess)
+{
+    if (task != m_task)
+        return;
+    m_task = nullptr;
+    task->deleteLater();
+
+    QString path = filePath(m_taskKey);
+    QFileInfo partial(path + kPartialSuffix);
+    bool ok = isSuccess && partial.exists() && partial.size() > 0;
+    if (ok) {
+        QFile::remove(path);
+        ok = QFile::rename(partial.filePath(), path);
+    } else {
+        QFile::remove(partial.filePath());
+    }
+
+    for (int i = 0; i < m_ranges.size(); ++i) {
+        Range& range = m_ranges[i];
+        if (range.key != m_taskKey || range.state != Rendering)
+            continue;
+        range.state = ok? Ready : Failed;
+        if (ok)
+            emit showStatusMessage(tr("Preview rendered: %1 - %2").arg(MLT.producer()? QString(MLT.producer()->frames_to_time(range.in)) : QString::number(range.in))
+                                   .arg(MLT.producer()? QString(MLT.producer()->frames_to_time(range.out)) : QString::number(range.out)));
+        else
+            LOG_WARNING() << "failed to render preview" << range.in << range.out;
+    }
+    m_taskKey.clear();
+    trimDirectory();
+    publish();
+    startNextRender();
+}
+
+//超出上限时从最旧的文件开始删除，正在使用的文件除外
+void PreviewRenderCache::trimDirectory()
+{
+    qint64 capacity = qint64(Settings.previewRenderCacheSize()) * 1024 * 1024;
+    QSet<QString> inUse;
+    foreach (const Range& range, m_ranges)
+        inUse << QFileInfo(filePath(range.key)).fileName();
+
+    QDir dir(cacheDir());
+    QFileInfoList files = dir.entryInfoList(QStringList() << QString("*") + kFileSuffix, QDir::Files, QDir::Time | QDir::Reversed);
+    qint64 total = 0;
+    foreach (const QFileInfo& info, files)
+        total += info.size();
+    foreach (const QFileInfo& info, files) {
+        if (total <= capacity)
+            break;
+        if (inUse.contains(info.fileName()))
+            continue;
+        if (dir.remove(info.fileName()))
+            total -= info.size();
+    }
+}
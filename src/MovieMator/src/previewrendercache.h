@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PREVIEWRENDERCACHE_H
+#define PREVIEWRENDERCACHE_H
+
+#include <QObject>
+#include <QList>
+#include <QString>
+#include <QTimer>
+
+class MultitrackModel;
+class AbstractTask;
+class MeltTask;
+class QDomDocument;
+
+//时间线上标记的区间在后台预渲染成只有帧内编码的文件（mjpeg），
+//内容没有变化时预览直接播放预渲染的文件。
+//缓存文件以区间 MLT XML的哈希命名，放在缩略图数据库旁边的 previews目录下，总大小有上限。
+class PreviewRenderCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PreviewRenderCache(MultitrackModel& model, QObject *parent = nullptr);
+    ~PreviewRenderCache();
+
+    void addRange(int in, int out);
+    //按片段的叠加、滤镜、转场估计渲染开销，标记出预览跟不上的区间，返回标记的区间数
+    int addHeavyRanges();
+    //删除所有缓存文件
+    void removeFiles();
+
+    int rangeCount() const { return m_ranges.size(); }
+    int readyCount() const;
+    static QString cacheDir();
+
+signals:
+    void showStatusMessage(QString);
+
+public slots:
+    void invalidate();
+    void clear();
+
+private slots:
+    void revalidate();
+    void onTaskFinished(AbstractTask* task, bool isSuccess);
+
+private:
+    enum State {
+        Stale,      //内容可能已变化，还没有重新检查
+        Queued,
+        Rendering,
+        Ready,
+        Failed
+    };
+
+    struct Range {
+        int in;
+        int out;
+        QString key;
+        QString renderXml;
+        State state;
+    };
+
+    void insertRange(int in, int out);
+    bool rangeXml(QDomDocument& dom, int in, int out) const;
+    QString filePath(const QString& key) const;
+    void publish();
+    void startNextRender();
+    void stopRender();
+    void trimDirectory();
+
+    MultitrackModel& m_model;
+    QList<Range> m_ranges;
+    QTimer m_revalidateTimer;
+    MeltTask* m_task;
+    QString m_taskKey;
+};
+
+#endif // PREVIEWRENDERCACHE_H
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "projectloader.h"
+#include "models/multitrackmodel.h"
+#include "util.h"
+#include <Logger.h>
+#include <QRunnable>
+#include <QThread>
+#include <QMutexLocker>
+#include "mltcontroller.h"
+
+class OpenProducerTask : public QRunnable
+{
+public:
+    OpenProducerTask(ProjectLoader* loader, int generation, int index, Mlt::Profile& profile, const QString& resource)
+        : QRunnable()
+        , m_loader(loader)
+        , m_generation(generation)
+        , m_index(index)
+        , m_profile(profile)
+        , m_resource(resource)
+    {
+    }
+
+    void run()
+    {
+        // avformat会在构造时打开文件并读取流信息，这是打开工程最慢的部分
+        Mlt::Producer* producer = new Mlt::Producer(m_profile, "avformat", m_resource.toUtf8().constData());
+        if (!producer->is_valid()) {
+            LOG_WARNING() << "failed to open" << m_resource;
+            delete producer;
+            producer = nullptr;
+        }
+        m_loader->setOpened(m_generation, m_index, producer);
+    }
+
+private:
+    ProjectLoader* m_loader;
+    int m_generation;
+    int m_index;
+    Mlt::Profile& m_profile;
+    QString m_resource;
+};
+
+ProjectLoader::ProjectLoader(MultitrackModel& model, QObject *parent)
+    : QObject(parent)
+    , m_model(model)
+    , m_timelineMs(-1)
+    , m_interactiveMs(-1)
+    , m_loading(false)
+    , m_generation(0)
+    , m_pending(0)
+    , m_replaced(0)
+{
+    // 打开文件大部分时间在等磁盘，线程数至少为 2
+    m_pool.setMaxThreadCount(qMax(2, QThread::idealThreadCount()));
+}
+
+ProjectLoader::~ProjectLoader()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+void ProjectLoader::begin(const QString &url)
+{
+    cancel();
+    m_url = url;
+    m_timelineMs = -1;
+    m_loading = true;
+    m_timer.start();
+}
+
+void ProjectLoader::cancel()
+{
+    m_pool.clear();
+    QMutexLocker locker(&m_mutex);
+    ++m_generation;
+    qDeleteAll(m_originals);
+    m_originals.clear();
+    qDeleteAll(m_opened);
+    m_opened.clear();
+    m_pending = 0;
+    m_replaced = 0;
+}
+
+void ProjectLoader::setOpened(int generation, int index, Mlt::Producer* producer)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (generation != m_generation) {
+            delete producer;
+            return;
+        }
+        m_opened.insert(index, producer);
+    }
+    QMetaObject::invokeMethod(this, "onProducerOpened", Qt::QueuedConnection,
+                              Q_ARG(int, generation), Q_ARG(int, index));
+}
+
+void ProjectLoader::onTimelineLoaded()
+{
+    if (!m_loading || m_timelineMs >= 0)
+        return;
+    m_timelineMs = m_timer.elapsed();
+    LOG_INFO() << "timeline structure ready after" << m_timelineMs << "ms";
+
+    QList<Mlt::Producer*> producers = m_model.lazyProducers();
+    if (producers.isEmpty())
+        return;
+    QMutexLocker locker(&m_mutex);
+    m_originals = producers;
+    m_pending = producers.size();
+    for (int i = 0; i < producers.size(); ++i) {
+        QString resource = QString::fromUtf8(producers[i]->get("resource"));
+        m_pool.start(new OpenProducerTask(this, m_generation, i, MLT.profile(), resource));
+    }
+    LOG_INFO() << "opening" << producers.size() << "media files in the background";
+}
+
+void ProjectLoader::onProducerOpened(int generation, int index)
+{
+    Mlt::Producer* original = nullptr;
+    Mlt::Producer* opened = nullptr;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (generation != m_generation || index < 0 || index >= m_originals.size())
+            return;
+        original = m_originals[index];
+        opened = m_opened.take(index);
+        m_originals[index] = nullptr;
+        --m_pending;
+    }
+    // 打开失败或者已经被播放打开过的素材保留原来的 producer
+    if (opened && original)
+        m_replaced += m_model.replaceProducer(*original, *opened);
+    delete opened;
+    delete original;
+
+    if (m_pending == 0) {
+        LOG_INFO() << "media opened after" << m_timer.elapsed() << "ms," << m_replaced << "clips updated";
+        QMutexLocker locker(&m_mutex);
+        m_originals.clear();
+    }
+}
+
+void ProjectLoader::onFrameDisplayed()
+{
+    if (!m_loading || m_timelineMs < 0)
+        return;
+    m_loading = false;
+    m_interactiveMs = m_timer.elapsed();
+    LOG_INFO() << "time to first interactive" << m_interactiveMs << "ms for" << m_url
+               << "timeline" << m_timelineMs << "ms";
+    emit showStatusMessage(tr("Opened %1 in %2 s").arg(Util::baseName(m_url))
+                           .arg(m_interactiveMs / 1000.0, 0, 'f', 1));
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PROJECTLOADER_H
+#define PROJECTLOADER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QMutex>
+#include <QList>
+#include <QMap>
+
+namespace Mlt {
+    class Producer;
+}
+class MultitrackModel;
+
+//打开工程分阶段进行：
+//1. MLT加载 XML时素材用 avformat-novalidate，不打开文件，时间线模型加载完就先显示轨道结构；
+//2. 随后在线程池里并行打开每个素材文件，打开一个就换进时间线，替换不记录撤销；
+//3. 换进去的片段重新显示缩略图并生成波形，界面陆续刷新；
+//4. 从开始打开到第一帧显示的时间记为可交互时间。
+class ProjectLoader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ProjectLoader(MultitrackModel& model, QObject *parent = nullptr);
+    ~ProjectLoader();
+
+    void begin(const QString& url);
+    //最近一次打开工程的可交互时间，单位 ms，还没有时返回 -1
+    qint64 lastInteractiveTime() const { return m_interactiveMs; }
+
+    //后台线程打开完一个素材后调用，只保存结果
+    void setOpened(int generation, int index, Mlt::Producer* producer);
+
+signals:
+    void showStatusMessage(QString);
+
+public slots:
+    void onTimelineLoaded();
+    void onFrameDisplayed();
+    //工程关闭或重新打开时放弃还没有换进去的素材
+    void cancel();
+
+private slots:
+    void onProducerOpened(int generation, int index);
+
+private:
+    MultitrackModel& m_model;
+    QElapsedTimer m_timer;
+    QString m_url;
+    qint64 m_timelineMs;
+    qint64 m_interactiveMs;
+    bool m_loading;
+
+    QThreadPool m_pool;
+    QMutex m_mutex;
+    int m_generation;                       // 每次 cancel()加一，旧任务的结果直接丢弃
+    QList<Mlt::Producer*> m_originals;      // 时间线里还没打开的素材
+    QMap<int, Mlt::Producer*> m_opened;     // 后台打开好的素材，按 m_originals的下标
+    int m_pending;
+    int m_replaced;
+};
+
+#endif // PROJECTLOADER_H
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "proxymanager.h"
+#include "jobqueue.h"
+#include "jobs/ffmpegjob.h"
+#include "util.h"
+#include "settings.h"
+#include "mltcontroller.h"
+#include <shotcut_mlt_properties.h>
+#include <Mlt.h>
+#include <Logger.h>
+#include <QDir>
+#include <QDomDocument>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+static const int kProxyHeight = 540;
+static const char* kFileSuffix = ".mov";
+static const char* kHashProperty = "_proxyHash";
+
+ProxyManager& ProxyManager::singleton()
+{
+    static ProxyManager* instance = new ProxyManager();
+    return *instance;
+}
+
+ProxyManager::ProxyManager(QObject* parent)
+    : QObject(parent)
+{
+}
+
+QString ProxyManager::dir()
+{
+    QDir dir(QStandardPaths::standardLocations(QStandardPaths::DataLocation).first());
+    if (!dir.exists("proxies"))
+        dir.mkpath("proxies");
+    dir.cd("proxies");
+    return dir.absolutePath();
+}
+
+QString ProxyManager::proxyPath(const QString& hash)
+{
+    return QDir(dir()).filePath(hash + kFileSuffix);
+}
+
+bool ProxyManager::isEligible(Mlt::Producer& producer) const
+{
+    if (!Settings.proxyEnabled() || !producer.is_valid())
+        return false;
+    if (!QString(producer.get("mlt_service")).startsWith("avformat"))
+        return false;
+    if (producer.get(kOriginalResourceProperty))
+        return false;
+    int index = producer.get_int("video_index");
+    if (index < 0 || producer.get_int("meta.media.height") <= 0)
+        return false;
+    if (producer.get_int("meta.media.height") > 1080)
+        return true;
+    QString codec = producer.get(QString("meta.media.%1.codec.name").arg(index).toLatin1().constData());
+    return codec == "hevc" || codec == "h265";
+}
+
+bool ProxyManager::prepare(Mlt::Producer& producer)
+{
+    if (!Settings.proxyEnabled())
+        return false;
+    if (!producer.get_int(kProxyProperty)) {
+        if (!isEligible(producer))
+            return false;
+        producer.set(kProxyProperty, 1);
+    }
+    if (producer.get(kOriginalResourceProperty))
+        return true;
+    QString hash = MLT.getHash(producer);
+    if (hash.isEmpty())
+        return false;
+    if (QFile::exists(proxyPath(hash)))
+        return true;
+    generate(producer, hash);
+    return false;
+}
+
+void ProxyManager::generate(Mlt::Producer& producer, const QString& hash)
+{
+    if (m_pending.contains(hash))
+        return;
+    QString resource = QString::fromUtf8(producer.get("resource"));
+    if (!QFile::exists(resource))
+        return;
+    m_pending.insert(hash);
+
+    // 先写到 .part文件，完成后再改名，中断的任务不会留下不完整的代理文件
+    QStringList args;
+    args << "-y" << "-hide_banner" << "-i" << resource;
+    args << "-map" << "0:v:0" << "-map" << "0:a:0?";
+    args << "-vf" << QString("scale=-2:%1").arg(kProxyHeight);
+    args << "-c:v" << "mjpeg" << "-q:v" << "5" << "-pix_fmt" << "yuvj422p";
+    args << "-c:a" << "pcm_s16le";
+    args << "-f" << "mov" << proxyPath(hash) + ".part";
+    FfmpegJob* job = new FfmpegJob(resource, args);
+    job->setLabel(tr("Make proxy for %1").arg(Util::baseName(resource)));
+    job->setProperty(kHashProperty, hash);
+    connect(job, SIGNAL(finished(AbstractJob*,bool)), this, SLOT(onJobFinished(AbstractJob*,bool)));
+    JOBS.add(job);
+}
+
+void ProxyManager::onJobFinished(AbstractJob* job, bool isSuccess)
+{
+    QString hash = job->property(kHashProperty).toString();
+    m_pending.remove(hash);
+    QString path = proxyPath(hash);
+    QString partPath = path + ".part";
+    if (!isSuccess || !QFile::rename(partPath, path)) {
+        LOG_WARNING() << "failed to make proxy" << path;
+        QFile::remove(partPath);
+        return;
+    }
+    emit proxyReady(hash);
+}
+
+static QDomElement findProperty(const QDomElement& service, const QString& name)
+{
+    for (QDomElement p = service.firstChildElement("property"); !p.isNull(); p = p.nextSiblingElement("property")) {
+        if (p.attribute("name") == name)
+            return p;
+    }
+    return QDomElement();
+}
+
+static void setElementProperty(QDomElement& service, const QString& name, const QString& value)
+{
+    QDomElement property = findProperty(service, name);
+    if (property.isNull()) {
+        property = service.ownerDocument().createElement("property");
+        property.setAttribute("name", name);
+        service.appendChild(property);
+    }
+    while (property.hasChildNodes())
+        property.removeChild(property.firstChild());
+    property.appendChild(service.ownerDocument().createTextNode(value));
+}
+
+bool ProxyManager::useProxies(QString& xml) const
+{
+    if (!Settings.proxyEnabled() || !xml.contains(kProxyProperty))
+        return false;
+    QDomDocument dom;
+    if (!dom.setContent(xml))
+        return false;
+
+    bool changed = false;
+    QDomNodeList producers = dom.elementsByTagName("producer");
+    for (int i = 0; i < producers.size(); ++i) {
+        QDomElement producer = producers.at(i).toElement();
+        if (findProperty(producer, kProxyProperty).text() != "1"
+                || !findProperty(producer, kOriginalResourceProperty).isNull())
+            continue;
+        QString path = proxyPath(findProperty(producer, kShotcutHashProperty).text());
+        if (!QFile::exists(path))
+            continue;
+        QString videoIndex = findProperty(producer, "video_index").text();
+        QString audioIndex = findProperty(producer, "audio_index").text();
+        setElementProperty(producer, kOriginalResourceProperty, findProperty(producer, "resource").text());
+        setElementProperty(producer, kOriginalVideoIndexProperty, videoIndex);
+        setElementProperty(producer, kOriginalAudioIndexProperty, audioIndex);
+        setElementProperty(producer, "resource", path);
+        // 代理文件只有一路视频和一路音频
+        setElementProperty(producer, "video_index", videoIndex.toInt() < 0? "-1" : "0");
+        setElementProperty(producer, "audio_index", audioIndex.toInt() < 0? "-1" : "1");
+        changed = true;
+    }
+    if (changed)
+        xml = dom.toString(2);
+    return changed;
+}
+
+Mlt::Producer* ProxyManager::proxied(Mlt::Producer& producer) const
+{
+    QString xml = MLT.XML(&producer);
+    if (!useProxies(xml))
+        return nullptr;
+    Mlt::Producer* p = new Mlt::Producer(MLT.profile(), "xml-string", xml.toUtf8().constData());
+    if (!p->is_valid()) {
+        delete p;
+        return nullptr;
+    }
+    return p;
+}
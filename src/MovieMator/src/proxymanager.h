@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROXYMANAGER_H
+#define PROXYMANAGER_H
+
+#include <QObject>
+#include <QSet>
+#include <QString>
+
+namespace Mlt {
+class Producer;
+}
+class AbstractJob;
+
+//高分辨率或 HEVC素材在后台转成低分辨率、只有帧内编码的代理文件（mjpeg），预览时使用代理文件。
+//代理文件以素材的哈希命名，放在 proxies目录下，所有工程共用。
+//工程里只保存 kProxyProperty标记，保存和导出时 Controller::saveXML会换回原始文件。
+class ProxyManager : public QObject
+{
+    Q_OBJECT
+public:
+    static ProxyManager& singleton();
+
+    static QString dir();
+    static QString proxyPath(const QString& hash);
+
+    //素材是否需要代理
+    bool isEligible(Mlt::Producer& producer) const;
+    //给需要代理的素材加上标记，代理文件不存在时加入任务队列生成，返回代理文件是否已存在
+    bool prepare(Mlt::Producer& producer);
+    //把 XML中已生成代理文件的素材换成代理文件，没有替换时返回 false
+    bool useProxies(QString& xml) const;
+    //返回使用代理文件的副本，没有可用的代理文件时返回 nullptr
+    Mlt::Producer* proxied(Mlt::Producer& producer) const;
+
+signals:
+    void proxyReady(const QString& hash);
+
+private slots:
+    void onJobFinished(AbstractJob* job, bool isSuccess);
+
+private:
+    explicit ProxyManager(QObject* parent = nullptr);
+    void generate(Mlt::Producer& producer, const QString& hash);
+
+    QSet<QString> m_pending;
+};
+
+#define PROXY ProxyManager::singleton()
+
+#endif // PROXYMANAGER_H
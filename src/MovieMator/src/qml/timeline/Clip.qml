@@ -80,6 +80,9 @@ Rectangle {
 
     property real visableX: 0.0
     property real visableWidth: 0.0
+    // clip是否在可见区域（左右各多留一屏）内，不在时不生成缩略图、波形和关键帧
+    readonly property bool inViewport: visableWidth <= 0 ||
+        (x + width > visableX - visableWidth && x < visableX + visableWidth * 2)
 
 
     // clip单击信号
@@ -203,7 +206,7 @@ Rectangle {
         console.assert(waveform.maxWidth > 0);
         if(waveform.maxWidth > 0)
         {
-            waveformRepeater.model = Math.ceil(waveform.innerWidth / waveform.maxWidth)
+            waveformRepeater.model = inViewport ? Math.ceil(waveform.innerWidth / waveform.maxWidth) : 0
         }
 //        for (var i = 0; i < waveformRepeater.count; i++)
         // console.assert(waveformRepeater.count>0);   // waveformRepeater.count可以为 0
@@ -227,6 +230,8 @@ Rectangle {
 
     // 响应音量调整信号的槽函数
     onAudioLevelsChanged: generateWaveform()
+    // 滚出可见区域时销毁波形，滚回来时重新生成
+    onInViewportChanged: generateWaveform()
 
     // 出点位置的 clip缩略图
     //有音频波形时出点缩略图
@@ -242,7 +247,9 @@ Rectangle {
         anchors.bottomMargin: parent.height / 2
         width: height * 16.0/9.0
         fillMode: Image.PreserveAspectFit
-        source: isText ? textThumbnail : imagePath(outPoint)
+        // 异步加载，滚出可见区域时清空 source 取消还没完成的请求
+        asynchronous: true
+        source: (inViewport && visible) ? (isText ? textThumbnail : imagePath(outPoint)) : ''
     }
 //    Image
 //    {
@@ -270,7 +277,8 @@ Rectangle {
         anchors.bottomMargin: parent.height / 2
         width: height * 16.0/9.0
         fillMode: Image.PreserveAspectFit
-        source: isText ? textThumbnail : imagePath(inPoint)
+        asynchronous: true
+        source: (inViewport && visible) ? (isText ? textThumbnail : imagePath(inPoint)) : ''
     }
 //    Image
 //    {
@@ -300,7 +308,8 @@ Rectangle {
 //        anchors.right: parent.right
         width: height * 16.0/9.0
         fillMode: Image.PreserveAspectFit
-        source: isText ? textThumbnail : imagePath((outPoint+inPoint)/2)
+        asynchronous: true
+        source: (inViewport && visible) ? (isText ? textThumbnail : imagePath((outPoint+inPoint)/2)) : ''
     }
 //    Image
 //    {
@@ -1050,7 +1059,7 @@ Rectangle {
         Repeater {
             id: keyFrameRepeater
             // 只有 Rectangle显示时才有 model，消除 currentFilter的 Reference Error警告
-            model: (parent.visible && currentFilter) ? currentFilter.keyframeNumber : 0
+            model: (parent.visible && inViewport && currentFilter) ? currentFilter.keyframeNumber : 0
             anchors.verticalCenter: parent.verticalCenter
 
 
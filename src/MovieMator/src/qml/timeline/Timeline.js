@@ -60,6 +60,71 @@ function scrollIfZoomNeeded(wheelx, scaleValue) {
     }
 }
 
+var SNAP = 10
+
+// 吸附到所有轨道上最近的编辑点，编辑点由 multitrack 按轨道索引查找
+function snapClip(clip) {
+    console.assert(clip);
+    console.assert(scrollView);
+    if (!clip || !scrollView) return;
+    var scale = multitrack.scaleFactor
+    var right = clip.x + clip.width
+    if (clip.x > -SNAP && clip.x < SNAP) {
+        // Snap around origin.
+        clip.x = 0
+        return
+    }
+    // Snap to other clips.
+    var leftEdit = multitrack.snapPosition(Math.round(clip.x / scale), SNAP, clip.originalTrackIndex, clip.originalClipIndex)
+    var rightEdit = multitrack.snapPosition(Math.round(right / scale), SNAP, clip.originalTrackIndex, clip.originalClipIndex)
+    if (rightEdit >= 0 && (leftEdit < 0 || Math.abs(rightEdit * scale - right) < Math.abs(leftEdit * scale - clip.x))) {
+        clip.x = rightEdit * scale - clip.width
+        return
+    } else if (leftEdit >= 0) {
+        clip.x = leftEdit * scale
+        return
+    }
+    if (!toolbar.scrub) {
+        var cursorX = scrollView.flickableItem.contentX + cursor.x
+        if (clip.x > cursorX - SNAP && clip.x < cursorX + SNAP)
+            // Snap around cursor/playhead.
+            clip.x = cursorX
+        if (right > cursorX - SNAP && right < cursorX + SNAP)
+            clip.x = cursorX - clip.width
+    }
+}
+
+function snapDrop(pos) {
+    console.assert(scrollView);
+    if (!scrollView) return;
+    var scale = multitrack.scaleFactor
+    var left = scrollView.flickableItem.contentX + pos.x - headerWidth
+    var right = left + dropTarget.width
+    if (left > -SNAP && left < SNAP) {
+        // Snap around origin.
+        dropTarget.x = headerWidth
+        return
+    }
+    // Snap to other clips.
+    var leftEdit = multitrack.snapPosition(Math.round(left / scale), SNAP)
+    var rightEdit = multitrack.snapPosition(Math.round(right / scale), SNAP)
+    if (rightEdit >= 0 && (leftEdit < 0 || Math.abs(rightEdit * scale - right) < Math.abs(leftEdit * scale - left))) {
+        dropTarget.x = rightEdit * scale - dropTarget.width + headerWidth - scrollView.flickableItem.contentX
+        return
+    } else if (leftEdit >= 0) {
+        dropTarget.x = leftEdit * scale + headerWidth - scrollView.flickableItem.contentX
+        return
+    }
+    if (!toolbar.scrub) {
+        var cursorX = scrollView.flickableItem.contentX + cursor.x
+        if (left > cursorX - SNAP && left < cursorX + SNAP)
+            // Snap around cursor/playhead.
+            dropTarget.x = cursorX + headerWidth - scrollView.flickableItem.contentX
+        if (right > cursorX - SNAP && right < cursorX + SNAP)
+            dropTarget.x = cursorX - dropTarget.width + headerWidth - scrollView.flickableItem.contentX
+    }
+}
+
 function dragging(pos, duration) {
     console.assert(tracksRepeater);
     console.assert(scrollView);
@@ -112,10 +177,8 @@ function dragging(pos, duration) {
             timeline.position = Math.round(
                 (pos.x + scrollView.flickableItem.contentX - headerWidth) / multitrack.scaleFactor)
         }
-        if (toolbar.snap) {
-            for (i = 0; i < tracksRepeater.count; i++)
-                tracksRepeater.itemAt(i).snapDrop(pos)
-        }
+        if (toolbar.snap)
+            snapDrop(pos)
     }
 }
 
@@ -20,40 +20,6 @@
  */
 var SNAP = 10
 
-function snapClip(clip, repeater) {
-    // clip.x = left edge
-    console.assert(clip);
-    console.assert(repeater);
-    if(!clip || !repeater) return;
-    var right = clip.x + clip.width
-    if (clip.x > -SNAP && clip.x < SNAP) {
-        // Snap around origin.
-        clip.x = 0
-        return
-    } else {
-        // Snap to other clips.
-        for (var i = 0; i < repeater.count; i++) {
-            var itemLeft = repeater.itemAt(i).x
-            var itemRight = itemLeft + repeater.itemAt(i).width
-            if (right > itemLeft - SNAP && right < itemLeft + SNAP) {
-                clip.x = itemLeft - clip.width
-                return
-            } else if (clip.x > itemRight - SNAP && clip.x < itemRight + SNAP) {
-                clip.x = itemRight
-                return
-            }
-        }
-    }
-    if (!toolbar.scrub) {
-        var cursorX = scrollView.flickableItem.contentX + cursor.x
-        if (clip.x > cursorX - SNAP && clip.x < cursorX + SNAP)
-            // Snap around cursor/playhead.
-            clip.x = cursorX
-        if (right > cursorX - SNAP && right < cursorX + SNAP)
-            clip.x = cursorX - clip.width
-    }
-}
-
 function snapTrimIn(clip, delta) {
     console.assert(clip);
     console.assert(scrollView);
@@ -110,37 +76,3 @@ function snapTrimOut(clip, delta) {
     }
     return delta
 }
-
-function snapDrop(pos, repeater) {
-    console.assert(repeater);
-    console.assert(scrollView);
-    if(!repeater || !scrollView) return;
-    var left = scrollView.flickableItem.contentX + pos.x - headerWidth
-    var right = left + dropTarget.width
-    if (left > -SNAP && left < SNAP) {
-        // Snap around origin.
-        dropTarget.x = headerWidth
-        return
-    } else {
-        // Snap to other clips.
-        for (var i = 0; i < repeater.count; i++) {
-            var itemLeft = repeater.itemAt(i).x
-            var itemRight = itemLeft + repeater.itemAt(i).width
-            if (right > itemLeft - SNAP && right < itemLeft + SNAP) {
-                dropTarget.x = itemLeft - dropTarget.width + headerWidth - scrollView.flickableItem.contentX
-                return
-            } else if (left > itemRight - SNAP && left < itemRight + SNAP) {
-                dropTarget.x = itemRight + headerWidth - scrollView.flickableItem.contentX
-                return
-            }
-        }
-    }
-    if (!toolbar.scrub) {
-        var cursorX = scrollView.flickableItem.contentX + cursor.x
-        if (left > cursorX - SNAP && left < cursorX + SNAP)
-            // Snap around cursor/playhead.
-            dropTarget.x = cursorX + headerWidth - scrollView.flickableItem.contentX
-        if (right > cursorX - SNAP && right < cursorX + SNAP)
-            dropTarget.x = cursorX - dropTarget.width + headerWidth - scrollView.flickableItem.contentX
-    }
-}
@@ -82,16 +82,6 @@ Rectangle {
         }
     }
 
-    // ？？？
-    function snapClip(clip) {
-        Logic.snapClip(clip, repeater)
-    }
-
-    // ？？？
-    function snapDrop(clip) {
-        Logic.snapDrop(clip, repeater)
-    }
-
     // 轨道 index上的 clip
     function clipAt(index) {
         console.assert(repeater);
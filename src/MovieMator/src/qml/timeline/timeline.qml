@@ -886,15 +886,7 @@ Rectangle {
                     clip.trackIndex = track.DelegateModel.itemsIndex
                 }
             }
-            onCheckSnap: {
-                console.assert(tracksRepeater);
-                if(!tracksRepeater) return;
-                for (var i = 0; i < tracksRepeater.count; i++){
-                    console.assert(tracksRepeater.itemAt(i));
-                    if(tracksRepeater)
-                        tracksRepeater.itemAt(i).snapClip(clip)
-                }
-            }
+            onCheckSnap: Logic.snapClip(clip)
             // 轨道被锁定时显示的图片
             Image {
                 anchors.fill: parent
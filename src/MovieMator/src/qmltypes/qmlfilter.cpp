@@ -40,6 +40,8 @@
 
 #include "encodetaskqueue.h"
 #include "jobs/melttask.h"
+#include <QUndoStack>
+#include <algorithm>
 
 static const char* kWidthProperty = "meta.media.width";
 static const char* kHeightProperty = "meta.media.height";
@@ -82,10 +84,7 @@ Mlt::Animation QmlFilter::getAnimation(const QString& name)
 int QmlFilter::getKeyFrameCountOnProject(QString name)
 {
     if (m_filter)
-    {
-        int count = getAnimation(name).key_count();
-        return count;
-    }
+        return keyFrameIndex(name).count();
     else
         return 0;
 }
@@ -96,7 +95,7 @@ int QmlFilter::getKeyFrameOnProjectOnIndex(int index, QString name)
 
     if (m_filter)
     {
-        int nKeyFrame = getAnimation(name).key_get_frame(index);
+        int nKeyFrame = keyFrameIndex(name).value(index, -1);
 
         int nPositionInClip = MAIN.timelineDock()->getPositionOnClip(nKeyFrame);
         int nClipLength = MAIN.timelineDock()->getCurrentClipLength();
@@ -111,60 +110,58 @@ int QmlFilter::getKeyFrameOnProjectOnIndex(int index, QString name)
 
 void QmlFilter::removeAnimationKeyFrame(int nFrame, QString name, bool bFromUndo)
 {
-    int nFrameInClip = nFrame;
-    nFrame = MAIN.timelineDock()->getPositionOnParentProducer(nFrame);
+    removeAnimationKeyFrames(QList<int>() << nFrame, name, bFromUndo);
+}
 
-    bool bKeyFrame = getAnimation(name).is_key(nFrame);
-    if(!bKeyFrame)      return;
+void QmlFilter::removeAnimationKeyFrames(const QList<int>& frames, QString name, bool bFromUndo)
+{
+    if (!m_filter)      return;
 
-    if (m_filter)
+    QVector<key_frame_item> keyFrameRemove;
+    Mlt::Animation animation = getAnimation(name);
+    foreach (int nFrameInClip, frames)
     {
-        if(!bFromUndo)
-        {
-            QString paraType = "string";
-            int paramCount = m_metadata->keyframes()->parameterCount();
-            for (int i = 0; i < paramCount; i++)
-            {
-                 QString key = m_metadata->keyframes()->parameter(i)->property();
-                 if (name == key) { paraType = m_metadata->keyframes()->parameter(i)->paraType(); break; }
-            }
-
-            QString from_value = "";
-            if (paraType == "double")
-                from_value = QString::number(getAnimDoubleValue(nFrameInClip, name));
-            else if(paraType == "int")
-                from_value = QString::number(getAnimIntValue(nFrameInClip, name));
-            else if(paraType == "string")
-                from_value = getAnimStringValue(nFrameInClip, name);
-            else if(paraType == "rect")
-            {
-                QRectF rect = getAnimRectValue(nFrameInClip, name);
-                from_value = QString("%1 %2 %3 %4 %5").arg(rect.x()).arg(rect.y()).arg(rect.width()).arg(rect.height()).arg(1.0);
-            }
-            else
-                from_value = getAnimStringValue(nFrameInClip, name);
-
+        int nFrame = MAIN.timelineDock()->getPositionOnParentProducer(nFrameInClip);
+        if (!isKeyFrame(name, nFrame))   continue;
 
+        if (!bFromUndo)
+        {
             key_frame_item para;
             para.keyFrame = nFrameInClip;
-            para.paraMap.insert(name, from_value);
-
-            QVector<key_frame_item> keyFrameRemove;
-            keyFrameRemove.insert(0, para);
-            MAIN.pushCommand(new Timeline::KeyFrameRemoveCommand(*(MAIN.timelineDock()->model()), m_filter, keyFrameRemove,true));
+            para.paraMap.insert(name, animValueString(nFrameInClip, name));
+            keyFrameRemove.append(para);
         }
 
-        getAnimation(name).remove(nFrame);
+        animation.remove(nFrame);
+        updateKeyFrameIndex(name, nFrame, false);
     }
 
+    if (!keyFrameRemove.isEmpty())
+        MAIN.pushCommand(new Timeline::KeyFrameRemoveCommand(*(MAIN.timelineDock()->model()), m_filter, keyFrameRemove, true));
+
     emit keyframeNumberChanged();
 }
 
+QString QmlFilter::animValueString(int nFrameInClip, const QString& name)
+{
+    QString type = paraType(name);
+    if (type == "double")
+        return QString::number(getAnimDoubleValue(nFrameInClip, name));
+    else if (type == "int")
+        return QString::number(getAnimIntValue(nFrameInClip, name));
+    else if (type == "rect")
+    {
+        QRectF rect = getAnimRectValue(nFrameInClip, name);
+        return QString("%1 %2 %3 %4 %5").arg(rect.x()).arg(rect.y()).arg(rect.width()).arg(rect.height()).arg(1.0);
+    }
+    return getAnimStringValue(nFrameInClip, name);
+}
+
 double QmlFilter::getKeyValueOnProjectOnIndex(int index, QString name)
 {
     if (m_filter)
     {
-        int nKeyFrame = getAnimation(name).key_get_frame(index);
+        int nKeyFrame = keyFrameIndex(name).value(index, -1);
         if (nKeyFrame >= 0)
         {
             double fKeyFrameValue = m_filter->anim_get_double(name.toUtf8().constData(), nKeyFrame, 0);
@@ -293,10 +290,11 @@ void QmlFilter::set(QString name, QString value)
         QString fromValue = m_filter->get(name.toUtf8().constData());
 
         m_filter->set(name.toUtf8().constData(), value.toUtf8().constData());
+        invalidateKeyFrameIndex(name);
          if(fromValue != "" && fromValue != value)
             MAIN.pushCommand(new Timeline::FilterCommand(*(MAIN.timelineDock()->model()), *(MAIN.filterController()->attachedModel()), MAIN.filterController()->currentFilterIndex(), name, fromValue, value,true));
 
-        MLT.refreshConsumer();
+        MAIN.timelineDock()->model()->refreshService(m_filter);
         emit filterPropertyValueChanged();
     }
 }
@@ -309,11 +307,12 @@ void QmlFilter::set(QString name, double value)
 
         double fromValue = m_filter->get_double(name.toUtf8().constData());
         m_filter->set(name.toUtf8().constData(), value);
+        invalidateKeyFrameIndex(name);
 
         if(!qFuzzyCompare(fromValue,value))
             MAIN.pushCommand(new Timeline::FilterCommand(*(MAIN.timelineDock()->model()), *(MAIN.filterController()->attachedModel()), MAIN.filterController()->currentFilterIndex(), name,  fromValue, value,true));
 
-        MLT.refreshConsumer();
+        MAIN.timelineDock()->model()->refreshService(m_filter);
         emit filterPropertyValueChanged();
     }
 }
@@ -326,10 +325,11 @@ void QmlFilter::set(QString name, int value)
 
         int fromValue = m_filter->get_int(name.toUtf8().constData());
         m_filter->set(name.toUtf8().constData(), value);
+        invalidateKeyFrameIndex(name);
          if(fromValue != value)
             MAIN.pushCommand(new Timeline::FilterCommand(*(MAIN.timelineDock()->model()), *(MAIN.filterController()->attachedModel()), MAIN.filterController()->currentFilterIndex(), name,  fromValue, value,true));
 
-        MLT.refreshConsumer();
+        MAIN.timelineDock()->model()->refreshService(m_filter);
         emit filterPropertyValueChanged();
     }
 }
@@ -371,12 +371,13 @@ void QmlFilter::set(QString name, double x, double y, double width, double heigh
         QRectF rectTo(x, y, width, height);
 
         m_filter->set(name.toUtf8().constData(), x, y, width, height, opacity);
+        invalidateKeyFrameIndex(name);
 
         if((rectFrom != rectTo) && isValidRect(rectFrom))
         {
             MAIN.pushCommand(new Timeline::FilterCommand(*(MAIN.timelineDock()->model()), *(MAIN.filterController()->attachedModel()), MAIN.filterController()->currentFilterIndex(), name,  rectFrom, rectTo,true));
         }
-        MLT.refreshConsumer();
+        MAIN.timelineDock()->model()->refreshService(m_filter);
         emit filterPropertyValueChanged();
     }
 }
@@ -394,7 +395,8 @@ void QmlFilter::anim_set(QString name, QString value)
     QString anim_name = "anim-"+name;
     qDebug()<<"anim_set, key:"<<anim_name<<", value:"<<value;
     m_filter->set(anim_name.toUtf8().constData(),value.toUtf8().constData());
-    MLT.refreshConsumer();
+    invalidateKeyFrameIndex(anim_name);
+    MAIN.timelineDock()->model()->refreshService(m_filter);
     emit filterPropertyValueChanged();
 }
 
@@ -402,6 +404,7 @@ void QmlFilter::resetProperty(const QString& name)
 {
     if (!m_filter) return;
     m_filter->clear(name.toUtf8().constData());
+    invalidateKeyFrameIndex(name);
 }
 
 void QmlFilter::loadPresets()
@@ -637,7 +640,8 @@ void QmlFilter::preset(const QString &name)
     if (!dir.cd("presets") || !dir.cd(objectNameOrService()))
         return;
     m_filter->load(dir.filePath(name).toUtf8().constData());
-    MLT.refreshConsumer();
+    invalidateKeyFrameIndex();
+    MAIN.timelineDock()->model()->refreshService(m_filter);
     emit filterPropertyValueChanged();
 }
 
@@ -657,11 +661,7 @@ int QmlFilter::cache_getPreKeyFrameNumInParent(int currentKeyFrame, QString prop
     if (propertyName == nullptr) propertyName = getAnyAnimPropertyName();
     if (propertyName == nullptr) return -1;
 
-    if (getAnimation(propertyName).is_key(currentKeyFrame)) currentKeyFrame = currentKeyFrame - 1;
-
-    int nKeyFrame = getAnimation(propertyName).previous_key(currentKeyFrame);
-
-    return nKeyFrame;
+    return previousKeyFrame(propertyName, currentKeyFrame);
 
 
 
@@ -734,9 +734,7 @@ int QmlFilter::cache_getNextKeyFrameNum(int currentKeyFrame, QString propertyNam
     if (propertyName == nullptr) propertyName = getAnyAnimPropertyName();
     if (propertyName == nullptr) return -1;
 
-    if (getAnimation(propertyName).is_key(currentKeyFrame)) currentKeyFrame = currentKeyFrame + 1;
-
-    int nKeyFrame = getAnimation(propertyName).next_key(currentKeyFrame);
+    int nKeyFrame = nextKeyFrame(propertyName, currentKeyFrame);
 
     int nPositionInClip = MAIN.timelineDock()->getPositionOnClip(nKeyFrame);
     int nClipLength     = MAIN.timelineDock()->getCurrentClipLength();
@@ -777,113 +775,7 @@ void QmlFilter::cache_setKeyFrameParaRectValue(int frame, QString key, const QRe
 
 void QmlFilter::cache_setKeyFrameParaValue(int frame, QString key, QString value, bool bFromUndo)
 {
-    QString from_value  = "";
-    int nFrameInClip    = frame;
-    bool bKeyFrame      = cache_bKeyFrame(frame, key);
-
-    if(frame < 0) return;
-    frame = MAIN.timelineDock()->getPositionOnParentProducer(frame);
-
-
-    Q_ASSERT(m_filter);
-    if(m_metadata)
-    {
-        QString paraType = "string";
-        int paramCount = m_metadata->keyframes()->parameterCount();
-        for (int i = 0; i < paramCount; i++)
-        {
-             QString name = m_metadata->keyframes()->parameter(i)->property();
-             if (name == key) { paraType = m_metadata->keyframes()->parameter(i)->paraType(); break; }
-        }
-        int duration = m_filter->get_length();
-
-                // Only set an animation keyframe if it does not already exist with the same value.
-                Mlt::Animation animation(m_filter->get_animation(key.toUtf8().constData()));
-                if (paraType == "double")
-                {
-                    if (!animation.is_valid() || !animation.is_key(frame)
-                            || !qFuzzyCompare(value.toDouble(),m_filter->anim_get_double(key.toUtf8().constData(), frame, duration)))
-                    {
-                        from_value = QString::number(m_filter->anim_get_double(key.toUtf8().constData(), frame, duration));
-                        m_filter->anim_set(key.toUtf8().constData(), value.toDouble(), frame, duration, mlt_keyframe_linear);
-                    }
-                }
-                else if(paraType == "int")
-                {
-                    if (!animation.is_valid() || !animation.is_key(frame)
-                            || value.toInt() != m_filter->anim_get_int(key.toUtf8().constData(), frame, duration)) {
-                        from_value = QString::number(m_filter->anim_get_int(key.toUtf8().constData(), frame, duration));
-                        m_filter->anim_set(key.toUtf8().constData(), value.toInt(), frame, duration, mlt_keyframe_linear);
-                    }
-                }
-                else if(paraType == "string")
-                {
-                    if (!animation.is_valid() || !animation.is_key(frame) || value != m_filter->anim_get(key.toUtf8().constData(), frame, duration))
-                    {
-                        from_value = QString::fromUtf8(m_filter->anim_get(key.toUtf8().constData(), frame, duration));
-
-                        m_filter->anim_set(key.toUtf8().constData(), value.toUtf8().constData(), frame, duration);
-                    }
-                }
-                else if(paraType == "rect")
-                {
-                    QStringList listValue = value.split(" ", QString::SkipEmptyParts);
-                    double x = listValue[0].toDouble();
-                    double y = listValue[1].toDouble();
-                    double width = listValue[2].toDouble();
-                    double height = listValue[3].toDouble();
-                    double opacity = listValue[4].toDouble();
-
-                    mlt_rect rect = m_filter->anim_get_rect(key.toUtf8().constData(), frame, duration);
-                    if (!animation.is_valid() || !animation.is_key(frame)
-                        || !qFuzzyCompare(x,rect.x) || !qFuzzyCompare(y,rect.y) || !qFuzzyCompare(width,rect.w) || !qFuzzyCompare(height,rect.h) || !qFuzzyCompare(opacity,rect.o))
-                    {
-                        from_value = QString("%1 %2 %3 %4 %5").arg(rect.x).arg(rect.y).arg(rect.w).arg(rect.h).arg(rect.o);
-                        rect.x = x;
-                        rect.y = y;
-                        rect.w = width;
-                        rect.h = height;
-                        rect.o = opacity;
-
-                        m_filter->anim_set(key.toUtf8().constData(), rect, frame, duration); //, mlt_keyframe_smooth); mlt_keyframe_smooth 可能有问题，在颜色显示时很明显  https://github.com/hansewu/MovieMator/issues/271
-                    }
-                }
-                else
-                {
-                    if (!animation.is_valid() || !animation.is_key(frame) || value != m_filter->anim_get(key.toUtf8().constData(), frame, duration))
-                    {
-                        from_value = QString::fromUtf8(m_filter->anim_get(key.toUtf8().constData(), frame, duration));
-                        m_filter->anim_set(key.toUtf8().constData(), value.toUtf8().constData(), frame, duration);
-                    }
-                }
-
-
-       if(!bFromUndo && (from_value != ""))
-       {
-            if(bKeyFrame)   //修改关键帧数据
-                MAIN.pushCommand(new Timeline::KeyFrameUpdateCommand(*(MAIN.timelineDock()->model()), m_filter, nFrameInClip, key, from_value, value,true));
-            else            //增加关键帧
-            {
-                key_frame_item paraFrom;
-                paraFrom.keyFrame = nFrameInClip;//-1;
-                paraFrom.paraMap.insert(key, from_value);
-
-                QVector<key_frame_item> keyFrameFrom;
-                keyFrameFrom.insert(0, paraFrom);
-
-
-                key_frame_item para;
-                para.keyFrame = nFrameInClip;
-                para.paraMap.insert(key, value);
-
-                QVector<key_frame_item> keyFrameAdd;
-                keyFrameAdd.insert(0, para);
-
-                MAIN.pushCommand(new Timeline::KeyFrameInsertCommand(*(MAIN.timelineDock()->model()), m_filter, keyFrameFrom, keyFrameAdd,true));
-            }
-       }
-
-    }
+    setKeyFrameValues(QList<int>() << frame, key, QStringList() << value, bFromUndo);
     emit keyframeNumberChanged();
 
 
@@ -1029,6 +921,130 @@ void QmlFilter::cache_setKeyFrameParaValue(int frame, QString key, QString value
 */
 }
 
+void QmlFilter::cache_setKeyFrameParaValues(const QList<int>& frames, QString key, const QStringList& values, bool bFromUndo)
+{
+    setKeyFrameValues(frames, key, values, bFromUndo);
+
+    MAIN.timelineDock()->model()->refreshService(m_filter);
+    emit filterPropertyValueChanged();
+    emit keyframeNumberChanged();
+}
+
+void QmlFilter::setKeyFrameValues(const QList<int>& frames, const QString& key, const QStringList& values, bool bFromUndo)
+{
+    Q_ASSERT(m_filter);
+    if (!m_metadata || frames.count() != values.count())     return;
+
+    QVector<key_frame_item> keyFrameFrom;
+    QVector<key_frame_item> keyFrameAdd;
+    QList<QUndoCommand *> commands;
+    for (int i = 0; i < frames.count(); i++)
+    {
+        int nFrameInClip = frames.at(i);
+        if (nFrameInClip < 0)   continue;
+
+        int frame       = MAIN.timelineDock()->getPositionOnParentProducer(nFrameInClip);
+        bool bKeyFrame  = isKeyFrame(key, frame);
+        QString from_value = setKeyFrameValue(frame, key, values.at(i));
+        if (bFromUndo || from_value == "")  continue;
+
+        if (bKeyFrame)   //修改关键帧数据
+        {
+            commands.append(new Timeline::KeyFrameUpdateCommand(*(MAIN.timelineDock()->model()), m_filter, nFrameInClip, key, from_value, values.at(i), true));
+        }
+        else            //增加关键帧
+        {
+            key_frame_item paraFrom;
+            paraFrom.keyFrame = nFrameInClip;
+            paraFrom.paraMap.insert(key, from_value);
+            keyFrameFrom.append(paraFrom);
+
+            key_frame_item para;
+            para.keyFrame = nFrameInClip;
+            para.paraMap.insert(key, values.at(i));
+            keyFrameAdd.append(para);
+        }
+    }
+
+    if (!keyFrameAdd.isEmpty())
+        commands.prepend(new Timeline::KeyFrameInsertCommand(*(MAIN.timelineDock()->model()), m_filter, keyFrameFrom, keyFrameAdd, true));
+
+    //批量设置时合成一个撤销步骤；单个时直接 push，保留命令的合并
+    if (commands.count() > 1)
+        MAIN.undoStack()->beginMacro(tr("Set key frames"));
+    foreach (QUndoCommand *command, commands)
+        MAIN.pushCommand(command);
+    if (commands.count() > 1)
+        MAIN.undoStack()->endMacro();
+}
+
+QString QmlFilter::setKeyFrameValue(int frame, const QString& key, const QString& value)
+{
+    QString from_value  = "";
+    bool bChanged       = false;
+    QString type        = paraType(key);
+    QByteArray name     = key.toUtf8();
+    int duration        = m_filter->get_length();
+
+    // Only set an animation keyframe if it does not already exist with the same value.
+    bool bKeyFrame = isKeyFrame(key, frame);
+    if (type == "double")
+    {
+        if (!bKeyFrame || !qFuzzyCompare(value.toDouble(), m_filter->anim_get_double(name.constData(), frame, duration)))
+        {
+            from_value = QString::number(m_filter->anim_get_double(name.constData(), frame, duration));
+            m_filter->anim_set(name.constData(), value.toDouble(), frame, duration, mlt_keyframe_linear);
+            bChanged = true;
+        }
+    }
+    else if(type == "int")
+    {
+        if (!bKeyFrame || value.toInt() != m_filter->anim_get_int(name.constData(), frame, duration))
+        {
+            from_value = QString::number(m_filter->anim_get_int(name.constData(), frame, duration));
+            m_filter->anim_set(name.constData(), value.toInt(), frame, duration, mlt_keyframe_linear);
+            bChanged = true;
+        }
+    }
+    else if(type == "rect")
+    {
+        QStringList listValue = value.split(" ", QString::SkipEmptyParts);
+        double x = listValue[0].toDouble();
+        double y = listValue[1].toDouble();
+        double width = listValue[2].toDouble();
+        double height = listValue[3].toDouble();
+        double opacity = listValue[4].toDouble();
+
+        mlt_rect rect = m_filter->anim_get_rect(name.constData(), frame, duration);
+        if (!bKeyFrame
+            || !qFuzzyCompare(x,rect.x) || !qFuzzyCompare(y,rect.y) || !qFuzzyCompare(width,rect.w) || !qFuzzyCompare(height,rect.h) || !qFuzzyCompare(opacity,rect.o))
+        {
+            from_value = QString("%1 %2 %3 %4 %5").arg(rect.x).arg(rect.y).arg(rect.w).arg(rect.h).arg(rect.o);
+            rect.x = x;
+            rect.y = y;
+            rect.w = width;
+            rect.h = height;
+            rect.o = opacity;
+
+            m_filter->anim_set(name.constData(), rect, frame, duration); //, mlt_keyframe_smooth); mlt_keyframe_smooth 可能有问题，在颜色显示时很明显  https://github.com/hansewu/MovieMator/issues/271
+            bChanged = true;
+        }
+    }
+    else
+    {
+        if (!bKeyFrame || value != m_filter->anim_get(name.constData(), frame, duration))
+        {
+            from_value = QString::fromUtf8(m_filter->anim_get(name.constData(), frame, duration));
+            m_filter->anim_set(name.constData(), value.toUtf8().constData(), frame, duration);
+            bChanged = true;
+        }
+    }
+
+    if (bChanged)
+        updateKeyFrameIndex(key, frame, true);
+    return from_value;
+}
+
 void QmlFilter::removeAllKeyFrame(bool bFromUndo)
 {
     Q_ASSERT(m_metadata);
@@ -1047,18 +1063,15 @@ void QmlFilter::removeAllKeyFrame(QString name, bool bFromUndo)
     Mlt::Animation animation = getAnimation(name);
     if (!animation.is_valid())   return;
 
-    int nKeyFrameCount = this->getKeyFrameCountOnProject(name);
-    for (int index = nKeyFrameCount-1; index >= 0; index--)
-    {
-        int nFrame          = animation.key_get_frame(index);
-        int nFrameInClip    = MAIN.timelineDock()->getPositionOnClip(nFrame);
-        removeAnimationKeyFrame(nFrameInClip, name, bFromUndo);
-//        animation.remove(nFrame);
-    }
+    QVector<int> keyFrames = keyFrameIndex(name);
+    QList<int> framesInClip;
+    for (int index = keyFrames.count()-1; index >= 0; index--)
+        framesInClip << MAIN.timelineDock()->getPositionOnClip(keyFrames.at(index));
+    removeAnimationKeyFrames(framesInClip, name, bFromUndo);
 
     emit keyframeNumberChanged();
 
-    MLT.refreshConsumer();
+    MAIN.timelineDock()->model()->refreshService(m_filter);
     emit filterPropertyValueChanged();
 }
 
@@ -1076,7 +1089,7 @@ void QmlFilter::removeKeyFrameParaValue(int frame, bool bFromUndo)
 
     emit keyframeNumberChanged();
 
-    MLT.refreshConsumer();
+    MAIN.timelineDock()->model()->refreshService(m_filter);
     emit filterPropertyValueChanged();
 
     return;
@@ -1084,7 +1097,7 @@ void QmlFilter::removeKeyFrameParaValue(int frame, bool bFromUndo)
 
 void QmlFilter::syncCacheToProject()
 {
-    MLT.refreshConsumer();
+    MAIN.timelineDock()->model()->refreshService(m_filter);
     emit filterPropertyValueChanged();
 }
 
@@ -1097,7 +1110,7 @@ bool QmlFilter::cache_bKeyFrame(int frame, QString propertyName)
     if (propertyName == nullptr) propertyName = getAnyAnimPropertyName();
     if (propertyName == nullptr) return false;
 
-    return getAnimation(propertyName).is_key(frame);
+    return isKeyFrame(propertyName, frame);
 }
 
 
@@ -1112,8 +1125,7 @@ bool QmlFilter::bHasPreKeyFrame(int frame)
         if (paramCount <= 0) return false;
         QString name = m_metadata->keyframes()->parameter(0)->property();
 
-        if (getAnimation(name).is_key(frameInParent)) frameInParent = frameInParent - 1;
-        int nKeyFrame = getAnimation(name).previous_key(frameInParent);
+        int nKeyFrame = previousKeyFrame(name, frameInParent);
         nKeyFrame = MAIN.timelineDock()->getPositionOnClip(nKeyFrame);
 
         if (nKeyFrame >= 0 && (nKeyFrame != frame)) return true;
@@ -1133,9 +1145,7 @@ bool QmlFilter::bHasNextKeyFrame(int frame)
         if (paramCount <= 0) return false;
         QString name = m_metadata->keyframes()->parameter(0)->property();
 
-        if (getAnimation(name).is_key(frameInParent)) frameInParent = frameInParent + 1;
-
-        int nKeyFrame = getAnimation(name).next_key(frameInParent);
+        int nKeyFrame = nextKeyFrame(name, frameInParent);
         nKeyFrame = MAIN.timelineDock()->getPositionOnClip(nKeyFrame);
 
         int nClipLength = MAIN.timelineDock()->getCurrentClipLength();
@@ -1259,6 +1269,94 @@ QRectF QmlFilter::getAnimRectValue(int frame, QString key)
     return QRectF();
 }
 
+const QVector<int>& QmlFilter::keyFrameIndex(const QString& name)
+{
+    QHash<QString, QVector<int> >::const_iterator it = m_keyFrameIndex.constFind(name);
+    if (it != m_keyFrameIndex.constEnd())
+        return it.value();
+
+    QVector<int> keyFrames;
+    Mlt::Animation animation = getAnimation(name);
+    if (animation.is_valid())
+    {
+        int nCount = animation.key_count();
+        keyFrames.reserve(nCount);
+        for (int i = 0; i < nCount; i++)
+            keyFrames.append(animation.key_get_frame(i));
+        std::sort(keyFrames.begin(), keyFrames.end());
+    }
+    return m_keyFrameIndex.insert(name, keyFrames).value();
+}
+
+void QmlFilter::updateKeyFrameIndex(const QString& name, int frame, bool isKey)
+{
+    QHash<QString, QVector<int> >::iterator it = m_keyFrameIndex.find(name);
+    if (it == m_keyFrameIndex.end())
+        return;
+
+    // 第一个关键帧写入时 mlt可能会在 0处补一个关键帧，这种情况下次查询时重新解析
+    if (isKey && it.value().isEmpty())
+    {
+        m_keyFrameIndex.erase(it);
+        return;
+    }
+
+    QVector<int>& keyFrames = it.value();
+    QVector<int>::iterator pos = std::lower_bound(keyFrames.begin(), keyFrames.end(), frame);
+    bool bExist = (pos != keyFrames.end() && *pos == frame);
+    if (isKey && !bExist)
+        keyFrames.insert(pos, frame);
+    else if (!isKey && bExist)
+        keyFrames.erase(pos);
+}
+
+void QmlFilter::invalidateKeyFrameIndex(const QString& name)
+{
+    if (name.isEmpty())
+        m_keyFrameIndex.clear();
+    else
+        m_keyFrameIndex.remove(name);
+}
+
+bool QmlFilter::isKeyFrame(const QString& name, int frame)
+{
+    const QVector<int>& keyFrames = keyFrameIndex(name);
+    return std::binary_search(keyFrames.constBegin(), keyFrames.constEnd(), frame);
+}
+
+int QmlFilter::previousKeyFrame(const QString& name, int frame)
+{
+    const QVector<int>& keyFrames = keyFrameIndex(name);
+    QVector<int>::const_iterator pos = std::lower_bound(keyFrames.constBegin(), keyFrames.constEnd(), frame);
+    if (pos == keyFrames.constBegin())
+        return -1;
+    return *(pos - 1);
+}
+
+int QmlFilter::nextKeyFrame(const QString& name, int frame)
+{
+    const QVector<int>& keyFrames = keyFrameIndex(name);
+    QVector<int>::const_iterator pos = std::upper_bound(keyFrames.constBegin(), keyFrames.constEnd(), frame);
+    if (pos == keyFrames.constEnd())
+        return -1;
+    return *pos;
+}
+
+QString QmlFilter::paraType(const QString& name)
+{
+    if (m_paraTypes.isEmpty() && m_metadata && m_metadata->keyframes())
+    {
+        int paramCount = m_metadata->keyframes()->parameterCount();
+        for (int i = 0; i < paramCount; i++)
+        {
+            QString property = m_metadata->keyframes()->parameter(i)->property();
+            if (!m_paraTypes.contains(property))
+                m_paraTypes.insert(property, m_metadata->keyframes()->parameter(i)->paraType());
+        }
+    }
+    return m_paraTypes.value(name, "string");
+}
+
 QString QmlFilter::getAnyAnimPropertyName()
 {
     Q_ASSERT(m_metadata);
@@ -1308,6 +1406,7 @@ int QmlFilter::getKeyFrame(int index, QString propertyName)
 void QmlFilter::refreshKeyFrame(const QVector<key_frame_item> &listKeyFrame)
 {
     Q_UNUSED(listKeyFrame)
+    invalidateKeyFrameIndex();
 }
 
 void QmlFilter::refreshNoAnimation(const QVector<key_frame_item> &listParameter, bool bFromUndo)
@@ -1321,13 +1420,7 @@ void QmlFilter::refreshNoAnimation(const QVector<key_frame_item> &listParameter,
             QString sPropertyName   = iter.key();
             QString sValue          = iter.value();
 
-            QString paraType    = "string";
-            int paramCount      = m_metadata->keyframes()->parameterCount();
-            for (int i = 0; i < paramCount; i++)
-            {
-                 QString name = m_metadata->keyframes()->parameter(i)->property();
-                 if (name == sPropertyName) { paraType = m_metadata->keyframes()->parameter(i)->paraType(); break; }
-            }
+            QString paraType    = this->paraType(sPropertyName);
 
             if (paraType == "double")
                 m_filter->set(sPropertyName.toUtf8().constData(), sValue.toDouble());
@@ -1355,8 +1448,9 @@ void QmlFilter::refreshNoAnimation(const QVector<key_frame_item> &listParameter,
             iter++;
         }
     }
+    invalidateKeyFrameIndex();
 
-    MLT.refreshConsumer();
+    MAIN.timelineDock()->model()->refreshService(m_filter);
     emit filterPropertyValueChanged();
     emit keyframeNumberChanged();
 }
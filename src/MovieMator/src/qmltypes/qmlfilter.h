@@ -31,6 +31,7 @@
 #include <MltFilter.h>
 #include "qmlmetadata.h"
 #include <QVector>
+#include <QHash>
 
 class AbstractJob;
 class AbstractTask;
@@ -310,6 +311,15 @@ public:
      */
     Q_INVOKABLE void cache_setKeyFrameParaValue(int frame, QString key, QString value, bool bFromUndo = false);
 
+    /** Set QString values associated to the name at several frame positions in one step.
+     * Used to import many key frames (e.g. motion tracking data): only one undo step is
+     * pushed and the UI is notified once.
+     * \param frames the frame numbers in the clip
+     * \param key the property to set
+     * \param values the values, one for each frame
+     */
+    Q_INVOKABLE void cache_setKeyFrameParaValues(const QList<int>& frames, QString key, const QStringList& values, bool bFromUndo = false);
+
     /** Set a QRectF value associated to the name at a frame position to cached data.
      *
      * \param key the property to set
@@ -490,6 +500,20 @@ public:
      */
     Q_INVOKABLE void removeAnimationKeyFrame(int nFrame, QString name, bool bFromUndo = false);
 
+    /** Remove the keyframes at the specified positions in one step.
+     *
+     * \param frames the frame numbers in the clip of the animation nodes to remove
+     * \param name the property to remove key frames
+     */
+    Q_INVOKABLE void removeAnimationKeyFrames(const QList<int>& frames, QString name, bool bFromUndo = false);
+
+    /** Drop the keyframe index of a property, or of all properties when name is empty.
+     * Must be called when the Mlt::Filter was modified without going through QmlFilter.
+     *
+     * \param name the property whose key frames changed
+     */
+    void invalidateKeyFrameIndex(const QString& name = QString());
+
 //#endif
 
     /** A Boolean value that indicates whether the animation is enable state.
@@ -573,6 +597,34 @@ private:
     //获取filter中任何一个支持动画的属性名
     QString getAnyAnimPropertyName();
 
+    /** Get the sorted key frames (in the parent producer) of a property.
+     * The animation is parsed only when the property is not in the index yet.
+     */
+    const QVector<int>& keyFrameIndex(const QString& name);
+
+    /** Add or remove a key frame of a property in the index after writing it. */
+    void updateKeyFrameIndex(const QString& name, int frame, bool isKey);
+
+    bool isKeyFrame(const QString& name, int frame);
+    int previousKeyFrame(const QString& name, int frame);   //严格小于frame的关键帧，没有返回-1
+    int nextKeyFrame(const QString& name, int frame);       //严格大于frame的关键帧，没有返回-1
+
+    /** Get the type of a keyframe parameter from the metadata, "string" if unknown. */
+    QString paraType(const QString& name);
+
+    /** Set a key frame value at a frame in the parent producer.
+     * \return the previous value, or "" if the key frame already had this value
+     */
+    QString setKeyFrameValue(int frame, const QString& key, const QString& value);
+
+    /** Get the value of a property at a frame in the clip as a string for undo. */
+    QString animValueString(int nFrameInClip, const QString& name);
+
+    void setKeyFrameValues(const QList<int>& frames, const QString& key, const QStringList& values, bool bFromUndo);
+
+    QHash<QString, QVector<int> > m_keyFrameIndex;  /** sorted key frames of each property, updated by writes*/
+    QHash<QString, QString> m_paraTypes;            /** the parameter type of each keyframe property*/
+
     //QVector<key_frame_item> m_cacheKeyFrameList; /** Cache data for keyframes*/
     bool m_bEnableAnimation;                /** a flag to indicate if the animation is enable state or not*/
     bool m_bAutoAddKeyFrame;                /** a flag to indicate if automatically add key frames or not*/
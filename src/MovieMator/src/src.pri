@@ -0,0 +1,450 @@
+# 主程序和基准、测试程序共用的源文件与链接设置，各自的 .pro只需要加上自己的 main.cpp
+# 路径都以 $$PWD开头，被其他目录下的工程包含时也能找到
+
+CONFIG   += link_prl
+
+QT       += widgets opengl xml qml quick sql svg
+QT       += multimedia quickwidgets
+QT       += qml-private core-private quick-private gui-private
+#QMAKE_LFLAGS +=MovieMator_Pro=1
+
+win32:DEFINES += QT_STATIC
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/mainwindow.cpp \
+    $$PWD/scrubbar.cpp \
+    $$PWD/openotherdialog.cpp \
+    $$PWD/controllers/filtercontroller.cpp \
+    $$PWD/widgets/plasmawidget.cpp \
+    $$PWD/widgets/lissajouswidget.cpp \
+    $$PWD/widgets/isingwidget.cpp \
+    $$PWD/widgets/video4linuxwidget.cpp \
+    $$PWD/widgets/colorproducerwidget.cpp \
+    $$PWD/widgets/decklinkproducerwidget.cpp \
+    $$PWD/widgets/networkproducerwidget.cpp \
+    $$PWD/widgets/colorbarswidget.cpp \
+    $$PWD/widgets/noisewidget.cpp \
+    $$PWD/widgets/pulseaudiowidget.cpp \
+    $$PWD/widgets/jackproducerwidget.cpp \
+    $$PWD/widgets/toneproducerwidget.cpp \
+    $$PWD/widgets/alsawidget.cpp \
+    $$PWD/widgets/x11grabwidget.cpp \
+    $$PWD/player.cpp \
+    $$PWD/widgets/servicepresetwidget.cpp \
+    $$PWD/abstractproducerwidget.cpp \
+    $$PWD/widgets/avformatproducerwidget.cpp \
+    $$PWD/widgets/imageproducerwidget.cpp \
+    $$PWD/widgets/timespinbox.cpp \
+    $$PWD/widgets/audiometerwidget.cpp \
+    $$PWD/docks/encodedock.cpp \
+    $$PWD/dialogs/addencodepresetdialog.cpp \
+    $$PWD/jobqueue.cpp \
+    $$PWD/docks/jobsdock.cpp \
+    $$PWD/dialogs/textviewerdialog.cpp \
+    $$PWD/dialogs/durationdialog.cpp \
+    $$PWD/widgets/colorwheel.cpp \
+    $$PWD/models/attachedfiltersmodel.cpp \
+    $$PWD/models/metadatamodel.cpp \
+    $$PWD/docks/filtersdock.cpp \
+    $$PWD/dialogs/customprofiledialog.cpp \
+    $$PWD/qmltypes/colorpickeritem.cpp \
+    $$PWD/qmltypes/colorwheelitem.cpp \
+    $$PWD/qmltypes/qmlfile.cpp \
+    $$PWD/qmltypes/qmlfilter.cpp \
+    $$PWD/qmltypes/qmlhtmleditor.cpp \
+    $$PWD/qmltypes/timelineitems.cpp \
+    $$PWD/widgets/lineeditclear.cpp \
+    $$PWD/widgets/webvfxproducer.cpp \
+    $$PWD/widgets/gltestwidget.cpp \
+    $$PWD/models/multitrackmodel.cpp \
+    $$PWD/docks/timelinedock.cpp \
+    $$PWD/qmltypes/thumbnailprovider.cpp \
+    $$PWD/commands/timelinecommands.cpp \
+    $$PWD/widgets/lumamixtransition.cpp \
+    $$PWD/autosavefile.cpp \
+    $$PWD/mediaprobe.cpp \
+    $$PWD/previewrendercache.cpp \
+    $$PWD/projectloader.cpp \
+    $$PWD/proxymanager.cpp \
+    $$PWD/timelineexporter.cpp \
+    $$PWD/widgets/directshowvideowidget.cpp \
+    $$PWD/jobs/abstractjob.cpp \
+    $$PWD/jobs/meltjob.cpp \
+    $$PWD/jobs/encodejob.cpp \
+    $$PWD/jobs/videoqualityjob.cpp \
+    $$PWD/docks/scopedock.cpp \
+    $$PWD/controllers/scopecontroller.cpp \
+    $$PWD/widgets/scopes/scopewidget.cpp \
+    $$PWD/widgets/scopes/audioloudnessscopewidget.cpp \
+    $$PWD/widgets/scopes/audiopeakmeterscopewidget.cpp \
+    $$PWD/widgets/scopes/audiospectrumscopewidget.cpp \
+    $$PWD/widgets/scopes/audiowaveformscopewidget.cpp \
+    $$PWD/widgets/scopes/videowaveformscopewidget.cpp \
+    $$PWD/widgets/audioscale.cpp \
+    $$PWD/commands/undohelper.cpp \
+    $$PWD/models/audiolevelstask.cpp \
+    $$PWD/models/loudnessmeter.cpp \
+    $$PWD/models/loudnesstask.cpp \
+    $$PWD/mltxmlchecker.cpp \
+    $$PWD/widgets/avfoundationproducerwidget.cpp \
+    $$PWD/widgets/gdigrabwidget.cpp \
+    $$PWD/widgets/trackpropertieswidget.cpp \
+    $$PWD/widgets/timelinepropertieswidget.cpp \
+    $$PWD/widgets/filterwidget.cpp \
+    $$PWD/jobs/ffmpegjob.cpp \
+    $$PWD/dialogs/unlinkedfilesdialog.cpp \
+    $$PWD/widgets/textmanagerwidget.cpp \
+    $$PWD/qmltypes/qmltextmetadata.cpp \
+    $$PWD/models/textmetadatamodel.cpp \
+    $$PWD/docks/textlistdock.cpp \
+    $$PWD/docks/resourcebuttondockwidget.cpp \
+    $$PWD/qmltypes/filesavedialog.cpp \
+    $$PWD/dialogs/registrationtipsdialog.cpp \
+    $$PWD/dialogs/registrationdialog.cpp \
+    $$PWD/registrationchecker.cpp \
+    $$PWD/dialogs/profeaturepromptdialog.cpp \
+    $$PWD/dialogs/upgradetopropromptdialog.cpp \
+    $$PWD/maincontroller.cpp \
+    $$PWD/jobs/encodetask.cpp \
+    $$PWD/dialogs/invalidprojectdialog.cpp \
+    $$PWD/encodetaskqueue.cpp \
+    $$PWD/docks/encodetaskdock.cpp \
+    $$PWD/melt/melt_main.c \
+    $$PWD/melt/io.c \
+    $$PWD/jobs/abstracttask.cpp \
+    $$PWD/jobs/melttask.cpp \
+    $$PWD/jobs/segmentedencodetask.cpp \
+    $$PWD/dialogs/mmsplashscreen.cpp \
+    $$PWD/qmltypes/mmqmlutilities.cpp \
+    $$PWD/maininterface.cpp \
+    $$PWD/containerdock.cpp \
+    $$PWD/widgets/avformatproducersimplewidget.cpp \
+    $$PWD/CrashHandler/CrashHandler.cpp \
+#    templateeidtor.cpp \
+    $$PWD/commands/abstractcommand.cpp \
+    $$PWD/dialogs/videomodesettingsdialog.cpp \
+    $$PWD/dialogs/aspectratiosettingsdialog.cpp
+
+HEADERS  += $$PWD/mainwindow.h \
+    $$PWD/scrubbar.h \
+    $$PWD/openotherdialog.h \
+    $$PWD/controllers/filtercontroller.h \
+    $$PWD/widgets/plasmawidget.h \
+    $$PWD/abstractproducerwidget.h \
+    $$PWD/widgets/lissajouswidget.h \
+    $$PWD/widgets/isingwidget.h \
+    $$PWD/widgets/video4linuxwidget.h \
+    $$PWD/widgets/colorproducerwidget.h \
+    $$PWD/widgets/decklinkproducerwidget.h \
+    $$PWD/widgets/networkproducerwidget.h \
+    $$PWD/widgets/colorbarswidget.h \
+    $$PWD/widgets/noisewidget.h \
+    $$PWD/widgets/pulseaudiowidget.h \
+    $$PWD/widgets/jackproducerwidget.h \
+    $$PWD/widgets/toneproducerwidget.h \
+    $$PWD/widgets/alsawidget.h \
+    $$PWD/widgets/x11grabwidget.h \
+    $$PWD/player.h \
+    $$PWD/widgets/servicepresetwidget.h \
+    $$PWD/widgets/avformatproducerwidget.h \
+    $$PWD/widgets/imageproducerwidget.h \
+    $$PWD/widgets/timespinbox.h \
+    $$PWD/widgets/iecscale.h \
+    $$PWD/widgets/audiometerwidget.h \
+    $$PWD/docks/encodedock.h \
+    $$PWD/dialogs/addencodepresetdialog.h \
+    $$PWD/jobqueue.h \
+    $$PWD/docks/jobsdock.h \
+    $$PWD/dialogs/textviewerdialog.h \
+    $$PWD/dialogs/durationdialog.h \
+    $$PWD/widgets/colorwheel.h \
+    $$PWD/models/attachedfiltersmodel.h \
+    $$PWD/models/metadatamodel.h \
+    $$PWD/docks/filtersdock.h \
+    $$PWD/dialogs/customprofiledialog.h \
+    $$PWD/qmltypes/colorpickeritem.h \
+    $$PWD/qmltypes/colorwheelitem.h \
+    $$PWD/qmltypes/qmlfile.h \
+    $$PWD/qmltypes/qmlfilter.h \
+    $$PWD/qmltypes/qmlhtmleditor.h \
+    $$PWD/qmltypes/timelineitems.h \
+    $$PWD/widgets/lineeditclear.h \
+    $$PWD/widgets/webvfxproducer.h \
+    $$PWD/widgets/gltestwidget.h \
+    $$PWD/models/multitrackmodel.h \
+    $$PWD/docks/timelinedock.h \
+    $$PWD/qmltypes/thumbnailprovider.h \
+    $$PWD/commands/timelinecommands.h \
+    $$PWD/widgets/lumamixtransition.h \
+    $$PWD/autosavefile.h \
+    $$PWD/mediaprobe.h \
+    $$PWD/previewrendercache.h \
+    $$PWD/projectloader.h \
+    $$PWD/proxymanager.h \
+    $$PWD/timelineexporter.h \
+    $$PWD/widgets/directshowvideowidget.h \
+    $$PWD/jobs/abstractjob.h \
+    $$PWD/jobs/meltjob.h \
+    $$PWD/jobs/encodejob.h \
+    $$PWD/jobs/videoqualityjob.h \
+    $$PWD/docks/scopedock.h \
+    $$PWD/controllers/scopecontroller.h \
+    $$PWD/widgets/scopes/scopewidget.h \
+    $$PWD/widgets/scopes/audioloudnessscopewidget.h \
+    $$PWD/widgets/scopes/audiopeakmeterscopewidget.h \
+    $$PWD/widgets/scopes/audiospectrumscopewidget.h \
+    $$PWD/widgets/scopes/audiowaveformscopewidget.h \
+    $$PWD/widgets/scopes/videowaveformscopewidget.h \
+    $$PWD/dataqueue.h \
+    $$PWD/framefanout.h \
+    $$PWD/widgets/audioscale.h \
+    $$PWD/commands/undohelper.h \
+    $$PWD/models/audiolevelstask.h \
+    $$PWD/models/loudnessmeter.h \
+    $$PWD/models/loudnesstask.h \
+    $$PWD/mltxmlchecker.h \
+    $$PWD/widgets/avfoundationproducerwidget.h \
+    $$PWD/widgets/gdigrabwidget.h \
+    $$PWD/widgets/trackpropertieswidget.h \
+    $$PWD/widgets/timelinepropertieswidget.h \
+    $$PWD/widgets/filterwidget.h \
+    $$PWD/jobs/ffmpegjob.h \
+    $$PWD/dialogs/unlinkedfilesdialog.h \
+    $$PWD/widgets/textmanagerwidget.h \
+    $$PWD/qmltypes/qmltextmetadata.h \
+    $$PWD/models/textmetadatamodel.h \
+    $$PWD/docks/textlistdock.h \
+    $$PWD/docks/resourcebuttondockwidget.h \
+    $$PWD/iratetransport.h \
+    $$PWD/securitybookmark/transport_security_bookmark.h \
+    $$PWD/qmltypes/filesavedialog.h \
+    $$PWD/eccregister/transport_ecc_register.h \
+    $$PWD/dialogs/registrationtipsdialog.h \
+    $$PWD/dialogs/registrationdialog.h \
+    $$PWD/registrationchecker.h \
+    $$PWD/dialogs/profeaturepromptdialog.h \
+    $$PWD/dialogs/upgradetopropromptdialog.h \
+    $$PWD/maincontroller.h \
+    $$PWD/jobs/encodetask.h \
+    $$PWD/dialogs/invalidprojectdialog.h \
+    $$PWD/encodetaskqueue.h \
+    $$PWD/docks/encodetaskdock.h \
+    $$PWD/melt/io.h \
+    $$PWD/jobs/abstracttask.h \
+    $$PWD/jobs/melttask.h \
+    $$PWD/jobs/segmentedencodetask.h \
+    $$PWD/melt/melt.h \
+    $$PWD/dialogs/mmsplashscreen.h \
+    $$PWD/qmltypes/mmqmlutilities.h \
+    $$PWD/maininterface.h \
+    $$PWD/containerdock.h \
+    $$PWD/widgets/avformatproducersimplewidget.h \
+#    templateeidtor.h \
+    $$PWD/eccregister/CEccRegister.h \
+    $$PWD/commands/abstractcommand.h \
+    $$PWD/CrashHandler/CrashHandler.h \
+    $$PWD/dialogs/videomodesettingsdialog.h \
+    $$PWD/dialogs/aspectratiosettingsdialog.h
+
+mac {
+    SOURCES += $$PWD/securitybookmark/SecurityBookmark.mm \
+                $$PWD/../iRate/iRate.mm
+    HEADERS += $$PWD/securitybookmark/SecurityBookmark.h \
+                $$PWD/../iRate/iRate.h
+}
+
+
+FORMS    += $$PWD/mainwindow.ui \
+    $$PWD/openotherdialog.ui \
+    $$PWD/widgets/plasmawidget.ui \
+    $$PWD/widgets/lissajouswidget.ui \
+    $$PWD/widgets/isingwidget.ui \
+    $$PWD/widgets/video4linuxwidget.ui \
+    $$PWD/widgets/colorproducerwidget.ui \
+    $$PWD/widgets/decklinkproducerwidget.ui \
+    $$PWD/widgets/networkproducerwidget.ui \
+    $$PWD/widgets/colorbarswidget.ui \
+    $$PWD/widgets/noisewidget.ui \
+    $$PWD/widgets/pulseaudiowidget.ui \
+    $$PWD/widgets/jackproducerwidget.ui \
+    $$PWD/widgets/toneproducerwidget.ui \
+    $$PWD/widgets/alsawidget.ui \
+    $$PWD/widgets/x11grabwidget.ui \
+    $$PWD/widgets/servicepresetwidget.ui \
+    $$PWD/widgets/avformatproducerwidget.ui \
+    $$PWD/widgets/imageproducerwidget.ui \
+    $$PWD/dialogs/addencodepresetdialog.ui \
+    $$PWD/docks/jobsdock.ui \
+    $$PWD/dialogs/textviewerdialog.ui \
+    $$PWD/dialogs/durationdialog.ui \
+    $$PWD/dialogs/customprofiledialog.ui \
+    $$PWD/widgets/webvfxproducer.ui \
+    $$PWD/docks/timelinedock.ui \
+    $$PWD/widgets/lumamixtransition.ui \
+    $$PWD/widgets/directshowvideowidget.ui \
+    $$PWD/widgets/avfoundationproducerwidget.ui \
+    $$PWD/widgets/gdigrabwidget.ui \
+    $$PWD/widgets/trackpropertieswidget.ui \
+    $$PWD/widgets/timelinepropertieswidget.ui \
+    $$PWD/docks/encodedock.ui \
+    $$PWD/dialogs/unlinkedfilesdialog.ui \
+    $$PWD/docks/textlistdock.ui \
+    $$PWD/docks/resourcebuttondockwidget.ui \
+    $$PWD/dialogs/registrationtipsdialog.ui \
+    $$PWD/dialogs/registrationdialog.ui \
+    $$PWD/dialogs/profeaturepromptdialog.ui \
+    $$PWD/dialogs/upgradetopropromptdialog.ui \
+    $$PWD/dialogs/invalidprojectdialog.ui \
+    $$PWD/docks/encodetaskdock.ui \
+    $$PWD/widgets/avformatproducersimplewidget.ui \
+    $$PWD/dialogs/videomodesettingsdialog.ui \
+    $$PWD/dialogs/aspectratiosettingsdialog.ui
+
+RESOURCES += \
+    $$PWD/../icons/resources.qrc \
+    $$PWD/../other-resources.qrc
+
+INCLUDEPATH += $$PWD/../CuteLogger/include $$PWD/../CommonUtil $$PWD/../MltController $$PWD/../QmlUtilities
+INCLUDEPATH += $$PWD/../include
+INCLUDEPATH += $$PWD/../Breakpad/breakpad/src
+INCLUDEPATH += $$PWD/../ResourceDockGenerator
+
+# 库的输出目录用 $$shadowed()推算，被 tests/<名字>/ 这样更深一层的工程包含时也能找到
+MM_BUILD_ROOT = $$shadowed($$PWD/..)
+debug_and_release {
+    build_pass:CONFIG(debug, debug|release) {
+        LIBS += -L$$MM_BUILD_ROOT/CuteLogger/debug -L$$MM_BUILD_ROOT/CommonUtil/debug -L$$MM_BUILD_ROOT/MltController/debug
+        LIBS += -L$$MM_BUILD_ROOT/QmlUtilities/debug
+        LIBS += -L$$MM_BUILD_ROOT/Breakpad/debug
+        LIBS += -L$$MM_BUILD_ROOT/ResourceDockGenerator/debug
+    } else {
+        LIBS += -L$$MM_BUILD_ROOT/CuteLogger/release -L$$MM_BUILD_ROOT/CommonUtil/release -L$$MM_BUILD_ROOT/MltController/release
+        LIBS += -L$$MM_BUILD_ROOT/QmlUtilities/release
+        LIBS += -L$$MM_BUILD_ROOT/Breakpad/release
+        LIBS += -L$$MM_BUILD_ROOT/ResourceDockGenerator/release
+    }
+} else {
+    LIBS += -L$$MM_BUILD_ROOT/CuteLogger -L$$MM_BUILD_ROOT/CommonUtil -L$$MM_BUILD_ROOT/MltController -L$$MM_BUILD_ROOT/QmlUtilities #-L../mm
+    LIBS += -L$$MM_BUILD_ROOT/Breakpad
+    LIBS += -L$$MM_BUILD_ROOT/ResourceDockGenerator
+}
+
+LIBS += -lLogger -lpthread -lCommonUtil -lMltController -lQmlUtilities
+LIBS += -lBreakpad
+LIBS += -lResourceDockGenerator
+
+
+
+#INCLUDEPATH += ../PythonQt3.2/src
+
+#LIBS += -L/Users/gdb/work/MacVideoEditor/trunk/MovieMator/PythonQt3.2/lib
+
+#LIBS += -lPythonQt-Qt5-Python2.7_d
+
+mac {
+#    DEFINES += STEAM=1
+    #pro share
+    DEFINES += MOVIEMATOR_PRO=1
+    DEFINES += SHARE_VERSION=1
+    QMAKE_INFO_PLIST = $$PWD/../Info_share.plist
+    ICON = $$PWD/../icons/moviemator-pro.icns
+    TARGET = "MovieMator Video Editor Pro"
+
+
+    #free appstore
+#    DEFINES += MOVIEMATOR_FREE=1
+#    TARGET = "MovieMator Video Editor Lite"
+#    QMAKE_INFO_PLIST = $$PWD/../Info-Free.plist
+#    ICON = $$PWD/../icons/moviemator.icns
+
+    #share 国区免费版本
+#    DEFINES += SHARE_VERSION=1
+#    DEFINES += MOVIEMATOR_FREE=1
+#    TARGET = "MovieMator Video Editor Pro"
+#    QMAKE_INFO_PLIST = $$PWD/../Info_share.plist
+#    ICON = $$PWD/../icons/moviemator-pro.icns
+
+    #pro appstore
+#    DEFINES += MOVIEMATOR_PRO=1
+#    TARGET = "MovieMator Video Editor Pro"
+#    QMAKE_INFO_PLIST = $$PWD/../Info.plist
+#    ICON = $$PWD/../icons/moviemator-pro.icns
+
+    QMAKE_MACOSX_DEPLOYMENT_TARGET = 10.8
+
+    # QMake from Qt 5.1.0 on OSX is messing with the environment in which it runs
+    # pkg-config such that the PKG_CONFIG_PATH env var is not set.
+    isEmpty(MLT_PREFIX) {
+#        MLT_PREFIX = $$PWD/../../../../mlt_lib
+#        MLT_PREFIX = $$PWD/../../../../MovieMator_gdb/MacVideoEditor/trunk/shotcut/mlt_build
+        MLT_PREFIX = $$PWD/../../../../shotcut/mlt_build/
+#        count($$USER, wzq)
+#        {
+#            MLT_PREFIX = /Users/wzq/Desktop/data/project/2018/moviemator/libs/mlt_build/debug
+#        }
+    }
+
+    INCLUDEPATH += $$MLT_PREFIX/include/mlt++
+    INCLUDEPATH += $$MLT_PREFIX/include/mlt
+#    INCLUDEPATH += ./mltmodules
+
+#    INCLUDEPATH += $$MLT_PREFIX/include/SDL
+
+    LIBS += -L$$MLT_PREFIX/lib -lmlt++ -lmlt
+#    LIBS += -L$$MLT_PREFIX/lib -lmlt++ -lmlt -lSDL
+#    LIBS += -lexif -lmltqt
+    LIBS += "-framework Cocoa"
+    LIBS += -L$$PWD/../../../../build/ecc -lregister
+
+    QMAKE_LFLAGS += -Wl,/usr/lib/libcrypto.0.9.8.dylib
+#    INCLUDEPATH += /System/Library/Frameworks/Python.framework/Versions/2.7/include/python2.7
+#    LIBS += -F/System/Library/Frameworks -framework Python
+    QMAKE_RPATHDIR += @executable_path/../Frameworks
+#    QT_PLUGIN_PATH += @executable_path/qt_lib/plugins/
+#    QT_QPA_PLATFORM_PLUGIN_PATH = @executable_path/qt_lib/plugins/platforms/
+}
+
+
+win32 {
+     #中国网站版
+    DEFINES += MOVIEMATOR_FREE=1
+    DEFINES += SHARE_VERSION=1
+
+    #国外网站版
+#    DEFINES += MOVIEMATOR_PRO=1
+#    DEFINES += SHARE_VERSION=1
+
+    #steam版
+#    DEFINES += STEAM=1
+#    DEFINES += MOVIEMATOR_PRO=1
+#    DEFINES += SHARE_VERSION=1
+}
+
+win32 {
+    CONFIG += windows rtti
+    isEmpty(MLT_PATH) {
+        message("MLT_PATH not set; using C:\\Projects\\MovieMator. You can change this with 'qmake MLT_PATH=...'")
+        MLT_PATH = C:\\Projects\\MovieMator
+    }
+    INCLUDEPATH += $$MLT_PATH\\include\\mlt++ $$MLT_PATH\\include\\mlt
+    LIBS += -L$$MLT_PATH\\lib -lmlt++ -lmlt -lopengl32
+
+    LIBS += -L$$MLT_PATH -leay32
+    LIBS += -L$$MLT_PATH -lregister
+}
+
+unix:!mac {
+    QT += x11extras
+    CONFIG += link_pkgconfig
+    PKGCONFIG += mlt++
+    LIBS += -lX11
+}
+
+isEmpty(MOVIEMATOR_VERSION) {
+    !win32:MOVIEMATOR_VERSION = $$system(date "+%y.%m.%d")
+     win32:MOVIEMATOR_VERSION = adhoc
+}
+#DEFINES += MOVIEMATOR_VERSION=\\\"$$MOVIEMATOR_VERSION\\\"
+DEFINES += MOVIEMATOR_VERSION=\\\"2.9.2\\\"
@@ -0,0 +1,341 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "timelineexporter.h"
+#include "shotcut_mlt_properties.h"
+#include <util.h>
+#include <qmlutilities.h>
+#include <Logger.h>
+#include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJSEngine>
+#include <QJSValue>
+#include <QRegExp>
+#include <QScopedPointer>
+#include <Mlt.h>
+
+TimelineExporter::TimelineExporter(Mlt::Tractor& tractor, const Options& options)
+    : m_tractor(tractor)
+    , m_options(options)
+    , m_fps(tractor.get_fps())
+{
+    if (m_fps <= 0.0)
+        m_fps = 25.0;
+}
+
+QString TimelineExporter::timecode(int frames) const
+{
+    //EDL使用不丢帧的时间码
+    int fps = qMax(1, qRound(m_fps));
+    frames = qMax(0, frames);
+    int ff = frames % fps;
+    int seconds = frames / fps;
+    return QString("%1:%2:%3:%4")
+            .arg(seconds / 3600, 2, 10, QChar('0'))
+            .arg(seconds / 60 % 60, 2, 10, QChar('0'))
+            .arg(seconds % 60, 2, 10, QChar('0'))
+            .arg(ff, 2, 10, QChar('0'));
+}
+
+QString TimelineExporter::reelName(Mlt::Producer& producer, const QString& resource) const
+{
+    if (!m_options.useBaseNameForReelName && producer.get(kShotcutHashProperty))
+        return QString::fromUtf8(producer.get(kShotcutHashProperty));
+    QString name = Util::baseName(resource);
+    name.replace(QRegExp("\\W"), "_");
+    return name;
+}
+
+void TimelineExporter::readClip(Mlt::Producer& producer, Event& event) const
+{
+    Mlt::Producer parent = producer.parent();
+    event.service = QString::fromUtf8(parent.get("mlt_service"));
+    event.speed = 1.0;
+    if (event.service == "timewarp") {
+        event.resource = QString::fromUtf8(parent.get("warp_resource"));
+        event.speed = parent.get_double("warp_speed");
+    } else {
+        event.resource = QString::fromUtf8(parent.get("resource"));
+    }
+    //使用代理文件时导出原始素材，timewarp的原始 resource带有“速度:”前缀
+    if (parent.get(kOriginalResourceProperty)) {
+        event.resource = QString::fromUtf8(parent.get(kOriginalResourceProperty));
+        int colon = event.resource.indexOf(':');
+        bool isSpeed = false;
+        if (event.service == "timewarp" && colon > 0)
+            event.resource.left(colon).toDouble(&isSpeed);
+        if (isSpeed)
+            event.resource = event.resource.mid(colon + 1);
+    }
+    event.reelName = reelName(parent, event.resource);
+
+    int n = producer.filter_count();
+    for (int i = 0; i < n; i++) {
+        QScopedPointer<Mlt::Filter> filter(producer.filter(i));
+        if (filter && filter->is_valid() && !filter->get_int("_loader"))
+            event.filters << QString::fromUtf8(filter->get("mlt_service"));
+    }
+}
+
+bool TimelineExporter::readTrack(int mltIndex, TrackEvents& track) const
+{
+    QScopedPointer<Mlt::Producer> producer(m_tractor.track(mltIndex));
+    if (!producer || !producer->is_valid())
+        return false;
+    track.id = QString::fromUtf8(producer->get("id"));
+    if (track.id == kBackgroundTrackId || track.id == kPlaylistTrackId)
+        return false;
+    if (producer->get_int(kAudioTrackProperty))
+        track.kind = "audio";
+    else if (producer->get_int(kVideoTrackProperty))
+        track.kind = "video";
+    else
+        return false;
+    track.name = QString::fromUtf8(producer->get(kTrackNameProperty));
+    if (track.name.isEmpty())
+        track.name = track.id;
+    int hide = producer->get_int("hide");
+    track.hidden = hide & 1;
+    track.muted = hide & 2;
+
+    //EDL通道：静音的音频轨、隐藏的视频轨不导出
+    track.format = track.kind == "audio" ? QString("A") : m_options.channelsAV;
+    if (track.muted)
+        track.format = track.kind == "audio" ? QString() : QString("V");
+    if (track.hidden && !track.format.isEmpty())
+        track.format = track.format == "V" ? QString() : QString("A");
+
+    Mlt::Playlist playlist(*producer);
+    int n = playlist.count();
+    for (int i = 0; i < n; i++) {
+        QScopedPointer<Mlt::ClipInfo> info(playlist.clip_info(i));
+        if (!info)
+            continue;
+        Event event;
+        event.position = info->start;
+        event.length = info->frame_count;
+        event.in = info->frame_in;
+        event.speed = 1.0;
+        event.inB = 0;
+        if (playlist.is_blank(i)) {
+            event.type = Blank;
+        } else if (info->producer && info->producer->parent().get(kShotcutTransitionProperty)) {
+            event.type = Transition;
+            Mlt::Tractor transition(info->producer->parent());
+            event.transitionService = QString::fromUtf8(transition.get(kShotcutTransitionProperty));
+            QScopedPointer<Mlt::Producer> trackA(transition.track(0));
+            QScopedPointer<Mlt::Producer> trackB(transition.track(1));
+            if (trackA && trackA->is_valid()) {
+                readClip(*trackA, event);
+                event.in = trackA->get_in();
+            }
+            if (trackB && trackB->is_valid()) {
+                Event b;
+                readClip(*trackB, b);
+                event.resourceB = b.resource;
+                event.reelNameB = b.reelName;
+                event.inB = trackB->get_in();
+            }
+        } else if (info->producer) {
+            event.type = Clip;
+            readClip(*info->producer, event);
+        } else {
+            continue;
+        }
+        track.events.append(event);
+    }
+    return true;
+}
+
+QList<TimelineExporter::TrackEvents> TimelineExporter::tracks() const
+{
+    QList<TrackEvents> result;
+    int n = m_tractor.count();
+    for (int i = 0; i < n; i++) {
+        TrackEvents track;
+        if (readTrack(i, track))
+            result.append(track);
+    }
+    return result;
+}
+
+bool TimelineExporter::writeEdl(QIODevice& device) const
+{
+    QTextStream out(&device);
+    QString title = QString::fromUtf8(m_tractor.get("title"));
+    out << "TITLE: " << (title.isEmpty() ? QString("Timeline") : title) << "\n";
+    out << "FCM: NON-DROP FRAME\n";
+
+    int n = m_tractor.count();
+    for (int i = 0; i < n; i++) {
+        TrackEvents track;
+        if (!readTrack(i, track) || track.format.isEmpty())
+            continue;
+        out << "\n === " << track.name << " === \n\n";
+        QString channels = track.format.leftJustified(4, ' ', true);
+        int eventNumber = 1;
+        foreach (const Event& event, track.events) {
+            if (event.type == Blank)
+                continue;
+            QString number = QString("%1").arg(eventNumber, 3, 10, QChar('0'));
+            QString recIn = timecode(event.position);
+            QString recOut = timecode(event.position + event.length);
+            if (event.type == Transition) {
+                //溶解：A片段的零长度剪切 + B片段的 D事件
+                QString srcA = timecode(qRound(event.in * event.speed));
+                out << number << "  " << event.reelName.leftJustified(8, ' ', true) << " "
+                    << channels << "  " << "C   " << "     "
+                    << srcA << " " << srcA << " " << recIn << " " << recIn << "\n";
+                out << number << "  " << event.reelNameB.leftJustified(8, ' ', true) << " "
+                    << channels << "  " << "D   " << " "
+                    << QString("%1").arg(event.length, 3, 10, QChar('0')) << " "
+                    << timecode(event.inB) << " " << timecode(event.inB + event.length) << " "
+                    << recIn << " " << recOut << "\n";
+                out << "* FROM CLIP NAME: " << (m_options.useBaseNameForClipComment ? Util::baseName(event.resource) : event.resource) << "\n";
+                out << "* TO CLIP NAME: " << (m_options.useBaseNameForClipComment ? Util::baseName(event.resourceB) : event.resourceB) << "\n";
+            } else {
+                int srcIn = qRound(event.in * event.speed);
+                int srcOut = srcIn + qRound(event.length * event.speed);
+                out << number << "  " << event.reelName.leftJustified(8, ' ', true) << " "
+                    << channels << "  " << "C   " << "     "
+                    << timecode(srcIn) << " " << timecode(srcOut) << " "
+                    << recIn << " " << recOut << "\n";
+                if (!qFuzzyCompare(event.speed, 1.0)) {
+                    //M2：变速片段的播放帧率
+                    out << "M2   " << event.reelName.leftJustified(8, ' ', true) << " "
+                        << QString::number(m_fps * event.speed, 'f', 1).rightJustified(5, '0') << "    "
+                        << timecode(srcIn) << "\n";
+                }
+                if (!event.resource.isEmpty())
+                    out << "* FROM CLIP NAME: " << (m_options.useBaseNameForClipComment ? Util::baseName(event.resource) : event.resource) << "\n";
+            }
+            ++eventNumber;
+        }
+    }
+    out.flush();
+    return out.status() == QTextStream::Ok;
+}
+
+QString TimelineExporter::edl() const
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    writeEdl(buffer);
+    return QString::fromUtf8(buffer.data());
+}
+
+QJsonObject TimelineExporter::json() const
+{
+    QJsonArray tracks;
+    foreach (const TrackEvents& track, this->tracks()) {
+        QJsonArray items;
+        foreach (const Event& event, track.events) {
+            QJsonObject item;
+            item["position"] = event.position;
+            item["length"] = event.length;
+            if (event.type == Blank) {
+                item["type"] = QString("gap");
+            } else if (event.type == Transition) {
+                QJsonObject from;
+                from["resource"] = event.resource;
+                from["in"] = event.in;
+                QJsonObject to;
+                to["resource"] = event.resourceB;
+                to["in"] = event.inB;
+                item["type"] = QString("transition");
+                item["transition"] = event.transitionService;
+                item["from"] = from;
+                item["to"] = to;
+            } else {
+                item["type"] = QString("clip");
+                item["resource"] = event.resource;
+                item["reel"] = event.reelName;
+                item["service"] = event.service;
+                item["in"] = event.in;
+                item["speed"] = event.speed;
+                item["filters"] = QJsonArray::fromStringList(event.filters);
+            }
+            items.append(item);
+        }
+        QJsonObject object;
+        object["id"] = track.id;
+        object["name"] = track.name;
+        object["kind"] = track.kind;
+        object["hidden"] = track.hidden;
+        object["muted"] = track.muted;
+        object["items"] = items;
+        tracks.append(object);
+    }
+
+    QJsonObject result;
+    result["schema"] = QString("moviemator.timeline/1");
+    result["name"] = QString::fromUtf8(m_tractor.get("title"));
+    result["fps"] = m_fps;
+    result["duration"] = m_tractor.get_playtime();
+    result["tracks"] = tracks;
+    //时间线还没有标记点，保留字段以便格式稳定
+    result["markers"] = QJsonArray();
+    return result;
+}
+
+bool TimelineExporter::writeJson(QIODevice& device) const
+{
+    QByteArray data = QJsonDocument(json()).toJson();
+    return device.write(data) == data.size();
+}
+
+QString TimelineExporter::legacyEdl(const QString& xml, const Options& options, QString* error)
+{
+    QDir qmlDir = QmlUtilities::qmlDir();
+    qmlDir.cd("export-edl");
+    QString jsFileName = qmlDir.absoluteFilePath("export-edl.js");
+    QFile scriptFile(jsFileName);
+    if (!scriptFile.open(QIODevice::ReadOnly)) {
+        if (error)
+            *error = QString("Failed to open %1").arg(jsFileName);
+        return QString();
+    }
+    QTextStream stream(&scriptFile);
+    QString contents = stream.readAll();
+    scriptFile.close();
+
+    QJSEngine jsEngine;
+    QJSValue result = jsEngine.evaluate(contents, jsFileName);
+    if (!result.isError()) {
+        QJSValue jsOptions = jsEngine.newObject();
+        jsOptions.setProperty("useBaseNameForReelName", options.useBaseNameForReelName);
+        jsOptions.setProperty("useBaseNameForClipComment", options.useBaseNameForClipComment);
+        jsOptions.setProperty("channelsAV", options.channelsAV);
+        QJSValueList args;
+        args << xml << jsOptions;
+        result = result.call(args);
+    }
+    if (result.isError()) {
+        LOG_ERROR() << "Uncaught exception at line"
+                    << result.property("lineNumber").toInt()
+                    << ":" << result.toString();
+        if (error)
+            *error = result.toString();
+        return QString();
+    }
+    return result.toString();
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TIMELINEEXPORTER_H
+#define TIMELINEEXPORTER_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QJsonObject>
+
+class QIODevice;
+namespace Mlt {
+class Tractor;
+class Producer;
+}
+
+//原生的时间线导出：直接遍历 tractor（时间线或加载的工程 XML），
+//输出 CMX3600 EDL，或者包含片段、转场、速度、滤镜的 JSON时间线交换格式。
+//取代原来在 QJSEngine里用 xmldoc解析整份 XML的 export-edl.js。
+class TimelineExporter
+{
+public:
+    struct Options {
+        Options()
+            : useBaseNameForReelName(true)
+            , useBaseNameForClipComment(true)
+            , channelsAV("AA/V")
+        {}
+        bool useBaseNameForReelName;
+        bool useBaseNameForClipComment;
+        QString channelsAV;
+    };
+
+    explicit TimelineExporter(Mlt::Tractor& tractor, const Options& options = Options());
+
+    //逐轨道写入 EDL，不在内存里拼接整份文本
+    bool writeEdl(QIODevice& device) const;
+    QString edl() const;
+    QJsonObject json() const;
+    bool writeJson(QIODevice& device) const;
+
+    //旧的 JavaScript导出器，只保留用于性能和结果对比
+    static QString legacyEdl(const QString& xml, const Options& options, QString* error = nullptr);
+
+private:
+    enum EventType { Blank, Clip, Transition };
+
+    struct Event {
+        EventType type;
+        int position;   //在轨道上的起点
+        int length;
+        QString resource;
+        QString reelName;
+        QString service;
+        int in;
+        double speed;
+        QStringList filters;
+        //转场：A为淡出的片段，B为淡入的片段
+        QString resourceB;
+        QString reelNameB;
+        int inB;
+        QString transitionService;
+    };
+
+    struct TrackEvents {
+        QString id;
+        QString name;
+        QString kind;    //video或 audio
+        QString format;  //EDL通道，如 V、A、AA/V
+        bool hidden;
+        bool muted;
+        QList<Event> events;
+    };
+
+    QList<TrackEvents> tracks() const;
+    bool readTrack(int mltIndex, TrackEvents& track) const;
+    void readClip(Mlt::Producer& producer, Event& event) const;
+    QString reelName(Mlt::Producer& producer, const QString& resource) const;
+    QString timecode(int frames) const;
+
+    Mlt::Tractor& m_tractor;
+    Options m_options;
+    double m_fps;
+};
+
+#endif // TIMELINEEXPORTER_H
@@ -25,7 +25,6 @@
 #include "mltcontroller.h"
 #include "shotcut_mlt_properties.h"
 #include "jobqueue.h"
-#include "jobs/ffprobejob.h"
 #include "jobs/ffmpegjob.h"
 #include <QtWidgets>
 #include "mainwindow.h"
@@ -25,7 +25,8 @@
 #include "mltcontroller.h"
 #include "shotcut_mlt_properties.h"
 #include "jobqueue.h"
-#include "jobs/ffprobejob.h"
+#include "mediaprobe.h"
+#include "dialogs/textviewerdialog.h"
 #include "jobs/ffmpegjob.h"
 #include <QtWidgets>
 #include "mainwindow.h"
@@ -492,14 +493,11 @@ void AvformatProducerWidget::on_notesTextEdit_textChanged()
 
 void AvformatProducerWidget::on_actionFFmpegInfo_triggered()
 {
-    QStringList args;
-    args << "-v" << "quiet";
-    args << "-print_format" << "ini";
-    args << "-pretty";
-    args << "-show_format" << "-show_programs" << "-show_streams";
-    args << GetFilenameFromProducer(m_producer);
-    AbstractJob* job = new FfprobeJob(args.last(), args);
-    job->start();
+    MediaInfo info = PROBE.probe(GetFilenameFromProducer(m_producer));
+    TextViewerDialog dialog(&MAIN);
+    dialog.setWindowTitle(tr("More Information"));
+    dialog.setText(info.toText());
+    dialog.exec();
 }
 
 void AvformatProducerWidget::on_actionFFmpegIntegrityCheck_triggered()
@@ -137,8 +137,7 @@ AudioLoudnessScopeWidget::~AudioLoudnessScopeWidget()
 void AudioLoudnessScopeWidget::refreshScope(const QSize& /*size*/, bool /*full*/)
 {
     SharedFrame sFrame;
-    while (m_queue.count() > 0) {
-        sFrame = m_queue.pop();
+    while (nextFrame(sFrame)) {
         if (sFrame.is_valid() && sFrame.get_audio_samples() > 0) {
             mlt_audio_format format = mlt_audio_f32le;
             int channels = sFrame.get_audio_channels();
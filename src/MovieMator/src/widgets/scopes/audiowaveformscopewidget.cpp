@@ -75,8 +75,7 @@ void AudioWaveformScopeWidget::refreshScope(const QSize& size, bool full)
     m_mutex.unlock();
 
     SharedFrame sFrame;
-    while (m_queue.count() > 0) {
-        sFrame = m_queue.pop();
+    while (nextFrame(sFrame)) {
     }
     
     // Check if a full refresh should be forced.
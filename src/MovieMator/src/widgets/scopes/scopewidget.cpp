@@ -22,9 +22,11 @@
 
 ScopeWidget::ScopeWidget(const QString& name)
   : QWidget()
-  , m_queue(3, DataQueue<SharedFrame>::OverflowModeDiscardOldest)
   , m_future()
   , m_refreshPending(false)
+  , m_frames(nullptr)
+  , m_consumer(-1)
+  , m_latestFrameOnly(false)
   , m_mutex(QMutex::NonRecursive)
   , m_forceRefresh(false)
   , m_size(0, 0)
@@ -38,9 +40,29 @@ ScopeWidget::~ScopeWidget()
 {
 }
 
-void ScopeWidget::onNewFrame(const SharedFrame& frame)
+void ScopeWidget::setFrameSource(FrameFanout<SharedFrame>* frames)
+{
+    Q_ASSERT(frames);
+    Q_ASSERT(!m_frames);
+    m_frames = frames;
+    m_consumer = m_frames->addConsumer(m_latestFrameOnly);
+    if (m_consumer < 0)
+        LOG_WARNING() << "too many scopes, no frames for" << objectName();
+}
+
+void ScopeWidget::setActive(bool active)
+{
+    if (m_frames)
+        m_frames->setActive(m_consumer, active);
+}
+
+bool ScopeWidget::nextFrame(SharedFrame& frame)
+{
+    return m_frames && m_frames->next(m_consumer, frame);
+}
+
+void ScopeWidget::onFramesAvailable()
 {
-    m_queue.push(frame);
     requestRefresh();
 }
 
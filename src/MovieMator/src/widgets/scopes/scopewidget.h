@@ -26,7 +26,7 @@
 #include <QFuture>
 #include <QMutex>
 #include "sharedframe.h"
-#include "dataqueue.h"
+#include "framefanout.h"
 
 /*!
   \class ScopeWidget
@@ -37,9 +37,11 @@
   store frames until they can be processed by the scope. Another common function
   is the ability to trigger the "heavy lifting" to be done in a worker thread.
 
-  Frames are received by the onNewFrame() slot. The ScopeWidget automatically
-  places new frames in the DataQueue (m_queue). Subclasses shall implement the
-  refreshScope() function and can check for new frames in m_queue.
+  Frames are shared by all scopes through a FrameFanout owned by the
+  application (see setFrameSource()). The onFramesAvailable() slot only
+  triggers a refresh; subclasses shall implement the refreshScope() function
+  and fetch the frames they have not seen yet with nextFrame(). A scope that
+  is not active costs nothing: it is skipped when frames are published.
 
   refreshScope() is run from a separate thread. Therefore, any members that are
   accessed by both the worker thread (refreshScope) and the GUI thread
@@ -82,9 +84,20 @@ public:
     */
     virtual void setOrientation(Qt::Orientation) {}
 
+    /*!
+      Registers the scope as a consumer of \a frames. Should be called once by
+      the application before the scope is activated.
+    */
+    void setFrameSource(FrameFanout<SharedFrame>* frames);
+
+    /*!
+      Activates or deactivates the scope. Inactive scopes receive no frames.
+    */
+    void setActive(bool active);
+
 public slots:
-    //! Provides a new frame to the scope. Should be called by the application.
-    virtual void onNewFrame(const SharedFrame& frame) Q_DECL_FINAL;
+    //! Notifies the scope that new frames were published. Should be called by the application.
+    virtual void onFramesAvailable() Q_DECL_FINAL;
 
 protected:
     /*!
@@ -104,12 +117,16 @@ protected:
     virtual void refreshScope(const QSize& size, bool full) = 0;
 
     /*!
-      Stores frames received by onNewFrame().
+      Fetches the next frame this scope has not seen yet. Returns false when
+      there is none. Subclasses should call this in refreshScope().
+    */
+    bool nextFrame(SharedFrame& frame);
 
-      Subclasses should check this queue for new frames in the refreshScope()
-      implementation.
+    /*!
+      Makes nextFrame() skip straight to the newest frame. Scopes that only
+      draw the current picture should call this in their constructor.
     */
-    DataQueue<SharedFrame> m_queue;
+    void setLatestFrameOnly(bool latestOnly) { m_latestFrameOnly = latestOnly; }
 
     void resizeEvent(QResizeEvent*) Q_DECL_OVERRIDE;
     void changeEvent(QEvent*) Q_DECL_OVERRIDE;
@@ -119,6 +136,9 @@ private:
     virtual void refreshInThread() Q_DECL_FINAL;
     QFuture<void> m_future;
     bool m_refreshPending;
+    FrameFanout<SharedFrame>* m_frames;
+    int m_consumer;
+    bool m_latestFrameOnly;
 
     // Members accessed in multiple threads (mutex protected).
     QMutex m_mutex;
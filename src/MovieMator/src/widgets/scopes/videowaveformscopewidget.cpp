@@ -29,6 +29,7 @@ VideoWaveformScopeWidget::VideoWaveformScopeWidget()
   , m_displayImg()
 {
     LOG_DEBUG() << "begin";
+    setLatestFrameOnly(true);
     m_refreshTime.start();
     LOG_DEBUG() << "end";
 }
@@ -37,9 +38,7 @@ VideoWaveformScopeWidget::VideoWaveformScopeWidget()
 void VideoWaveformScopeWidget::refreshScope(const QSize& size, bool full)
 {
     Q_UNUSED(size)
-    while (m_queue.count() > 0) {
-        m_frame = m_queue.pop();
-    }
+    nextFrame(m_frame);
 
     if (!full && m_refreshTime.elapsed() < 90) {
         // Limit refreshes to 90ms unless there is a good reason.
@@ -0,0 +1,13 @@
+# TimelineExporter的往返测试：corpus里的工程加载、导出，经 MLT XML保存再加载后导出结果不变
+include(../tests.pri)
+
+TARGET = tst_timelineexporter
+
+INCLUDEPATH += $$MM_SOURCE_ROOT/src
+
+SOURCES += tst_timelineexporter.cpp \
+    $$MM_SOURCE_ROOT/src/timelineexporter.cpp
+
+HEADERS += $$MM_SOURCE_ROOT/src/timelineexporter.h
+
+OTHER_FILES += corpus/*.mlt
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "timelineexporter.h"
+#include <mltcontroller.h>
+#include <QtTest>
+#include <QBuffer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QScopedPointer>
+#include <Mlt.h>
+
+class TestTimelineExporter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void roundTrip_data();
+    void roundTrip();
+
+private:
+    Mlt::Tractor* load(Mlt::Producer& producer);
+    QString save(Mlt::Tractor& tractor);
+    QString exportEdl(Mlt::Tractor& tractor);
+    QString exportJson(Mlt::Tractor& tractor);
+};
+
+void TestTimelineExporter::initTestCase()
+{
+    QCoreApplication::setOrganizationName("effectmatrix");
+    QCoreApplication::setApplicationName("MovieMator Tests");
+    Mlt::Controller::createHeadless();
+}
+
+//和 MultitrackModel::load()一样把 XML的根当作 tractor
+Mlt::Tractor* TestTimelineExporter::load(Mlt::Producer& producer)
+{
+    if (!producer.is_valid())
+        return nullptr;
+    producer.set("mlt_type", "mlt_producer");
+    producer.set("resource", "<tractor>");
+    Mlt::Tractor* tractor = new Mlt::Tractor(producer);
+    if (!tractor->is_valid()) {
+        delete tractor;
+        return nullptr;
+    }
+    return tractor;
+}
+
+//和保存工程时一样用 xml consumer序列化
+QString TestTimelineExporter::save(Mlt::Tractor& tractor)
+{
+    Mlt::Consumer consumer(MLT.profile(), "xml", "string");
+    consumer.set("no_meta", 1);
+    consumer.set("store", "moviemator");
+    consumer.connect(tractor);
+    consumer.start();
+    return QString::fromUtf8(consumer.get("string"));
+}
+
+QString TestTimelineExporter::exportEdl(Mlt::Tractor& tractor)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    TimelineExporter(tractor).writeEdl(buffer);
+    return QString::fromUtf8(buffer.data());
+}
+
+QString TestTimelineExporter::exportJson(Mlt::Tractor& tractor)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    TimelineExporter(tractor).writeJson(buffer);
+    return QString::fromUtf8(buffer.data());
+}
+
+void TestTimelineExporter::roundTrip_data()
+{
+    QTest::addColumn<QString>("file");
+    QTest::addColumn<int>("tracks");
+    QTest::addColumn<int>("clips");
+    QTest::addColumn<int>("gaps");
+    QTest::addColumn<int>("transitions");
+    QTest::addColumn<QString>("speeds");    //所有片段的速度，按轨道和位置排列
+    QTest::newRow("simple") << "simple.mlt" << 1 << 2 << 1 << 0 << "1,1";
+    QTest::newRow("tracks") << "tracks.mlt" << 3 << 4 << 0 << 0 << "1,1,1,1";
+    QTest::newRow("speed") << "speed.mlt" << 1 << 3 << 0 << 0 << "2,0.5,1";
+    QTest::newRow("transition") << "transition.mlt" << 1 << 2 << 0 << 1 << "1,1";
+    QTest::newRow("filters") << "filters.mlt" << 1 << 2 << 0 << 0 << "1,1";
+}
+
+//加载 → 导出 → 保存成 XML → 再加载 → 导出，两次导出的 EDL和 JSON必须完全相同，
+//导出的内容也要和工程的结构一致：片段首尾相接，总长等于时间线长度
+void TestTimelineExporter::roundTrip()
+{
+    QFETCH(QString, file);
+    QFETCH(int, tracks);
+    QFETCH(int, clips);
+    QFETCH(int, gaps);
+    QFETCH(int, transitions);
+    QFETCH(QString, speeds);
+
+    QString path = QFINDTESTDATA("corpus/" + file);
+    QVERIFY(!path.isEmpty());
+    Mlt::Producer producer(MLT.profile(), "xml", path.toUtf8().constData());
+    QScopedPointer<Mlt::Tractor> tractor(load(producer));
+    QVERIFY(tractor);
+
+    QString edl = exportEdl(*tractor);
+    QString json = exportJson(*tractor);
+    QVERIFY(edl.startsWith("TITLE: "));
+
+    QJsonObject document = QJsonDocument::fromJson(json.toUtf8()).object();
+    QJsonArray trackArray = document.value("tracks").toArray();
+    QCOMPARE(trackArray.size(), tracks);
+    int clipCount = 0;
+    int gapCount = 0;
+    int transitionCount = 0;
+    QStringList speedList;
+    foreach (const QJsonValue& trackValue, trackArray) {
+        int position = 0;
+        foreach (const QJsonValue& itemValue, trackValue.toObject().value("items").toArray()) {
+            QJsonObject item = itemValue.toObject();
+            QCOMPARE(item.value("position").toInt(), position);
+            position += item.value("length").toInt();
+            QString type = item.value("type").toString();
+            if (type == "clip") {
+                ++clipCount;
+                speedList << QString::number(item.value("speed").toDouble());
+            } else if (type == "gap") {
+                ++gapCount;
+            } else if (type == "transition") {
+                ++transitionCount;
+            }
+        }
+        QCOMPARE(position, document.value("duration").toInt());
+    }
+    QCOMPARE(clipCount, clips);
+    QCOMPARE(gapCount, gaps);
+    QCOMPARE(transitionCount, transitions);
+    QCOMPARE(speedList.join(','), speeds);
+
+    QString xml = save(*tractor);
+    QVERIFY(!xml.isEmpty());
+    Mlt::Producer reloaded(MLT.profile(), "xml-string", xml.toUtf8().constData());
+    QScopedPointer<Mlt::Tractor> reloadedTractor(load(reloaded));
+    QVERIFY(reloadedTractor);
+    QCOMPARE(exportEdl(*reloadedTractor), edl);
+    QCOMPARE(exportJson(*reloadedTractor), json);
+}
+
+QTEST_MAIN(TestTimelineExporter)
+
+#include "tst_timelineexporter.moc"
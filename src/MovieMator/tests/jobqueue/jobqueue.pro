@@ -0,0 +1,13 @@
+# JobQueue调度的测试：只编译队列和任务基类，用只会 sleep的假任务代替导出进程
+include(../tests.pri)
+
+TARGET = tst_jobqueue
+
+INCLUDEPATH += $$MM_SOURCE_ROOT/src
+
+SOURCES += tst_jobqueue.cpp \
+    $$MM_SOURCE_ROOT/src/jobqueue.cpp \
+    $$MM_SOURCE_ROOT/src/jobs/abstractjob.cpp
+
+HEADERS += $$MM_SOURCE_ROOT/src/jobqueue.h \
+    $$MM_SOURCE_ROOT/src/jobs/abstractjob.h
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "jobqueue.h"
+#include "jobs/abstractjob.h"
+#include <settings.h>
+#include <QtTest>
+#include <algorithm>
+
+//只 sleep的假任务，不需要任何媒体文件。
+//started()要等进程真正起来才异步发出，顺序不可靠，所以在 start()里直接通知 observer
+class SleepJob : public AbstractJob
+{
+public:
+    SleepJob(const QString& name, int ms, int weight, QObject* observer)
+        : AbstractJob(name), m_ms(ms), m_weight(weight), m_observer(observer)
+    {}
+    int threadWeight() const { return m_weight; }
+    void start()
+    {
+#ifdef Q_OS_WIN
+        QProcess::start("powershell", QStringList() << "-NoProfile" << "-Command"
+                        << QString("Start-Sleep -Milliseconds %1").arg(m_ms));
+#else
+        QProcess::start("sleep", QStringList() << QString::number(m_ms / 1000.0, 'f', 3));
+#endif
+        AbstractJob::start();
+        QMetaObject::invokeMethod(m_observer, "onJobStarted", Qt::DirectConnection, Q_ARG(AbstractJob*, this));
+    }
+private:
+    int m_ms;
+    int m_weight;
+    QObject* m_observer;
+};
+
+class TestJobQueue : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void onJobStarted(AbstractJob* job);
+    void onJobFinished(AbstractJob* job, bool isSuccess);
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void pausedQueueStartsNothing();
+    void concurrencyCap_data();
+    void concurrencyCap();
+    void threadWeights();
+    void priorityOrder();
+    void pauseHoldsPendingJobs();
+
+private:
+    QList<AbstractJob*> addJobs(int count, int ms, const QList<int>& weights, const QList<int>& priorities);
+
+    QList<AbstractJob*> m_started;
+    int m_running;
+    int m_peak;
+    int m_weight;
+    bool m_overweight;
+    int m_finished;
+    int m_failed;
+};
+
+void TestJobQueue::initTestCase()
+{
+    QCoreApplication::setOrganizationName("effectmatrix");
+    QCoreApplication::setApplicationName("MovieMator Tests");
+}
+
+void TestJobQueue::init()
+{
+    m_started.clear();
+    m_running = m_peak = m_weight = 0;
+    m_overweight = false;
+    m_finished = m_failed = 0;
+    JOBS.pause();
+    JOBS.setMaxConcurrentJobs(0);
+}
+
+//等所有假任务结束后从队列里删掉，下一个测试从空队列开始
+void TestJobQueue::cleanup()
+{
+    JOBS.stopJobs();
+    for (int row = JOBS.rowCount() - 1; row >= 0; row--) {
+        AbstractJob* job = JOBS.jobFromIndex(JOBS.index(row, 0));
+        if (job->state() != QProcess::NotRunning)
+            job->waitForFinished(5000);
+        JOBS.remove(JOBS.index(row, 0));
+    }
+    JOBS.setMaxConcurrentJobs(0);
+    JOBS.resume();
+}
+
+void TestJobQueue::onJobStarted(AbstractJob* job)
+{
+    m_started << job;
+    m_running++;
+    m_peak = qMax(m_peak, m_running);
+    m_weight += qMin(job->threadWeight(), QThread::idealThreadCount());
+    //只有一个任务时允许超重，多个任务同时运行时占用的核数不能超过总核数
+    if (m_running > 1 && m_weight > QThread::idealThreadCount())
+        m_overweight = true;
+}
+
+void TestJobQueue::onJobFinished(AbstractJob* job, bool isSuccess)
+{
+    if (m_started.contains(job)) {
+        m_running--;
+        m_weight -= qMin(job->threadWeight(), QThread::idealThreadCount());
+    }
+    m_finished++;
+    if (!isSuccess)
+        m_failed++;
+}
+
+//必须在 JOBS.add()之前连接 finished，这样 observer先于队列收到通知，
+//队列在 onFinished里启动下一个任务时计数已经减掉
+QList<AbstractJob*> TestJobQueue::addJobs(int count, int ms, const QList<int>& weights, const QList<int>& priorities)
+{
+    QList<AbstractJob*> jobs;
+    for (int i = 0; i < count; i++) {
+        AbstractJob* job = new SleepJob(QString("sleep %1").arg(i), ms, weights.at(i % weights.size()), this);
+        job->setPriority(priorities.at(i % priorities.size()));
+        connect(job, SIGNAL(finished(AbstractJob*, bool)), this, SLOT(onJobFinished(AbstractJob*, bool)));
+        jobs << JOBS.add(job);
+    }
+    return jobs;
+}
+
+void TestJobQueue::pausedQueueStartsNothing()
+{
+    const int count = 4;
+    addJobs(count, 100, QList<int>() << 1, QList<int>() << 0);
+    QTest::qWait(300);
+    QVERIFY(m_started.isEmpty());
+    QVERIFY(JOBS.hasIncomplete());
+
+    JOBS.resume();
+    QTRY_COMPARE_WITH_TIMEOUT(m_finished, count, 10000);
+    QCOMPARE(m_failed, 0);
+    QCOMPARE(m_started.size(), count);
+    QVERIFY(!JOBS.hasIncomplete());
+}
+
+void TestJobQueue::concurrencyCap_data()
+{
+    QTest::addColumn<int>("max");
+    QTest::newRow("1") << 1;
+    QTest::newRow("2") << 2;
+    QTest::newRow("3") << 3;
+}
+
+//所有任务在暂停时加入，恢复后同时运行的任务数应该正好到上限（线程数为1时受核数限制）
+void TestJobQueue::concurrencyCap()
+{
+    QFETCH(int, max);
+    const int count = 6;
+    JOBS.setMaxConcurrentJobs(max);
+    QCOMPARE(JOBS.maxConcurrentJobs(), max);
+    addJobs(count, 300, QList<int>() << 1, QList<int>() << 0);
+
+    JOBS.resume();
+    QTRY_COMPARE_WITH_TIMEOUT(m_finished, count, 20000);
+    QCOMPARE(m_failed, 0);
+    QCOMPARE(m_peak, qMin(max, QThread::idealThreadCount()));
+}
+
+//自动并发时按线程数分配核：多个任务同时运行不能超过核数，线程数超过核数的任务单独运行
+void TestJobQueue::threadWeights()
+{
+    const int cores = QThread::idealThreadCount();
+    const int count = 8;
+    addJobs(count, 200, QList<int>() << cores + 1 << 1 << qMax(1, cores / 2) << 2, QList<int>() << 0);
+
+    JOBS.resume();
+    QTRY_COMPARE_WITH_TIMEOUT(m_finished, count, 20000);
+    QCOMPARE(m_failed, 0);
+    QVERIFY(!m_overweight);
+    QCOMPARE(m_started.size(), count);
+}
+
+//一次只运行一个任务时，启动顺序就是按优先级从高到低、相同优先级按加入顺序
+void TestJobQueue::priorityOrder()
+{
+    const int count = 9;
+    JOBS.setMaxConcurrentJobs(1);
+    QList<AbstractJob*> jobs = addJobs(count, 50, QList<int>() << 1, QList<int>() << 0 << 2 << 1);
+    QList<AbstractJob*> expected = jobs;
+    std::stable_sort(expected.begin(), expected.end(), [](AbstractJob* a, AbstractJob* b) {
+        return a->priority() > b->priority();
+    });
+
+    JOBS.resume();
+    QTRY_COMPARE_WITH_TIMEOUT(m_finished, count, 10000);
+    QCOMPARE(m_peak, 1);
+    QCOMPARE(m_started, expected);
+}
+
+//运行中暂停：已经在跑的任务照常结束，等待中的任务直到恢复才启动
+void TestJobQueue::pauseHoldsPendingJobs()
+{
+    const int count = 4;
+    JOBS.setMaxConcurrentJobs(1);
+    addJobs(count, 200, QList<int>() << 1, QList<int>() << 0);
+
+    JOBS.resume();
+    QTRY_COMPARE_WITH_TIMEOUT(m_started.size(), 1, 5000);
+    JOBS.pause();
+    QTRY_COMPARE_WITH_TIMEOUT(m_finished, 1, 5000);
+    QTest::qWait(400);
+    QCOMPARE(m_started.size(), 1);
+    QVERIFY(JOBS.hasIncomplete());
+
+    JOBS.resume();
+    QTRY_COMPARE_WITH_TIMEOUT(m_finished, count, 10000);
+    QCOMPARE(m_failed, 0);
+    QCOMPARE(m_started.size(), count);
+}
+
+QTEST_MAIN(TestJobQueue)
+
+#include "tst_jobqueue.moc"
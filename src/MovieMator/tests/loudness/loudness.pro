@@ -0,0 +1,13 @@
+# 响度测量的测试：用已知响度的测试音校验 LoudnessMeter和从文件测量剪辑的 LoudnessAnalysis
+include(../tests.pri)
+
+TARGET = tst_loudness
+
+INCLUDEPATH += $$MM_SOURCE_ROOT/src
+
+SOURCES += tst_loudness.cpp \
+    $$MM_SOURCE_ROOT/src/models/loudnessmeter.cpp \
+    $$MM_SOURCE_ROOT/src/models/loudnesstask.cpp
+
+HEADERS += $$MM_SOURCE_ROOT/src/models/loudnessmeter.h \
+    $$MM_SOURCE_ROOT/src/models/loudnesstask.h
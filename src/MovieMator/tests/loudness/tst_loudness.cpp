@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "models/loudnessmeter.h"
+#include "models/loudnesstask.h"
+#include <mltcontroller.h>
+#include <QtTest>
+#include <QDataStream>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtMath>
+
+class TestLoudness : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void tone_data();
+    void tone();
+    void measureFile();
+    void measureAppliesClipFilters();
+    void measureHonoursAudioIndex();
+
+private:
+    LoudnessResult toneClip() const;
+
+    QTemporaryDir m_dir;
+};
+
+static const int kFps = 25;
+static const int kToneSeconds = 10;
+
+//1kHz正弦测试音在第 t个采样的值
+static float toneSample(double dBFS, qint64 t, int sampleRate)
+{
+    return float(qPow(10.0, dBFS / 20.0) * qSin(2.0 * M_PI * 1000.0 * t / sampleRate));
+}
+
+//生成 1kHz正弦测试音直接送进 LoudnessMeter，每段为 (幅度 dBFS, 秒数)
+static void measureTone(LoudnessMeter& meter, int sampleRate, int channels, const QList<QPair<double, double> >& segments)
+{
+    QVector<float> buffer(channels * 1024);
+    qint64 t = 0;
+    for (int s = 0; s < segments.size(); s++) {
+        qint64 n = qint64(segments.at(s).second * sampleRate);
+        for (qint64 i = 0; i < n; i += 1024) {
+            int frames = int(qMin<qint64>(1024, n - i));
+            for (int j = 0; j < frames; j++, t++) {
+                float v = toneSample(segments.at(s).first, t, sampleRate);
+                for (int c = 0; c < channels; c++)
+                    buffer[j * channels + c] = v;
+            }
+            meter.addSamples(buffer.constData(), frames);
+        }
+    }
+}
+
+//写一个 48kHz 16位立体声的 WAV文件
+static bool writeToneWav(const QString& path, double dBFS, int seconds)
+{
+    const int sampleRate = 48000;
+    const int channels = 2;
+    const quint32 dataSize = quint32(sampleRate) * seconds * channels * 2;
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.writeRawData("RIFF", 4);
+    out << quint32(36 + dataSize);
+    out.writeRawData("WAVEfmt ", 8);
+    out << quint32(16) << quint16(1) << quint16(channels) << quint32(sampleRate)
+        << quint32(sampleRate * channels * 2) << quint16(channels * 2) << quint16(16);
+    out.writeRawData("data", 4);
+    out << dataSize;
+    for (qint64 t = 0; t < qint64(sampleRate) * seconds; t++) {
+        qint16 v = qint16(qRound(toneSample(dBFS, t, sampleRate) * 32767.0));
+        for (int c = 0; c < channels; c++)
+            out << v;
+    }
+    return out.status() == QDataStream::Ok;
+}
+
+void TestLoudness::initTestCase()
+{
+    QCoreApplication::setOrganizationName("effectmatrix");
+    QCoreApplication::setApplicationName("MovieMator Tests");
+    Mlt::Controller::createHeadless();
+    QVERIFY(m_dir.isValid());
+    QVERIFY(writeToneWav(m_dir.filePath("tone-23.wav"), -23.0, kToneSeconds));
+}
+
+LoudnessResult TestLoudness::toneClip() const
+{
+    LoudnessResult clip;
+    clip.service = "avformat";
+    clip.resource = m_dir.filePath("tone-23.wav");
+    clip.in = 0;
+    clip.out = kToneSeconds * kFps - 1;
+    return clip;
+}
+
+//EBU Tech 3341/3342里的测试音：结果只由采样决定，可以直接和标准值比较
+void TestLoudness::tone_data()
+{
+    QTest::addColumn<int>("sampleRate");
+    QTest::addColumn<int>("channels");
+    QTest::addColumn<double>("level1");
+    QTest::addColumn<double>("level2");     //第二段，0表示没有
+    QTest::addColumn<bool>("range");        //比较 LRA而不是综合响度
+    QTest::addColumn<double>("expected");
+    QTest::addColumn<double>("tolerance");
+    QTest::newRow("stereo -23 dBFS 48 kHz") << 48000 << 2 << -23.0 << 0.0 << false << -23.0 << 0.1;
+    QTest::newRow("stereo -33 dBFS 48 kHz") << 48000 << 2 << -33.0 << 0.0 << false << -33.0 << 0.1;
+    QTest::newRow("stereo -23 dBFS 44.1 kHz") << 44100 << 2 << -23.0 << 0.0 << false << -23.0 << 0.1;
+    QTest::newRow("mono -20 dBFS 48 kHz") << 48000 << 1 << -20.0 << 0.0 << false << -23.0 << 0.1;
+    QTest::newRow("LRA -20/-30 dBFS") << 48000 << 2 << -20.0 << -30.0 << true << 10.0 << 1.0;
+}
+
+void TestLoudness::tone()
+{
+    QFETCH(int, sampleRate);
+    QFETCH(int, channels);
+    QFETCH(double, level1);
+    QFETCH(double, level2);
+    QFETCH(bool, range);
+    QFETCH(double, expected);
+    QFETCH(double, tolerance);
+
+    QList<QPair<double, double> > segments;
+    segments << qMakePair(level1, 20.0);
+    if (level2 < 0.0)
+        segments << qMakePair(level2, 20.0);
+    LoudnessMeter meter(sampleRate, channels);
+    measureTone(meter, sampleRate, channels, segments);
+    double measured = range ? meter.range() : meter.integrated();
+    QVERIFY2(qAbs(measured - expected) <= tolerance,
+             qPrintable(QString("measured %1, expected %2").arg(measured).arg(expected)));
+}
+
+//和时间线一样从文件解码测量：-23 dBFS的立体声 1kHz正弦波是 -23 LUFS
+void TestLoudness::measureFile()
+{
+    LoudnessResult clip = toneClip();
+    QAtomicInt canceled;
+    QVERIFY(LoudnessAnalysis::measure(clip, kFps, 1, canceled));
+    QVERIFY(clip.valid);
+    QVERIFY2(qAbs(clip.integrated + 23.0) <= 0.2, qPrintable(QString::number(clip.integrated)));
+    QVERIFY2(qAbs(clip.peak + 23.0) <= 0.1, qPrintable(QString::number(clip.peak)));
+}
+
+//剪辑上的音量滤镜参与测量：增益 0.5（-6.02 dB）后是 -29 LUFS
+void TestLoudness::measureAppliesClipFilters()
+{
+    LoudnessResult clip = toneClip();
+    LoudnessFilter volume;
+    volume.insert("mlt_service", "volume");
+    volume.insert("gain", "0.5");
+    clip.filters << volume;
+    QAtomicInt canceled;
+    QVERIFY(LoudnessAnalysis::measure(clip, kFps, 1, canceled));
+    double expected = -23.0 + 20.0 * std::log10(0.5);
+    QVERIFY2(qAbs(clip.integrated - expected) <= 0.2, qPrintable(QString::number(clip.integrated)));
+}
+
+//audio_index为 -1时素材没有声音可测
+void TestLoudness::measureHonoursAudioIndex()
+{
+    LoudnessResult clip = toneClip();
+    clip.audioIndex = "-1";
+    QAtomicInt canceled;
+    QVERIFY(!LoudnessAnalysis::measure(clip, kFps, 1, canceled));
+    QVERIFY(!clip.valid);
+}
+
+QTEST_MAIN(TestLoudness)
+
+#include "tst_loudness.moc"
@@ -0,0 +1,17 @@
+# MultitrackModel片段缓存表的测试：模型依赖编辑器的大部分代码，和 benchmark一样包含 src.pri
+include(../../src/src.pri)
+
+TARGET = tst_multitrackmodel
+TEMPLATE = app
+QT += testlib
+CONFIG += testcase console
+CONFIG -= app_bundle
+win32:CONFIG -= windows
+
+unix {
+    QMAKE_RPATHDIR += $$MM_BUILD_ROOT/CuteLogger $$MM_BUILD_ROOT/CommonUtil
+    QMAKE_RPATHDIR += $$MM_BUILD_ROOT/QmlUtilities $$MM_BUILD_ROOT/MltController
+    QMAKE_RPATHDIR += $$MM_BUILD_ROOT/Breakpad $$MM_BUILD_ROOT/ResourceDockGenerator
+}
+
+SOURCES += tst_multitrackmodel.cpp
@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "models/multitrackmodel.h"
+#include "commands/timelinecommands.h"
+#include "mltcontroller.h"
+#include "shotcut_mlt_properties.h"
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QUndoStack>
+#include <Mlt.h>
+
+class TestMultitrackModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void mutations();
+
+private:
+    bool writeProject(const QString& fileName);
+    QString colorClipXml(int frames);
+    int firstClip(int trackIndex, int from);
+    void warm();
+    bool check(const char* step);
+    void push(const char* step, QUndoCommand* command);
+
+    QTemporaryDir m_dir;
+    MultitrackModel m_model;
+    QUndoStack m_undoStack;
+    QStringList m_steps;
+};
+
+static const int kClipsPerTrack = 12;
+static const int kClipFrames = 20;
+
+void TestMultitrackModel::initTestCase()
+{
+    QCoreApplication::setOrganizationName("effectmatrix");
+    QCoreApplication::setApplicationName("MovieMator Tests");
+    Mlt::Controller::createHeadless();
+    QVERIFY(m_dir.isValid());
+    QString fileName = m_dir.filePath("multitrack.mmp");
+    QVERIFY(writeProject(fileName));
+    QCOMPARE(MLT.open(fileName), 0);
+    m_model.load();
+    QVERIFY(m_model.tractor());
+    QCOMPARE(m_model.trackList().count(), 2);
+}
+
+//背景轨道加两条视频轨道，每条轨道上是 kClipsPerTrack个 kClipFrames帧的纯色片段
+bool TestMultitrackModel::writeProject(const QString& fileName)
+{
+    Mlt::Tractor tractor(MLT.profile());
+    Mlt::Playlist background(MLT.profile());
+    background.set("id", kBackgroundTrackId);
+    Mlt::Producer black(MLT.profile(), "color:black");
+    black.set("length", 1);
+    black.set("id", "black");
+    background.append(black);
+    tractor.set_track(background, 0);
+    for (int t = 0; t < 2; t++) {
+        Mlt::Playlist playlist(MLT.profile());
+        playlist.set(kVideoTrackProperty, 1);
+        playlist.set(kTrackNameProperty, QString("V%1").arg(t + 1).toUtf8().constData());
+        for (int c = 0; c < kClipsPerTrack; c++) {
+            int rgb = (c * 0x2f1b37 + t * 0x13579b) & 0xffffff;
+            Mlt::Producer producer(MLT.profile(),
+                QString("color:#%1").arg(rgb, 6, 16, QChar('0')).toUtf8().constData());
+            if (!producer.is_valid())
+                return false;
+            producer.set("length", kClipFrames);
+            producer.set_in_and_out(0, kClipFrames - 1);
+            playlist.append(producer);
+        }
+        tractor.set_track(playlist, t + 1);
+    }
+    MLT.saveXML(fileName, &tractor, false);
+    return QFile::exists(fileName);
+}
+
+QString TestMultitrackModel::colorClipXml(int frames)
+{
+    Mlt::Producer producer(MLT.profile(), "color:#336699");
+    producer.set("length", frames);
+    producer.set_in_and_out(0, frames - 1);
+    return MLT.XML(&producer);
+}
+
+//from及之后第一个不是空白的片段
+int TestMultitrackModel::firstClip(int trackIndex, int from)
+{
+    int count = m_model.clipCount(trackIndex);
+    for (int i = qMax(0, from); i < count; i++) {
+        if (!m_model.isBlankClip(trackIndex, i))
+            return i;
+    }
+    return -1;
+}
+
+//读一遍所有片段，让每条轨道的缓存表都是有效的，接下来的编辑必须增量更新或者作废它
+void TestMultitrackModel::warm()
+{
+    for (int t = 0; t < m_model.trackList().count(); t++) {
+        QModelIndex track = m_model.index(t);
+        for (int i = 0; i < m_model.rowCount(track); i++)
+            m_model.data(m_model.index(i, 0, track), MultitrackModel::StartRole);
+    }
+}
+
+bool TestMultitrackModel::check(const char* step)
+{
+    QCoreApplication::processEvents();
+    bool ok = m_model.checkClipTable();
+    if (!ok)
+        qWarning() << "clip table is stale after" << step;
+    return ok;
+}
+
+void TestMultitrackModel::push(const char* step, QUndoCommand* command)
+{
+    warm();
+    m_undoStack.push(command);
+    m_steps << step;
+}
+
+//每一步编辑（以及之后的撤销、重做）之后缓存表都要和 MLT里的 playlist一致
+void TestMultitrackModel::mutations()
+{
+    int clip = -1;
+
+    push("insert", new Timeline::InsertClipCommand(m_model, 0, kClipFrames + kClipFrames / 2, colorClipXml(25)));
+    QVERIFY(check("insert"));
+
+    push("append", new Timeline::AppendClipCommand(m_model, 1, colorClipXml(15)));
+    QVERIFY(check("append"));
+
+    push("overwrite", new Timeline::OverwriteClipCommand(m_model, 1, kClipFrames * 3 + 5, colorClipXml(30)));
+    QVERIFY(check("overwrite"));
+
+    clip = firstClip(0, 2);
+    QVERIFY(clip >= 0);
+    push("remove", new Timeline::RemoveClipsCommand(m_model, 0, QList<int>() << clip, false));
+    QVERIFY(check("remove"));
+
+    //相邻的两个片段先后替换成空白，第二次要和前面的空白合并
+    clip = firstClip(0, 3);
+    QVERIFY(clip >= 0);
+    push("lift", new Timeline::RemoveClipsCommand(m_model, 0, QList<int>() << clip, true));
+    QVERIFY(check("lift"));
+    int clipsBefore = m_model.clipCount(0);
+    clip = firstClip(0, clip);
+    QVERIFY(clip > 0);
+    QVERIFY(m_model.isBlankClip(0, clip - 1));
+    push("lift next to blank", new Timeline::RemoveClipsCommand(m_model, 0, QList<int>() << clip, true));
+    QVERIFY(check("lift next to blank"));
+    QCOMPARE(m_model.clipCount(0), clipsBefore - 1);
+
+    clip = firstClip(0, 0);
+    QVERIFY(m_model.trimClipInValid(0, clip, 5, false));
+    push("trim in", new Timeline::TrimClipInCommand(m_model, 0, clip, 5, false));
+    QVERIFY(check("trim in"));
+
+    clip = firstClip(1, 1);
+    QVERIFY(m_model.trimClipOutValid(1, clip, 5, true));
+    push("ripple trim out", new Timeline::TrimClipOutCommand(m_model, 1, clip, 5, true));
+    QVERIFY(check("ripple trim out"));
+
+    clip = firstClip(1, 2);
+    QModelIndex index = m_model.index(clip, 0, m_model.index(1));
+    int start = m_model.data(index, MultitrackModel::StartRole).toInt();
+    int duration = m_model.data(index, MultitrackModel::DurationRole).toInt();
+    QVERIFY(duration > 1);
+    push("split", new Timeline::SplitCommand(m_model, 1, clip, start + duration / 2));
+    QVERIFY(check("split"));
+
+    //一条命令删除多个片段，走 beginBatch()/endBatch()
+    QList<int> batch;
+    for (int i = m_model.clipCount(1) - 1; i >= 0 && batch.size() < 3; i -= 2) {
+        if (!m_model.isBlankClip(1, i))
+            batch << i;
+    }
+    QCOMPARE(batch.size(), 3);
+    push("batch remove", new Timeline::RemoveClipsCommand(m_model, 1, batch, false));
+    QVERIFY(check("batch remove"));
+
+    batch.clear();
+    for (int i = m_model.clipCount(0) - 1; i >= 0 && batch.size() < 3; i -= 2) {
+        if (!m_model.isBlankClip(0, i))
+            batch << i;
+    }
+    QCOMPARE(batch.size(), 3);
+    push("batch lift", new Timeline::RemoveClipsCommand(m_model, 0, batch, true));
+    QVERIFY(check("batch lift"));
+
+    //撤销全部再重做全部
+    for (int i = m_steps.size() - 1; i >= 0; i--) {
+        warm();
+        m_undoStack.undo();
+        QVERIFY2(check(qPrintable("undo " + m_steps.at(i))), qPrintable("undo " + m_steps.at(i)));
+    }
+    for (int i = 0; i < m_steps.size(); i++) {
+        warm();
+        m_undoStack.redo();
+        QVERIFY2(check(qPrintable("redo " + m_steps.at(i))), qPrintable("redo " + m_steps.at(i)));
+    }
+
+    //不经过命令直接在一个批量里编辑两条轨道，合并空白在 endBatch()时统一做
+    warm();
+    m_model.beginBatch();
+    clip = firstClip(0, 0);
+    m_model.liftClip(0, clip);
+    m_model.liftClip(0, firstClip(0, clip + 1));
+    clip = firstClip(1, 0);
+    m_model.removeClip(1, clip);
+    m_model.endBatch();
+    QVERIFY(check("direct batch"));
+}
+
+QTEST_MAIN(TestMultitrackModel)
+
+#include "tst_multitrackmodel.moc"
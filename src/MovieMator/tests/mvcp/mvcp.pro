@@ -0,0 +1,20 @@
+# MVCP客户端和 melted模型的测试：编辑器不使用这些代码，libmvcp和 src/mvcp下的源文件只在这里编译
+include(../tests.pri)
+
+QT += network
+
+TARGET = tst_mvcp
+
+DEFINES += MVCP_EMBEDDED
+INCLUDEPATH += $$MM_SOURCE_ROOT/mvcp $$MM_SOURCE_ROOT/src/mvcp
+LIBS += -L$$MM_BUILD_ROOT/mvcp$$MM_LIB_SUFFIX -lmvcp
+
+SOURCES += tst_mvcp.cpp \
+    $$MM_SOURCE_ROOT/src/mvcp/mvcp_socket.cpp \
+    $$MM_SOURCE_ROOT/src/mvcp/mvcpclient.cpp \
+    $$MM_SOURCE_ROOT/src/mvcp/mvcptestserver.cpp \
+    $$MM_SOURCE_ROOT/src/mvcp/meltedplaylistmodel.cpp
+
+HEADERS += $$MM_SOURCE_ROOT/src/mvcp/mvcpclient.h \
+    $$MM_SOURCE_ROOT/src/mvcp/mvcptestserver.h \
+    $$MM_SOURCE_ROOT/src/mvcp/meltedplaylistmodel.h
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "mvcpclient.h"
+#include "mvcptestserver.h"
+#include "meltedplaylistmodel.h"
+#include <mltcontroller.h>
+#include <QtTest>
+#include <QHostAddress>
+
+static const int kTimeoutMs = 60000;
+
+class TestMvcp : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void statusWaitsForReplies_data();
+    void statusWaitsForReplies();
+    void modelAppendsInOneBatch();
+};
+
+void TestMvcp::initTestCase()
+{
+    QCoreApplication::setOrganizationName("effectmatrix");
+    QCoreApplication::setApplicationName("MovieMator Tests");
+    Mlt::Controller::createHeadless();
+}
+
+void TestMvcp::statusWaitsForReplies_data()
+{
+    QTest::addColumn<int>("window");
+    QTest::addColumn<int>("commands");
+    QTest::addColumn<int>("latency");
+    QTest::newRow("one at a time") << 1 << 200 << 2;
+    QTest::newRow("pipelined") << 64 << 200 << 2;
+}
+
+//连续发 commands条 APND，紧跟着订阅 STATUS：所有 APND的应答都要作为应答收到，
+//不能被当成状态行，服务器上的片段数要与发送的一致
+void TestMvcp::statusWaitsForReplies()
+{
+    QFETCH(int, window);
+    QFETCH(int, commands);
+    QFETCH(int, latency);
+
+    MvcpTestServer server(1);
+    server.setLatency(latency);
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+    MvcpClient client;
+    client.setWindow(window);
+    QSignalSpy responses(&client, SIGNAL(responseReceived(int, int, int, QStringList)));
+    QSignalSpy status(&client, SIGNAL(statusReceived(QByteArray)));
+    client.connectToHost("127.0.0.1", server.serverPort());
+    //欢迎行
+    QTRY_COMPARE_WITH_TIMEOUT(responses.count(), 1, kTimeoutMs);
+
+    QBENCHMARK_ONCE {
+        for (int i = 0; i < commands; i++)
+            client.send(QString("APND U0 \"clip%1.mp4\" 0 24").arg(i));
+        client.subscribeStatus();
+        //欢迎行 + APND + STATUS，之后至少还要收到一行状态
+        QTRY_COMPARE_WITH_TIMEOUT(responses.count(), 2 + commands, kTimeoutMs);
+        QTRY_VERIFY_WITH_TIMEOUT(status.count() >= 1, kTimeoutMs);
+    }
+
+    for (int i = 1; i < responses.count(); i++)
+        QVERIFY2(responses.at(i).at(2).toInt() < 400, qPrintable(responses.at(i).at(3).toStringList().join(' ')));
+    QCOMPARE(server.playlist(0).size(), commands);
+    client.disconnectFromHost();
+}
+
+//MeltedPlaylistModel一次追加整批：success()只发一次，刷新后的行数与追加的一致
+void TestMvcp::modelAppendsInOneBatch()
+{
+    const int commands = 200;
+    MvcpTestServer server(1);
+    server.setLatency(2);
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+    MeltedPlaylistModel model;
+    QSignalSpy success(&model, SIGNAL(success()));
+    QSignalSpy loaded(&model, SIGNAL(loaded()));
+    model.onConnected("127.0.0.1", server.serverPort(), 0);
+
+    QStringList clips;
+    for (int i = 0; i < commands; i++)
+        clips << QString("clip%1.mp4").arg(i);
+    model.append(clips);
+    QTRY_COMPARE_WITH_TIMEOUT(success.count(), 1, kTimeoutMs);
+    QCOMPARE(server.playlist(0).size(), commands);
+
+    loaded.clear();
+    model.refresh();
+    QTRY_VERIFY_WITH_TIMEOUT(loaded.count() >= 1, kTimeoutMs);
+    QCOMPARE(model.rowCount(), commands);
+    QCOMPARE(success.count(), 1);
+    model.onDisconnected();
+}
+
+QTEST_MAIN(TestMvcp)
+
+#include "tst_mvcp.moc"
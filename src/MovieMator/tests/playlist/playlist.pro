@@ -0,0 +1,10 @@
+# PlaylistModel 的测试：PlaylistDock 只在这里链接，编辑器本身不使用它
+include(../tests.pri)
+
+TARGET = tst_playlistmodel
+
+INCLUDEPATH += $$MM_SOURCE_ROOT/PlaylistDock
+LIBS += -L$$MM_BUILD_ROOT/PlaylistDock$$MM_LIB_SUFFIX -lPlaylistDock
+unix:QMAKE_RPATHDIR += $$MM_BUILD_ROOT/PlaylistDock
+
+SOURCES += tst_playlistmodel.cpp
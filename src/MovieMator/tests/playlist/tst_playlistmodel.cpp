@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2016-2019 EffectMatrix Inc.
+ * Author: vgawen <gdb_1986@163.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "models/playlistmodel.h"
+#include <mltcontroller.h>
+#include <settings.h>
+#include <shotcut_mlt_properties.h>
+#include <QtTest>
+#include <QScopedPointer>
+#include <Mlt.h>
+
+class TestPlaylistModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void decorationIsImmediate();
+    void visibleThumbnailsArrive();
+    void scroll_data();
+    void scroll();
+
+private:
+    void fill(Mlt::Playlist& playlist, int rows);
+    bool hasThumbnail(PlaylistModel& model, int row);
+};
+
+void TestPlaylistModel::initTestCase()
+{
+    QCoreApplication::setOrganizationName("effectmatrix");
+    QCoreApplication::setApplicationName("MovieMator Tests");
+    Mlt::Controller::createHeadless();
+    Settings.setPlaylistThumbnails("small");
+}
+
+void TestPlaylistModel::fill(Mlt::Playlist& playlist, int rows)
+{
+    for (int i = 0; i < rows; i++) {
+        QString color = QString("#%1").arg((0x405060 + i * 0x030507) & 0xffffff, 6, 16, QChar('0'));
+        Mlt::Producer producer(MLT.profile(), "color", color.toLatin1().constData());
+        QVERIFY(producer.is_valid());
+        producer.set("length", 50);
+        producer.set_in_and_out(0, 49);
+        playlist.append(producer);
+    }
+}
+
+bool TestPlaylistModel::hasThumbnail(PlaylistModel& model, int row)
+{
+    QScopedPointer<Mlt::Producer> clip(model.playlist()->get_clip(row));
+    Mlt::Producer parent(clip->get_parent());
+    return parent.get_data(kThumbnailInProperty) != nullptr;
+}
+
+//data()不能等缩略图：第一次取就要返回占位图，而不是空值
+void TestPlaylistModel::decorationIsImmediate()
+{
+    Mlt::Playlist playlist(MLT.profile());
+    fill(playlist, 50);
+    PlaylistModel model;
+    model.setPlaylist(playlist);
+    QCOMPARE(model.rowCount(), 50);
+
+    model.setVisibleRows(0, 9);
+    for (int row = 0; row < model.rowCount(); row++) {
+        QImage image = model.data(model.index(row, PlaylistModel::COLUMN_THUMBNAIL), Qt::DecorationRole).value<QImage>();
+        QVERIFY(!image.isNull());
+        QCOMPARE(image.size(), QSize(PlaylistModel::THUMBNAIL_WIDTH, PlaylistModel::THUMBNAIL_HEIGHT));
+        QVERIFY(!model.data(model.index(row, PlaylistModel::COLUMN_RESOURCE), Qt::DisplayRole).toString().isEmpty());
+    }
+}
+
+//可见行的缩略图在后台生成，回到 GUI线程后 data()能取到
+void TestPlaylistModel::visibleThumbnailsArrive()
+{
+    Mlt::Playlist playlist(MLT.profile());
+    fill(playlist, 100);
+    PlaylistModel model;
+    model.setPlaylist(playlist);
+
+    model.setVisibleRows(40, 49);
+    for (int row = 40; row <= 49; row++)
+        model.data(model.index(row, PlaylistModel::COLUMN_THUMBNAIL), Qt::DecorationRole);
+    for (int row = 40; row <= 49; row++)
+        QTRY_VERIFY_WITH_TIMEOUT(hasThumbnail(model, row), 10000);
+    //没有绘制过的行不生成缩略图
+    QVERIFY(!hasThumbnail(model, 0));
+    QVERIFY(!hasThumbnail(model, 99));
+}
+
+void TestPlaylistModel::scroll_data()
+{
+    QTest::addColumn<int>("rows");
+    QTest::addColumn<int>("visible");
+    QTest::addColumn<int>("step");
+    QTest::newRow("500 rows") << 500 << 20 << 3;
+}
+
+//模拟视图滚动：每一步先告知可见行，再像视图绘制一样取可见行每一列的显示、提示和缩略图数据，
+//两步之间处理事件，让后台的哈希和缩略图结果回到 GUI线程
+void TestPlaylistModel::scroll()
+{
+    QFETCH(int, rows);
+    QFETCH(int, visible);
+    QFETCH(int, step);
+
+    Mlt::Playlist playlist(MLT.profile());
+    fill(playlist, rows);
+    PlaylistModel model;
+    model.setPlaylist(playlist);
+    QCOMPARE(model.rowCount(), rows);
+
+    static const int roles[] = { Qt::DisplayRole, Qt::ToolTipRole, Qt::DecorationRole };
+    QBENCHMARK {
+        for (int first = 0; first + visible <= rows; first += step) {
+            int last = first + visible - 1;
+            model.setVisibleRows(first, last);
+            for (int row = first; row <= last; row++) {
+                for (int column = 0; column < model.columnCount(); column++) {
+                    QModelIndex index = model.index(row, column);
+                    for (int role : roles)
+                        model.data(index, role);
+                }
+            }
+            QCoreApplication::processEvents();
+        }
+    }
+}
+
+QTEST_MAIN(TestPlaylistModel)
+
+#include "tst_playlistmodel.moc"
@@ -0,0 +1,50 @@
+# 单元测试共用的设置：QtTest、CuteLogger、CommonUtil、QmlUtilities、MltController和 MLT
+# 测试程序在 tests/<名字>/ 下，库的输出目录用 $$shadowed()推算，影子构建时也能找到
+
+QT       += testlib widgets xml
+CONFIG   += testcase console link_prl
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+MM_SOURCE_ROOT = $$PWD/..
+MM_BUILD_ROOT = $$shadowed($$PWD/..)
+
+INCLUDEPATH += $$MM_SOURCE_ROOT/CuteLogger/include $$MM_SOURCE_ROOT/CommonUtil
+INCLUDEPATH += $$MM_SOURCE_ROOT/QmlUtilities $$MM_SOURCE_ROOT/MltController
+
+debug_and_release {
+    build_pass:CONFIG(debug, debug|release) {
+        MM_LIB_SUFFIX = /debug
+    } else {
+        MM_LIB_SUFFIX = /release
+    }
+}
+LIBS += -L$$MM_BUILD_ROOT/CuteLogger$$MM_LIB_SUFFIX -L$$MM_BUILD_ROOT/CommonUtil$$MM_LIB_SUFFIX
+LIBS += -L$$MM_BUILD_ROOT/QmlUtilities$$MM_LIB_SUFFIX -L$$MM_BUILD_ROOT/MltController$$MM_LIB_SUFFIX
+LIBS += -lLogger -lCommonUtil -lQmlUtilities -lMltController
+
+mac {
+    isEmpty(MLT_PREFIX) {
+        MLT_PREFIX = $$PWD/../../../../shotcut/mlt_build/
+    }
+    INCLUDEPATH += $$MLT_PREFIX/include/mlt++
+    INCLUDEPATH += $$MLT_PREFIX/include/mlt
+    LIBS += -L$$MLT_PREFIX/lib -lmlt++ -lmlt
+    QMAKE_RPATHDIR += $$MM_BUILD_ROOT/CuteLogger $$MM_BUILD_ROOT/CommonUtil
+    QMAKE_RPATHDIR += $$MM_BUILD_ROOT/QmlUtilities $$MM_BUILD_ROOT/MltController
+}
+
+win32 {
+    isEmpty(MLT_PATH) {
+        MLT_PATH = C:\\Projects\\MovieMator
+    }
+    INCLUDEPATH += $$MLT_PATH\\include\\mlt++ $$MLT_PATH\\include\\mlt
+    LIBS += -L$$MLT_PATH\\lib -lmlt++ -lmlt
+}
+
+unix:!mac {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += mlt++
+    QMAKE_RPATHDIR += $$MM_BUILD_ROOT/CuteLogger $$MM_BUILD_ROOT/CommonUtil
+    QMAKE_RPATHDIR += $$MM_BUILD_ROOT/QmlUtilities $$MM_BUILD_ROOT/MltController
+}
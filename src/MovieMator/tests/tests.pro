@@ -0,0 +1,9 @@
+TEMPLATE = subdirs
+
+# 每个子目录是一个 QtTest 程序，make check 依次运行；没有显示器时用 QT_QPA_PLATFORM=offscreen make check
+SUBDIRS = playlist \
+    mvcp \
+    jobqueue \
+    loudness \
+    exporter \
+    multitrack